@@ -0,0 +1,256 @@
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#include "capture.h"
+#include "logger.h"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+
+// the writer hands bigger chunks to the os
+#define CAPTURE_OUTPUT_BUFFER_SIZE (1 << 20)
+
+
+// bt.601 limited range in 8 bit fixed point, the offsets keep the sums positive before the shift
+static inline void RGBToYUV(const uint8_t red, const uint8_t green, const uint8_t blue, uint8_t yuv[3]) {
+    yuv[0] = (uint8_t)(((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16);
+    yuv[1] = (uint8_t)((-38 * red - 74 * green + 112 * blue + 128 + (128 << 8)) >> 8);
+    yuv[2] = (uint8_t)((112 * red - 94 * green - 18 * blue + 128 + (128 << 8)) >> 8);
+}
+
+static void ConvertPaletteIndices(const struct Capture* capture, const uint16_t* palette_indices, uint8_t* converted) {
+    uint32_t pixel_count = (uint32_t)capture->width * capture->height;
+
+    if (capture->format == CAPTURE_Y4M) {
+        for (uint32_t i = 0; i < pixel_count; i++) {
+            const uint8_t* yuv = capture->palette_yuv[palette_indices[i] % PALETTE_INDEX_COUNT];
+            converted[i] = yuv[0];
+            converted[pixel_count + i] = yuv[1];
+            converted[2 * pixel_count + i] = yuv[2];
+        }
+    } else {
+        for (uint32_t i = 0; i < pixel_count; i++) {
+            memcpy(&converted[i * 3], capture->palette_rgb[palette_indices[i] % PALETTE_INDEX_COUNT], 3);
+        }
+    }
+}
+
+static void ConvertRGBA(const struct Capture* capture, const uint32_t* pixels, uint8_t* converted) {
+    uint32_t pixel_count = (uint32_t)capture->width * capture->height;
+
+    for (uint32_t i = 0; i < pixel_count; i++) {
+        uint8_t red = (pixels[i] >> 24) & 0xFF;
+        uint8_t green = (pixels[i] >> 16) & 0xFF;
+        uint8_t blue = (pixels[i] >> 8) & 0xFF;
+
+        if (capture->format == CAPTURE_Y4M) {
+            uint8_t yuv[3];
+            RGBToYUV(red, green, blue, yuv);
+            converted[i] = yuv[0];
+            converted[pixel_count + i] = yuv[1];
+            converted[2 * pixel_count + i] = yuv[2];
+        } else {
+            converted[i * 3 + 0] = red;
+            converted[i * 3 + 1] = green;
+            converted[i * 3 + 2] = blue;
+        }
+    }
+}
+
+static bool WriteFrame(struct Capture* capture, const struct CaptureSlot* slot) {
+    if (slot->kind == CAPTURE_FRAME_PALETTE_INDICES) {
+        ConvertPaletteIndices(capture, (const uint16_t*)slot->pixels, capture->converted);
+    } else {
+        ConvertRGBA(capture, (const uint32_t*)slot->pixels, capture->converted);
+    }
+
+    size_t size = (size_t)capture->width * capture->height * 3;
+    if ((capture->format == CAPTURE_Y4M && fputs("FRAME\n", capture->output) < 0)
+        || fwrite(capture->converted, 1, size, capture->output) != size) {
+        // eg. the piped command exited (EPIPE, SIGPIPE is ignored), the emulator keeps running and the rest of the frames are dropped
+        LOG(WARNING, CAPTURE, "failed to write frame %u, capture stopped\n", capture->frames_written);
+        return false;
+    }
+    capture->frames_written++;
+    return true;
+}
+
+static int Writer(void* data) {
+    struct Capture* capture = (struct Capture*)data;
+
+    mtx_lock(&capture->mutex);
+    while (true) {
+        while (capture->queued == 0 && !capture->stop) {
+            cnd_wait(&capture->frame_queued, &capture->mutex);
+        }
+        if (capture->queued == 0) {
+            break;
+        }
+        const struct CaptureSlot* slot = &capture->slots[capture->read_index];
+        mtx_unlock(&capture->mutex);
+
+        // only the writer sets write_failed, the producer reads it under the lock
+        bool written = !capture->write_failed && WriteFrame(capture, slot);
+
+        mtx_lock(&capture->mutex);
+        capture->write_failed = !written;
+        capture->read_index = (capture->read_index + 1) % CAPTURE_QUEUE_LENGTH;
+        capture->queued--;
+    }
+    mtx_unlock(&capture->mutex);
+
+    return 0;
+}
+
+// hands out the next free slot or NULL (and counts the frame as dropped) when the writer is too far behind
+static struct CaptureSlot* ReserveSlot(struct Capture* capture) {
+    mtx_lock(&capture->mutex);
+    capture->frames_pushed++;
+    struct CaptureSlot* slot = NULL;
+    if (capture->queued < CAPTURE_QUEUE_LENGTH && !capture->write_failed) {
+        slot = &capture->slots[capture->write_index];
+    } else {
+        capture->frames_dropped++;
+    }
+    mtx_unlock(&capture->mutex);
+    return slot;
+}
+
+static void QueueSlot(struct Capture* capture) {
+    mtx_lock(&capture->mutex);
+    capture->write_index = (capture->write_index + 1) % CAPTURE_QUEUE_LENGTH;
+    capture->queued++;
+    if (capture->queued > capture->max_queued) {
+        capture->max_queued = capture->queued;
+    }
+    cnd_signal(&capture->frame_queued);
+    mtx_unlock(&capture->mutex);
+}
+
+
+void CaptureStart(
+    struct Capture* capture, const char* target, const enum CaptureFormat format, const struct Palette* palette,
+    const uint16_t width, const uint16_t height, const float frames_per_second
+) {
+    capture->pipe = (target[0] == CAPTURE_PIPE_PREFIX);
+#ifndef _WIN32
+    // a write into a pipe whose reader exited would kill the whole emulator with SIGPIPE, 
+    // ignored the write fails with EPIPE instead and only the capture stops
+    if (capture->pipe) {
+        signal(SIGPIPE, SIG_IGN);
+    }
+#endif
+    capture->output = capture->pipe ? popen(&target[1], "w") : fopen(target, "wb");
+    if (capture->output == NULL) {
+        LOG(ERROR, CAPTURE, "failed to open %s\n", target);
+    }
+    setvbuf(capture->output, NULL, _IOFBF, CAPTURE_OUTPUT_BUFFER_SIZE);
+
+    capture->format = format;
+    capture->width = width;
+    capture->height = height;
+
+    for (uint16_t palette_index = 0; palette_index < PALETTE_INDEX_COUNT; palette_index++) {
+        uint32_t rgba = palette->colors_rgba[palette_index];
+        capture->palette_rgb[palette_index][0] = (rgba >> 24) & 0xFF;
+        capture->palette_rgb[palette_index][1] = (rgba >> 16) & 0xFF;
+        capture->palette_rgb[palette_index][2] = (rgba >> 8) & 0xFF;
+        RGBToYUV(
+            capture->palette_rgb[palette_index][0], capture->palette_rgb[palette_index][1], capture->palette_rgb[palette_index][2],
+            capture->palette_yuv[palette_index]
+        );
+    }
+
+    size_t pixel_count = (size_t)width * height;
+    for (uint8_t i = 0; i < CAPTURE_QUEUE_LENGTH; i++) {
+        capture->slots[i].kind = CAPTURE_FRAME_PALETTE_INDICES;
+        capture->slots[i].pixels = (uint8_t*)malloc(pixel_count * sizeof(uint32_t));
+        if (capture->slots[i].pixels == NULL) {
+            LOG(ERROR, CAPTURE, "failed to allocate the frame queue\n");
+        }
+    }
+    capture->converted = (uint8_t*)malloc(pixel_count * 3);
+    if (capture->converted == NULL) {
+        LOG(ERROR, CAPTURE, "failed to allocate the conversion buffer\n");
+    }
+
+    capture->read_index = 0;
+    capture->write_index = 0;
+    capture->queued = 0;
+    capture->stop = false;
+    capture->write_failed = false;
+
+    capture->frames_pushed = 0;
+    capture->frames_written = 0;
+    capture->frames_dropped = 0;
+    capture->max_queued = 0;
+
+    if (format == CAPTURE_Y4M) {
+        // the rate as a fraction in thousandths, 60.0988 fps on NTSC
+        fprintf(capture->output, "YUV4MPEG2 W%u H%u F%u:1000 Ip A1:1 C444 XCOLORRANGE=LIMITED\n", width, height, (uint32_t)(frames_per_second * 1000.0f + 0.5f));
+    }
+
+    if (mtx_init(&capture->mutex, mtx_plain) != thrd_success || cnd_init(&capture->frame_queued) != thrd_success) {
+        LOG(ERROR, CAPTURE, "failed to create the writer synchronization\n");
+    }
+    if (thrd_create(&capture->writer, &Writer, capture) != thrd_success) {
+        LOG(ERROR, CAPTURE, "failed to start the writer thread\n");
+    }
+
+    LOG(INFO, CAPTURE, "capturing %ux%u %s frames into %s\n", width, height, (format == CAPTURE_Y4M) ? "y4m" : "rgb24", target);
+}
+
+void CaptureStop(struct Capture* capture) {
+    mtx_lock(&capture->mutex);
+    capture->stop = true;
+    cnd_signal(&capture->frame_queued);
+    mtx_unlock(&capture->mutex);
+
+    thrd_join(capture->writer, NULL);
+
+    cnd_destroy(&capture->frame_queued);
+    mtx_destroy(&capture->mutex);
+
+    if (capture->pipe) {
+        pclose(capture->output);
+    } else {
+        fclose(capture->output);
+    }
+    capture->output = NULL;
+
+    for (uint8_t i = 0; i < CAPTURE_QUEUE_LENGTH; i++) {
+        free(capture->slots[i].pixels);
+        capture->slots[i].pixels = NULL;
+    }
+    free(capture->converted);
+    capture->converted = NULL;
+
+    LOG(
+        INFO, CAPTURE, "%u frames written, %u of %u dropped (writer behind), at most %u of %u queued\n",
+        capture->frames_written, capture->frames_dropped, capture->frames_pushed, capture->max_queued, CAPTURE_QUEUE_LENGTH
+    );
+}
+
+void CapturePushPaletteIndices(struct Capture* capture, const uint16_t* palette_indices) {
+    struct CaptureSlot* slot = ReserveSlot(capture);
+    if (slot == NULL) {
+        return;
+    }
+    slot->kind = CAPTURE_FRAME_PALETTE_INDICES;
+    memcpy(slot->pixels, palette_indices, (size_t)capture->width * capture->height * sizeof(uint16_t));
+    QueueSlot(capture);
+}
+
+void CapturePushRGBA(struct Capture* capture, const uint32_t* pixels) {
+    struct CaptureSlot* slot = ReserveSlot(capture);
+    if (slot == NULL) {
+        return;
+    }
+    slot->kind = CAPTURE_FRAME_RGBA;
+    memcpy(slot->pixels, pixels, (size_t)capture->width * capture->height * sizeof(uint32_t));
+    QueueSlot(capture);
+}
\ No newline at end of file
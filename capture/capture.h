@@ -0,0 +1,81 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <threads.h>
+
+#include "palette.h"
+
+
+// frames waiting for the writer, when it falls further behind the new ones are dropped
+#define CAPTURE_QUEUE_LENGTH 16
+
+// a target starting with this is a command the frames are piped into (eg. "|ffmpeg -i - out.mp4")
+#define CAPTURE_PIPE_PREFIX '|'
+
+
+enum CaptureFormat {
+    CAPTURE_Y4M,    // yuv 4:4:4 (bt.601 limited range), ffmpeg reads the size and rate from the header
+    CAPTURE_RGB,    // raw rgb24, needs -f rawvideo -pix_fmt rgb24 -s WxH -r fps
+};
+
+enum CaptureFrameKind {
+    CAPTURE_FRAME_PALETTE_INDICES,
+    CAPTURE_FRAME_RGBA,
+};
+
+struct CaptureSlot {
+    enum CaptureFrameKind kind;
+    // big enough for an rgba frame
+    uint8_t* pixels;
+};
+
+struct Capture {
+    FILE* output;
+    bool pipe;
+    enum CaptureFormat format;
+    uint16_t width;
+    uint16_t height;
+
+    // converted once at the start, so the writer only looks up the palette indices
+    uint8_t palette_rgb[PALETTE_INDEX_COUNT][3];
+    uint8_t palette_yuv[PALETTE_INDEX_COUNT][3];
+
+    // ring of frames from the emulation thread (producer) to the writer thread (consumer),
+    // a slot is filled outside of the lock since neither side touches the slots the other one owns
+    struct CaptureSlot slots[CAPTURE_QUEUE_LENGTH];
+    uint8_t read_index;     // writer only
+    uint8_t write_index;    // producer only
+    uint8_t queued;
+
+    // one converted frame (3 planes or packed rgb) for a single fwrite
+    uint8_t* converted;
+
+    thrd_t writer;
+    mtx_t mutex;
+    cnd_t frame_queued;
+    bool stop;
+    bool write_failed;
+
+    uint32_t frames_pushed;
+    uint32_t frames_written;
+    uint32_t frames_dropped;
+    uint8_t max_queued;
+};
+
+
+// the target is a file or CAPTURE_PIPE_PREFIX followed by a command, the palette converts the palette index frames
+void CaptureStart(
+    struct Capture* capture, const char* target, const enum CaptureFormat format, const struct Palette* palette,
+    const uint16_t width, const uint16_t height, const float frames_per_second
+);
+// writes the queued frames, closes the output and logs the statistics
+void CaptureStop(struct Capture* capture);
+
+// only a copy into the queue, the conversion and the writing happen on the writer thread
+void CapturePushPaletteIndices(struct Capture* capture, const uint16_t* palette_indices);
+void CapturePushRGBA(struct Capture* capture, const uint32_t* pixels);
+
+#endif
\ No newline at end of file
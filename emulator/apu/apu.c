@@ -0,0 +1,746 @@
+#include "apu.h"
+#include "logger.h"
+
+
+static const uint8_t length_counter_table[32] = {
+    10, 254, 20, 2, 40, 4, 80, 6, 160, 8, 60, 10, 14, 12, 26, 14,
+    12, 16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30,
+};
+
+static const uint8_t duty_sequences[4][8] = {
+    { 0, 1, 0, 0, 0, 0, 0, 0 },
+    { 0, 1, 1, 0, 0, 0, 0, 0 },
+    { 0, 1, 1, 1, 1, 0, 0, 0 },
+    { 1, 0, 0, 1, 1, 1, 1, 1 },
+};
+
+static const uint8_t triangle_sequence[32] = {
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+};
+
+// in cpu cycles
+static const uint16_t ntsc_noise_periods[16] = { 4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068 };
+static const uint16_t pal_noise_periods[16] = { 4, 8, 14, 30, 60, 88, 118, 148, 188, 236, 354, 472, 708, 944, 1890, 3778 };
+
+static const uint16_t ntsc_dmc_periods[16] = { 428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54 };
+static const uint16_t pal_dmc_periods[16] = { 398, 354, 316, 298, 276, 236, 210, 198, 176, 148, 132, 118, 98, 78, 66, 50 };
+
+// 4 step mode, 5 step mode
+static const struct APUFrameCounterSequence ntsc_frame_counter_sequences[2] = {
+    {
+        .step_count = 4,
+        .step_cycles = { 7457, 14913, 22371, 29829, 29830 },
+        .quarter_frame = { true, true, true, true },
+        .half_frame = { false, true, false, true },
+        .interrupt = { false, false, false, true },
+    },
+    {
+        .step_count = 5,
+        .step_cycles = { 7457, 14913, 22371, 29829, 37281, 37282 },
+        .quarter_frame = { true, true, true, false, true },
+        .half_frame = { false, true, false, false, true },
+        .interrupt = { false, false, false, false, false },
+    },
+};
+
+static const struct APUFrameCounterSequence pal_frame_counter_sequences[2] = {
+    {
+        .step_count = 4,
+        .step_cycles = { 8313, 16627, 24939, 33253, 33254 },
+        .quarter_frame = { true, true, true, true },
+        .half_frame = { false, true, false, true },
+        .interrupt = { false, false, false, true },
+    },
+    {
+        .step_count = 5,
+        .step_cycles = { 8313, 16627, 24939, 33253, 41565, 41566 },
+        .quarter_frame = { true, true, true, false, true },
+        .half_frame = { false, true, false, false, true },
+        .interrupt = { false, false, false, false, false },
+    },
+};
+
+
+static inline uint8_t EnvelopeVolume(const struct APUEnvelope* envelope) {
+    return envelope->constant_volume ? envelope->period : envelope->decay_level;
+}
+
+static inline int32_t SweepTarget(const struct APUPulse* pulse) {
+    int32_t change = pulse->timer_period >> pulse->sweep_shift;
+    if (pulse->sweep_negate) {
+        return (int32_t)pulse->timer_period - change - pulse->sweep_negate_offset;
+    }
+    return (int32_t)pulse->timer_period + change;
+}
+
+static inline bool PulseMuted(const struct APUPulse* pulse) {
+    return pulse->timer_period < 8 || SweepTarget(pulse) > 0x7FF;
+}
+
+
+static inline void UpdatePulseOutput(struct APUPulse* pulse) {
+    bool active = pulse->length_counter != 0 && !PulseMuted(pulse) && duty_sequences[pulse->duty][pulse->sequence_step];
+    pulse->output = active ? EnvelopeVolume(&pulse->envelope) : 0;
+}
+
+static inline void UpdateTriangleOutput(struct APUTriangle* triangle) {
+    // a halted triangle keeps its last level
+    triangle->output = triangle_sequence[triangle->sequence_step];
+}
+
+static inline void UpdateNoiseOutput(struct APUNoise* noise) {
+    bool active = noise->length_counter != 0 && !(noise->shift_register & 0x0001);
+    noise->output = active ? EnvelopeVolume(&noise->envelope) : 0;
+}
+
+static inline void UpdateMix(struct APU* apu) {
+    float output = apu->pulse_mix[apu->pulse_1.output + apu->pulse_2.output]
+        + apu->tnd_mix[3 * apu->triangle.output + 2 * apu->noise.output + apu->dmc.output];
+
+    float delta = output - apu->mix_output;
+    if (delta != 0.0f) {
+        BlipAddDelta(&apu->blip, (uint32_t)(apu->cycle - apu->frame_start_cycle), delta);
+        apu->mix_output = output;
+    }
+}
+
+
+// a channel is only scheduled while stepping it can change the output, everything else freezes it until a register write
+// or the frame counter changes its state (the phase of a silent channel doesn't matter)
+static void Reschedule(struct APU* apu) {
+    struct APUPulse* pulses[2] = { &apu->pulse_1, &apu->pulse_2 };
+    for (uint8_t i = 0; i < 2; i++) {
+        struct APUPulse* pulse = pulses[i];
+        bool audible = pulse->length_counter != 0 && !PulseMuted(pulse) && EnvelopeVolume(&pulse->envelope) != 0;
+        if (!audible) {
+            pulse->next_step_cycle = APU_NO_EVENT;
+        } else if (pulse->next_step_cycle == APU_NO_EVENT) {
+            pulse->next_step_cycle = apu->cycle + (pulse->timer_period + 1) * 2;
+        }
+    }
+
+    // periods below 2 are ultrasonic, the triangle just stays where it is
+    struct APUTriangle* triangle = &apu->triangle;
+    bool triangle_running = triangle->length_counter != 0 && triangle->linear_counter != 0 && triangle->timer_period >= 2;
+    if (!triangle_running) {
+        triangle->next_step_cycle = APU_NO_EVENT;
+    } else if (triangle->next_step_cycle == APU_NO_EVENT) {
+        triangle->next_step_cycle = apu->cycle + triangle->timer_period + 1;
+    }
+
+    struct APUNoise* noise = &apu->noise;
+    bool noise_audible = noise->length_counter != 0 && EnvelopeVolume(&noise->envelope) != 0;
+    if (!noise_audible) {
+        noise->next_step_cycle = APU_NO_EVENT;
+    } else if (noise->next_step_cycle == APU_NO_EVENT) {
+        noise->next_step_cycle = apu->cycle + noise->timer_period;
+    }
+
+    struct APUDMC* dmc = &apu->dmc;
+    bool dmc_running = !dmc->silence || dmc->sample_buffer_full || dmc->bytes_remaining != 0;
+    if (!dmc_running) {
+        dmc->next_step_cycle = APU_NO_EVENT;
+    } else if (dmc->next_step_cycle == APU_NO_EVENT) {
+        dmc->next_step_cycle = apu->cycle + dmc->timer_period;
+    }
+}
+
+// after register writes and frame counter clocks, anything could have changed
+static void UpdateChannels(struct APU* apu) {
+    UpdatePulseOutput(&apu->pulse_1);
+    UpdatePulseOutput(&apu->pulse_2);
+    UpdateTriangleOutput(&apu->triangle);
+    UpdateNoiseOutput(&apu->noise);
+    Reschedule(apu);
+    UpdateMix(apu);
+}
+
+static inline void UpdateIrq(struct APU* apu) {
+    apu->irq = apu->frame_interrupt || apu->dmc_interrupt;
+}
+
+
+static void RestartDMCSample(struct APUDMC* dmc) {
+    dmc->current_address = dmc->sample_address;
+    dmc->bytes_remaining = dmc->sample_length;
+}
+
+static void FetchDMCSample(struct APU* apu) {
+    struct APUDMC* dmc = &apu->dmc;
+    if (dmc->sample_buffer_full || dmc->bytes_remaining == 0) {
+        return;
+    }
+
+    dmc->sample_buffer = apu->DMCRead(apu->dmc_read_data, dmc->current_address);
+    dmc->sample_buffer_full = true;
+    apu->cpu_stall_cycles += APU_DMC_STALL_CYCLES;
+
+    dmc->current_address = (dmc->current_address == 0xFFFF) ? 0x8000 : dmc->current_address + 1;
+    dmc->bytes_remaining--;
+
+    if (dmc->bytes_remaining == 0) {
+        if (dmc->loop) {
+            RestartDMCSample(dmc);
+        } else if (dmc->irq_enabled) {
+            apu->dmc_interrupt = true;
+            UpdateIrq(apu);
+        }
+    }
+}
+
+
+static inline void StepPulse(struct APUPulse* pulse) {
+    pulse->sequence_step = (pulse->sequence_step - 1) & 0x07;
+    UpdatePulseOutput(pulse);
+    pulse->next_step_cycle += (pulse->timer_period + 1) * 2;
+}
+
+static inline void StepTriangle(struct APUTriangle* triangle) {
+    triangle->sequence_step = (triangle->sequence_step + 1) & 0x1F;
+    UpdateTriangleOutput(triangle);
+    triangle->next_step_cycle += triangle->timer_period + 1;
+}
+
+static inline void StepNoise(struct APUNoise* noise) {
+    uint16_t feedback = (noise->shift_register ^ (noise->shift_register >> (noise->mode ? 6 : 1))) & 0x0001;
+    noise->shift_register = (noise->shift_register >> 1) | (feedback << 14);
+    UpdateNoiseOutput(noise);
+    noise->next_step_cycle += noise->timer_period;
+}
+
+static inline void StepDMC(struct APU* apu) {
+    struct APUDMC* dmc = &apu->dmc;
+    if (!dmc->silence) {
+        if (dmc->shift_register & 0x01) {
+            if (dmc->output <= 125) {
+                dmc->output += 2;
+            }
+        } else if (dmc->output >= 2) {
+            dmc->output -= 2;
+        }
+    }
+    dmc->shift_register >>= 1;
+
+    dmc->bits_remaining--;
+    if (dmc->bits_remaining == 0) {
+        // new output cycle, the buffer is emptied into the shift register and refilled right away
+        dmc->bits_remaining = 8;
+        dmc->silence = !dmc->sample_buffer_full;
+        if (dmc->sample_buffer_full) {
+            dmc->shift_register = dmc->sample_buffer;
+            dmc->sample_buffer_full = false;
+            FetchDMCSample(apu);
+        }
+    }
+
+    dmc->next_step_cycle += dmc->timer_period;
+    if (dmc->silence && !dmc->sample_buffer_full && dmc->bytes_remaining == 0) {
+        dmc->next_step_cycle = APU_NO_EVENT;
+    }
+}
+
+// steps the channel timers up to and including end, always the earliest step first so the mixed output changes in order
+static void RunChannels(struct APU* apu, const uint64_t end) {
+    while (true) {
+        uint64_t next = apu->pulse_1.next_step_cycle;
+        next = (apu->pulse_2.next_step_cycle < next) ? apu->pulse_2.next_step_cycle : next;
+        next = (apu->triangle.next_step_cycle < next) ? apu->triangle.next_step_cycle : next;
+        next = (apu->noise.next_step_cycle < next) ? apu->noise.next_step_cycle : next;
+        next = (apu->dmc.next_step_cycle < next) ? apu->dmc.next_step_cycle : next;
+        if (next > end) {
+            break;
+        }
+
+        apu->cycle = next;
+        if (apu->pulse_1.next_step_cycle == next) {
+            StepPulse(&apu->pulse_1);
+        }
+        if (apu->pulse_2.next_step_cycle == next) {
+            StepPulse(&apu->pulse_2);
+        }
+        if (apu->triangle.next_step_cycle == next) {
+            StepTriangle(&apu->triangle);
+        }
+        if (apu->noise.next_step_cycle == next) {
+            StepNoise(&apu->noise);
+        }
+        if (apu->dmc.next_step_cycle == next) {
+            StepDMC(apu);
+        }
+        UpdateMix(apu);
+    }
+    apu->cycle = end;
+}
+
+
+static void ClockEnvelope(struct APUEnvelope* envelope) {
+    if (envelope->start) {
+        envelope->start = false;
+        envelope->decay_level = 15;
+        envelope->divider = envelope->period;
+    } else if (envelope->divider == 0) {
+        envelope->divider = envelope->period;
+        if (envelope->decay_level != 0) {
+            envelope->decay_level--;
+        } else if (envelope->loop) {
+            envelope->decay_level = 15;
+        }
+    } else {
+        envelope->divider--;
+    }
+}
+
+static void ClockSweep(struct APUPulse* pulse) {
+    if (pulse->sweep_divider == 0 && pulse->sweep_enabled && pulse->sweep_shift != 0 && !PulseMuted(pulse)) {
+        pulse->timer_period = (uint16_t)SweepTarget(pulse);
+    }
+    if (pulse->sweep_divider == 0 || pulse->sweep_reload) {
+        pulse->sweep_divider = pulse->sweep_period;
+        pulse->sweep_reload = false;
+    } else {
+        pulse->sweep_divider--;
+    }
+}
+
+static inline void ClockLengthCounter(uint8_t* length_counter, const bool halt) {
+    if (!halt && *length_counter != 0) {
+        (*length_counter)--;
+    }
+}
+
+static void ClockQuarterFrame(struct APU* apu) {
+    ClockEnvelope(&apu->pulse_1.envelope);
+    ClockEnvelope(&apu->pulse_2.envelope);
+    ClockEnvelope(&apu->noise.envelope);
+
+    struct APUTriangle* triangle = &apu->triangle;
+    if (triangle->linear_counter_reload) {
+        triangle->linear_counter = triangle->linear_counter_period;
+    } else if (triangle->linear_counter != 0) {
+        triangle->linear_counter--;
+    }
+    if (!triangle->control) {
+        triangle->linear_counter_reload = false;
+    }
+}
+
+static void ClockHalfFrame(struct APU* apu) {
+    ClockLengthCounter(&apu->pulse_1.length_counter, apu->pulse_1.envelope.loop);
+    ClockLengthCounter(&apu->pulse_2.length_counter, apu->pulse_2.envelope.loop);
+    ClockLengthCounter(&apu->triangle.length_counter, apu->triangle.control);
+    ClockLengthCounter(&apu->noise.length_counter, apu->noise.envelope.loop);
+
+    ClockSweep(&apu->pulse_1);
+    ClockSweep(&apu->pulse_2);
+}
+
+static inline uint64_t FrameCounterNextCycle(const struct APU* apu) {
+    return apu->frame_counter_start_cycle + apu->frame_counter_sequence->step_cycles[apu->frame_counter_step];
+}
+
+static void ClockFrameCounter(struct APU* apu) {
+    const struct APUFrameCounterSequence* sequence = apu->frame_counter_sequence;
+    uint8_t step = apu->frame_counter_step;
+
+    if (step == sequence->step_count) {
+        apu->frame_counter_start_cycle += sequence->step_cycles[step];
+        apu->frame_counter_step = 0;
+        return;
+    }
+
+    if (sequence->quarter_frame[step]) {
+        ClockQuarterFrame(apu);
+    }
+    if (sequence->half_frame[step]) {
+        ClockHalfFrame(apu);
+    }
+    if (sequence->interrupt[step] && !apu->irq_inhibit) {
+        apu->frame_interrupt = true;
+        UpdateIrq(apu);
+    }
+    apu->frame_counter_step++;
+
+    UpdateChannels(apu);
+}
+
+// emulates everything up to and including the target cycle
+static void RunTo(struct APU* apu, const uint64_t target) {
+    while (true) {
+        uint64_t frame_counter_cycle = FrameCounterNextCycle(apu);
+        if (frame_counter_cycle > target) {
+            break;
+        }
+        RunChannels(apu, frame_counter_cycle);
+        ClockFrameCounter(apu);
+    }
+    RunChannels(apu, target);
+}
+
+static void UpdateNextEvent(struct APU* apu) {
+    if (apu->cpu_stall_cycles != 0) {
+        apu->next_event_cycle = 0;
+        return;
+    }
+
+    apu->next_event_cycle = FrameCounterNextCycle(apu);
+
+    struct APUDMC* dmc = &apu->dmc;
+    if (dmc->bytes_remaining != 0 && dmc->next_step_cycle != APU_NO_EVENT) {
+        // the step that empties the shift register also fetches the next byte
+        uint64_t fetch_cycle = dmc->next_step_cycle + (uint64_t)(dmc->bits_remaining - 1) * dmc->timer_period;
+        apu->next_event_cycle = (fetch_cycle < apu->next_event_cycle) ? fetch_cycle : apu->next_event_cycle;
+    }
+}
+
+
+static void RestartFrameCounter(struct APU* apu) {
+    apu->frame_counter_sequence = &apu->frame_counter_sequences[apu->five_step_mode ? 1 : 0];
+    apu->frame_counter_step = 0;
+    // the write takes effect 3 or 4 cycles later depending on the cpu cycle parity
+    apu->frame_counter_start_cycle = apu->cycle + ((apu->cycle & 1) ? 4 : 3);
+
+    if (apu->five_step_mode) {
+        ClockQuarterFrame(apu);
+        ClockHalfFrame(apu);
+    }
+}
+
+static void InitMixer(struct APU* apu) {
+    apu->pulse_mix[0] = 0.0f;
+    for (uint32_t i = 1; i < 31; i++) {
+        apu->pulse_mix[i] = 95.52f / (8128.0f / (float)i + 100.0f);
+    }
+    apu->tnd_mix[0] = 0.0f;
+    for (uint32_t i = 1; i < 203; i++) {
+        apu->tnd_mix[i] = 163.67f / (24329.0f / (float)i + 100.0f);
+    }
+    apu->mix_output = 0.0f;
+}
+
+static void InitChannels(struct APU* apu) {
+    struct APUPulse* pulses[2] = { &apu->pulse_1, &apu->pulse_2 };
+    for (uint8_t i = 0; i < 2; i++) {
+        struct APUPulse* pulse = pulses[i];
+        pulse->envelope = (struct APUEnvelope){ 0 };
+        pulse->duty = 0;
+        pulse->sequence_step = 0;
+        pulse->timer_period = 0;
+        pulse->length_counter = 0;
+        pulse->sweep_enabled = false;
+        pulse->sweep_negate = false;
+        pulse->sweep_reload = false;
+        pulse->sweep_period = 0;
+        pulse->sweep_shift = 0;
+        pulse->sweep_divider = 0;
+        pulse->output = 0;
+        pulse->next_step_cycle = APU_NO_EVENT;
+    }
+    apu->pulse_1.sweep_negate_offset = 1;
+    apu->pulse_2.sweep_negate_offset = 0;
+
+    apu->triangle = (struct APUTriangle){ 0 };
+    apu->triangle.next_step_cycle = APU_NO_EVENT;
+
+    apu->noise = (struct APUNoise){ 0 };
+    apu->noise.timer_period = apu->noise_periods[0];
+    apu->noise.shift_register = 1;
+    apu->noise.next_step_cycle = APU_NO_EVENT;
+
+    apu->dmc = (struct APUDMC){ 0 };
+    apu->dmc.timer_period = apu->dmc_periods[0];
+    apu->dmc.bits_remaining = 8;
+    apu->dmc.silence = true;
+    apu->dmc.next_step_cycle = APU_NO_EVENT;
+}
+
+
+void APUInit(struct APU* apu, const enum TVSystem tv_system, const uint64_t* cpu_tick_counter, uint8_t (*DMCRead)(void*, const uint16_t), void* dmc_read_data) {
+    apu->cpu_tick_counter = cpu_tick_counter;
+    apu->DMCRead = DMCRead;
+    apu->dmc_read_data = dmc_read_data;
+
+    apu->cycle = *cpu_tick_counter;
+    apu->frame_start_cycle = apu->cycle;
+    apu->cpu_stall_cycles = 0;
+
+    // same as writing 0 to $4017 right before power on
+    apu->five_step_mode = false;
+    apu->irq_inhibit = false;
+
+    APUSetTVSystem(apu, tv_system);
+
+    InitMixer(apu);
+    InitChannels(apu);
+    apu->enabled_channels = 0;
+
+    apu->frame_interrupt = false;
+    apu->dmc_interrupt = false;
+    apu->irq = false;
+
+    RestartFrameCounter(apu);
+
+    AudioRingInit(&apu->ring);
+    apu->rate_control = false;
+
+    UpdateNextEvent(apu);
+}
+
+void APUReset(struct APU* apu) {
+    RunTo(apu, *apu->cpu_tick_counter);
+
+    // same as writing 0 to $4015, the frame counter mode stays
+    apu->enabled_channels = 0;
+    apu->pulse_1.length_counter = 0;
+    apu->pulse_2.length_counter = 0;
+    apu->triangle.length_counter = 0;
+    apu->noise.length_counter = 0;
+    apu->dmc.bytes_remaining = 0;
+
+    apu->frame_interrupt = false;
+    apu->dmc_interrupt = false;
+    UpdateIrq(apu);
+
+    RestartFrameCounter(apu);
+    UpdateChannels(apu);
+    UpdateNextEvent(apu);
+}
+
+void APUSetTVSystem(struct APU* apu, const enum TVSystem tv_system) {
+    apu->tv_system = tv_system;
+
+    double clock_rate = NTSC_CPU_CLOCK_RATE;
+    switch (tv_system) {
+        case NTSC:
+            apu->noise_periods = ntsc_noise_periods;
+            apu->dmc_periods = ntsc_dmc_periods;
+            apu->frame_counter_sequences = ntsc_frame_counter_sequences;
+            clock_rate = NTSC_CPU_CLOCK_RATE;
+            break;
+        case PAL:
+            apu->noise_periods = pal_noise_periods;
+            apu->dmc_periods = pal_dmc_periods;
+            apu->frame_counter_sequences = pal_frame_counter_sequences;
+            clock_rate = PAL_CPU_CLOCK_RATE;
+            break;
+        case DENDY:
+            // the Dendy apu runs the NTSC tables at its own clock rate
+            apu->noise_periods = ntsc_noise_periods;
+            apu->dmc_periods = ntsc_dmc_periods;
+            apu->frame_counter_sequences = ntsc_frame_counter_sequences;
+            clock_rate = DENDY_CPU_CLOCK_RATE;
+            break;
+    }
+
+    apu->frame_counter_sequence = &apu->frame_counter_sequences[apu->five_step_mode ? 1 : 0];
+
+    apu->clock_rate = clock_rate;
+    BlipInit(&apu->blip, clock_rate, APU_SAMPLE_RATE);
+    apu->frame_start_cycle = apu->cycle;
+    apu->mix_output = 0.0f;
+}
+
+
+static void WriteEnvelope(struct APUEnvelope* envelope, const uint8_t data) {
+    envelope->loop = (data & 0x20) != 0;
+    envelope->constant_volume = (data & 0x10) != 0;
+    envelope->period = data & 0x0F;
+}
+
+static void WritePulse(struct APU* apu, struct APUPulse* pulse, const uint8_t enabled_bit, const uint8_t reg, const uint8_t data) {
+    switch (reg) {
+        case 0:
+            pulse->duty = data >> 6;
+            WriteEnvelope(&pulse->envelope, data);
+            break;
+        case 1:
+            pulse->sweep_enabled = (data & 0x80) != 0;
+            pulse->sweep_period = (data >> 4) & 0x07;
+            pulse->sweep_negate = (data & 0x08) != 0;
+            pulse->sweep_shift = data & 0x07;
+            pulse->sweep_reload = true;
+            break;
+        case 2:
+            pulse->timer_period = (pulse->timer_period & 0x0700) | data;
+            break;
+        case 3:
+            pulse->timer_period = (pulse->timer_period & 0x00FF) | ((uint16_t)(data & 0x07) << 8);
+            if (apu->enabled_channels & enabled_bit) {
+                pulse->length_counter = length_counter_table[data >> 3];
+            }
+            pulse->sequence_step = 0;
+            pulse->envelope.start = true;
+            break;
+    }
+}
+
+void APUWrite(struct APU* apu, const uint16_t address, const uint8_t data) {
+    RunTo(apu, *apu->cpu_tick_counter);
+
+    switch (address) {
+        case APU_PULSE_1_CTRL:
+        case APU_PULSE_1_SWEEP:
+        case APU_PULSE_1_LOW_BYTE:
+        case APU_PULSE_1_HIGH_BYTE:
+            WritePulse(apu, &apu->pulse_1, APU_PULSE_1_BIT, address & 0x03, data);
+            break;
+        case APU_PULSE_2_CTRL:
+        case APU_PULSE_2_SWEEP:
+        case APU_PULSE_2_LOW_BYTE:
+        case APU_PULSE_2_HIGH_BYTE:
+            WritePulse(apu, &apu->pulse_2, APU_PULSE_2_BIT, address & 0x03, data);
+            break;
+
+        case APU_TRIANGLE_CTRL:
+            apu->triangle.control = (data & 0x80) != 0;
+            apu->triangle.linear_counter_period = data & 0x7F;
+            break;
+        case APU_TRIANGLE_LOW_BYTE:
+            apu->triangle.timer_period = (apu->triangle.timer_period & 0x0700) | data;
+            break;
+        case APU_TRIANGLE_HIGH_BYTE:
+            apu->triangle.timer_period = (apu->triangle.timer_period & 0x00FF) | ((uint16_t)(data & 0x07) << 8);
+            if (apu->enabled_channels & APU_TRIANGLE_BIT) {
+                apu->triangle.length_counter = length_counter_table[data >> 3];
+            }
+            apu->triangle.linear_counter_reload = true;
+            break;
+
+        case APU_NOISE_CTRL:
+            WriteEnvelope(&apu->noise.envelope, data);
+            break;
+        case APU_NOISE_LOW_BYTE:
+            apu->noise.mode = (data & 0x80) != 0;
+            apu->noise.timer_period = apu->noise_periods[data & 0x0F];
+            break;
+        case APU_NOISE_HIGH_BYTE:
+            if (apu->enabled_channels & APU_NOISE_BIT) {
+                apu->noise.length_counter = length_counter_table[data >> 3];
+            }
+            apu->noise.envelope.start = true;
+            break;
+
+        case APU_DMC_CTRL:
+            apu->dmc.irq_enabled = (data & 0x80) != 0;
+            apu->dmc.loop = (data & 0x40) != 0;
+            apu->dmc.timer_period = apu->dmc_periods[data & 0x0F];
+            if (!apu->dmc.irq_enabled) {
+                apu->dmc_interrupt = false;
+                UpdateIrq(apu);
+            }
+            break;
+        case APU_DMC_DIRECT_LOAD:
+            apu->dmc.output = data & 0x7F;
+            break;
+        case APU_DMC_ADDRESS:
+            apu->dmc.sample_address = 0xC000 | ((uint16_t)data << 6);
+            break;
+        case APU_DMC_LENGTH:
+            apu->dmc.sample_length = ((uint16_t)data << 4) | 0x0001;
+            break;
+
+        case APU_CTRL:
+            apu->enabled_channels = data & (APU_PULSE_1_BIT | APU_PULSE_2_BIT | APU_TRIANGLE_BIT | APU_NOISE_BIT | APU_DMC_BIT);
+            if (!(data & APU_PULSE_1_BIT)) {
+                apu->pulse_1.length_counter = 0;
+            }
+            if (!(data & APU_PULSE_2_BIT)) {
+                apu->pulse_2.length_counter = 0;
+            }
+            if (!(data & APU_TRIANGLE_BIT)) {
+                apu->triangle.length_counter = 0;
+            }
+            if (!(data & APU_NOISE_BIT)) {
+                apu->noise.length_counter = 0;
+            }
+
+            if (!(data & APU_DMC_BIT)) {
+                apu->dmc.bytes_remaining = 0;
+            } else if (apu->dmc.bytes_remaining == 0) {
+                RestartDMCSample(&apu->dmc);
+                FetchDMCSample(apu);
+            }
+            apu->dmc_interrupt = false;
+            UpdateIrq(apu);
+            break;
+
+        case APU_FRAME_COUNTER:
+            apu->five_step_mode = (data & APU_FRAME_COUNTER_MODE_BIT) != 0;
+            apu->irq_inhibit = (data & APU_FRAME_COUNTER_IRQ_INHIBIT_BIT) != 0;
+            if (apu->irq_inhibit) {
+                apu->frame_interrupt = false;
+                UpdateIrq(apu);
+            }
+            RestartFrameCounter(apu);
+            break;
+
+        default:
+            LOG(WARNING, APU, "write to unused address: 0x%04X\n", address);
+            break;
+    }
+
+    UpdateChannels(apu);
+    UpdateNextEvent(apu);
+}
+
+uint8_t APUReadStatus(struct APU* apu) {
+    RunTo(apu, *apu->cpu_tick_counter);
+
+    uint8_t status = 0;
+    status |= (apu->pulse_1.length_counter != 0) ? APU_PULSE_1_BIT : 0;
+    status |= (apu->pulse_2.length_counter != 0) ? APU_PULSE_2_BIT : 0;
+    status |= (apu->triangle.length_counter != 0) ? APU_TRIANGLE_BIT : 0;
+    status |= (apu->noise.length_counter != 0) ? APU_NOISE_BIT : 0;
+    status |= (apu->dmc.bytes_remaining != 0) ? APU_DMC_BIT : 0;
+    status |= apu->frame_interrupt ? APU_FRAME_INTERRUPT_BIT : 0;
+    status |= apu->dmc_interrupt ? APU_DMC_INTERRUPT_BIT : 0;
+
+    apu->frame_interrupt = false;
+    UpdateIrq(apu);
+
+    return status;
+}
+
+uint8_t APURunEvents(struct APU* apu) {
+    RunTo(apu, *apu->cpu_tick_counter);
+
+    uint8_t stall_cycles = apu->cpu_stall_cycles;
+    apu->cpu_stall_cycles = 0;
+
+    UpdateNextEvent(apu);
+    return stall_cycles;
+}
+
+void APUEndFrame(struct APU* apu) {
+    RunTo(apu, *apu->cpu_tick_counter);
+    UpdateNextEvent(apu);
+
+    BlipEndFrame(&apu->blip, (uint32_t)(apu->cycle - apu->frame_start_cycle));
+    apu->frame_start_cycle = apu->cycle;
+
+    if (apu->rate_control) {
+        // below the target more samples are made from the same clocks, above it fewer
+        double fill = (double)AudioRingAvailable(&apu->ring);
+        double delta = APU_RATE_CONTROL_MAX_DELTA * (APU_RING_TARGET_FILL - fill) / APU_RING_TARGET_FILL;
+        if (delta > APU_RATE_CONTROL_MAX_DELTA) {
+            delta = APU_RATE_CONTROL_MAX_DELTA;
+        } else if (delta < -APU_RATE_CONTROL_MAX_DELTA) {
+            delta = -APU_RATE_CONTROL_MAX_DELTA;
+        }
+        BlipSetRate(&apu->blip, apu->clock_rate, APU_SAMPLE_RATE * (1.0 + delta));
+    }
+
+    int16_t samples[512];
+    uint32_t read;
+    while ((read = BlipReadSamples(&apu->blip, samples, sizeof(samples) / sizeof(int16_t))) != 0) {
+        // when the consumer doesn't keep up the rest is dropped
+        AudioRingWrite(&apu->ring, samples, read);
+    }
+}
+
+void APUSetRateControl(struct APU* apu, const bool enabled) {
+    apu->rate_control = enabled;
+    if (!enabled) {
+        BlipSetRate(&apu->blip, apu->clock_rate, APU_SAMPLE_RATE);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,233 @@
+#ifndef APU_H
+#define APU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cartridge.h"
+#include "blip.h"
+#include "audio_ring.h"
+
+
+#define APU_SAMPLE_RATE 48000
+
+// with rate control the output rate is nudged by at most this much so the ring stays around the target fill (~43ms at 48kHz),
+// small enough that the pitch change can't be heard
+#define APU_RATE_CONTROL_MAX_DELTA 0.005
+#define APU_RING_TARGET_FILL 2048
+
+#define NTSC_CPU_CLOCK_RATE 1789773
+#define PAL_CPU_CLOCK_RATE 1662607
+#define DENDY_CPU_CLOCK_RATE 1773448
+
+#define APU_PULSE_1_CTRL 0x4000
+#define APU_PULSE_1_SWEEP 0x4001
+#define APU_PULSE_1_LOW_BYTE 0x4002
+#define APU_PULSE_1_HIGH_BYTE 0x4003
+
+#define APU_PULSE_2_CTRL 0x4004
+#define APU_PULSE_2_SWEEP 0x4005
+#define APU_PULSE_2_LOW_BYTE 0x4006
+#define APU_PULSE_2_HIGH_BYTE 0x4007
+
+#define APU_TRIANGLE_CTRL 0x4008
+#define APU_TRIANGLE_UNUSED 0x4009
+#define APU_TRIANGLE_LOW_BYTE 0x400A
+#define APU_TRIANGLE_HIGH_BYTE 0x400B
+
+#define APU_NOISE_CTRL 0x400C
+#define APU_NOISE_UNUSED 0x400D
+#define APU_NOISE_LOW_BYTE 0x400E
+#define APU_NOISE_HIGH_BYTE 0x400F
+
+#define APU_DMC_CTRL 0x4010
+#define APU_DMC_DIRECT_LOAD 0x4011
+#define APU_DMC_ADDRESS 0x4012
+#define APU_DMC_LENGTH 0x4013
+
+#define APU_CTRL 0x4015
+#define APU_STATUS 0x4015
+
+#define APU_FRAME_COUNTER 0x4017
+
+// cpu cycles stolen by every dmc sample fetch
+#define APU_DMC_STALL_CYCLES 4
+
+// $4015
+#define APU_PULSE_1_BIT         0b00000001
+#define APU_PULSE_2_BIT         0b00000010
+#define APU_TRIANGLE_BIT        0b00000100
+#define APU_NOISE_BIT           0b00001000
+#define APU_DMC_BIT             0b00010000
+#define APU_FRAME_INTERRUPT_BIT 0b01000000
+#define APU_DMC_INTERRUPT_BIT   0b10000000
+
+// $4017
+#define APU_FRAME_COUNTER_MODE_BIT          0b10000000
+#define APU_FRAME_COUNTER_IRQ_INHIBIT_BIT   0b01000000
+
+#define APU_FRAME_COUNTER_MAX_STEPS 5
+
+// channels that don't change their output aren't scheduled
+#define APU_NO_EVENT UINT64_MAX
+
+
+struct APUEnvelope {
+    bool start;
+    bool loop;   // also the length counter halt flag
+    bool constant_volume;
+    uint8_t period;   // also the constant volume
+    uint8_t divider;
+    uint8_t decay_level;
+};
+
+struct APUPulse {
+    struct APUEnvelope envelope;
+
+    uint8_t duty;
+    uint8_t sequence_step;
+    uint16_t timer_period;
+    uint8_t length_counter;
+
+    bool sweep_enabled;
+    bool sweep_negate;
+    bool sweep_reload;
+    uint8_t sweep_period;
+    uint8_t sweep_shift;
+    uint8_t sweep_divider;
+    // pulse 1 negates with ones' complement, pulse 2 with two's complement
+    uint8_t sweep_negate_offset;
+
+    uint8_t output;
+    uint64_t next_step_cycle;
+};
+
+struct APUTriangle {
+    bool control;   // also the length counter halt flag
+    bool linear_counter_reload;
+    uint8_t linear_counter_period;
+    uint8_t linear_counter;
+
+    uint8_t sequence_step;
+    uint16_t timer_period;
+    uint8_t length_counter;
+
+    uint8_t output;
+    uint64_t next_step_cycle;
+};
+
+struct APUNoise {
+    struct APUEnvelope envelope;
+
+    bool mode;
+    uint16_t timer_period;
+    uint16_t shift_register;
+    uint8_t length_counter;
+
+    uint8_t output;
+    uint64_t next_step_cycle;
+};
+
+struct APUDMC {
+    bool irq_enabled;
+    bool loop;
+    uint16_t timer_period;
+
+    uint16_t sample_address;
+    uint16_t sample_length;
+    uint16_t current_address;
+    uint16_t bytes_remaining;
+
+    uint8_t sample_buffer;
+    bool sample_buffer_full;
+
+    uint8_t shift_register;
+    uint8_t bits_remaining;
+    bool silence;
+
+    uint8_t output;
+    uint64_t next_step_cycle;
+};
+
+// the step cycles are relative to the start of the sequence, the last step is also its length
+struct APUFrameCounterSequence {
+    uint8_t step_count;
+    uint32_t step_cycles[APU_FRAME_COUNTER_MAX_STEPS + 1];
+    bool quarter_frame[APU_FRAME_COUNTER_MAX_STEPS];
+    bool half_frame[APU_FRAME_COUNTER_MAX_STEPS];
+    bool interrupt[APU_FRAME_COUNTER_MAX_STEPS];
+};
+
+// the apu isn't clocked with the cpu, it runs in catch up mode: whenever a register is accessed (and at the end of every frame)
+// it jumps from one channel timer step to the next until it reaches the current cpu cycle
+struct APU {
+    struct APUPulse pulse_1;
+    struct APUPulse pulse_2;
+    struct APUTriangle triangle;
+    struct APUNoise noise;
+    struct APUDMC dmc;
+
+    uint8_t enabled_channels;
+
+    const struct APUFrameCounterSequence* frame_counter_sequence;
+    uint8_t frame_counter_step;
+    uint64_t frame_counter_start_cycle;
+    bool five_step_mode;
+    bool irq_inhibit;
+
+    bool frame_interrupt;
+    bool dmc_interrupt;
+    // polled by the emulator at every instruction boundary
+    bool irq;
+
+    // everything before this cpu cycle has been emulated
+    uint64_t cycle;
+    const uint64_t* cpu_tick_counter;
+
+    // the emulator calls APURunEvents once the cpu reaches this cycle (frame counter steps, dmc fetches, pending stall cycles),
+    // everything else can wait until the next register access
+    uint64_t next_event_cycle;
+    uint8_t cpu_stall_cycles;
+
+    // dmc samples are read from the cpu bus
+    uint8_t (*DMCRead)(void*, const uint16_t);
+    void* dmc_read_data;
+
+    enum TVSystem tv_system;
+    const uint16_t* noise_periods;
+    const uint16_t* dmc_periods;
+    const struct APUFrameCounterSequence* frame_counter_sequences;
+
+    float pulse_mix[31];
+    float tnd_mix[203];
+    float mix_output;
+
+    uint64_t frame_start_cycle;
+    struct Blip blip;
+
+    double clock_rate;
+    // off by default, only makes sense when something consumes the ring in real time
+    bool rate_control;
+
+    struct AudioRing ring;
+};
+
+
+void APUInit(struct APU* apu, const enum TVSystem tv_system, const uint64_t* cpu_tick_counter, uint8_t (*DMCRead)(void*, const uint16_t), void* dmc_read_data);
+void APUReset(struct APU* apu);
+void APUSetTVSystem(struct APU* apu, const enum TVSystem tv_system);
+
+void APUWrite(struct APU* apu, const uint16_t address, const uint8_t data);
+uint8_t APUReadStatus(struct APU* apu);
+
+// catches up to the cpu, only needed once the cpu reached next_event_cycle, returns the cycles the cpu has to stall for dmc fetches
+uint8_t APURunEvents(struct APU* apu);
+
+// catches up to the cpu and moves the samples of the frame into the ring
+void APUEndFrame(struct APU* apu);
+
+// adjusts the resampling ratio after every frame based on how full the ring is, so a consumer running on
+// the audio device clock neither underruns nor overflows even though the emulated clock doesn't match it exactly
+void APUSetRateControl(struct APU* apu, const bool enabled);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include "audio_ring.h"
+
+
+void AudioRingInit(struct AudioRing* ring) {
+    for (uint32_t i = 0; i < AUDIO_RING_SIZE; i++) {
+        ring->samples[i] = 0;
+    }
+    atomic_init(&ring->write_index, 0);
+    atomic_init(&ring->read_index, 0);
+}
+
+uint32_t AudioRingWrite(struct AudioRing* ring, const int16_t* samples, const uint32_t count) {
+    uint32_t write_index = atomic_load_explicit(&ring->write_index, memory_order_relaxed);
+    uint32_t read_index = atomic_load_explicit(&ring->read_index, memory_order_acquire);
+
+    uint32_t free_space = AUDIO_RING_SIZE - (write_index - read_index);
+    uint32_t written = (count < free_space) ? count : free_space;
+
+    for (uint32_t i = 0; i < written; i++) {
+        ring->samples[(write_index + i) & (AUDIO_RING_SIZE - 1)] = samples[i];
+    }
+
+    // the samples have to be visible before the consumer sees the new index
+    atomic_store_explicit(&ring->write_index, write_index + written, memory_order_release);
+    return written;
+}
+
+uint32_t AudioRingRead(struct AudioRing* ring, int16_t* samples, const uint32_t count) {
+    uint32_t read_index = atomic_load_explicit(&ring->read_index, memory_order_relaxed);
+    uint32_t write_index = atomic_load_explicit(&ring->write_index, memory_order_acquire);
+
+    uint32_t available = write_index - read_index;
+    uint32_t read = (count < available) ? count : available;
+
+    for (uint32_t i = 0; i < read; i++) {
+        samples[i] = ring->samples[(read_index + i) & (AUDIO_RING_SIZE - 1)];
+    }
+
+    // the producer can only reuse the slots once they were copied out
+    atomic_store_explicit(&ring->read_index, read_index + read, memory_order_release);
+    return read;
+}
+
+uint32_t AudioRingAvailable(struct AudioRing* ring) {
+    uint32_t write_index = atomic_load_explicit(&ring->write_index, memory_order_acquire);
+    uint32_t read_index = atomic_load_explicit(&ring->read_index, memory_order_acquire);
+    return write_index - read_index;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+
+// has to be a power of 2, ~170ms at 48kHz
+#define AUDIO_RING_SIZE 8192
+
+
+// single producer (the emulator) / single consumer (the audio callback) queue of samples,
+// the indices only ever grow and are masked on access so a full ring and an empty one can be told apart
+struct AudioRing {
+    int16_t samples[AUDIO_RING_SIZE];
+
+    _Atomic uint32_t write_index;
+    _Atomic uint32_t read_index;
+};
+
+
+void AudioRingInit(struct AudioRing* ring);
+
+// producer side, samples that don't fit are dropped, returns how many were written
+uint32_t AudioRingWrite(struct AudioRing* ring, const int16_t* samples, const uint32_t count);
+// consumer side, returns how many were read
+uint32_t AudioRingRead(struct AudioRing* ring, int16_t* samples, const uint32_t count);
+
+uint32_t AudioRingAvailable(struct AudioRing* ring);
+
+#endif
\ No newline at end of file
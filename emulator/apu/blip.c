@@ -0,0 +1,123 @@
+#include <string.h>
+#include <math.h>
+#include <stdbool.h>
+
+#include "blip.h"
+#include "logger.h"
+
+
+#define BLIP_CUTOFF 0.45   // of the sample rate, just below nyquist
+#define BLIP_PI 3.14159265358979323846
+
+
+// one row of taps per sub sample phase, every row sums to 1 so a step of delta ends up as exactly delta after integration
+static float kernel[BLIP_PHASES][BLIP_KERNEL_WIDTH];
+static bool kernel_initialized = false;
+
+
+static void InitKernel(void) {
+    for (uint32_t phase = 0; phase < BLIP_PHASES; phase++) {
+        double sum = 0.0;
+        for (uint32_t tap = 0; tap < BLIP_KERNEL_WIDTH; tap++) {
+            // distance of the tap from the center of the step in samples
+            double x = (double)tap - (BLIP_KERNEL_WIDTH / 2 - 1) - (double)phase / BLIP_PHASES;
+
+            double sinc = (x == 0.0) ? 1.0 : sin(BLIP_PI * 2.0 * BLIP_CUTOFF * x) / (BLIP_PI * 2.0 * BLIP_CUTOFF * x);
+
+            // blackman window over the whole kernel width
+            double window_position = (x + BLIP_KERNEL_WIDTH / 2) / BLIP_KERNEL_WIDTH;
+            double window = 0.42 - 0.5 * cos(2.0 * BLIP_PI * window_position) + 0.08 * cos(4.0 * BLIP_PI * window_position);
+
+            kernel[phase][tap] = (float)(sinc * window);
+            sum += sinc * window;
+        }
+        for (uint32_t tap = 0; tap < BLIP_KERNEL_WIDTH; tap++) {
+            kernel[phase][tap] = (float)(kernel[phase][tap] / sum);
+        }
+    }
+    kernel_initialized = true;
+}
+
+
+void BlipInit(struct Blip* blip, const double clock_rate, const double sample_rate) {
+    if (!kernel_initialized) {
+        InitKernel();
+    }
+
+    BlipSetRate(blip, clock_rate, sample_rate);
+    BlipClear(blip);
+}
+
+void BlipSetRate(struct Blip* blip, const double clock_rate, const double sample_rate) {
+    blip->samples_per_clock = (uint64_t)(sample_rate / clock_rate * (double)(1ULL << BLIP_TIME_BITS) + 0.5);
+}
+
+void BlipClear(struct Blip* blip) {
+    blip->offset = 0;
+    blip->integrator = 0.0f;
+    blip->high_pass_input = 0.0f;
+    blip->high_pass_output = 0.0f;
+    memset(blip->buffer, 0, sizeof(blip->buffer));
+}
+
+void BlipAddDelta(struct Blip* blip, const uint32_t time, const float delta) {
+    uint64_t position = blip->offset + (uint64_t)time * blip->samples_per_clock;
+
+    uint32_t index = (uint32_t)(position >> BLIP_TIME_BITS);
+    if (index >= BLIP_BUFFER_SIZE) {
+        LOG(WARNING, APU, "blip buffer overflow, frame too long\n");
+        return;
+    }
+
+    uint32_t phase = (uint32_t)(position >> (BLIP_TIME_BITS - BLIP_PHASE_BITS)) & (BLIP_PHASES - 1);
+
+    float* out = &blip->buffer[index];
+    const float* taps = kernel[phase];
+    for (uint32_t tap = 0; tap < BLIP_KERNEL_WIDTH; tap++) {
+        out[tap] += taps[tap] * delta;
+    }
+}
+
+void BlipEndFrame(struct Blip* blip, const uint32_t time) {
+    blip->offset += (uint64_t)time * blip->samples_per_clock;
+}
+
+uint32_t BlipSamplesAvailable(struct Blip* blip) {
+    return (uint32_t)(blip->offset >> BLIP_TIME_BITS);
+}
+
+uint32_t BlipReadSamples(struct Blip* blip, int16_t* samples, const uint32_t count) {
+    uint32_t available = BlipSamplesAvailable(blip);
+    uint32_t read = (count < available) ? count : available;
+
+    float integrator = blip->integrator;
+    float high_pass_input = blip->high_pass_input;
+    float high_pass_output = blip->high_pass_output;
+
+    for (uint32_t i = 0; i < read; i++) {
+        integrator += blip->buffer[i];
+
+        high_pass_output = integrator - high_pass_input + BLIP_HIGH_PASS * high_pass_output;
+        high_pass_input = integrator;
+
+        float sample = high_pass_output * 32767.0f;
+        if (sample > 32767.0f) {
+            sample = 32767.0f;
+        } else if (sample < -32768.0f) {
+            sample = -32768.0f;
+        }
+        samples[i] = (int16_t)sample;
+    }
+
+    blip->integrator = integrator;
+    blip->high_pass_input = high_pass_input;
+    blip->high_pass_output = high_pass_output;
+
+    // the kernel tails of the next samples are already in the buffer
+    uint32_t remaining = BLIP_BUFFER_SIZE + BLIP_KERNEL_WIDTH - read;
+    memmove(blip->buffer, &blip->buffer[read], remaining * sizeof(float));
+    memset(&blip->buffer[remaining], 0, read * sizeof(float));
+    blip->offset -= (uint64_t)read << BLIP_TIME_BITS;
+
+    return read;
+}
\ No newline at end of file
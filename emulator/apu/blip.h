@@ -0,0 +1,50 @@
+#ifndef BLIP_H
+#define BLIP_H
+
+#include <stdint.h>
+
+
+// band-limited step synthesis: every change of the output is added as a windowed sinc step at its exact (sub sample) time,
+// the buffer holds the differences and reading integrates them, so the cost depends on the number of changes and not the clock rate
+#define BLIP_PHASE_BITS 6
+#define BLIP_PHASES (1 << BLIP_PHASE_BITS)
+#define BLIP_KERNEL_WIDTH 16
+
+// sample positions are 32.32 fixed point
+#define BLIP_TIME_BITS 32
+
+// a bit more than 2 frames of samples, the emulator reads them out after every frame
+#define BLIP_BUFFER_SIZE 4096
+
+// dc blocker pole (~8Hz at 48kHz), the nes output isn't centered around 0
+#define BLIP_HIGH_PASS 0.999f
+
+
+struct Blip {
+    // how far one clock moves in the output, 32.32 fixed point samples
+    uint64_t samples_per_clock;
+    // start of the current frame in the output, 32.32 fixed point samples
+    uint64_t offset;
+
+    float integrator;
+    float high_pass_input;
+    float high_pass_output;
+
+    float buffer[BLIP_BUFFER_SIZE + BLIP_KERNEL_WIDTH];
+};
+
+
+void BlipInit(struct Blip* blip, const double clock_rate, const double sample_rate);
+// only changes the resampling ratio, can be called between frames without a glitch
+void BlipSetRate(struct Blip* blip, const double clock_rate, const double sample_rate);
+void BlipClear(struct Blip* blip);
+
+// time is in clocks since the start of the frame
+void BlipAddDelta(struct Blip* blip, const uint32_t time, const float delta);
+// the frame ends after the given number of clocks, the samples before it can be read
+void BlipEndFrame(struct Blip* blip, const uint32_t time);
+
+uint32_t BlipSamplesAvailable(struct Blip* blip);
+uint32_t BlipReadSamples(struct Blip* blip, int16_t* samples, const uint32_t count);
+
+#endif
\ No newline at end of file
@@ -94,8 +94,6 @@ void CartridgeInit(struct Cartridge* cartridge, const char* filename) {
 
         if (header.TV_system == 1) {
             cartridge->tv_system = PAL;
-            fclose(cartridge_file);
-            LOG(ERROR, CARTRIDGE, "PAL TV system not supported\n");
         } else {
             cartridge->tv_system = NTSC;
         }
@@ -129,6 +127,10 @@ void CartridgeInit(struct Cartridge* cartridge, const char* filename) {
 
         cartridge->mapper_id = mapper_id;
 
+        cartridge->irq = false;
+
+        // connected by the ppu bus
+        cartridge->ppu_vram = NULL;
         enum Mirroring mirroring = header.mirroring ? VERTICAL_MIRRORING : HORIZONTAL_MIRRORING;
         CartridgeSetMirroring(cartridge, mirroring);
 
@@ -193,6 +195,8 @@ void CartridgeInit(struct Cartridge* cartridge, const char* filename) {
         if (!cartridge->supports_chr_ram && fread(cartridge->chr_rom, sizeof(uint8_t), chr_rom_size, cartridge_file) != chr_rom_size) {
             LOG(ERROR, CARTRIDGE, "couldn't read chr rom fully\n");
         }
+        // the mappers are initialized before the chr rom is there
+        CartridgeUpdateCHRPages(cartridge);
 
         if (cartridge->prg_ram_8KB_units != 0) {
             cartridge->prg_ram = malloc(prg_ram_size * sizeof(uint8_t));
@@ -216,8 +220,8 @@ void CartridgeClean(struct Cartridge* cartridge) {
     free(cartridge->mapper_info);
 }
 
-bool CartridgeScanlineIRQ(struct Cartridge* cartridge) {
-    return cartridge->MapperScanlineIRQ(cartridge);
+void CartridgeScanlineIRQ(struct Cartridge* cartridge) {
+    cartridge->MapperScanlineIRQ(cartridge);
 }
 
 void CartridgeSetMirroring(struct Cartridge* cartridge, enum Mirroring mirroring) {
@@ -262,15 +266,29 @@ void CartridgeSetMirroring(struct Cartridge* cartridge, enum Mirroring mirroring
         default:
             LOG(ERROR, CARTRIDGE, "unsuported mirroring\n");
     }
+
+    if (cartridge->ppu_vram != NULL) {
+        for (uint8_t nametable = 0; nametable < 4; nametable++) {
+            cartridge->ppu_pages[PPU_NAMETABLE_PAGE + nametable] = &cartridge->ppu_vram[cartridge->mirroring_offsets[nametable]];
+            cartridge->ppu_pages[PPU_NAMETABLE_PAGE + 4 + nametable] = &cartridge->ppu_vram[cartridge->mirroring_offsets[nametable]];
+        }
+    }
 }
 
+void CartridgeConnectVRAM(struct Cartridge* cartridge, uint8_t* ppu_vram) {
+    cartridge->ppu_vram = ppu_vram;
+    CartridgeSetMirroring(cartridge, cartridge->mirroring);
+}
 
-uint8_t CartridgeReadCPU(struct Cartridge* cartridge, const uint16_t address) {
-    return cartridge->MapperReadCPU(cartridge, address);
+void CartridgeUpdateCHRPages(struct Cartridge* cartridge) {
+    for (uint8_t page = 0; page < PPU_NAMETABLE_PAGE; page++) {
+        cartridge->ppu_pages[page] = &cartridge->chr_rom[cartridge->MapperMapCHR(cartridge, page * PPU_PAGE_SIZE)];
+    }
 }
 
-uint8_t CartridgeReadPPU(struct Cartridge* cartridge, const uint16_t address) {
-    return cartridge->MapperReadPPU(cartridge, address);
+
+uint8_t CartridgeReadCPU(struct Cartridge* cartridge, const uint16_t address) {
+    return cartridge->MapperReadCPU(cartridge, address);
 }
 
 
@@ -281,3 +299,10 @@ void CartridgeWriteCPU(struct Cartridge* cartridge, const uint16_t address, cons
 void CartridgeWritePPU(struct Cartridge* cartridge, const uint16_t address, const uint8_t value) {
     cartridge->MapperWritePPU(cartridge, address, value);
 }
+
+uint32_t CartridgeMapPRGROM(struct Cartridge* cartridge, const uint16_t address) {
+    if (address < 0x8000) {
+        return CARTRIDGE_NOT_PRG_ROM;
+    }
+    return cartridge->MapperMapPRGROM(cartridge, address);
+}
\ No newline at end of file
@@ -14,6 +14,14 @@
 #define ColorDreams 11
 #define GxROM 66
 
+// returned by CartridgeMapPRGROM for addresses that aren't backed by prg rom (ram, registers, prg ram)
+#define CARTRIDGE_NOT_PRG_ROM 0xFFFFFFFF
+
+// the ppu address space below the palette in 1KB pages, 8 chr pages then the 4 nametables twice (0x3000 mirrors 0x2000)
+#define PPU_PAGE_SIZE 0x0400
+#define PPU_PAGE_COUNT 16
+#define PPU_NAMETABLE_PAGE 8
+
 enum FileFormat {
     iNES,
     NES_2,
@@ -23,6 +31,7 @@ enum FileFormat {
 enum TVSystem {
     PAL,
     NTSC,
+    DENDY,  // can't be told apart from PAL by the header, only selectable from the command line
 };
 
 
@@ -55,13 +64,27 @@ struct Cartridge {
 
     uint16_t mirroring_offsets[4];
 
+    // where every ppu page currently is, the mappers update the chr pages when they switch banks and 
+    // CartridgeSetMirroring the nametable pages, so reading a ppu address is just an index
+    uint8_t* ppu_pages[PPU_PAGE_COUNT];
+    // the vram of the ppu bus the nametable pages point into, NULL until CartridgeConnectVRAM
+    uint8_t* ppu_vram;
+
     uint8_t (*MapperReadCPU)(struct Cartridge*, uint16_t);
-    uint8_t (*MapperReadPPU)(struct Cartridge*, uint16_t);
     
     void (*MapperWriteCPU)(struct Cartridge*, uint16_t, uint8_t);
     void (*MapperWritePPU)(struct Cartridge*, uint16_t, uint8_t);
 
-    bool (*MapperScanlineIRQ)(struct Cartridge*);
+    // the irq line of the cartridge, the mapper asserts it and acknowledges it itself, the cpu only samples it
+    bool irq;
+
+    // clocked once per rendered scanline when ppu A12 rises (see PPU scanline_irq_cycle)
+    void (*MapperScanlineIRQ)(struct Cartridge*);
+
+    // offset into prg_rom of a cpu address (>= 0x8000) with the currently selected banks, used for bank aware debugging
+    uint32_t (*MapperMapPRGROM)(struct Cartridge*, uint16_t);
+    // offset into chr_rom of a ppu address (< 0x2000) with the currently selected banks, the chr pages are made from it
+    uint32_t (*MapperMapCHR)(struct Cartridge*, uint16_t);
 };
 
 struct Mapper000Info {
@@ -138,14 +161,18 @@ struct Mapper066Info {
 void CartridgeInit(struct Cartridge* cartridge, const char* filename);
 void CartridgeClean(struct Cartridge* cartridge);
 
-bool CartridgeScanlineIRQ(struct Cartridge* cartridge);
+void CartridgeScanlineIRQ(struct Cartridge* cartridge);
 void CartridgeSetMirroring(struct Cartridge* cartridge, enum Mirroring mirroring);
+void CartridgeConnectVRAM(struct Cartridge* cartridge, uint8_t* ppu_vram);
+// has to be called by the mappers after their chr banks changed
+void CartridgeUpdateCHRPages(struct Cartridge* cartridge);
 
 uint8_t CartridgeReadCPU(struct Cartridge* cartridge, const uint16_t address);
-uint8_t CartridgeReadPPU(struct Cartridge* cartridge, const uint16_t address);
 void CartridgeWriteCPU(struct Cartridge* cartridge, const uint16_t address, const uint8_t value);
 void CartridgeWritePPU(struct Cartridge* cartridge, const uint16_t address, const uint8_t value);
 
+uint32_t CartridgeMapPRGROM(struct Cartridge* cartridge, const uint16_t address);
+
 
 void Mapper000Init(struct Cartridge* cartridge);
 void Mapper001Init(struct Cartridge* cartridge);
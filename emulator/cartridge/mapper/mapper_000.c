@@ -5,11 +5,12 @@
 
 
 uint8_t Mapper000ReadCPU(struct Cartridge* cartridge, uint16_t address);
-uint8_t Mapper000ReadPPU(struct Cartridge* cartridge, uint16_t address);
 void Mapper000WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 void Mapper000WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 
-bool Mapper000ScanlineIRQ(struct Cartridge* cartridge);
+void Mapper000ScanlineIRQ(struct Cartridge* cartridge);
+uint32_t Mapper000MapPRGROM(struct Cartridge* cartridge, uint16_t address);
+uint32_t Mapper000MapCHR(struct Cartridge* cartridge, uint16_t address);
 
 
 void Mapper000Init(struct Cartridge* cartridge) {
@@ -23,11 +24,12 @@ void Mapper000Init(struct Cartridge* cartridge) {
     }
 
     cartridge->MapperReadCPU = &Mapper000ReadCPU;
-    cartridge->MapperReadPPU = &Mapper000ReadPPU;
     cartridge->MapperWriteCPU = &Mapper000WriteCPU;
     cartridge->MapperWritePPU = &Mapper000WritePPU;
 
     cartridge->MapperScanlineIRQ = &Mapper000ScanlineIRQ;
+    cartridge->MapperMapPRGROM = &Mapper000MapPRGROM;
+    cartridge->MapperMapCHR = &Mapper000MapCHR;
 }
 
 uint8_t Mapper000ReadCPU(struct Cartridge* cartridge, uint16_t address) {
@@ -46,10 +48,6 @@ uint8_t Mapper000ReadCPU(struct Cartridge* cartridge, uint16_t address) {
     }
 }
 
-uint8_t Mapper000ReadPPU(struct Cartridge* cartridge, uint16_t address) {
-    return cartridge->chr_rom[address & 0x1FFF];
-}
-
 void Mapper000WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data) {
     if (address < 0x6000) {
         LOG(WARNING, MAPPER, "Attempted write to unmapped area\n");
@@ -73,6 +71,14 @@ void Mapper000WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
 }
 
 
-bool Mapper000ScanlineIRQ(struct Cartridge* cartridge) {
-    return false;
+void Mapper000ScanlineIRQ(struct Cartridge* cartridge) {
+}
+
+uint32_t Mapper000MapPRGROM(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper000Info* mapper_info = (struct Mapper000Info*)cartridge->mapper_info;
+    return address & mapper_info->prg_rom_mask;
+}
+
+uint32_t Mapper000MapCHR(struct Cartridge* cartridge, uint16_t address) {
+    return address & 0x1FFF;
 }
\ No newline at end of file
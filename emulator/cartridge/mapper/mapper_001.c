@@ -20,11 +20,12 @@
 
 
 uint8_t Mapper001ReadCPU(struct Cartridge* cartridge, uint16_t address);
-uint8_t Mapper001ReadPPU(struct Cartridge* cartridge, uint16_t address);
 void Mapper001WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 void Mapper001WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 
-bool Mapper001ScanlineIRQ(struct Cartridge* cartridge);
+void Mapper001ScanlineIRQ(struct Cartridge* cartridge);
+uint32_t Mapper001MapPRGROM(struct Cartridge* cartridge, uint16_t address);
+uint32_t Mapper001MapCHR(struct Cartridge* cartridge, uint16_t address);
 
 static void SetCHRBanks(struct Cartridge* cartridge);
 static void SetPRGBanks(struct Cartridge* cartridge);
@@ -51,11 +52,12 @@ void Mapper001Init(struct Cartridge* cartridge) {
 
 
     cartridge->MapperReadCPU = &Mapper001ReadCPU;
-    cartridge->MapperReadPPU = &Mapper001ReadPPU;
     cartridge->MapperWriteCPU = &Mapper001WriteCPU;
     cartridge->MapperWritePPU = &Mapper001WritePPU;
 
     cartridge->MapperScanlineIRQ = &Mapper001ScanlineIRQ;
+    cartridge->MapperMapPRGROM = &Mapper001MapPRGROM;
+    cartridge->MapperMapCHR = &Mapper001MapCHR;
 }
 
 uint8_t Mapper001ReadCPU(struct Cartridge* cartridge, uint16_t address) {
@@ -76,15 +78,6 @@ uint8_t Mapper001ReadCPU(struct Cartridge* cartridge, uint16_t address) {
     }
 }
 
-uint8_t Mapper001ReadPPU(struct Cartridge* cartridge, uint16_t address) {
-    struct Mapper001Info* mapper_info = (struct Mapper001Info*)cartridge->mapper_info;
-    if (address < 0x1000) {
-        return cartridge->chr_rom[(address & 0x0FFF) + mapper_info->chr_rom_bank_1_offset];
-    } else {
-        return cartridge->chr_rom[(address & 0x0FFF) + mapper_info->chr_rom_bank_2_offset];
-    }
-}
-
 void Mapper001WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data) {
     struct Mapper001Info* mapper_info = (struct Mapper001Info*)cartridge->mapper_info;
     if (address < 0x6000) {
@@ -156,8 +149,7 @@ void Mapper001WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
 }
 
 
-bool Mapper001ScanlineIRQ(struct Cartridge* cartridge) {
-    return false;
+void Mapper001ScanlineIRQ(struct Cartridge* cartridge) {
 }
 
 
@@ -175,6 +167,7 @@ static void SetCHRBanks(struct Cartridge* cartridge) {
             mapper_info->chr_rom_bank_2_offset = mapper_info->chr_2_register * 0x1000;
             break;
     }
+    CartridgeUpdateCHRPages(cartridge);
 }
 
 static void SetPRGBanks(struct Cartridge* cartridge) {
@@ -197,4 +190,22 @@ static void SetPRGBanks(struct Cartridge* cartridge) {
             mapper_info->prg_rom_bank_2_offset = (cartridge->prg_rom_16KB_units - 1) * 0x4000;
             break;
     }
+}
+
+uint32_t Mapper001MapPRGROM(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper001Info* mapper_info = (struct Mapper001Info*)cartridge->mapper_info;
+    if (address < 0xC000) {
+        return (address & 0x3FFF) + mapper_info->prg_rom_bank_1_offset;
+    } else {
+        return (address & 0x3FFF) + mapper_info->prg_rom_bank_2_offset;
+    }
+}
+
+uint32_t Mapper001MapCHR(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper001Info* mapper_info = (struct Mapper001Info*)cartridge->mapper_info;
+    if (address < 0x1000) {
+        return (address & 0x0FFF) + mapper_info->chr_rom_bank_1_offset;
+    } else {
+        return (address & 0x0FFF) + mapper_info->chr_rom_bank_2_offset;
+    }
 }
\ No newline at end of file
@@ -5,11 +5,12 @@
 
 
 uint8_t Mapper002ReadCPU(struct Cartridge* cartridge, uint16_t address);
-uint8_t Mapper002ReadPPU(struct Cartridge* cartridge, uint16_t address);
 void Mapper002WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 void Mapper002WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 
-bool Mapper002ScanlineIRQ(struct Cartridge* cartridge);
+void Mapper002ScanlineIRQ(struct Cartridge* cartridge);
+uint32_t Mapper002MapPRGROM(struct Cartridge* cartridge, uint16_t address);
+uint32_t Mapper002MapCHR(struct Cartridge* cartridge, uint16_t address);
 
 
 void Mapper002Init(struct Cartridge* cartridge) {
@@ -18,11 +19,12 @@ void Mapper002Init(struct Cartridge* cartridge) {
     mapper_info->prg_rom_bank_2_offset = (cartridge->prg_rom_16KB_units - 1) * 0x4000;
 
     cartridge->MapperReadCPU = &Mapper002ReadCPU;
-    cartridge->MapperReadPPU = &Mapper002ReadPPU;
     cartridge->MapperWriteCPU = &Mapper002WriteCPU;
     cartridge->MapperWritePPU = &Mapper002WritePPU;
 
     cartridge->MapperScanlineIRQ = &Mapper002ScanlineIRQ;
+    cartridge->MapperMapPRGROM = &Mapper002MapPRGROM;
+    cartridge->MapperMapCHR = &Mapper002MapCHR;
 }
 
 uint8_t Mapper002ReadCPU(struct Cartridge* cartridge, uint16_t address) {
@@ -43,10 +45,6 @@ uint8_t Mapper002ReadCPU(struct Cartridge* cartridge, uint16_t address) {
     }
 }
 
-uint8_t Mapper002ReadPPU(struct Cartridge* cartridge, uint16_t address) {
-    return cartridge->chr_rom[address & 0x1FFF];
-}
-
 void Mapper002WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data) {
     struct Mapper002Info* mapper_info = (struct Mapper002Info*)cartridge->mapper_info;
     if (address < 0x6000) {
@@ -71,6 +69,18 @@ void Mapper002WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
 }
 
 
-bool Mapper002ScanlineIRQ(struct Cartridge* cartridge) {
-    return false;
+void Mapper002ScanlineIRQ(struct Cartridge* cartridge) {
+}
+
+uint32_t Mapper002MapPRGROM(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper002Info* mapper_info = (struct Mapper002Info*)cartridge->mapper_info;
+    if (address < 0xC000) {
+        return (address & 0x3FFF) + mapper_info->prg_rom_bank_1_offset;
+    } else {
+        return (address & 0x3FFF) + mapper_info->prg_rom_bank_2_offset;
+    }
+}
+
+uint32_t Mapper002MapCHR(struct Cartridge* cartridge, uint16_t address) {
+    return address & 0x1FFF;
 }
\ No newline at end of file
@@ -5,11 +5,12 @@
 
 
 uint8_t Mapper003ReadCPU(struct Cartridge* cartridge, uint16_t address);
-uint8_t Mapper003ReadPPU(struct Cartridge* cartridge, uint16_t address);
 void Mapper003WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 void Mapper003WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 
-bool Mapper003ScanlineIRQ(struct Cartridge* cartridge);
+void Mapper003ScanlineIRQ(struct Cartridge* cartridge);
+uint32_t Mapper003MapPRGROM(struct Cartridge* cartridge, uint16_t address);
+uint32_t Mapper003MapCHR(struct Cartridge* cartridge, uint16_t address);
 
 
 void Mapper003Init(struct Cartridge* cartridge) {
@@ -24,11 +25,12 @@ void Mapper003Init(struct Cartridge* cartridge) {
     mapper_info->chr_rom_offset = 0x00000000;
 
     cartridge->MapperReadCPU = &Mapper003ReadCPU;
-    cartridge->MapperReadPPU = &Mapper003ReadPPU;
     cartridge->MapperWriteCPU = &Mapper003WriteCPU;
     cartridge->MapperWritePPU = &Mapper003WritePPU;
 
     cartridge->MapperScanlineIRQ = &Mapper003ScanlineIRQ;
+    cartridge->MapperMapPRGROM = &Mapper003MapPRGROM;
+    cartridge->MapperMapCHR = &Mapper003MapCHR;
 }
 
 uint8_t Mapper003ReadCPU(struct Cartridge* cartridge, uint16_t address) {
@@ -47,11 +49,6 @@ uint8_t Mapper003ReadCPU(struct Cartridge* cartridge, uint16_t address) {
     }
 }
 
-uint8_t Mapper003ReadPPU(struct Cartridge* cartridge, uint16_t address) {
-    struct Mapper003Info* mapper_info = (struct Mapper003Info*)cartridge->mapper_info;
-    return cartridge->chr_rom[(address & 0x1FFF) + mapper_info->chr_rom_offset];
-}
-
 void Mapper003WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data) {
     struct Mapper003Info* mapper_info = (struct Mapper003Info*)cartridge->mapper_info;
     if (address < 0x6000) {
@@ -64,6 +61,7 @@ void Mapper003WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
         }
     } else {
         mapper_info->chr_rom_offset = 0x2000 * data;
+        CartridgeUpdateCHRPages(cartridge);
     }
 }
 
@@ -77,6 +75,15 @@ void Mapper003WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
 }
 
 
-bool Mapper003ScanlineIRQ(struct Cartridge* cartridge) {
-    return false;
+void Mapper003ScanlineIRQ(struct Cartridge* cartridge) {
+}
+
+uint32_t Mapper003MapPRGROM(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper003Info* mapper_info = (struct Mapper003Info*)cartridge->mapper_info;
+    return address & mapper_info->prg_rom_mask;
+}
+
+uint32_t Mapper003MapCHR(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper003Info* mapper_info = (struct Mapper003Info*)cartridge->mapper_info;
+    return (address & 0x1FFF) + mapper_info->chr_rom_offset;
 }
\ No newline at end of file
@@ -14,11 +14,12 @@
 
 
 uint8_t Mapper004ReadCPU(struct Cartridge* cartridge, uint16_t address);
-uint8_t Mapper004ReadPPU(struct Cartridge* cartridge, uint16_t address);
 void Mapper004WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 void Mapper004WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 
-bool Mapper004ScanlineIRQ(struct Cartridge* cartridge);
+void Mapper004ScanlineIRQ(struct Cartridge* cartridge);
+uint32_t Mapper004MapPRGROM(struct Cartridge* cartridge, uint16_t address);
+uint32_t Mapper004MapCHR(struct Cartridge* cartridge, uint16_t address);
 
 static void SetPRGCHRBanks(struct Cartridge* cartridge);
 static void SwapPRGROMMode(struct Cartridge* cartridge);
@@ -52,11 +53,12 @@ void Mapper004Init(struct Cartridge* cartridge) {
     mapper_info->chr_rom_bank_8_offset = 0;
 
     cartridge->MapperReadCPU = &Mapper004ReadCPU;
-    cartridge->MapperReadPPU = &Mapper004ReadPPU;
     cartridge->MapperWriteCPU = &Mapper004WriteCPU;
     cartridge->MapperWritePPU = &Mapper004WritePPU;
 
     cartridge->MapperScanlineIRQ = &Mapper004ScanlineIRQ;
+    cartridge->MapperMapPRGROM = &Mapper004MapPRGROM;
+    cartridge->MapperMapCHR = &Mapper004MapCHR;
 }
 
 uint8_t Mapper004ReadCPU(struct Cartridge* cartridge, uint16_t address) {
@@ -81,27 +83,6 @@ uint8_t Mapper004ReadCPU(struct Cartridge* cartridge, uint16_t address) {
     }
 }
 
-uint8_t Mapper004ReadPPU(struct Cartridge* cartridge, uint16_t address) {
-    struct Mapper004Info* mapper_info = (struct Mapper004Info*)cartridge->mapper_info;
-    if (address < 0x0400) {
-        return cartridge->chr_rom[(address & 0x03FF) + mapper_info->chr_rom_bank_1_offset];
-    } else if (address < 0x0800) {
-        return cartridge->chr_rom[(address & 0x03FF) + mapper_info->chr_rom_bank_2_offset];
-    } else if (address < 0x0C00) {
-        return cartridge->chr_rom[(address & 0x03FF) + mapper_info->chr_rom_bank_3_offset];
-    } else if (address < 0x1000) {
-        return cartridge->chr_rom[(address & 0x03FF) + mapper_info->chr_rom_bank_4_offset];
-    } else if (address < 0x1400) {
-        return cartridge->chr_rom[(address & 0x03FF) + mapper_info->chr_rom_bank_5_offset];
-    } else if (address < 0x1800) {
-        return cartridge->chr_rom[(address & 0x03FF) + mapper_info->chr_rom_bank_6_offset];
-    } else if (address < 0x1C00) {
-        return cartridge->chr_rom[(address & 0x03FF) + mapper_info->chr_rom_bank_7_offset];
-    } else {
-        return cartridge->chr_rom[(address & 0x03FF) + mapper_info->chr_rom_bank_8_offset];
-    }
-}
-
 void Mapper004WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data) {
     struct Mapper004Info* mapper_info = (struct Mapper004Info*)cartridge->mapper_info;
     if (address < 0x6000) {
@@ -129,6 +110,7 @@ void Mapper004WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
             case 0x8001: 
                 mapper_info->bank_value_register = data;
                 SetPRGCHRBanks(cartridge);
+                CartridgeUpdateCHRPages(cartridge);
                 break;
             case 0xA000: 
                 if (cartridge->mirroring != FOUR_SCREEN_MIRRORING) {
@@ -147,7 +129,9 @@ void Mapper004WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
                 mapper_info->irq_reload_latch = true;
                 break;
             case 0xE000: 
+                // disabling also acknowledges a pending irq
                 mapper_info->irq_enabled = false;
+                cartridge->irq = false;
                 break;
             case 0xE001: 
                 mapper_info->irq_enabled = true;;
@@ -182,7 +166,8 @@ void Mapper004WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
 }
 
 
-bool Mapper004ScanlineIRQ(struct Cartridge* cartridge) {
+// clocked on the rising edges of ppu A12, the line stays asserted until the game writes to 0xE000
+void Mapper004ScanlineIRQ(struct Cartridge* cartridge) {
     struct Mapper004Info* mapper_info = (struct Mapper004Info*)cartridge->mapper_info;
     if ((mapper_info->irq_counter_register == 0) || mapper_info->irq_reload_latch) {
         mapper_info->irq_counter_register = mapper_info->irq_latch_register;
@@ -192,9 +177,7 @@ bool Mapper004ScanlineIRQ(struct Cartridge* cartridge) {
     }
 
     if ((mapper_info->irq_counter_register == 0) && mapper_info->irq_enabled) {
-        return true;
-    } else {
-        return false;
+        cartridge->irq = true;
     }
 }
 
@@ -286,4 +269,39 @@ static void SwapCHRInversion(struct Cartridge* cartridge) {
     mapper_info->chr_rom_bank_6_offset = temp_2;
     mapper_info->chr_rom_bank_7_offset = temp_3;
     mapper_info->chr_rom_bank_8_offset = temp_4;
+    CartridgeUpdateCHRPages(cartridge);
 }
+
+uint32_t Mapper004MapPRGROM(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper004Info* mapper_info = (struct Mapper004Info*)cartridge->mapper_info;
+    if (address < 0xA000) {
+        return (address & 0x1FFF) + mapper_info->prg_rom_bank_1_offset;
+    } else if (address < 0xC000) {
+        return (address & 0x1FFF) + mapper_info->prg_rom_bank_2_offset;
+    } else if (address < 0xE000) {
+        return (address & 0x1FFF) + mapper_info->prg_rom_bank_3_offset;
+    } else {
+        return (address & 0x1FFF) + mapper_info->prg_rom_bank_4_offset;
+    }
+}
+
+uint32_t Mapper004MapCHR(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper004Info* mapper_info = (struct Mapper004Info*)cartridge->mapper_info;
+    if (address < 0x0400) {
+        return (address & 0x03FF) + mapper_info->chr_rom_bank_1_offset;
+    } else if (address < 0x0800) {
+        return (address & 0x03FF) + mapper_info->chr_rom_bank_2_offset;
+    } else if (address < 0x0C00) {
+        return (address & 0x03FF) + mapper_info->chr_rom_bank_3_offset;
+    } else if (address < 0x1000) {
+        return (address & 0x03FF) + mapper_info->chr_rom_bank_4_offset;
+    } else if (address < 0x1400) {
+        return (address & 0x03FF) + mapper_info->chr_rom_bank_5_offset;
+    } else if (address < 0x1800) {
+        return (address & 0x03FF) + mapper_info->chr_rom_bank_6_offset;
+    } else if (address < 0x1C00) {
+        return (address & 0x03FF) + mapper_info->chr_rom_bank_7_offset;
+    } else {
+        return (address & 0x03FF) + mapper_info->chr_rom_bank_8_offset;
+    }
+}
\ No newline at end of file
@@ -10,11 +10,12 @@
 
 
 uint8_t Mapper007ReadCPU(struct Cartridge* cartridge, uint16_t address);
-uint8_t Mapper007ReadPPU(struct Cartridge* cartridge, uint16_t address);
 void Mapper007WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 void Mapper007WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 
-bool Mapper007ScanlineIRQ(struct Cartridge* cartridge);
+void Mapper007ScanlineIRQ(struct Cartridge* cartridge);
+uint32_t Mapper007MapPRGROM(struct Cartridge* cartridge, uint16_t address);
+uint32_t Mapper007MapCHR(struct Cartridge* cartridge, uint16_t address);
 
 
 void Mapper007Init(struct Cartridge* cartridge) {
@@ -23,11 +24,12 @@ void Mapper007Init(struct Cartridge* cartridge) {
     mapper_info->prg_rom_bank_offset = 0;
 
     cartridge->MapperReadCPU = &Mapper007ReadCPU;
-    cartridge->MapperReadPPU = &Mapper007ReadPPU;
     cartridge->MapperWriteCPU = &Mapper007WriteCPU;
     cartridge->MapperWritePPU = &Mapper007WritePPU;
 
     cartridge->MapperScanlineIRQ = &Mapper007ScanlineIRQ;
+    cartridge->MapperMapPRGROM = &Mapper007MapPRGROM;
+    cartridge->MapperMapCHR = &Mapper007MapCHR;
 }
 
 uint8_t Mapper007ReadCPU(struct Cartridge* cartridge, uint16_t address) {
@@ -46,10 +48,6 @@ uint8_t Mapper007ReadCPU(struct Cartridge* cartridge, uint16_t address) {
     }
 }
 
-uint8_t Mapper007ReadPPU(struct Cartridge* cartridge, uint16_t address) {
-    return cartridge->chr_rom[address & 0x1FFF];
-}
-
 void Mapper007WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data) {
     struct Mapper007Info* mapper_info = (struct Mapper007Info*)cartridge->mapper_info;
     if (address < 0x6000) {
@@ -79,6 +77,14 @@ void Mapper007WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
 }
 
 
-bool Mapper007ScanlineIRQ(struct Cartridge* cartridge) {
-    return false;
+void Mapper007ScanlineIRQ(struct Cartridge* cartridge) {
+}
+
+uint32_t Mapper007MapPRGROM(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper007Info* mapper_info = (struct Mapper007Info*)cartridge->mapper_info;
+    return (address & 0x7FFF) + mapper_info->prg_rom_bank_offset;
+}
+
+uint32_t Mapper007MapCHR(struct Cartridge* cartridge, uint16_t address) {
+    return address & 0x1FFF;
 }
\ No newline at end of file
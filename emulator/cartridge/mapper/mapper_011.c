@@ -10,11 +10,12 @@
 
 
 uint8_t Mapper011ReadCPU(struct Cartridge* cartridge, uint16_t address);
-uint8_t Mapper011ReadPPU(struct Cartridge* cartridge, uint16_t address);
 void Mapper011WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 void Mapper011WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 
-bool Mapper011ScanlineIRQ(struct Cartridge* cartridge);
+void Mapper011ScanlineIRQ(struct Cartridge* cartridge);
+uint32_t Mapper011MapPRGROM(struct Cartridge* cartridge, uint16_t address);
+uint32_t Mapper011MapCHR(struct Cartridge* cartridge, uint16_t address);
 
 
 void Mapper011Init(struct Cartridge* cartridge) {
@@ -24,11 +25,12 @@ void Mapper011Init(struct Cartridge* cartridge) {
     mapper_info->chr_rom_bank_offset = 0;
 
     cartridge->MapperReadCPU = &Mapper011ReadCPU;
-    cartridge->MapperReadPPU = &Mapper011ReadPPU;
     cartridge->MapperWriteCPU = &Mapper011WriteCPU;
     cartridge->MapperWritePPU = &Mapper011WritePPU;
 
     cartridge->MapperScanlineIRQ = &Mapper011ScanlineIRQ;
+    cartridge->MapperMapPRGROM = &Mapper011MapPRGROM;
+    cartridge->MapperMapCHR = &Mapper011MapCHR;
 }
 
 uint8_t Mapper011ReadCPU(struct Cartridge* cartridge, uint16_t address) {
@@ -47,11 +49,6 @@ uint8_t Mapper011ReadCPU(struct Cartridge* cartridge, uint16_t address) {
     }
 }
 
-uint8_t Mapper011ReadPPU(struct Cartridge* cartridge, uint16_t address) {
-    struct Mapper011Info* mapper_info = (struct Mapper011Info*)cartridge->mapper_info;
-    return cartridge->chr_rom[(address & 0x1FFF) + mapper_info->chr_rom_bank_offset];
-}
-
 void Mapper011WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data) {
     struct Mapper011Info* mapper_info = (struct Mapper011Info*)cartridge->mapper_info;
     if (address < 0x6000) {
@@ -65,6 +62,7 @@ void Mapper011WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
     } else {
         mapper_info->prg_rom_bank_offset = (data & BANK_SELECT_PRG_ROM_BITS) * 0x8000;
         mapper_info->chr_rom_bank_offset = ((data & BANK_SELECT_CHR_ROM_BITS) >> 4) * 0x2000;
+        CartridgeUpdateCHRPages(cartridge);
     }
 }
 
@@ -78,6 +76,15 @@ void Mapper011WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
 }
 
 
-bool Mapper011ScanlineIRQ(struct Cartridge* cartridge) {
-    return false;
+void Mapper011ScanlineIRQ(struct Cartridge* cartridge) {
+}
+
+uint32_t Mapper011MapPRGROM(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper011Info* mapper_info = (struct Mapper011Info*)cartridge->mapper_info;
+    return (address & 0x7FFF) + mapper_info->prg_rom_bank_offset;
+}
+
+uint32_t Mapper011MapCHR(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper011Info* mapper_info = (struct Mapper011Info*)cartridge->mapper_info;
+    return (address & 0x1FFF) + mapper_info->chr_rom_bank_offset;
 }
\ No newline at end of file
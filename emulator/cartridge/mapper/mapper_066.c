@@ -10,11 +10,12 @@
 
 
 uint8_t Mapper066ReadCPU(struct Cartridge* cartridge, uint16_t address);
-uint8_t Mapper066ReadPPU(struct Cartridge* cartridge, uint16_t address);
 void Mapper066WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 void Mapper066WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t data);
 
-bool Mapper066ScanlineIRQ(struct Cartridge* cartridge);
+void Mapper066ScanlineIRQ(struct Cartridge* cartridge);
+uint32_t Mapper066MapPRGROM(struct Cartridge* cartridge, uint16_t address);
+uint32_t Mapper066MapCHR(struct Cartridge* cartridge, uint16_t address);
 
 
 void Mapper066Init(struct Cartridge* cartridge) {
@@ -24,11 +25,12 @@ void Mapper066Init(struct Cartridge* cartridge) {
     mapper_info->chr_rom_bank_offset = 0;
 
     cartridge->MapperReadCPU = &Mapper066ReadCPU;
-    cartridge->MapperReadPPU = &Mapper066ReadPPU;
     cartridge->MapperWriteCPU = &Mapper066WriteCPU;
     cartridge->MapperWritePPU = &Mapper066WritePPU;
 
     cartridge->MapperScanlineIRQ = &Mapper066ScanlineIRQ;
+    cartridge->MapperMapPRGROM = &Mapper066MapPRGROM;
+    cartridge->MapperMapCHR = &Mapper066MapCHR;
 }
 
 uint8_t Mapper066ReadCPU(struct Cartridge* cartridge, uint16_t address) {
@@ -47,11 +49,6 @@ uint8_t Mapper066ReadCPU(struct Cartridge* cartridge, uint16_t address) {
     }
 }
 
-uint8_t Mapper066ReadPPU(struct Cartridge* cartridge, uint16_t address) {
-    struct Mapper066Info* mapper_info = (struct Mapper066Info*)cartridge->mapper_info;
-    return cartridge->chr_rom[(address & 0x1FFF) + mapper_info->chr_rom_bank_offset];
-}
-
 void Mapper066WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t data) {
     struct Mapper066Info* mapper_info = (struct Mapper066Info*)cartridge->mapper_info;
     if (address < 0x6000) {
@@ -65,6 +62,7 @@ void Mapper066WriteCPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
     } else {
         mapper_info->prg_rom_bank_offset = ((data & BANK_SELECT_PRG_ROM_BITS) >> 4) * 0x8000;
         mapper_info->chr_rom_bank_offset = (data & BANK_SELECT_CHR_ROM_BITS) * 0x2000;
+        CartridgeUpdateCHRPages(cartridge);
     }
 }
 
@@ -78,6 +76,15 @@ void Mapper066WritePPU(struct Cartridge* cartridge, uint16_t address, uint8_t da
 }
 
 
-bool Mapper066ScanlineIRQ(struct Cartridge* cartridge) {
-    return false;
+void Mapper066ScanlineIRQ(struct Cartridge* cartridge) {
+}
+
+uint32_t Mapper066MapPRGROM(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper066Info* mapper_info = (struct Mapper066Info*)cartridge->mapper_info;
+    return (address & 0x7FFF) + mapper_info->prg_rom_bank_offset;
+}
+
+uint32_t Mapper066MapCHR(struct Cartridge* cartridge, uint16_t address) {
+    struct Mapper066Info* mapper_info = (struct Mapper066Info*)cartridge->mapper_info;
+    return (address & 0x1FFF) + mapper_info->chr_rom_bank_offset;
 }
\ No newline at end of file
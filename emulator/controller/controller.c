@@ -8,8 +8,8 @@ void ControllerInit(struct Controller* controller) {
     controller->status_1 = 0;
     controller->status_2 = 0;
     
-    controller->real_status_1 = 0;
-    controller->real_status_2 = 0;
+    atomic_init(&controller->real_status_1, 0);
+    atomic_init(&controller->real_status_2, 0);
 }
 
 void ControllerReset(struct Controller* controller) {
@@ -22,19 +22,19 @@ void ControllerReset(struct Controller* controller) {
 
 
 void ControllerKeyDown1(struct Controller* controller, enum Button button) {
-    controller->real_status_1 |= button;
+    atomic_fetch_or_explicit(&controller->real_status_1, (uint8_t)button, memory_order_relaxed);
 }
 
 void ControllerKeyDown2(struct Controller* controller, enum Button button) {
-    controller->real_status_2 |= button;
+    atomic_fetch_or_explicit(&controller->real_status_2, (uint8_t)button, memory_order_relaxed);
 }
 
 void ControllerKeyUp1(struct Controller* controller, enum Button button) {
-    controller->real_status_1 &= ~button;
+    atomic_fetch_and_explicit(&controller->real_status_1, (uint8_t)~button, memory_order_relaxed);
 }
 
 void ControllerKeyUp2(struct Controller* controller, enum Button button) {
-    controller->real_status_2 &= ~button;
+    atomic_fetch_and_explicit(&controller->real_status_2, (uint8_t)~button, memory_order_relaxed);
 }
 
 
@@ -48,7 +48,7 @@ uint8_t ControllerRead1(struct Controller* controller) {
             controller->status_1 |= 0x80;
             break;
         case 1: 
-            res |= (controller->real_status_1 & A);
+            res |= (atomic_load_explicit(&controller->real_status_1, memory_order_relaxed) & A);
             break; 
     }
     return res;
@@ -63,7 +63,7 @@ uint8_t ControllerRead2(struct Controller* controller) {
             controller->status_2 |= 0x80;
             break;
         case 1: 
-            res = (controller->real_status_2 & A);
+            res = (atomic_load_explicit(&controller->real_status_2, memory_order_relaxed) & A);
             break; 
     }
     return res;
@@ -73,7 +73,7 @@ void ControllerWrite(struct Controller* controller, uint8_t data) {
     controller->strobe = data & 0x01;
 
     if (controller->strobe == 0x01) {
-        controller->status_1 = controller->real_status_1; 
-        controller->status_2 = controller->real_status_2; 
+        controller->status_1 = atomic_load_explicit(&controller->real_status_1, memory_order_relaxed);
+        controller->status_2 = atomic_load_explicit(&controller->real_status_2, memory_order_relaxed);
     }
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define CONTROLLER_H
 
 #include <stdint.h>
+#include <stdatomic.h>
 
 enum Button {
     A =      0b00000001,
@@ -20,8 +21,9 @@ struct Controller {
     uint8_t status_1;
     uint8_t status_2;
     
-    uint8_t real_status_1;
-    uint8_t real_status_2;
+    // the keys currently held, written by the input (sdl) thread while the emulation thread reads them
+    _Atomic uint8_t real_status_1;
+    _Atomic uint8_t real_status_2;
 };
 
 void ControllerInit(struct Controller* controller);
@@ -2,6 +2,7 @@
 #include <stdio.h>
 
 #include "cpu.h"
+#include "profiler.h"
 #include "logger.h"
 
 
@@ -108,10 +109,10 @@ static inline void ClearAllFlags(struct CPU* cpu) {
 
 
 static inline uint8_t ReadByte(struct CPU* cpu, const uint16_t address) {
-    return CPUBusRead(cpu->cpu_bus, address);
+    return cpu->BusRead(cpu->cpu_bus, address);
 }
 static inline void WriteByte(struct CPU* cpu, const uint16_t address, const uint8_t data) {
-    bool dma_transfer_initiated = CPUBusWrite(cpu->cpu_bus, address, data);
+    bool dma_transfer_initiated = cpu->BusWrite(cpu->cpu_bus, address, data);
     if (dma_transfer_initiated) {
         cpu->dma_transfer = true;
         cpu->dma_aligned = false;
@@ -147,11 +148,14 @@ static inline void StackPushByte(struct CPU* cpu, const uint8_t data) {
     cpu->registers.stack_pointer--;
 }
 
+// the operands of | aren't sequenced, so the first pull needs its own statement
 static inline uint16_t StackPullBigEndianWord(struct CPU* cpu) {
-    return (StackPullByte(cpu) << 8) | StackPullByte(cpu);
+    uint8_t high = StackPullByte(cpu);
+    return (high << 8) | StackPullByte(cpu);
 } 
 static inline uint16_t StackPullLittleEndianWord(struct CPU* cpu) {
-    return StackPullByte(cpu) | (StackPullByte(cpu) << 8);
+    uint8_t low = StackPullByte(cpu);
+    return low | (StackPullByte(cpu) << 8);
 }
 static inline void StackPushBigEndianWord(struct CPU* cpu, uint16_t data) {
     // 6502 stack goes from higher address to lower (right to left)
@@ -794,6 +798,7 @@ typedef struct Instruction {
     void (*operator)(struct CPU*, const uint16_t);
     uint16_t (*address_mode)(struct CPU*);
     uint8_t cycles;
+    bool fixed_cycles;  // stores and read modify writes always take the page crossing cycle, it's already in cycles
 } Instruction;
 
 static const Instruction instructions[256] = {
@@ -829,7 +834,7 @@ static const Instruction instructions[256] = {
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//7 },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//4 },
     { .mnemonic="ORA", .operator=&ORA, .address_mode=&AbsoluteX, .cycles=4 },
-    { .mnemonic="ASL", .operator=&ASL, .address_mode=&AbsoluteX, .cycles=7 },
+    { .mnemonic="ASL", .operator=&ASL, .address_mode=&AbsoluteX, .cycles=7, .fixed_cycles=true },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//7 },
 	// 2
     { .mnemonic="JSR", .operator=&JSR, .address_mode=&Absolute, .cycles=6 },
@@ -863,7 +868,7 @@ static const Instruction instructions[256] = {
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//7 },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//4 },
     { .mnemonic="AND", .operator=&AND, .address_mode=&AbsoluteX, .cycles=4 },
-    { .mnemonic="ROL", .operator=&ROL, .address_mode=&AbsoluteX, .cycles=7 },
+    { .mnemonic="ROL", .operator=&ROL, .address_mode=&AbsoluteX, .cycles=7, .fixed_cycles=true },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//7 },
 	// 4
     { .mnemonic="RTI", .operator=&RTI, .address_mode=&Implied, .cycles=6 },
@@ -897,7 +902,7 @@ static const Instruction instructions[256] = {
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//7 },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//4 },
     { .mnemonic="EOR", .operator=&EOR, .address_mode=&AbsoluteX, .cycles=4 },
-    { .mnemonic="LSR", .operator=&LSR, .address_mode=&AbsoluteX, .cycles=7 },
+    { .mnemonic="LSR", .operator=&LSR, .address_mode=&AbsoluteX, .cycles=7, .fixed_cycles=true },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//7 },
 	// 6
     { .mnemonic="RTS", .operator=&RTS, .address_mode=&Implied, .cycles=6 },
@@ -931,7 +936,7 @@ static const Instruction instructions[256] = {
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//7 },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//4 },
     { .mnemonic="ADC", .operator=&ADC, .address_mode=&AbsoluteX, .cycles=4 },
-    { .mnemonic="ROR", .operator=&ROR, .address_mode=&AbsoluteX, .cycles=7 },
+    { .mnemonic="ROR", .operator=&ROR, .address_mode=&AbsoluteX, .cycles=7, .fixed_cycles=true },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//7 },
 	// 8
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//2 },
@@ -952,7 +957,7 @@ static const Instruction instructions[256] = {
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//4 },
 	// 9
     { .mnemonic="BCC", .operator=&BCC, .address_mode=&Relative, .cycles=2 },
-    { .mnemonic="STA", .operator=&STA, .address_mode=&IndirectY, .cycles=6 },
+    { .mnemonic="STA", .operator=&STA, .address_mode=&IndirectY, .cycles=6, .fixed_cycles=true },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//2 },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//6 },
     { .mnemonic="STY", .operator=&STY, .address_mode=&ZeroPageX, .cycles=4 },
@@ -960,11 +965,11 @@ static const Instruction instructions[256] = {
     { .mnemonic="STX", .operator=&STX, .address_mode=&ZeroPageY, .cycles=4 },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//4 },
     { .mnemonic="TYA", .operator=&TYA, .address_mode=&Implied, .cycles=2 },
-    { .mnemonic="STA", .operator=&STA, .address_mode=&AbsoluteY, .cycles=5 },
+    { .mnemonic="STA", .operator=&STA, .address_mode=&AbsoluteY, .cycles=5, .fixed_cycles=true },
     { .mnemonic="TXS", .operator=&TXS, .address_mode=&Implied, .cycles=2 },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//5 },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//5 },
-    { .mnemonic="STA", .operator=&STA, .address_mode=&AbsoluteX, .cycles=5 },
+    { .mnemonic="STA", .operator=&STA, .address_mode=&AbsoluteX, .cycles=5, .fixed_cycles=true },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//5 },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//5 },
 	// A
@@ -1033,7 +1038,7 @@ static const Instruction instructions[256] = {
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//7 },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//4 },
     { .mnemonic="CMP", .operator=&CMP, .address_mode=&AbsoluteX, .cycles=4 },
-    { .mnemonic="DEC", .operator=&DEC, .address_mode=&AbsoluteX, .cycles=7 },
+    { .mnemonic="DEC", .operator=&DEC, .address_mode=&AbsoluteX, .cycles=7, .fixed_cycles=true },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//7 },
 	// E
     { .mnemonic="CPX", .operator=&CPX, .address_mode=&Immediate, .cycles=2 },
@@ -1067,7 +1072,7 @@ static const Instruction instructions[256] = {
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//7 },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//4 },
     { .mnemonic="SBC", .operator=&SBC, .address_mode=&AbsoluteX, .cycles=4 },
-    { .mnemonic="INC", .operator=&INC, .address_mode=&AbsoluteX, .cycles=7 },
+    { .mnemonic="INC", .operator=&INC, .address_mode=&AbsoluteX, .cycles=7, .fixed_cycles=true },
     { .mnemonic="???", .operator=&ILL, .address_mode=&IlligalMode, .cycles=0 },//7 }
 };
 
@@ -1077,6 +1082,9 @@ static const Instruction instructions[256] = {
 void CPUInit(struct CPU* cpu, struct CPUBus* cpu_bus) {
     cpu->cpu_bus = cpu_bus;
 
+    cpu->BusRead = &CPUBusRead;
+    cpu->BusWrite = &CPUBusWrite;
+
     // registers
     cpu->registers.a_register = 0;
 	cpu->registers.x_register = 0; 
@@ -1088,6 +1096,7 @@ void CPUInit(struct CPU* cpu, struct CPUBus* cpu_bus) {
 
     cpu->remaining_cycles = 0;
     cpu->tick_counter = 0;
+    cpu->stall_cycles = 0;
 
     cpu->dma_transfer = false;
     cpu->dma_aligned = false;
@@ -1095,6 +1104,17 @@ void CPUInit(struct CPU* cpu, struct CPUBus* cpu_bus) {
     cpu->oam_address = 0;
     cpu->oam_data = 0;
 
+    cpu->trace_hook = NULL;
+    cpu->trace_hook_data = NULL;
+
+    cpu->profiler = NULL;
+
+#ifdef CPU_TRACE
+    memset(cpu->trace_buffer, 0, CPU_TRACE_BUFFER_SIZE * sizeof(struct CPUTraceEntry));
+    cpu->trace_index = 0;
+    cpu->trace_enabled = 1;
+#endif
+
     SetUnusedFlagValue(cpu, 1);
     SetIrqDisableFlagValue(cpu, 1);
 }
@@ -1109,6 +1129,7 @@ void CPUReset(struct CPU* cpu) {
     SetIrqDisableFlagValue(cpu, 1);
 
     cpu->remaining_cycles = 8;
+    cpu->stall_cycles = 0;
 
     cpu->dma_transfer = false;
     cpu->dma_aligned = false;
@@ -1123,14 +1144,20 @@ void CPUInterruptRequest(struct CPU* cpu) {
     if (GetIrqDisableFlagValue(cpu) == 0) {
         StackPushLittleEndianWord(cpu, cpu->registers.program_counter);
 
+        // the pushed flags keep the I flag as it was, otherwise RTI would leave irqs disabled
         SetBrkCommandFlagValue(cpu, 0);
-        SetIrqDisableFlagValue(cpu, 1);
         SetUnusedFlagValue(cpu, 1);
 
         StackPushByte(cpu, cpu->registers.status_flags);
+        SetIrqDisableFlagValue(cpu, 1);
 
+        uint16_t return_address = cpu->registers.program_counter;
         cpu->registers.program_counter = ReadLittleEndianWord(cpu, BREAK_INTERRUPT_OFFSET);
 
+        if (cpu->profiler != NULL) {
+            ProfilerInterrupt(cpu->profiler, PROFILER_IRQ, return_address, cpu->registers.program_counter);
+        }
+
         cpu->remaining_cycles = 7;
     }
 }
@@ -1139,18 +1166,25 @@ void CPUNonMaskableInterrupt(struct CPU* cpu) {
     StackPushLittleEndianWord(cpu, cpu->registers.program_counter);
 
     SetBrkCommandFlagValue(cpu, 0);
-    SetIrqDisableFlagValue(cpu, 1);
     SetUnusedFlagValue(cpu, 1);
 
     StackPushByte(cpu, cpu->registers.status_flags);
+    SetIrqDisableFlagValue(cpu, 1);
 
+    uint16_t return_address = cpu->registers.program_counter;
     cpu->registers.program_counter = ReadLittleEndianWord(cpu, NON_MASKABLE_INTERRUPT_OFFSET);
 
+    if (cpu->profiler != NULL) {
+        ProfilerInterrupt(cpu->profiler, PROFILER_NMI, return_address, cpu->registers.program_counter);
+    }
+
     cpu->remaining_cycles = 8;
 }
 
 void CPUClock(struct CPU* cpu) {
-    if (cpu->dma_transfer) {
+    if (cpu->stall_cycles != 0) {
+        cpu->stall_cycles--;
+    } else if (cpu->dma_transfer) {
         if (cpu->dma_aligned) {
             if (cpu->tick_counter % 2 == 0) {
                 cpu->oam_data = ReadByte(cpu, cpu->dma_address);
@@ -1169,13 +1203,38 @@ void CPUClock(struct CPU* cpu) {
         }
     } else {
         if (cpu->remaining_cycles == 0) {
+            if (cpu->trace_hook != NULL) {
+                cpu->trace_hook(cpu, cpu->trace_hook_data);
+            }
+
             uint8_t op_code = ReadByte(cpu, cpu->registers.program_counter);
+
+            if (cpu->profiler != NULL) {
+                ProfilerInstruction(cpu->profiler, cpu->registers.program_counter, op_code, cpu->tick_counter);
+            }
+
+#ifdef CPU_TRACE
+            struct CPUTraceEntry* trace_entry = &cpu->trace_buffer[cpu->trace_index & (CPU_TRACE_BUFFER_SIZE - 1)];
+            trace_entry->tick_counter = cpu->tick_counter;
+            trace_entry->program_counter = cpu->registers.program_counter;
+            trace_entry->op_code = op_code;
+            trace_entry->a_register = cpu->registers.a_register;
+            trace_entry->x_register = cpu->registers.x_register;
+            trace_entry->y_register = cpu->registers.y_register;
+            trace_entry->status_flags = cpu->registers.status_flags;
+            trace_entry->stack_pointer = cpu->registers.stack_pointer;
+            cpu->trace_index += cpu->trace_enabled;
+#endif
+
             cpu->registers.program_counter++;
 
             Instruction instruction = instructions[op_code];
 
             cpu->remaining_cycles = instruction.cycles;
             uint16_t absolute_address = instruction.address_mode(cpu);
+            if (instruction.fixed_cycles) {
+                cpu->remaining_cycles = instruction.cycles;
+            }
 
             instruction.operator(cpu, absolute_address);
         }
@@ -1185,10 +1244,73 @@ void CPUClock(struct CPU* cpu) {
     cpu->tick_counter++;
 }
 
-void CPUUpdateIrqDisableFlag(struct CPU* cpu, bool irq_enabled) {
-    SetIrqDisableFlagValue(cpu, (irq_enabled ? 0 : 1));
+void CPUTraceEnable(struct CPU* cpu, bool enabled) {
+#ifdef CPU_TRACE
+    cpu->trace_enabled = enabled ? 1 : 0;
+#else
+    LOG(WARNING, CPU, "cpu trace is not compiled in (configure with -DNES_CPU_TRACE=ON)\n");
+#endif
 }
 
+bool CPUTraceIsEnabled(struct CPU* cpu) {
+#ifdef CPU_TRACE
+    return cpu->trace_enabled;
+#else
+    return false;
+#endif
+}
+
+void CPUTraceDump(struct CPU* cpu, FILE* file) {
+#ifdef CPU_TRACE
+    // oldest entry first, if the buffer hasn't wrapped around yet the zeroed entries are skipped
+    uint32_t count = (cpu->trace_index < CPU_TRACE_BUFFER_SIZE) ? (uint32_t)cpu->trace_index : CPU_TRACE_BUFFER_SIZE;
+    // while recording is off the entry at trace_index keeps getting overwritten, after a wrap around that was the oldest one
+    if (!cpu->trace_enabled && count == CPU_TRACE_BUFFER_SIZE) {
+        count--;
+    }
+    
+    fprintf(file, "cpu trace (last %u instructions):\n", count);
+    for (uint64_t i = cpu->trace_index - count; i != cpu->trace_index; i++) {
+        struct CPUTraceEntry* trace_entry = &cpu->trace_buffer[i & (CPU_TRACE_BUFFER_SIZE - 1)];
+        fprintf(
+            file, "%04X  %02X  %s  A:%02X X:%02X Y:%02X P:%02X SP:%02X CYC:%llu\n", 
+            trace_entry->program_counter, trace_entry->op_code, instructions[trace_entry->op_code].mnemonic, 
+            trace_entry->a_register, trace_entry->x_register, trace_entry->y_register, 
+            trace_entry->status_flags, trace_entry->stack_pointer, (unsigned long long)trace_entry->tick_counter
+        );
+    }
+    fflush(file);
+#else
+    fprintf(file, "cpu trace is not compiled in (configure with -DNES_CPU_TRACE=ON)\n");
+#endif
+}
+
+void CPUSetWatchpointsEnabled(struct CPU* cpu, bool enabled) {
+    cpu->BusRead = enabled ? &CPUBusReadWatched : &CPUBusRead;
+    cpu->BusWrite = enabled ? &CPUBusWriteWatched : &CPUBusWrite;
+}
+
+void CPUSetProfiler(struct CPU* cpu, struct Profiler* profiler) {
+    cpu->profiler = profiler;
+}
+
+const char* CPUGetMnemonic(const uint8_t op_code) {
+    return instructions[op_code].mnemonic;
+}
+
+void CPUSetTraceHook(struct CPU* cpu, void (*trace_hook)(struct CPU*, void*), void* trace_hook_data) {
+    cpu->trace_hook = trace_hook;
+    cpu->trace_hook_data = trace_hook_data;
+}
+
+
+// reads for the disassembly always skip the watchpoints, looking at memmory in the debug view shouldn't trigger them
+static inline uint8_t PeekByte(struct CPU* cpu, const uint16_t address) {
+    return CPUBusRead(cpu->cpu_bus, address);
+}
+static inline uint16_t PeekLittleEndianWord(struct CPU* cpu, const uint16_t address_start) {
+    return PeekByte(cpu, address_start) | (PeekByte(cpu, (address_start + 1)) << 8);
+}
 
 static inline bool IsSafeToReadByte(uint16_t address) {
     return (address < 0x2000 || address >= 0x4020);
@@ -1198,195 +1320,271 @@ static inline bool IsSafeToReadLittleEndieanWord(uint16_t address) {
     return (address < 0x1FFF || address >= 0x4021);
 }
 
-uint8_t CPUDisassemble(
-    struct CPU* cpu, uint16_t start_address, uint16_t count, 
-    char disassembly_buffer[DISASSEMBLY_BUFFER_HEIGHT][DISASSEMBLY_BUFFER_WIDTH],
-    char zero_page_buffer[ZERO_PAGE_BYTE_BUFFER_HEIGHT][ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH],
-    char registers_buffer[REGISTERS_BUFFER_HEIGHT][REGISTER_WIDTH]
-) {
-    char registers_row_buffer[REGISTER_WIDTH + 1];
-    for (int y = 0; y < REGISTERS_BUFFER_HEIGHT; y++) {
-        for (int i = 0; i < (REGISTER_WIDTH + 1); i++) {
-            registers_row_buffer[i] = ' ';
-        }
-
-        int x = REGISTER_WIDTH;
-        switch (y) {
-            case 0: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "A: 0x%02X", cpu->registers.a_register); registers_row_buffer[x] = ' '; break;
-            case 1: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "X: 0x%02X", cpu->registers.x_register); registers_row_buffer[x] = ' '; break;
-            case 2: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "Y: 0x%02X", cpu->registers.y_register); registers_row_buffer[x] = ' '; break;
-            case 3: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "CARRY: %s", GetCarryFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
-            case 4: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "ZERO: %s", GetZeroFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
-            case 5: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "IRQ DISABLE: %s", GetIrqDisableFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
-            case 6: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "DECIMAL MODE: %s", GetDecimalModeFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
-            case 7: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "BRK COMMAND: %s", GetBrkCommandFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
-            case 8: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "UNUSED: %s", GetUnusedFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
-            case 9: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "OVERFLOW: %s", GetOverflowFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
-            case 10: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "NEGATIVE: %s", GetNegativeFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
-            case 11: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "STACK POINTER: 0x%02X", cpu->registers.stack_pointer); registers_row_buffer[x] = ' '; break;
-            case 12: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "PROGRAM COUNTER: 0x%04X", cpu->registers.program_counter); registers_row_buffer[x] = ' '; break;
-        }
-
-        memcpy(&registers_buffer[y], &registers_row_buffer[0], REGISTER_WIDTH * sizeof(char));
+// nestest.log shows the value at the effective address, it's left out when reading it could have side effects
+static void AppendValue(struct CPU* cpu, const uint16_t address, char* buffer, const size_t buffer_size) {
+    size_t length = strlen(buffer);
+    if (IsSafeToReadByte(address) && length < buffer_size) {
+        snprintf(&buffer[length], buffer_size - length, " = %02X", PeekByte(cpu, address));
     }
+}
 
+uint8_t CPUDisassembleInstruction(struct CPU* cpu, const uint16_t address, char* buffer, const size_t buffer_size) {
+    // formats a single instruction the way nestest.log does (with the effective addresses and values for the current registers)
+    // and returns its length in bytes
+    if (!IsSafeToReadByte(address)) {
+        snprintf(buffer, buffer_size, "UNSAFE ADDRESS");
+        return 1;
+    }
 
+    Instruction instruction = instructions[PeekByte(cpu, address)];
+    uint16_t operand_address = address + 1;
+    uint8_t x = cpu->registers.x_register;
+    uint8_t y = cpu->registers.y_register;
+
+    if (instruction.address_mode == &Implied || instruction.address_mode == &IlligalMode) {
+        snprintf(buffer, buffer_size, "%s", instruction.mnemonic);
+        return 1;
+    } else if (instruction.address_mode == &Accumulator) {
+        snprintf(buffer, buffer_size, "%s A", instruction.mnemonic);
+        return 1;
+    } else if (instruction.address_mode == &Immediate || instruction.address_mode == &ZeroPage || instruction.address_mode == &ZeroPageX 
+            || instruction.address_mode == &ZeroPageY || instruction.address_mode == &IndirectX || instruction.address_mode == &IndirectY 
+            || instruction.address_mode == &Relative) {
+        if (!IsSafeToReadByte(operand_address)) {
+            snprintf(buffer, buffer_size, "%s UNSAFE ADDRESS", instruction.mnemonic);
+            return 2;
+        }
+        uint8_t operand = PeekByte(cpu, operand_address);
+
+        if (instruction.address_mode == &Immediate) {
+            snprintf(buffer, buffer_size, "%s #$%02X", instruction.mnemonic, operand);
+        } else if (instruction.address_mode == &ZeroPage) {
+            snprintf(buffer, buffer_size, "%s $%02X", instruction.mnemonic, operand);
+            AppendValue(cpu, operand, buffer, buffer_size);
+        } else if (instruction.address_mode == &ZeroPageX) {
+            snprintf(buffer, buffer_size, "%s $%02X,X @ %02X", instruction.mnemonic, operand, (uint8_t)(operand + x));
+            AppendValue(cpu, (uint8_t)(operand + x), buffer, buffer_size);
+        } else if (instruction.address_mode == &ZeroPageY) {
+            snprintf(buffer, buffer_size, "%s $%02X,Y @ %02X", instruction.mnemonic, operand, (uint8_t)(operand + y));
+            AppendValue(cpu, (uint8_t)(operand + y), buffer, buffer_size);
+        } else if (instruction.address_mode == &IndirectX) {
+            uint8_t pointer = operand + x;
+            uint16_t effective_address = PeekByte(cpu, pointer) | (PeekByte(cpu, (uint8_t)(pointer + 1)) << 8);
+            snprintf(buffer, buffer_size, "%s ($%02X,X) @ %02X = %04X", instruction.mnemonic, operand, pointer, effective_address);
+            AppendValue(cpu, effective_address, buffer, buffer_size);
+        } else if (instruction.address_mode == &IndirectY) {
+            uint16_t base_address = PeekByte(cpu, operand) | (PeekByte(cpu, (uint8_t)(operand + 1)) << 8);
+            uint16_t effective_address = base_address + y;
+            snprintf(buffer, buffer_size, "%s ($%02X),Y = %04X @ %04X", instruction.mnemonic, operand, base_address, effective_address);
+            AppendValue(cpu, effective_address, buffer, buffer_size);
+        } else {
+            uint16_t relative_address = (operand & 0x80) ? (operand | 0xFF00) : operand;
+            snprintf(buffer, buffer_size, "%s $%04X", instruction.mnemonic, (uint16_t)(address + 2 + relative_address));
+        }
+        return 2;
+    } else {
+        if (!IsSafeToReadLittleEndieanWord(operand_address)) {
+            snprintf(buffer, buffer_size, "%s UNSAFE ADDRESS", instruction.mnemonic);
+            return 3;
+        }
+        uint16_t operand = PeekLittleEndianWord(cpu, operand_address);
 
-
-    char zero_page_row_buffer[ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH + 1];
-
-    for (int y = 0; y < ZERO_PAGE_BYTE_BUFFER_HEIGHT; y++) {
-        for (int x = 0; x < ZERO_PAGE_BYTE_BUFFER_WIDTH; x++) {
-            uint16_t temp_address = y * ZERO_PAGE_BYTE_BUFFER_WIDTH + x;
-            snprintf(&zero_page_row_buffer[x * ZERO_PAGE_BYTE_WIDTH], (ZERO_PAGE_BYTE_WIDTH + 1) * sizeof(char), "%02X ", ReadByte(cpu, temp_address));
+        if (instruction.address_mode == &Absolute) {
+            snprintf(buffer, buffer_size, "%s $%04X", instruction.mnemonic, operand);
+            if (instruction.operator != &JMP && instruction.operator != &JSR) {
+                AppendValue(cpu, operand, buffer, buffer_size);
+            }
+        } else if (instruction.address_mode == &AbsoluteX) {
+            snprintf(buffer, buffer_size, "%s $%04X,X @ %04X", instruction.mnemonic, operand, (uint16_t)(operand + x));
+            AppendValue(cpu, operand + x, buffer, buffer_size);
+        } else if (instruction.address_mode == &AbsoluteY) {
+            snprintf(buffer, buffer_size, "%s $%04X,Y @ %04X", instruction.mnemonic, operand, (uint16_t)(operand + y));
+            AppendValue(cpu, operand + y, buffer, buffer_size);
+        } else {
+            // same page wrap as Indirect
+            uint16_t high_byte_address = (operand & 0xFF00) | ((operand + 1) & 0x00FF);
+            if (IsSafeToReadByte(operand) && IsSafeToReadByte(high_byte_address)) {
+                snprintf(buffer, buffer_size, "%s ($%04X) = %04X", instruction.mnemonic, operand, PeekByte(cpu, operand) | (PeekByte(cpu, high_byte_address) << 8));
+            } else {
+                snprintf(buffer, buffer_size, "%s ($%04X)", instruction.mnemonic, operand);
+            }
         }
-        memcpy(&zero_page_buffer[y], &zero_page_row_buffer[0], ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH * sizeof(char));
+        return 3;
     }
+}
 
+// formats one row of the debug view disassembly and returns the address of the next instruction
+static uint16_t DisassembleRow(struct CPU* cpu, const uint16_t address, char row[DISASSEMBLY_BUFFER_WIDTH]) {
+    uint16_t dummy_address = address;
+    char disassembly_row_buffer[DISASSEMBLY_BUFFER_WIDTH + 1];
 
+    for (int i = 0; i < (DISASSEMBLY_BUFFER_WIDTH + 1); i++) {
+        disassembly_row_buffer[i] = ' ';
+    }        
 
+    int x = 0;
+    
+    if (IsSafeToReadByte(dummy_address)) { // with certain mappers this still could cause side effects but minimizes the chance
+        uint8_t op_code = PeekByte(cpu, dummy_address);
+        Instruction instruction = instructions[op_code];
 
-    // note that for addressing modes that require a register can't fully be disassembled 
-    // because registers are a runtime thing and this function only disassembles the code doesn't execute it 
+        if ((x + 12) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+            snprintf(&disassembly_row_buffer[x], 12 * sizeof(char), "0x%04X: %s", dummy_address, instruction.mnemonic);
+        }
+        x += 11;    // the reason for adding one less to x is because snprintf also prints a null terminator and this way the next snprintf overlaps
 
-    uint16_t dummy_address = start_address;
-    uint16_t prev_dummy_address = start_address;
+        dummy_address++;
 
-    uint8_t active_row = DISASSEMBLY_BUFFER_HEIGHT;
-    char disassembly_row_buffer[DISASSEMBLY_BUFFER_WIDTH + 1];
-    
-    for (int y = 0; y < count && y < DISASSEMBLY_BUFFER_HEIGHT; y++) {
-        for (int i = 0; i < (DISASSEMBLY_BUFFER_WIDTH + 1); i++) {
-            disassembly_row_buffer[i] = ' ';
-        }        
-    
-        int x = 0;
-        
-        if (IsSafeToReadByte(dummy_address)) { // with certain mappers this still could cause side effects but minimizes the chance
-            uint8_t op_code = ReadByte(cpu, dummy_address);
-            Instruction instruction = instructions[op_code];
-    
-            if ((x + 12) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                snprintf(&disassembly_row_buffer[x], 12 * sizeof(char), "0x%04X: %s", dummy_address, instruction.mnemonic);
-            }
-            x += 11;    // the reason for adding one less to x is because snprintf also prints a null terminator and this way the next snprintf overlaps
-    
-            dummy_address++;
-    
-            if (instruction.address_mode == &IlligalMode) {
-                if ((x + 5) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                    snprintf(&disassembly_row_buffer[x], 5 * sizeof(char), " ???");
-                }    
-                x += 4;
-            }
-            else if (instruction.address_mode == &Accumulator) {
-                if ((x + 5) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                    snprintf(&disassembly_row_buffer[x], 5 * sizeof(char), " ACC");
-                }    
-                x += 4;
+        if (instruction.address_mode == &IlligalMode) {
+            if ((x + 5) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                snprintf(&disassembly_row_buffer[x], 5 * sizeof(char), " ???");
+            }    
+            x += 4;
+        }
+        else if (instruction.address_mode == &Accumulator) {
+            if ((x + 5) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                snprintf(&disassembly_row_buffer[x], 5 * sizeof(char), " ACC");
+            }    
+            x += 4;
+        }
+        else if (instruction.address_mode == &Implied) {
+            if ((x + 5) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                snprintf(&disassembly_row_buffer[x], 5 * sizeof(char), " IMP");
+            } 
+            x += 4;
+        }
+        else if (instruction.address_mode == &Immediate) {
+            if (IsSafeToReadByte(dummy_address)) {
+                uint8_t temp_address = PeekByte(cpu, dummy_address);
+                dummy_address++;
+                if ((x + 11) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 11 * sizeof(char), " IMM  0x%02X", temp_address);
+                } 
+                x += 10;
+            } else { 
+                if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
+                }
+                x += 15;
             }
-            else if (instruction.address_mode == &Implied) {
-                if ((x + 5) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                    snprintf(&disassembly_row_buffer[x], 5 * sizeof(char), " IMP");
+        }
+        else if (instruction.address_mode == &ZeroPage) {
+            if (IsSafeToReadByte(dummy_address)) {
+                uint8_t temp_address = PeekByte(cpu, dummy_address);
+                dummy_address++;
+                if ((x + 11) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 11 * sizeof(char), " ZP   0x%02X", temp_address);
                 } 
-                x += 4;
+                x += 10;
+            } else { 
+                if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
+                }
+                x += 15;
             }
-            else if (instruction.address_mode == &Immediate) {
-                if (IsSafeToReadByte(dummy_address)) {
-                    uint8_t temp_address = ReadByte(cpu, dummy_address);
-                    dummy_address++;
-                    if ((x + 11) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 11 * sizeof(char), " IMM  0x%02X", temp_address);
-                    } 
-                    x += 10;
-                } else { 
-                    if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
-                    }
-                    x += 15;
+        }
+        else if (instruction.address_mode == &ZeroPageX) {
+            if (IsSafeToReadByte(dummy_address)) {
+                uint8_t temp_address = PeekByte(cpu, dummy_address);
+                dummy_address++;
+                if ((x + 11) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 11 * sizeof(char), " ZPX  0x%02X", temp_address);
+                } 
+                x += 10;
+            } else { 
+                if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
                 }
+                x += 15;
             }
-            else if (instruction.address_mode == &ZeroPage) {
-                if (IsSafeToReadByte(dummy_address)) {
-                    uint8_t temp_address = ReadByte(cpu, dummy_address);
-                    dummy_address++;
-                    if ((x + 11) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 11 * sizeof(char), " ZP   0x%02X", temp_address);
-                    } 
-                    x += 10;
-                } else { 
-                    if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
-                    }
-                    x += 15;
+        }
+        else if (instruction.address_mode == &ZeroPageY) {
+            if (IsSafeToReadByte(dummy_address)) {
+                uint8_t temp_address = PeekByte(cpu, dummy_address);
+                dummy_address++;
+                if ((x + 11) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 11 * sizeof(char), " ZPY  0x%02X", temp_address);
+                } 
+                x += 10;
+            } else { 
+                if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
                 }
+                x += 15;
             }
-            else if (instruction.address_mode == &ZeroPageX) {
-                if (IsSafeToReadByte(dummy_address)) {
-                    uint8_t temp_address = ReadByte(cpu, dummy_address);
-                    dummy_address++;
-                    if ((x + 11) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 11 * sizeof(char), " ZPX  0x%02X", temp_address);
-                    } 
-                    x += 10;
-                } else { 
-                    if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
-                    }
-                    x += 15;
+        }
+        else if (instruction.address_mode == &Relative) {
+            if (IsSafeToReadByte(dummy_address)) {
+                uint8_t temp_address = PeekByte(cpu, dummy_address);
+                dummy_address++;
+                if ((x + 11) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 11 * sizeof(char), " REL %c0x%02X", (((int8_t)temp_address < 0) ? '-' : '+'), (((int8_t)temp_address < 0) ? (-1 * (int8_t)temp_address) : temp_address));
+                } 
+                x += 10;
+            } else { 
+                if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
                 }
+                x += 15;
             }
-            else if (instruction.address_mode == &ZeroPageY) {
-                if (IsSafeToReadByte(dummy_address)) {
-                    uint8_t temp_address = ReadByte(cpu, dummy_address);
-                    dummy_address++;
-                    if ((x + 11) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 11 * sizeof(char), " ZPY  0x%02X", temp_address);
-                    } 
-                    x += 10;
-                } else { 
-                    if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
-                    }
-                    x += 15;
+        }
+        else if (instruction.address_mode == &Absolute) {
+            if (IsSafeToReadLittleEndieanWord(dummy_address)) {
+                uint16_t temp_address = PeekLittleEndianWord(cpu, dummy_address);
+                dummy_address += 2;
+                if ((x + 13) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 13 * sizeof(char), " ABS  0x%04X", temp_address);
+                } 
+                x += 12;
+            } else { 
+                if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
                 }
+                x += 15;
             }
-            else if (instruction.address_mode == &Relative) {
-                if (IsSafeToReadByte(dummy_address)) {
-                    uint8_t temp_address = ReadByte(cpu, dummy_address);
-                    dummy_address++;
-                    if ((x + 11) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 11 * sizeof(char), " REL %c0x%02X", (((int8_t)temp_address < 0) ? '-' : '+'), (((int8_t)temp_address < 0) ? (-1 * (int8_t)temp_address) : temp_address));
-                    } 
-                    x += 10;
-                } else { 
-                    if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
-                    }
-                    x += 15;
+        }
+        else if (instruction.address_mode == &AbsoluteX) {
+            if (IsSafeToReadLittleEndieanWord(dummy_address)) {
+                uint16_t temp_address = PeekLittleEndianWord(cpu, dummy_address);
+                dummy_address += 2;
+                if ((x + 13) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 13 * sizeof(char), " ABX  0x%04X", temp_address);
+                } 
+                x += 12;
+            } else { 
+                if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
                 }
+                x += 15;
             }
-            else if (instruction.address_mode == &Absolute) {
-                if (IsSafeToReadLittleEndieanWord(dummy_address)) {
-                    uint16_t temp_address = ReadLittleEndianWord(cpu, dummy_address);
-                    dummy_address += 2;
-                    if ((x + 13) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 13 * sizeof(char), " ABS  0x%04X", temp_address);
-                    } 
-                    x += 12;
-                } else { 
-                    if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
-                    }
-                    x += 15;
+        }
+        else if (instruction.address_mode == &AbsoluteY) {
+            if (IsSafeToReadLittleEndieanWord(dummy_address)) {
+                uint16_t temp_address = PeekLittleEndianWord(cpu, dummy_address);
+                dummy_address += 2;
+                if ((x + 13) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 13 * sizeof(char), " ABY  0x%04X", temp_address);
+                } 
+                x += 12;
+            } else { 
+                if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
                 }
+                x += 15;
             }
-            else if (instruction.address_mode == &AbsoluteX) {
-                if (IsSafeToReadLittleEndieanWord(dummy_address)) {
-                    uint16_t temp_address = ReadLittleEndianWord(cpu, dummy_address);
-                    dummy_address += 2;
+        }
+        else if (instruction.address_mode == &Indirect) {
+            if (IsSafeToReadLittleEndieanWord(dummy_address)) {
+                uint16_t temp_address_ptr = PeekLittleEndianWord(cpu, dummy_address);
+                dummy_address += 2;
+        
+                uint16_t temp_address_ptr_to_high = ((temp_address_ptr & 0xFF00) | ((temp_address_ptr + 1) & 0x00FF));
+                uint16_t temp_address_ptr_to_low = temp_address_ptr;
+        
+                if (IsSafeToReadByte(temp_address_ptr_to_low) && IsSafeToReadByte(temp_address_ptr_to_high)) {
+                    uint16_t temp_address = (uint16_t)(PeekByte(cpu, temp_address_ptr_to_high) << 8) | (uint16_t)PeekByte(cpu, temp_address_ptr_to_low);
                     if ((x + 13) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 13 * sizeof(char), " ABX  0x%04X", temp_address);
+                        snprintf(&disassembly_row_buffer[x], 13 * sizeof(char), " IND  0x%04X", temp_address);
                     } 
                     x += 12;
                 } else { 
@@ -1395,13 +1593,25 @@ uint8_t CPUDisassemble(
                     }
                     x += 15;
                 }
+            } else { 
+                if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
+                }
+                x += 15;
             }
-            else if (instruction.address_mode == &AbsoluteY) {
-                if (IsSafeToReadLittleEndieanWord(dummy_address)) {
-                    uint16_t temp_address = ReadLittleEndianWord(cpu, dummy_address);
-                    dummy_address += 2;
+        }
+        else if (instruction.address_mode == &IndirectX) {
+            if (IsSafeToReadByte(dummy_address)) {
+                uint8_t temp_address_ptr = PeekByte(cpu, dummy_address);
+                dummy_address++;
+            
+                uint16_t temp_address_ptr_to_high = (((uint16_t)temp_address_ptr + cpu->registers.x_register + 1) & 0x00FF);
+                uint16_t temp_address_ptr_to_low = (((uint16_t)temp_address_ptr + cpu->registers.x_register) & 0x00FF);
+            
+                if (IsSafeToReadByte(temp_address_ptr_to_low) && IsSafeToReadByte(temp_address_ptr_to_high)) {
+                    uint16_t temp_address = (uint16_t)(PeekByte(cpu, temp_address_ptr_to_high) << 8) | (uint16_t)PeekByte(cpu, temp_address_ptr_to_low);
                     if ((x + 13) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 13 * sizeof(char), " ABY  0x%04X", temp_address);
+                        snprintf(&disassembly_row_buffer[x], 13 * sizeof(char), " INX  0x%04X", temp_address);
                     } 
                     x += 12;
                 } else { 
@@ -1410,106 +1620,234 @@ uint8_t CPUDisassemble(
                     }
                     x += 15;
                 }
+            } else { 
+                if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
+                }
+                x += 15;
             }
-            else if (instruction.address_mode == &Indirect) {
-                if (IsSafeToReadLittleEndieanWord(dummy_address)) {
-                    uint16_t temp_address_ptr = ReadLittleEndianWord(cpu, dummy_address);
-                    dummy_address += 2;
+        }
+        else if (instruction.address_mode == &IndirectY) {
+            if (IsSafeToReadByte(dummy_address)) {
+                uint8_t temp_address_ptr = PeekByte(cpu, dummy_address);
+                dummy_address++;
             
-                    uint16_t temp_address_ptr_to_high = ((temp_address_ptr & 0xFF00) | ((temp_address_ptr + 1) & 0x00FF));
-                    uint16_t temp_address_ptr_to_low = temp_address_ptr;
+                uint16_t temp_address_ptr_to_high = (((uint16_t)temp_address_ptr + 1) & 0x00FF);
+                uint16_t temp_address_ptr_to_low = (uint16_t)temp_address_ptr;
             
-                    if (IsSafeToReadByte(temp_address_ptr_to_low) && IsSafeToReadByte(temp_address_ptr_to_high)) {
-                        uint16_t temp_address = (uint16_t)(ReadByte(cpu, temp_address_ptr_to_high) << 8) | (uint16_t)ReadByte(cpu, temp_address_ptr_to_low);
-                        if ((x + 13) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                            snprintf(&disassembly_row_buffer[x], 13 * sizeof(char), " IND  0x%04X", temp_address);
-                        } 
-                        x += 12;
-                    } else { 
-                        if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                            snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
-                        }
-                        x += 15;
-                    }
+                if (IsSafeToReadByte(temp_address_ptr_to_low) && IsSafeToReadByte(temp_address_ptr_to_high)) {
+                    uint16_t temp_address = (uint16_t)(PeekByte(cpu, temp_address_ptr_to_high) << 8) | (uint16_t)PeekByte(cpu, temp_address_ptr_to_low);
+                    temp_address += cpu->registers.y_register;
+                    if ((x + 13) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                        snprintf(&disassembly_row_buffer[x], 13 * sizeof(char), " INY  0x%04X", temp_address);
+                    } 
+                    x += 12;
                 } else { 
                     if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
                         snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
                     }
                     x += 15;
                 }
-            }
-            else if (instruction.address_mode == &IndirectX) {
-                if (IsSafeToReadByte(dummy_address)) {
-                    uint8_t temp_address_ptr = ReadByte(cpu, dummy_address);
-                    dummy_address++;
-                
-                    uint16_t temp_address_ptr_to_high = (((uint16_t)temp_address_ptr + cpu->registers.x_register + 1) & 0x00FF);
-                    uint16_t temp_address_ptr_to_low = (((uint16_t)temp_address_ptr + cpu->registers.x_register) & 0x00FF);
-                
-                    if (IsSafeToReadByte(temp_address_ptr_to_low) && IsSafeToReadByte(temp_address_ptr_to_high)) {
-                        uint16_t temp_address = (uint16_t)(ReadByte(cpu, temp_address_ptr_to_high) << 8) | (uint16_t)ReadByte(cpu, temp_address_ptr_to_low);
-                        if ((x + 13) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                            snprintf(&disassembly_row_buffer[x], 13 * sizeof(char), " INX  0x%04X", temp_address);
-                        } 
-                        x += 12;
-                    } else { 
-                        if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                            snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
-                        }
-                        x += 15;
-                    }
-                } else { 
-                    if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
-                    }
-                    x += 15;
+            } else { 
+                if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+                    snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
                 }
+                x += 15;
             }
-            else if (instruction.address_mode == &IndirectY) {
-                if (IsSafeToReadByte(dummy_address)) {
-                    uint8_t temp_address_ptr = ReadByte(cpu, dummy_address);
-                    dummy_address++;
-                
-                    uint16_t temp_address_ptr_to_high = (((uint16_t)temp_address_ptr + 1) & 0x00FF);
-                    uint16_t temp_address_ptr_to_low = (uint16_t)temp_address_ptr;
-                
-                    if (IsSafeToReadByte(temp_address_ptr_to_low) && IsSafeToReadByte(temp_address_ptr_to_high)) {
-                        uint16_t temp_address = (uint16_t)(ReadByte(cpu, temp_address_ptr_to_high) << 8) | (uint16_t)ReadByte(cpu, temp_address_ptr_to_low);
-                        temp_address += cpu->registers.y_register;
-                        if ((x + 13) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                            snprintf(&disassembly_row_buffer[x], 13 * sizeof(char), " INY  0x%04X", temp_address);
-                        } 
-                        x += 12;
-                    } else { 
-                        if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                            snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
-                        }
-                        x += 15;
-                    }
-                } else { 
-                    if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                        snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
-                    }
-                    x += 15;
-                }
-            }
-            else {
-                LOG(ERROR, CPU, "unknown addressing mode\n");
+        }
+        else {
+            LOG(ERROR, CPU, "unknown addressing mode\n");
+        }
+    } else { 
+        if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
+            snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
+        }
+        x += 15;
+    }
+
+    if (x >= DISASSEMBLY_BUFFER_WIDTH) {
+        // this means something didn't fit
+        LOG(ERROR, CPU, "disassembly character buffer too thin\n");
+    }
+    
+    disassembly_row_buffer[x] = ' ';    // removes null terminator at the end
+    memcpy(row, &disassembly_row_buffer[0], DISASSEMBLY_BUFFER_WIDTH * sizeof(char));
+
+    return dummy_address;
+}
+
+// everything the text of a disassembly row depends on, if these are the same the cached row can be reused
+static void GetDisassemblyKey(struct CPU* cpu, const uint16_t address, uint8_t key[DISASSEMBLY_KEY_SIZE]) {
+    memset(key, 0, DISASSEMBLY_KEY_SIZE * sizeof(uint8_t));
+
+    if (!IsSafeToReadByte(address)) {
+        key[0] = 1;
+        return;
+    }
+
+    uint8_t op_code = PeekByte(cpu, address);
+    Instruction instruction = instructions[op_code];
+    key[1] = op_code;
+
+    uint16_t operand_address = address + 1;
+    if (instruction.address_mode == &Implied || instruction.address_mode == &Accumulator || instruction.address_mode == &IlligalMode) {
+        return;
+    } else if (instruction.address_mode == &Absolute || instruction.address_mode == &AbsoluteX || instruction.address_mode == &AbsoluteY || instruction.address_mode == &Indirect) {
+        if (!IsSafeToReadLittleEndieanWord(operand_address)) {
+            key[0] = 2;
+            return;
+        }
+        key[2] = PeekByte(cpu, operand_address);
+        key[3] = PeekByte(cpu, operand_address + 1);
+    } else {
+        if (!IsSafeToReadByte(operand_address)) {
+            key[0] = 2;
+            return;
+        }
+        key[2] = PeekByte(cpu, operand_address);
+    }
+
+    // the indirect modes also show the address the pointer points to (with the current x/y)
+    uint16_t pointer_to_low;
+    uint16_t pointer_to_high;
+    if (instruction.address_mode == &Indirect) {
+        uint16_t pointer = (key[3] << 8) | key[2];
+        pointer_to_low = pointer;
+        pointer_to_high = ((pointer & 0xFF00) | ((pointer + 1) & 0x00FF));
+    } else if (instruction.address_mode == &IndirectX) {
+        pointer_to_low = (((uint16_t)key[2] + cpu->registers.x_register) & 0x00FF);
+        pointer_to_high = (((uint16_t)key[2] + cpu->registers.x_register + 1) & 0x00FF);
+        key[6] = cpu->registers.x_register;
+    } else if (instruction.address_mode == &IndirectY) {
+        pointer_to_low = (uint16_t)key[2];
+        pointer_to_high = (((uint16_t)key[2] + 1) & 0x00FF);
+        key[6] = cpu->registers.y_register;
+    } else {
+        return;
+    }
+
+    if (!IsSafeToReadByte(pointer_to_low) || !IsSafeToReadByte(pointer_to_high)) {
+        key[0] |= 4;
+        return;
+    }
+    key[4] = PeekByte(cpu, pointer_to_low);
+    key[5] = PeekByte(cpu, pointer_to_high);
+}
+
+static inline bool RegistersEqual(const struct Registers* a, const struct Registers* b) {
+    return a->a_register == b->a_register && a->x_register == b->x_register && a->y_register == b->y_register 
+        && a->status_flags == b->status_flags && a->stack_pointer == b->stack_pointer && a->program_counter == b->program_counter;
+}
+
+void CPUDisassemblyCacheInit(struct CPUDisassemblyCache* cache) {
+    for (uint16_t i = 0; i < DISASSEMBLY_CACHE_SIZE; i++) {
+        cache->lines[i].valid = false;
+    }
+    memset(cache->disassembly, 0, sizeof(cache->disassembly));
+    cache->disassembly_active_row = DISASSEMBLY_BUFFER_HEIGHT;
+    cache->disassembly_generation = 0;
+    cache->zero_page_valid = false;
+    cache->zero_page_generation = 0;
+    cache->registers_valid = false;
+    cache->registers_generation = 0;
+}
+
+uint8_t CPUDisassemble(struct CPU* cpu, struct CPUDisassemblyCache* cache, uint16_t start_address, uint16_t count) {
+    if (!cache->registers_valid || !RegistersEqual(&cache->registers, &cpu->registers)) {
+        char registers_row_buffer[REGISTER_WIDTH + 1];
+        for (int y = 0; y < REGISTERS_BUFFER_HEIGHT; y++) {
+            for (int i = 0; i < (REGISTER_WIDTH + 1); i++) {
+                registers_row_buffer[i] = ' ';
             }
-        } else { 
-            if ((x + 16) < (DISASSEMBLY_BUFFER_WIDTH + 1)) {
-                snprintf(&disassembly_row_buffer[x], 16 * sizeof(char), " UNSAFE ADDRESS");
+
+            int x = REGISTER_WIDTH;
+            switch (y) {
+                case 0: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "A: 0x%02X", cpu->registers.a_register); registers_row_buffer[x] = ' '; break;
+                case 1: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "X: 0x%02X", cpu->registers.x_register); registers_row_buffer[x] = ' '; break;
+                case 2: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "Y: 0x%02X", cpu->registers.y_register); registers_row_buffer[x] = ' '; break;
+                case 3: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "CARRY: %s", GetCarryFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
+                case 4: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "ZERO: %s", GetZeroFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
+                case 5: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "IRQ DISABLE: %s", GetIrqDisableFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
+                case 6: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "DECIMAL MODE: %s", GetDecimalModeFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
+                case 7: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "BRK COMMAND: %s", GetBrkCommandFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
+                case 8: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "UNUSED: %s", GetUnusedFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
+                case 9: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "OVERFLOW: %s", GetOverflowFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
+                case 10: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "NEGATIVE: %s", GetNegativeFlag(cpu) ? "True" : "False"); registers_row_buffer[x] = ' '; break;
+                case 11: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "STACK POINTER: 0x%02X", cpu->registers.stack_pointer); registers_row_buffer[x] = ' '; break;
+                case 12: x = snprintf(&registers_row_buffer[0], sizeof(registers_row_buffer), "PROGRAM COUNTER: 0x%04X", cpu->registers.program_counter); registers_row_buffer[x] = ' '; break;
             }
-            x += 15;
+
+            memcpy(&cache->registers_text[y], &registers_row_buffer[0], REGISTER_WIDTH * sizeof(char));
+        }
+
+        cache->registers = cpu->registers;
+        cache->registers_valid = true;
+        cache->registers_generation++;
+    }
+
+
+
+
+    // only the rows with changed bytes are formatted again
+    char zero_page_row_buffer[ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH + 1];
+    uint8_t zero_page_row[ZERO_PAGE_BYTE_BUFFER_WIDTH];
+    bool zero_page_changed = false;
+
+    for (int y = 0; y < ZERO_PAGE_BYTE_BUFFER_HEIGHT; y++) {
+        for (int x = 0; x < ZERO_PAGE_BYTE_BUFFER_WIDTH; x++) {
+            zero_page_row[x] = PeekByte(cpu, y * ZERO_PAGE_BYTE_BUFFER_WIDTH + x);
         }
+
+        uint8_t* cached_row = &cache->zero_page[y * ZERO_PAGE_BYTE_BUFFER_WIDTH];
+        if (cache->zero_page_valid && memcmp(cached_row, zero_page_row, ZERO_PAGE_BYTE_BUFFER_WIDTH * sizeof(uint8_t)) == 0) {
+            continue;
+        }
+        memcpy(cached_row, zero_page_row, ZERO_PAGE_BYTE_BUFFER_WIDTH * sizeof(uint8_t));
+
+        for (int x = 0; x < ZERO_PAGE_BYTE_BUFFER_WIDTH; x++) {
+            snprintf(&zero_page_row_buffer[x * ZERO_PAGE_BYTE_WIDTH], (ZERO_PAGE_BYTE_WIDTH + 1) * sizeof(char), "%02X ", zero_page_row[x]);
+        }
+        memcpy(&cache->zero_page_text[y], &zero_page_row_buffer[0], ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH * sizeof(char));
+        zero_page_changed = true;
+    }
+    cache->zero_page_valid = true;
+    if (zero_page_changed) {
+        cache->zero_page_generation++;
+    }
+
+
+
+
+    // note that for addressing modes that require a register can't fully be disassembled 
+    // because registers are a runtime thing and this function only disassembles the code doesn't execute it 
+
+    // rows are cached by address (direct mapped on the low byte) and prg rom bank, so moving the window 
+    // reuses the rows that are still visible and a row is only formatted again when its bytes (or the pointer/register it shows) change
+    uint16_t dummy_address = start_address;
+    uint16_t prev_dummy_address = start_address;
+
+    uint8_t active_row = DISASSEMBLY_BUFFER_HEIGHT;
+    bool disassembly_changed = false;
+    uint8_t key[DISASSEMBLY_KEY_SIZE];
     
-        if (x >= DISASSEMBLY_BUFFER_WIDTH) {
-            // this means something didn't fit
-            LOG(ERROR, CPU, "disassembly character buffer too thin\n");
+    for (int y = 0; y < count && y < DISASSEMBLY_BUFFER_HEIGHT; y++) {
+        struct CPUDisassemblyCacheLine* line = &cache->lines[dummy_address % DISASSEMBLY_CACHE_SIZE];
+        uint32_t bank = CartridgeMapPRGROM(cpu->cpu_bus->cartridge, dummy_address);
+        GetDisassemblyKey(cpu, dummy_address, key);
+
+        if (!line->valid || line->address != dummy_address || line->bank != bank || memcmp(line->key, key, DISASSEMBLY_KEY_SIZE * sizeof(uint8_t)) != 0) {
+            line->valid = true;
+            line->address = dummy_address;
+            line->bank = bank;
+            memcpy(line->key, key, DISASSEMBLY_KEY_SIZE * sizeof(uint8_t));
+            line->next_address = DisassembleRow(cpu, dummy_address, line->text);
         }
-        
-        disassembly_row_buffer[x] = ' ';    // removes null terminator at the end
-        memcpy(&disassembly_buffer[y], &disassembly_row_buffer[0], DISASSEMBLY_BUFFER_WIDTH * sizeof(char));
+
+        if (memcmp(&cache->disassembly[y], line->text, DISASSEMBLY_BUFFER_WIDTH * sizeof(char)) != 0) {
+            memcpy(&cache->disassembly[y], line->text, DISASSEMBLY_BUFFER_WIDTH * sizeof(char));
+            disassembly_changed = true;
+        }
+        dummy_address = line->next_address;
     
         if (cpu->registers.program_counter >= prev_dummy_address && cpu->registers.program_counter < dummy_address) {
             active_row = y;
@@ -1517,6 +1855,10 @@ uint8_t CPUDisassemble(
     
         prev_dummy_address = dummy_address;
     }
-    
+
+    if (disassembly_changed || active_row != cache->disassembly_active_row) {
+        cache->disassembly_active_row = active_row;
+        cache->disassembly_generation++;
+    }
     return active_row;
 }
\ No newline at end of file
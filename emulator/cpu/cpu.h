@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <sys/stat.h>
 
 #include "cpu_bus.h"
@@ -19,6 +20,9 @@
 #define DISASSEMBLY_BUFFER_WIDTH 32
 #define DISASSEMBLY_BUFFER_HEIGHT 48
 
+#define DISASSEMBLY_CACHE_SIZE 256
+#define DISASSEMBLY_KEY_SIZE 7
+
 
 #define STACK_POINTER_OFFSET 0xFD
 #define STACK_OFFSET 0x0100
@@ -27,6 +31,10 @@
 #define NON_MASKABLE_INTERRUPT_OFFSET 0xFFFA
 
 
+// has to be a power of 2 because the ring buffer index is masked instead of being wrapped
+#define CPU_TRACE_BUFFER_SIZE 1024
+
+
 #define CARRY        0b00000001
 #define ZERO         0b00000010
 #define IRQ_DISABLE  0b00000100
@@ -45,10 +53,54 @@ struct Registers {
 	uint16_t program_counter;
 };
 
+struct Profiler;
+
+struct CPUDisassemblyCacheLine {
+    bool valid;
+    uint16_t address;
+    uint32_t bank;
+    uint8_t key[DISASSEMBLY_KEY_SIZE];    // the bytes (and register) the text was made from
+    uint16_t next_address;
+    char text[DISASSEMBLY_BUFFER_WIDTH];
+};
+
+// keeps the debug view from formatting everything again every frame, the text is kept here 
+// and the generations are bumped when it changes so the frontend only copies what it doesn't have yet
+struct CPUDisassemblyCache {
+    struct CPUDisassemblyCacheLine lines[DISASSEMBLY_CACHE_SIZE];
+    char disassembly[DISASSEMBLY_BUFFER_HEIGHT][DISASSEMBLY_BUFFER_WIDTH];
+    uint8_t disassembly_active_row;
+    uint32_t disassembly_generation;
+
+    uint8_t zero_page[ZERO_PAGE_BYTE_BUFFER_HEIGHT * ZERO_PAGE_BYTE_BUFFER_WIDTH];
+    bool zero_page_valid;
+    char zero_page_text[ZERO_PAGE_BYTE_BUFFER_HEIGHT][ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH];
+    uint32_t zero_page_generation;
+
+    struct Registers registers;
+    bool registers_valid;
+    char registers_text[REGISTERS_BUFFER_HEIGHT][REGISTER_WIDTH];
+    uint32_t registers_generation;
+};
+
+struct CPUTraceEntry {
+    uint64_t tick_counter;
+    uint16_t program_counter;
+    uint8_t op_code;
+    uint8_t a_register;
+    uint8_t x_register;
+    uint8_t y_register;
+    uint8_t status_flags;
+    uint8_t stack_pointer;
+};
+
 struct CPU {
     uint8_t remaining_cycles;
     uint64_t tick_counter;
 
+    // cycles taken by dmc sample fetches, the cpu does nothing until they are over
+    uint8_t stall_cycles;
+
     bool dma_transfer;
     bool dma_aligned;
     uint16_t dma_address;
@@ -58,6 +110,26 @@ struct CPU {
     struct Registers registers;
 
     struct CPUBus* cpu_bus;
+
+    // swapped to the watched variants only while there are watchpoints, so they cost nothing otherwise
+    uint8_t (*BusRead)(struct CPUBus*, const uint16_t);
+    bool (*BusWrite)(struct CPUBus*, const uint16_t, const uint8_t);
+
+    // called at every instruction boundary (before the opcode is fetched), NULL when tracing is off
+    void (*trace_hook)(struct CPU*, void*);
+    void* trace_hook_data;
+
+    // NULL when not profiling
+    struct Profiler* profiler;
+
+#ifdef CPU_TRACE
+    // the last CPU_TRACE_BUFFER_SIZE executed instructions, trace_enabled (0 or 1) is added to the index after every write
+    // so when it's disabled the same entry keeps getting overwritten instead of branching
+    // 64 bit like tick_counter, a 32 bit index would wrap after a few hours and make the dump look like a fresh buffer
+    struct CPUTraceEntry trace_buffer[CPU_TRACE_BUFFER_SIZE];
+    uint64_t trace_index;
+    uint64_t trace_enabled;
+#endif
 };
 
 
@@ -69,13 +141,20 @@ void CPUNonMaskableInterrupt(struct CPU* cpu);
 
 void CPUClock(struct CPU* cpu);
 
-void CPUUpdateIrqDisableFlag(struct CPU* cpu, bool irq_enabled);
+void CPUTraceEnable(struct CPU* cpu, bool enabled);
+bool CPUTraceIsEnabled(struct CPU* cpu);
+void CPUTraceDump(struct CPU* cpu, FILE* file);
+
+void CPUSetWatchpointsEnabled(struct CPU* cpu, bool enabled);
+
+void CPUSetProfiler(struct CPU* cpu, struct Profiler* profiler);
+const char* CPUGetMnemonic(const uint8_t op_code);
+
+void CPUSetTraceHook(struct CPU* cpu, void (*trace_hook)(struct CPU*, void*), void* trace_hook_data);
+uint8_t CPUDisassembleInstruction(struct CPU* cpu, const uint16_t address, char* buffer, const size_t buffer_size);
 
-uint8_t CPUDisassemble(
-    struct CPU* cpu, uint16_t start_address, uint16_t count, 
-    char disassembly_buffer[DISASSEMBLY_BUFFER_HEIGHT][DISASSEMBLY_BUFFER_WIDTH],
-    char zero_page_buffer[ZERO_PAGE_BYTE_BUFFER_HEIGHT][ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH],
-    char registers_buffer[REGISTERS_BUFFER_HEIGHT][REGISTER_WIDTH]
-);
+void CPUDisassemblyCacheInit(struct CPUDisassemblyCache* cache);
+// updates the text in the cache, returns the row of the program counter
+uint8_t CPUDisassemble(struct CPU* cpu, struct CPUDisassemblyCache* cache, uint16_t start_address, uint16_t count);
 
 #endif
\ No newline at end of file
@@ -4,7 +4,7 @@
 #include "logger.h"
 
 
-void CPUBusInit(struct CPUBus* cpu_bus, struct Cartridge* cartridge, struct PPU* ppu, struct Controller* controller) {
+void CPUBusInit(struct CPUBus* cpu_bus, struct Cartridge* cartridge, struct PPU* ppu, struct APU* apu, struct Controller* controller, struct Debugger* debugger) {
     memset(cpu_bus->cpu_ram, 0x00, CPU_RAM_SIZE * sizeof(uint8_t));
 
     cpu_bus->cpu_open_bus_data = 0x00;
@@ -12,7 +12,9 @@ void CPUBusInit(struct CPUBus* cpu_bus, struct Cartridge* cartridge, struct PPU*
 
     cpu_bus->cartridge = cartridge;
     cpu_bus->ppu = ppu;
+    cpu_bus->apu = apu;
     cpu_bus->controller = controller;
+    cpu_bus->debugger = debugger;
 }
 
 void CPUBusReset(struct CPUBus* cpu_bus) {
@@ -48,8 +50,9 @@ uint8_t CPUBusRead(struct CPUBus* cpu_bus, const uint16_t address) {
     } else if (address < 0x4018) {
         // apu and io
         switch (address) {
-            case APU_CTRL:  
-                LOG(WARNING, CPU_BUS, "apu and io registers not implemented\n"); 
+            case APU_STATUS:
+                // bit 5 isn't driven
+                cpu_bus->cpu_open_bus_data = (cpu_bus->cpu_open_bus_data & 0x20) | (APUReadStatus(cpu_bus->apu) & 0xDF);
                 break;
             case JOYSTICK_1_DATA: 
                 cpu_bus->cpu_open_bus_data = 0x40;
@@ -111,42 +114,65 @@ bool CPUBusWrite(struct CPUBus* cpu_bus, const uint16_t address, const uint8_t d
         }
     } else if (address < 0x4018) {
         switch (address) {
-            case APU_PULSE_1_CTRL: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_PULSE_1_SWEEP: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_PULSE_1_LOW_BYTE: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_PULSE_1_HIGH_BYTE: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_PULSE_2_CTRL: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_PULSE_2_SWEEP: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_PULSE_2_LOW_BYTE: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_PULSE_2_HIGH_BYTE: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_TRIANGLE_CTRL: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
             case APU_TRIANGLE_UNUSED: LOG(WARNING, CPU_BUS, "write to unused address"); break;
-            case APU_TRIANGLE_LOW_BYTE: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_TRIANGLE_HIGH_BYTE: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_NOISE_CTRL: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
             case APU_NOISE_UNUSED: LOG(WARNING, CPU_BUS, "write to unused address"); break;
-            case APU_NOISE_LOW_BYTE: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_NOISE_HIGH_BYTE: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_DMC_CTRL: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_DMC_DIRECT_LOAD: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_DMC_ADDRESS: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
-            case APU_DMC_LENGTH: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
             case PPU_DMA:
                 dma_transfer_initiated = true;
                 break;
-            case APU_CTRL: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;
             case JOYSTICK_STROBE: 
                 cpu_bus->cpu_open_bus_data = (previous_cpu_open_bus_data & 0xE0) | (data & 0x1F);
                 ControllerWrite(cpu_bus->controller, data);
                 break;
-            case APU_FRAME_COUNTER: LOG(WARNING, CPU_BUS, "apu not implemented\n"); break;    // TODO: open bus behavior
+            default:
+                // everything else is an apu register ($4017 writes go to the frame counter)
+                APUWrite(cpu_bus->apu, address, data);
+                break;
         }
     } else if (address < 0x4020) {
         // ignored
         LOG(ERROR, CPU_BUS, "cpu test mode not implemented\n");
     } else {
+        // only the mapper registers (0x8000 and up in every mapper here) can switch chr banks or mirroring, 
+        // prg ram writes leave the cached background lines alone
+        if (address >= 0x8000) {
+            PPUSyncBackground(cpu_bus->ppu);
+        }
         CartridgeWriteCPU(cpu_bus->cartridge, address, data);
     }
 
     return dma_transfer_initiated;
 }
+
+
+static inline bool IsPPUDataAddress(const uint16_t address) {
+    return (address >= 0x2000 && address < 0x4000 && (address & 0x2007) == PPU_DATA);
+}
+
+uint8_t CPUBusReadWatched(struct CPUBus* cpu_bus, const uint16_t address) {
+    uint16_t ppu_address = cpu_bus->ppu->v & 0x3FFF;
+
+    uint8_t data = CPUBusRead(cpu_bus, address);
+
+    if (cpu_bus->debugger->cpu_page_flags[address / DEBUGGER_PAGE_SIZE] & DEBUGGER_READ_BIT) {
+        DebuggerCheckAccess(cpu_bus->debugger, DEBUGGER_CPU_READ_WATCHPOINT, address, data);
+    }
+    if (IsPPUDataAddress(address) && (cpu_bus->debugger->ppu_page_flags[ppu_address / DEBUGGER_PAGE_SIZE] & DEBUGGER_READ_BIT)) {
+        // the value that was actually fetched from the ppu bus (ppu data reads are delayed by one through the buffer)
+        DebuggerCheckAccess(cpu_bus->debugger, DEBUGGER_PPU_READ_WATCHPOINT, ppu_address, cpu_bus->ppu->ppu_data_buffer);
+    }
+
+    return data;
+}
+
+bool CPUBusWriteWatched(struct CPUBus* cpu_bus, const uint16_t address, const uint8_t data) {
+    if (cpu_bus->debugger->cpu_page_flags[address / DEBUGGER_PAGE_SIZE] & DEBUGGER_WRITE_BIT) {
+        DebuggerCheckAccess(cpu_bus->debugger, DEBUGGER_CPU_WRITE_WATCHPOINT, address, data);
+    }
+
+    uint16_t ppu_address = cpu_bus->ppu->v & 0x3FFF;
+    if (IsPPUDataAddress(address) && (cpu_bus->debugger->ppu_page_flags[ppu_address / DEBUGGER_PAGE_SIZE] & DEBUGGER_WRITE_BIT)) {
+        DebuggerCheckAccess(cpu_bus->debugger, DEBUGGER_PPU_WRITE_WATCHPOINT, ppu_address, data);
+    }
+
+    return CPUBusWrite(cpu_bus, address, data);
+}
\ No newline at end of file
@@ -5,7 +5,9 @@
 
 #include "cartridge.h"
 #include "ppu.h"
+#include "apu.h"
 #include "controller.h"
+#include "debugger.h"
 
 #define CPU_RAM_SIZE 0x0800  // 2KB
 
@@ -19,40 +21,11 @@
 #define PPU_ADDRESS 0x2006
 #define PPU_DATA 0x2007
 
-#define APU_PULSE_1_CTRL 0x4000
-#define APU_PULSE_1_SWEEP 0x4001
-#define APU_PULSE_1_LOW_BYTE 0x4002
-#define APU_PULSE_1_HIGH_BYTE 0x4003
-
-#define APU_PULSE_2_CTRL 0x4004
-#define APU_PULSE_2_SWEEP 0x4005
-#define APU_PULSE_2_LOW_BYTE 0x4006
-#define APU_PULSE_2_HIGH_BYTE 0x4007
-
-#define APU_TRIANGLE_CTRL 0x4008
-#define APU_TRIANGLE_UNUSED 0x4009
-#define APU_TRIANGLE_LOW_BYTE 0x400A
-#define APU_TRIANGLE_HIGH_BYTE 0x400B
-
-#define APU_NOISE_CTRL 0x400C
-#define APU_NOISE_UNUSED 0x400D
-#define APU_NOISE_LOW_BYTE 0x400E
-#define APU_NOISE_HIGH_BYTE 0x400F
-
-#define APU_DMC_CTRL 0x4010
-#define APU_DMC_DIRECT_LOAD 0x4011
-#define APU_DMC_ADDRESS 0x4012
-#define APU_DMC_LENGTH 0x4013
-
 #define PPU_DMA 0x4014
 
-#define APU_CTRL 0x4015
-#define APU_STATUS 0x4015
-
 #define JOYSTICK_STROBE 0x4016
 #define JOYSTICK_1_DATA 0x4016
 
-#define APU_FRAME_COUNTER 0x4017
 #define JOYSTICK_2_DATA 0x4017
 
 
@@ -66,14 +39,20 @@ struct CPUBus {
 
     struct Cartridge* cartridge;
     struct PPU* ppu;
+    struct APU* apu;
     struct Controller* controller;
+    struct Debugger* debugger;
 };
 
-void CPUBusInit(struct CPUBus* cpu_bus, struct Cartridge* cartridge, struct PPU* ppu, struct Controller* controller);
+void CPUBusInit(struct CPUBus* cpu_bus, struct Cartridge* cartridge, struct PPU* ppu, struct APU* apu, struct Controller* controller, struct Debugger* debugger);
 void CPUBusReset(struct CPUBus* cpu_bus);
 
 
 uint8_t CPUBusRead(struct CPUBus* cpu_bus, const uint16_t address);
 bool CPUBusWrite(struct CPUBus* cpu_bus, const uint16_t address, const uint8_t data);
 
+// same as CPUBusRead/CPUBusWrite but they also check the watchpoints, the cpu only uses these while there are any set
+uint8_t CPUBusReadWatched(struct CPUBus* cpu_bus, const uint16_t address);
+bool CPUBusWriteWatched(struct CPUBus* cpu_bus, const uint16_t address, const uint8_t data);
+
 #endif
\ No newline at end of file
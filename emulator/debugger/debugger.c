@@ -0,0 +1,166 @@
+#include <string.h>
+
+#include "debugger.h"
+#include "logger.h"
+
+
+static const char* point_kind_names[] = {
+    [DEBUGGER_BREAKPOINT] = "breakpoint",
+    [DEBUGGER_CPU_READ_WATCHPOINT] = "cpu read watchpoint",
+    [DEBUGGER_CPU_WRITE_WATCHPOINT] = "cpu write watchpoint",
+    [DEBUGGER_PPU_READ_WATCHPOINT] = "ppu read watchpoint",
+    [DEBUGGER_PPU_WRITE_WATCHPOINT] = "ppu write watchpoint",
+};
+
+
+static void UpdatePageFlags(struct Debugger* debugger) {
+    memset(debugger->cpu_page_flags, 0, DEBUGGER_CPU_PAGES * sizeof(uint8_t));
+    memset(debugger->ppu_page_flags, 0, DEBUGGER_PPU_PAGES * sizeof(uint8_t));
+
+    debugger->watchpoint_count = 0;
+    debugger->breakpoint_count = 0;
+
+    for (uint8_t i = 0; i < debugger->point_count; i++) {
+        struct DebuggerPoint* point = &debugger->points[i];
+        
+        uint8_t* page_flags = debugger->cpu_page_flags;
+        uint8_t flag = 0;
+        switch (point->kind) {
+            case DEBUGGER_BREAKPOINT: flag = DEBUGGER_EXECUTE_BIT; break;
+            case DEBUGGER_CPU_READ_WATCHPOINT: flag = DEBUGGER_READ_BIT; break;
+            case DEBUGGER_CPU_WRITE_WATCHPOINT: flag = DEBUGGER_WRITE_BIT; break;
+            case DEBUGGER_PPU_READ_WATCHPOINT: page_flags = debugger->ppu_page_flags; flag = DEBUGGER_READ_BIT; break;
+            case DEBUGGER_PPU_WRITE_WATCHPOINT: page_flags = debugger->ppu_page_flags; flag = DEBUGGER_WRITE_BIT; break;
+        }
+
+        for (uint16_t page = (point->address_start / DEBUGGER_PAGE_SIZE); page <= (point->address_end / DEBUGGER_PAGE_SIZE); page++) {
+            page_flags[page] |= flag;
+        }
+
+        if (point->kind == DEBUGGER_BREAKPOINT) {
+            debugger->breakpoint_count++;
+        } else {
+            debugger->watchpoint_count++;
+        }
+    }
+}
+
+
+
+void DebuggerInit(struct Debugger* debugger) {
+    debugger->point_count = 0;
+
+    debugger->hit = false;
+    debugger->hit_address = 0;
+    debugger->hit_value = 0;
+
+    debugger->resuming = false;
+
+    UpdatePageFlags(debugger);
+}
+
+bool DebuggerAddPoint(struct Debugger* debugger, const enum DebuggerPointKind kind, const uint16_t address_start, const uint16_t address_end) {
+    bool is_ppu = (kind == DEBUGGER_PPU_READ_WATCHPOINT || kind == DEBUGGER_PPU_WRITE_WATCHPOINT);
+    if (address_start > address_end || (is_ppu && address_end >= 0x4000)) {
+        LOG(WARNING, DEBUGGER, "invalid %s range: 0x%04X - 0x%04X\n", point_kind_names[kind], address_start, address_end);
+        return false;
+    }
+
+    if (debugger->point_count == DEBUGGER_MAX_POINTS) {
+        LOG(WARNING, DEBUGGER, "can't have more than %d breakpoints/watchpoints\n", DEBUGGER_MAX_POINTS);
+        return false;
+    }
+
+    debugger->points[debugger->point_count].kind = kind;
+    debugger->points[debugger->point_count].address_start = address_start;
+    debugger->points[debugger->point_count].address_end = address_end;
+    debugger->point_count++;
+
+    UpdatePageFlags(debugger);
+    return true;
+}
+
+void DebuggerRemovePoint(struct Debugger* debugger, const uint8_t index) {
+    if (index >= debugger->point_count) {
+        LOG(WARNING, DEBUGGER, "there is no breakpoint/watchpoint with index: %d\n", index);
+        return;
+    }
+
+    memmove(&debugger->points[index], &debugger->points[index + 1], (debugger->point_count - index - 1) * sizeof(struct DebuggerPoint));
+    debugger->point_count--;
+
+    UpdatePageFlags(debugger);
+}
+
+void DebuggerClear(struct Debugger* debugger) {
+    debugger->point_count = 0;
+    debugger->hit = false;
+    debugger->resuming = false;
+
+    UpdatePageFlags(debugger);
+}
+
+void DebuggerContinue(struct Debugger* debugger) {
+    if (debugger->hit) {
+        debugger->hit = false;
+        debugger->resuming = (debugger->hit_point.kind == DEBUGGER_BREAKPOINT);
+    }
+}
+
+bool DebuggerCheckExecute(struct Debugger* debugger, const uint16_t address) {
+    if (debugger->resuming) {
+        debugger->resuming = false;
+        return false;
+    }
+
+    if ((debugger->cpu_page_flags[address / DEBUGGER_PAGE_SIZE] & DEBUGGER_EXECUTE_BIT) == 0) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < debugger->point_count; i++) {
+        struct DebuggerPoint* point = &debugger->points[i];
+        if (point->kind == DEBUGGER_BREAKPOINT && address >= point->address_start && address <= point->address_end) {
+            debugger->hit = true;
+            debugger->hit_point = *point;
+            debugger->hit_address = address;
+            debugger->hit_value = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+// only called for accesses to flagged pages, so this can afford to search the list
+void DebuggerCheckAccess(struct Debugger* debugger, const enum DebuggerPointKind kind, const uint16_t address, const uint8_t value) {
+    if (debugger->hit) {
+        return;    // keep the first hit of the instruction
+    }
+
+    for (uint8_t i = 0; i < debugger->point_count; i++) {
+        struct DebuggerPoint* point = &debugger->points[i];
+        if (point->kind == kind && address >= point->address_start && address <= point->address_end) {
+            debugger->hit = true;
+            debugger->hit_point = *point;
+            debugger->hit_address = address;
+            debugger->hit_value = value;
+            return;
+        }
+    }
+}
+
+void DebuggerPrintHit(struct Debugger* debugger) {
+    if (!debugger->hit) {
+        return;
+    }
+
+    if (debugger->hit_point.kind == DEBUGGER_BREAKPOINT) {
+        LOG(INFO, DEBUGGER, "%s hit at: 0x%04X\n", point_kind_names[debugger->hit_point.kind], debugger->hit_address);
+    } else {
+        LOG(
+            INFO, DEBUGGER, "%s (0x%04X - 0x%04X) hit at: 0x%04X  value: 0x%02X\n", 
+            point_kind_names[debugger->hit_point.kind], 
+            debugger->hit_point.address_start, debugger->hit_point.address_end, 
+            debugger->hit_address, debugger->hit_value
+        );
+    }
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#define DEBUGGER_MAX_POINTS 32
+
+#define DEBUGGER_PAGE_SIZE 0x100
+#define DEBUGGER_CPU_PAGES (0x10000 / DEBUGGER_PAGE_SIZE)
+#define DEBUGGER_PPU_PAGES (0x4000 / DEBUGGER_PAGE_SIZE)
+
+// page flags, a page only gets a flag if at least one point covers some of its addresses
+#define DEBUGGER_EXECUTE_BIT 0b00000001
+#define DEBUGGER_READ_BIT    0b00000010
+#define DEBUGGER_WRITE_BIT   0b00000100
+
+
+enum DebuggerPointKind {
+    DEBUGGER_BREAKPOINT,
+    DEBUGGER_CPU_READ_WATCHPOINT,
+    DEBUGGER_CPU_WRITE_WATCHPOINT,
+    DEBUGGER_PPU_READ_WATCHPOINT,
+    DEBUGGER_PPU_WRITE_WATCHPOINT,
+};
+
+struct DebuggerPoint {
+    enum DebuggerPointKind kind;
+    uint16_t address_start;
+    uint16_t address_end;    // inclusive
+};
+
+struct Debugger {
+    // the flag tables are what the hot paths look at, the point list is only searched when a flagged page is accessed
+    uint8_t cpu_page_flags[DEBUGGER_CPU_PAGES];
+    uint8_t ppu_page_flags[DEBUGGER_PPU_PAGES];
+
+    struct DebuggerPoint points[DEBUGGER_MAX_POINTS];
+    uint8_t point_count;
+
+    uint8_t watchpoint_count;
+    uint8_t breakpoint_count;
+
+    bool hit;
+    struct DebuggerPoint hit_point;
+    uint16_t hit_address;
+    uint8_t hit_value;
+
+    // set when continuing from a breakpoint so the same instruction doesn't stop again right away
+    bool resuming;
+};
+
+
+void DebuggerInit(struct Debugger* debugger);
+
+bool DebuggerAddPoint(struct Debugger* debugger, const enum DebuggerPointKind kind, const uint16_t address_start, const uint16_t address_end);
+void DebuggerRemovePoint(struct Debugger* debugger, const uint8_t index);
+void DebuggerClear(struct Debugger* debugger);
+
+void DebuggerContinue(struct Debugger* debugger);
+
+bool DebuggerCheckExecute(struct Debugger* debugger, const uint16_t address);
+void DebuggerCheckAccess(struct Debugger* debugger, const enum DebuggerPointKind kind, const uint16_t address, const uint8_t value);
+
+void DebuggerPrintHit(struct Debugger* debugger);
+
+#endif
\ No newline at end of file
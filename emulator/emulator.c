@@ -2,33 +2,71 @@
 #include "logger.h"
 
 
+static void SelectRenderFrame(struct Emulator* emulator);
+
+
+static uint8_t ReadDMCSample(void* data, const uint16_t address) {
+    return CPUBusRead((struct CPUBus*)data, address);
+}
+
+
 void EmulatorInit(struct Emulator* emulator, const char* filename) {
     CartridgeInit(&emulator->cartridge, filename);
     PPUBusInit(&emulator->ppu_bus, &emulator->cartridge);
-    PPUInit(&emulator->ppu, &emulator->ppu_bus, emulator->cartridge.tv_system);
+    PaletteInit(&emulator->palette);
+    PPUInit(&emulator->ppu, &emulator->ppu_bus, &emulator->palette, emulator->cartridge.tv_system);
     ControllerInit(&emulator->controller);
-    CPUBusInit(&emulator->cpu_bus, &emulator->cartridge, &emulator->ppu, &emulator->controller);
+    DebuggerInit(&emulator->debugger);
+    CPUBusInit(&emulator->cpu_bus, &emulator->cartridge, &emulator->ppu, &emulator->apu, &emulator->controller, &emulator->debugger);
     CPUInit(&emulator->cpu, &emulator->cpu_bus);
+    APUInit(&emulator->apu, emulator->cartridge.tv_system, &emulator->cpu.tick_counter, &ReadDMCSample, &emulator->cpu_bus);
+
+    SelectRenderFrame(emulator);
+    emulator->cpu_clock_accumulator = 0;
+    emulator->cpu_clock_pending = false;
+
+    emulator->profiling = false;
 }
 
 void EmulatorClean(struct Emulator* emulator) {
+    if (emulator->profiling) {
+        CPUSetProfiler(&emulator->cpu, NULL);
+        ProfilerClean(&emulator->profiler);
+        emulator->profiling = false;
+    }
     CartridgeClean(&emulator->cartridge);
 }
 
 void EmulatorReset(struct Emulator* emulator) {
     CPUReset(&emulator->cpu);
     PPUReset(&emulator->ppu, emulator->cartridge.tv_system);
+    APUSetTVSystem(&emulator->apu, emulator->cartridge.tv_system);
+    APUReset(&emulator->apu);
     
     CPUBusReset(&emulator->cpu_bus);
     PPUBusReset(&emulator->ppu_bus);
 
     ControllerReset(&emulator->controller);
+
+    SelectRenderFrame(emulator);
+    emulator->cpu_clock_accumulator = 0;
+    emulator->cpu_clock_pending = false;
+    DebuggerContinue(&emulator->debugger);
 }
 
 void EmulatorReloadCartridge(struct Emulator* emulator, const char* filename) {
     CartridgeInit(&emulator->cartridge, filename);
 }
 
+void EmulatorSetTVSystem(struct Emulator* emulator, enum TVSystem tv_system) {
+    emulator->cartridge.tv_system = tv_system;
+    PPUSetRegion(&emulator->ppu, tv_system);
+    APUSetTVSystem(&emulator->apu, tv_system);
+    SelectRenderFrame(emulator);
+    emulator->cpu_clock_accumulator = 0;
+    emulator->cpu_clock_pending = false;
+}
+
 void EmulatorKeyDown(struct Emulator* emulator, enum Button button, enum Player player) {
     switch (player) {
         case PLAYER_1: ControllerKeyDown1(&emulator->controller, button); break;
@@ -43,59 +81,164 @@ void EmulatorKeyUp(struct Emulator* emulator, enum Button button, enum Player pl
     }
 }
 
-void EmulatorRender(struct Emulator* emulator, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]) {
-    uint64_t temp = 0;
-    switch (emulator->cartridge.tv_system) {
-        case NTSC: 
-            while (emulator->ppu.render_state != FINISHED) {
-                switch (PPUClockNTSC(&emulator->ppu, pixels_buffer)) {
-                    case GENERATE_NMI: CPUNonMaskableInterrupt(&emulator->cpu); break;
-                    case GENERATE_IRQ: 
-                        CPUInterruptRequest(&emulator->cpu); 
-                        break;
-                    case GENERATE_NO_INTERRUPT: break;
-                }
-                
-                if (temp % 3 == 2) {
-                    CPUClock(&emulator->cpu);
-                    // apu
-                    if (emulator->cartridge.mapper_id == MMC3) {
-                        struct Mapper004Info* mapper_info = (struct Mapper004Info*)emulator->cartridge.mapper_info;
-                        CPUUpdateIrqDisableFlag(&emulator->cpu, mapper_info->irq_enabled);
-                    }
-                }
-            
-                temp++;
+void EmulatorStartProfiler(struct Emulator* emulator) {
+    if (emulator->profiling) {
+        ProfilerClean(&emulator->profiler);
+    }
+    ProfilerInit(&emulator->profiler, &emulator->cartridge, &CPUGetMnemonic);
+    CPUSetProfiler(&emulator->cpu, &emulator->profiler);
+    emulator->profiling = true;
+}
+
+void EmulatorStopProfiler(struct Emulator* emulator, const char* output_prefix) {
+    if (!emulator->profiling) {
+        LOG(WARNING, EMULATOR, "the profiler isn't running\n");
+        return;
+    }
+
+    CPUSetProfiler(&emulator->cpu, NULL);
+
+    char filename[FILENAME_MAX];
+    
+    snprintf(filename, sizeof(filename), "%s.txt", output_prefix);
+    FILE* report_file = fopen(filename, "w");
+    if (report_file == NULL) {
+        LOG(WARNING, EMULATOR, "failed to open profiler report file: %s\n", filename);
+    } else {
+        ProfilerWriteReport(&emulator->profiler, report_file);
+        fclose(report_file);
+        LOG(INFO, EMULATOR, "profiler report written to: %s\n", filename);
+    }
+
+    snprintf(filename, sizeof(filename), "%s.folded", output_prefix);
+    FILE* stacks_file = fopen(filename, "w");
+    if (stacks_file == NULL) {
+        LOG(WARNING, EMULATOR, "failed to open profiler collapsed stacks file: %s\n", filename);
+    } else {
+        ProfilerWriteCollapsedStacks(&emulator->profiler, stacks_file);
+        fclose(stacks_file);
+        LOG(INFO, EMULATOR, "profiler collapsed stacks written to: %s\n", filename);
+    }
+
+    ProfilerClean(&emulator->profiler);
+    emulator->profiling = false;
+}
+
+static inline void HandleInterrupt(struct Emulator* emulator, enum GenerateInterrupt generate_interrupt) {
+    switch (generate_interrupt) {
+        case GENERATE_NMI: CPUNonMaskableInterrupt(&emulator->cpu); break;
+        case GENERATE_NO_INTERRUPT: break;
+    }
+}
+
+static inline void ClockCPU(struct Emulator* emulator) {
+    // the apu catches up by itself on register accesses, it only has to be run here for irqs and dmc fetches
+    if (emulator->cpu.tick_counter >= emulator->apu.next_event_cycle) {
+        emulator->cpu.stall_cycles += APURunEvents(&emulator->apu);
+    }
+    // the irq lines are level triggered and sampled at instruction boundaries, they stay asserted until acknowledged
+    if ((emulator->apu.irq || emulator->cartridge.irq) && emulator->cpu.remaining_cycles == 0 && !emulator->cpu.dma_transfer && emulator->cpu.stall_cycles == 0) {
+        CPUInterruptRequest(&emulator->cpu);
+    }
+
+    CPUClock(&emulator->cpu);
+}
+
+// the cpu gets cpu_cycles_per_ppu_dots cycles every ppu_dots_per_cpu_cycles dots (3 : 1 on NTSC and Dendy, 16 : 5 on PAL),
+// every region gets its own copy of the loop so the ratio is a constant and the ppu clock a direct call
+#define DEFINE_RENDER_FRAME(name, ppu_clock, ppu_dots_per_cpu_cycles, cpu_cycles_per_ppu_dots) \
+    static void name(struct Emulator* emulator, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]) { \
+        uint32_t cpu_clock_accumulator = emulator->cpu_clock_accumulator; \
+        while (emulator->ppu.render_state != FINISHED) { \
+            HandleInterrupt(emulator, ppu_clock(&emulator->ppu, pixels_buffer)); \
+            \
+            cpu_clock_accumulator += (cpu_cycles_per_ppu_dots); \
+            if (cpu_clock_accumulator >= (ppu_dots_per_cpu_cycles)) { \
+                cpu_clock_accumulator -= (ppu_dots_per_cpu_cycles); \
+                ClockCPU(emulator); \
+            } \
+        } \
+        emulator->cpu_clock_accumulator = cpu_clock_accumulator; \
+        APUEndFrame(&emulator->apu); \
+    }
+
+DEFINE_RENDER_FRAME(RenderFrameNTSC, PPUClockNTSC, NTSC_PPU_DOTS_PER_CPU_CYCLES, NTSC_CPU_CYCLES_PER_PPU_DOTS)
+DEFINE_RENDER_FRAME(RenderFramePAL, PPUClockPAL, PAL_PPU_DOTS_PER_CPU_CYCLES, PAL_CPU_CYCLES_PER_PPU_DOTS)
+DEFINE_RENDER_FRAME(RenderFrameDendy, PPUClockDendy, DENDY_PPU_DOTS_PER_CPU_CYCLES, DENDY_CPU_CYCLES_PER_PPU_DOTS)
+
+static void SelectRenderFrame(struct Emulator* emulator) {
+    switch (emulator->ppu.region->tv_system) {
+        case NTSC: emulator->RenderFrame = &RenderFrameNTSC; break;
+        case PAL: emulator->RenderFrame = &RenderFramePAL; break;
+        case DENDY: emulator->RenderFrame = &RenderFrameDendy; break;
+    }
+}
+
+// only used while there are breakpoints/watchpoints, it's the same as the loop in EmulatorRender 
+// but it can stop in the middle of a frame and continue from there on the next call
+static bool RenderDebug(struct Emulator* emulator, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]) {
+    const struct Region* region = emulator->ppu.region;
+    while (emulator->ppu.render_state != FINISHED) {
+        if (!emulator->cpu_clock_pending) {
+            HandleInterrupt(emulator, region->Clock(&emulator->ppu, pixels_buffer));
+            emulator->cpu_clock_accumulator += region->cpu_cycles_per_ppu_dots;
+        }
+
+        if (emulator->cpu_clock_accumulator >= region->ppu_dots_per_cpu_cycles) {
+            bool instruction_boundary = (emulator->cpu.remaining_cycles == 0 && !emulator->cpu.dma_transfer);
+            if (instruction_boundary && DebuggerCheckExecute(&emulator->debugger, emulator->cpu.registers.program_counter)) {
+                // stops before the instruction, the ppu already did its part of this cycle
+                emulator->cpu_clock_pending = true;
+                return false;
             }
-            break;
-        case PAL:
-            while (emulator->ppu.render_state != FINISHED) {
-                switch (PPUClockPAL(&emulator->ppu, pixels_buffer)) {
-                    case GENERATE_NMI: CPUNonMaskableInterrupt(&emulator->cpu); break;
-                    case GENERATE_IRQ: CPUInterruptRequest(&emulator->cpu); break;
-                    case GENERATE_NO_INTERRUPT: break;
-                }
-
-                if (temp % 15 == 14 && emulator->ppu.render_state != FINISHED) {    // makes the ratio of ppu and cpu cycles to 3.2 : 1 instead of 3 : 1
-                    switch (PPUClockPAL(&emulator->ppu, pixels_buffer)) {
-                        case GENERATE_NMI: CPUNonMaskableInterrupt(&emulator->cpu); break;
-                        case GENERATE_IRQ: CPUInterruptRequest(&emulator->cpu); break;
-                        case GENERATE_NO_INTERRUPT: break;
-                    }
-                }
-
-                if (temp % 3 == 2) {
-                    CPUClock(&emulator->cpu);
-                    // apu
-                    if (emulator->cartridge.mapper_id == MMC3) {
-                        struct Mapper004Info* mapper_info = (struct Mapper004Info*)emulator->cartridge.mapper_info;
-                        CPUUpdateIrqDisableFlag(&emulator->cpu, mapper_info->irq_enabled);
-                    }
-                }
-
-                temp++;
-            } 
-            break;
+            emulator->cpu_clock_pending = false;
+            emulator->cpu_clock_accumulator -= region->ppu_dots_per_cpu_cycles;
+            ClockCPU(emulator);
+        }
+
+        if (emulator->debugger.hit) {
+            return false;
+        }
+    }
+    APUEndFrame(&emulator->apu);
+    emulator->ppu.render_state = PRE_RENDER;
+    return true;
+}
+
+bool EmulatorAddDebuggerPoint(struct Emulator* emulator, const enum DebuggerPointKind kind, const uint16_t address_start, const uint16_t address_end) {
+    bool added = DebuggerAddPoint(&emulator->debugger, kind, address_start, address_end);
+    CPUSetWatchpointsEnabled(&emulator->cpu, emulator->debugger.watchpoint_count != 0);
+    return added;
+}
+
+void EmulatorRemoveDebuggerPoint(struct Emulator* emulator, const uint8_t index) {
+    DebuggerRemovePoint(&emulator->debugger, index);
+    CPUSetWatchpointsEnabled(&emulator->cpu, emulator->debugger.watchpoint_count != 0);
+}
+
+void EmulatorClearDebuggerPoints(struct Emulator* emulator) {
+    DebuggerClear(&emulator->debugger);
+    CPUSetWatchpointsEnabled(&emulator->cpu, false);
+}
+
+void EmulatorContinue(struct Emulator* emulator) {
+    DebuggerContinue(&emulator->debugger);
+}
+
+bool EmulatorRender(struct Emulator* emulator, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]) {
+    if (emulator->debugger.point_count != 0 || emulator->cpu_clock_pending) {
+        return RenderDebug(emulator, pixels_buffer);
     }
+
+    emulator->RenderFrame(emulator, pixels_buffer);
     emulator->ppu.render_state = PRE_RENDER;
+    return true;
+}
+
+bool EmulatorRenderPaletteIndices(struct Emulator* emulator, uint16_t palette_indices_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]) {
+    emulator->ppu.palette_indices_buffer = palette_indices_buffer;
+    bool frame_finished = EmulatorRender(emulator, NULL);
+    emulator->ppu.palette_indices_buffer = NULL;
+
+    return frame_finished;
 }
\ No newline at end of file
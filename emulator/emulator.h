@@ -6,7 +6,11 @@
 #include "cpu_bus.h"
 #include "ppu.h"
 #include "ppu_bus.h"
+#include "palette.h"
+#include "apu.h"
 #include "controller.h"
+#include "profiler.h"
+#include "debugger.h"
 
 struct Emulator {
     struct Cartridge cartridge; 
@@ -14,7 +18,24 @@ struct Emulator {
     struct CPUBus cpu_bus; 
     struct PPU ppu; 
     struct PPUBus ppu_bus;
+    struct APU apu;
+    // only changed before the emulation starts, the frontend converts with it too
+    struct Palette palette;
     struct Controller controller;
+
+    struct Debugger debugger;
+
+    struct Profiler profiler;
+    bool profiling;
+
+    // frame loop specialized for the region of the ppu, picked whenever the region can change
+    void (*RenderFrame)(struct Emulator* emulator, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]);
+
+    // cpu:ppu clock ratio of the region, the cpu is clocked whenever this reaches region->ppu_dots_per_cpu_cycles
+    // kept between frames so the fractional PAL ratio doesn't drift
+    uint32_t cpu_clock_accumulator;
+    // the debugger stopped right before a cpu cycle whose ppu dots were already clocked
+    bool cpu_clock_pending;
 };
 
 enum Player {
@@ -28,10 +49,24 @@ void EmulatorClean(struct Emulator* emulator);
 void EmulatorReset(struct Emulator* emulator);
 
 void EmulatorReloadCartridge(struct Emulator* emulator, const char* filename);
+// overrides the tv system from the rom header (needed for Dendy which can't be detected)
+void EmulatorSetTVSystem(struct Emulator* emulator, enum TVSystem tv_system);
 
 void EmulatorKeyDown(struct Emulator* emulator, enum Button button, enum Player player);
 void EmulatorKeyUp(struct Emulator* emulator, enum Button button, enum Player player);
 
-void EmulatorRender(struct Emulator* emulator, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]);
+// the profiler results are written to <output_prefix>.txt (flat per opcode/address) and <output_prefix>.folded (collapsed stacks for flamegraphs)
+void EmulatorStartProfiler(struct Emulator* emulator);
+void EmulatorStopProfiler(struct Emulator* emulator, const char* output_prefix);
+
+bool EmulatorAddDebuggerPoint(struct Emulator* emulator, const enum DebuggerPointKind kind, const uint16_t address_start, const uint16_t address_end);
+void EmulatorRemoveDebuggerPoint(struct Emulator* emulator, const uint8_t index);
+void EmulatorClearDebuggerPoints(struct Emulator* emulator);
+void EmulatorContinue(struct Emulator* emulator);
+
+// returns false when the frame was stopped by a breakpoint/watchpoint (the next call continues it)
+bool EmulatorRender(struct Emulator* emulator, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]);
+// same as EmulatorRender but the frame is left as palette indices (see ppu_composite.h) for the caller to convert
+bool EmulatorRenderPaletteIndices(struct Emulator* emulator, uint16_t palette_indices_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "palette.h"
+#include "logger.h"
+
+
+#define PALETTE_PI 3.14159265358979323846f
+
+// the only copy of the built in colors, everything else reads the generated 512 entry table
+static const uint32_t default_colors_rgba[PALETTE_COLOR_COUNT] = {
+    0x666666FF, 0x002A88FF, 0x1412A7FF, 0x3B00A4FF, 0x5C007EFF, 0x6E0040FF, 0x6C0600FF, 0x561D00FF,
+    0x333500FF, 0x0B4800FF, 0x005200FF, 0x004F08FF, 0x00404DFF, 0x000000FF, 0x000000FF, 0x000000FF,
+    0xADADADFF, 0x155FD9FF, 0x4240FFFF, 0x7527FEFF, 0xA01ACCFF, 0xB71E7BFF, 0xB53120FF, 0x994E00FF,
+    0x6B6D00FF, 0x388700FF, 0x0C9300FF, 0x008F32FF, 0x007C8DFF, 0x000000FF, 0x000000FF, 0x000000FF,
+    0xFFFEFFFF, 0x64B0FFFF, 0x9290FFFF, 0xC676FFFF, 0xF36AFFFF, 0xFE6ECCFF, 0xFE8170FF, 0xEA9E22FF,
+    0xBCBE00FF, 0x88D800FF, 0x5CE430FF, 0x45E082FF, 0x48CDDEFF, 0x4F4F4FFF, 0x000000FF, 0x000000FF,
+    0xFFFEFFFF, 0xC0DFFFFF, 0xD3D2FFFF, 0xE8C8FFFF, 0xFBC2FFFF, 0xFEC4EAFF, 0xFECCC5FF, 0xF7D8A5FF,
+    0xE4E594FF, 0xCFEF96FF, 0xBDF4ABFF, 0xB3F3CCFF, 0xB5EBF2FF, 0xB8B8B8FF, 0x000000FF, 0x000000FF,
+};
+
+// composite voltages of the 4 luma levels when the square wave is low / high, relative to sync
+static const float signal_low_levels[4]  = {0.350f, 0.518f, 0.962f, 1.550f};
+static const float signal_high_levels[4] = {1.094f, 1.506f, 1.962f, 1.962f};
+#define SIGNAL_BLACK 0.518f
+#define SIGNAL_WHITE 1.962f
+
+
+static inline uint32_t PackRGBA(const uint8_t red, const uint8_t green, const uint8_t blue) {
+    return ((uint32_t)red << 24) | ((uint32_t)green << 16) | ((uint32_t)blue << 8) | 0xFF;
+}
+
+static inline uint8_t Dim(const uint8_t channel) {
+    return (uint8_t)(channel * PALETTE_EMPHASIS_ATTENUATION + 0.5f);
+}
+
+// an emphasis bit dims the 2 other channels, so with all 3 set the whole color gets darker
+static void DeriveEmphasis(struct Palette* palette) {
+    for (uint16_t palette_index = PALETTE_COLOR_COUNT; palette_index < PALETTE_INDEX_COUNT; palette_index++) {
+        uint32_t rgba = palette->colors_rgba[palette_index & PALETTE_INDEX_COLOR_BITS];
+        uint8_t red = (rgba >> 24) & 0xFF;
+        uint8_t green = (rgba >> 16) & 0xFF;
+        uint8_t blue = (rgba >> 8) & 0xFF;
+
+        if (palette_index & (PALETTE_EMPHASIS_GREEN_BIT | PALETTE_EMPHASIS_BLUE_BIT)) {
+            red = Dim(red);
+        }
+        if (palette_index & (PALETTE_EMPHASIS_RED_BIT | PALETTE_EMPHASIS_BLUE_BIT)) {
+            green = Dim(green);
+        }
+        if (palette_index & (PALETTE_EMPHASIS_RED_BIT | PALETTE_EMPHASIS_GREEN_BIT)) {
+            blue = Dim(blue);
+        }
+
+        palette->colors_rgba[palette_index] = PackRGBA(red, green, blue);
+    }
+}
+
+
+void PaletteInit(struct Palette* palette) {
+    for (uint8_t color = 0; color < PALETTE_COLOR_COUNT; color++) {
+        palette->colors_rgba[color] = default_colors_rgba[color];
+    }
+    DeriveEmphasis(palette);
+}
+
+void PaletteGetDefaultParameters(struct PaletteParameters* parameters) {
+    parameters->hue = 0.0f;
+    parameters->saturation = 1.0f;
+    parameters->gamma = 2.2f / 1.8f;
+}
+
+
+static inline bool InColorPhase(const uint8_t color, const uint8_t phase) {
+    return ((color + phase) % PALETTE_SIGNAL_PHASES) < 6;
+}
+
+// the ppu makes a square wave between 2 voltages, its phase is the hue (color 0 is always high, 13 - 15 are always low)
+// and each emphasis bit attenuates a third of the cycle
+float PaletteSignal(const uint16_t palette_index, const uint8_t phase) {
+    uint8_t color = palette_index & 0x0F;
+    uint8_t level = (palette_index >> 4) & 0x03;
+
+    if (color > 13) {
+        level = 1;
+    }
+
+    float low = signal_low_levels[level];
+    float high = signal_high_levels[level];
+    if (color == 0) {
+        low = high;
+    } else if (color > 12) {
+        high = low;
+    }
+
+    float signal = InColorPhase(color, phase) ? high : low;
+
+    if (((palette_index & PALETTE_EMPHASIS_RED_BIT) && InColorPhase(0, phase))
+        || ((palette_index & PALETTE_EMPHASIS_GREEN_BIT) && InColorPhase(4, phase))
+        || ((palette_index & PALETTE_EMPHASIS_BLUE_BIT) && InColorPhase(8, phase))) {
+        signal *= PALETTE_EMPHASIS_ATTENUATION;
+    }
+
+    return (signal - SIGNAL_BLACK) / (SIGNAL_WHITE - SIGNAL_BLACK);
+}
+
+static inline uint8_t GammaCorrect(float value, const float gamma) {
+    value = (value < 0.0f) ? 0.0f : ((value > 1.0f) ? 1.0f : value);
+    return (uint8_t)(255.0f * powf(value, gamma) + 0.5f);
+}
+
+void PaletteGenerate(struct Palette* palette, const struct PaletteParameters* parameters) {
+    float hue = PALETTE_HUE_TWEAK + parameters->hue / PALETTE_DEGREES_PER_PHASE;
+
+    for (uint16_t palette_index = 0; palette_index < PALETTE_INDEX_COUNT; palette_index++) {
+        // a whole cycle of the subcarrier, so the chroma averages out of y
+        float y = 0.0f;
+        float i = 0.0f;
+        float q = 0.0f;
+        for (uint8_t phase = 0; phase < PALETTE_SIGNAL_PHASES; phase++) {
+            float signal = PaletteSignal(palette_index, phase) / PALETTE_SIGNAL_PHASES;
+            y += signal;
+            i += signal * cosf(PALETTE_PI * (phase + hue) / 6.0f);
+            q += signal * sinf(PALETTE_PI * (phase + hue) / 6.0f);
+        }
+        i *= parameters->saturation;
+        q *= parameters->saturation;
+
+        palette->colors_rgba[palette_index] = PackRGBA(
+            GammaCorrect(y + PALETTE_I_TO_RED * i + PALETTE_Q_TO_RED * q, parameters->gamma),
+            GammaCorrect(y + PALETTE_I_TO_GREEN * i + PALETTE_Q_TO_GREEN * q, parameters->gamma),
+            GammaCorrect(y + PALETTE_I_TO_BLUE * i + PALETTE_Q_TO_BLUE * q, parameters->gamma)
+        );
+    }
+}
+
+void PaletteLoad(struct Palette* palette, const char* filename) {
+    FILE* palette_file = fopen(filename, "rb");
+    if (palette_file == NULL) {
+        LOG(ERROR, PALETTE, "failed to open %s\n", filename);
+    }
+
+    uint8_t rgb[PALETTE_INDEX_COUNT * 3];
+    size_t size = fread(rgb, 1, sizeof(rgb), palette_file);
+    fclose(palette_file);
+
+    if (size != (PALETTE_COLOR_COUNT * 3) && size != (PALETTE_INDEX_COUNT * 3)) {
+        LOG(ERROR, PALETTE, "%s is %zu bytes, expected %u (64 colors) or %u (with emphasis)\n", filename, size, PALETTE_COLOR_COUNT * 3, PALETTE_INDEX_COUNT * 3);
+    }
+
+    uint16_t color_count = size / 3;
+    for (uint16_t palette_index = 0; palette_index < color_count; palette_index++) {
+        palette->colors_rgba[palette_index] = PackRGBA(rgb[palette_index * 3 + 0], rgb[palette_index * 3 + 1], rgb[palette_index * 3 + 2]);
+    }
+    if (color_count == PALETTE_COLOR_COUNT) {
+        DeriveEmphasis(palette);
+    }
+}
\ No newline at end of file
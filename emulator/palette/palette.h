@@ -0,0 +1,62 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <stdint.h>
+
+
+// final palette index of a pixel: bits 0-5 are the nes color, bits 6-8 are the emphasis bits of the mask register
+#define PALETTE_INDEX_COLOR_BITS    0x003F
+#define PALETTE_INDEX_EMPHASIS_BITS 0x01C0
+#define PALETTE_INDEX_COUNT         0x0200
+
+#define PALETTE_COLOR_COUNT 64
+
+#define PALETTE_EMPHASIS_RED_BIT   0x0040
+#define PALETTE_EMPHASIS_GREEN_BIT 0x0080
+#define PALETTE_EMPHASIS_BLUE_BIT  0x0100
+
+// the ppu lowers the voltage of the signal to this in the emphasized thirds of the color cycle
+#define PALETTE_EMPHASIS_ATTENUATION 0.746f
+
+// the color subcarrier is 12 samples long, a ppu dot is 8 of them
+#define PALETTE_SIGNAL_PHASES 12
+
+// lines the decoded hues up with the usual nes palettes (in subcarrier phases)
+#define PALETTE_HUE_TWEAK 3.9f
+#define PALETTE_DEGREES_PER_PHASE (360.0f / PALETTE_SIGNAL_PHASES)
+
+// fcc yiq to rgb
+#define PALETTE_I_TO_RED     0.946882f
+#define PALETTE_Q_TO_RED     0.623557f
+#define PALETTE_I_TO_GREEN  -0.274788f
+#define PALETTE_Q_TO_GREEN  -0.635691f
+#define PALETTE_I_TO_BLUE   -1.108545f
+#define PALETTE_Q_TO_BLUE    1.709007f
+
+
+struct PaletteParameters {
+    float hue;          // in degrees
+    float saturation;
+    float gamma;
+};
+
+// rgba colors of every palette index, the ppu and the frontend both convert with the same table
+struct Palette {
+    uint32_t colors_rgba[PALETTE_INDEX_COUNT];
+};
+
+
+// the built in 64 colors, the emphasized ones are derived by dimming the other 2 channels
+void PaletteInit(struct Palette* palette);
+
+// decodes the colors from the composite signal of the ppu the same way a tv would
+void PaletteGenerate(struct Palette* palette, const struct PaletteParameters* parameters);
+void PaletteGetDefaultParameters(struct PaletteParameters* parameters);
+
+// raw rgb triplets, 64 colors (emphasis derived) or all 512
+void PaletteLoad(struct Palette* palette, const char* filename);
+
+// composite signal level (0 is black, 1 is white) of a palette index at a phase of the color subcarrier
+float PaletteSignal(const uint16_t palette_index, const uint8_t phase);
+
+#endif
\ No newline at end of file
@@ -2,11 +2,36 @@
 #include <stdio.h>
 
 #include "ppu.h"
+#include "ppu_composite.h"
 #include "logger.h"
 
 
-void PPUInit(struct PPU* ppu, struct PPUBus* ppu_bus, enum TVSystem tv_system) {
+// the pattern table is set to a value that can't match so the first cached line redecodes everything
+static void ResetBackgroundCache(struct PPU* ppu) {
+    ppu->background_cache_pattern_table = 0xFFFF;
+
+    ppu->background_prefetch_clean = false;
+    ppu->background_line_cached = false;
+    ppu->background_line_column = 0;
+    ppu->background_line_row = 0;
+}
+
+static uint16_t ScanlineIRQCycle(const uint8_t ctrl_register) {
+    // 8x16 sprites pick the table per tile but the empty slots fetch tile 0xFF, so they count as 0x1000
+    bool sprites_high = (ctrl_register & (SPRITE_PATTERN_TABLE_ADDRESS_BIT | SPRITE_SIZE_BIT)) != 0;
+    bool background_high = (ctrl_register & BACKGROUND_PATTERN_TABLE_ADDRESS_BIT) != 0;
+    if (sprites_high && !background_high) {
+        return SCANLINE_SPRITE_FETCH_IRQ_CYCLE;
+    } else if (background_high && !sprites_high) {
+        return SCANLINE_BACKGROUND_FETCH_IRQ_CYCLE;
+    } else {
+        return SCANLINE_NO_IRQ_CYCLE;
+    }
+}
+
+void PPUInit(struct PPU* ppu, struct PPUBus* ppu_bus, const struct Palette* palette, enum TVSystem tv_system) {
     ppu->ctrl_register = 0;
+    ppu->scanline_irq_cycle = ScanlineIRQCycle(ppu->ctrl_register);
     ppu->mask_register = 0;
     ppu->status_register = 0;
     ppu->oam_address_register = 0;
@@ -25,20 +50,41 @@ void PPUInit(struct PPU* ppu, struct PPUBus* ppu_bus, enum TVSystem tv_system) {
     memset(ppu->OAM, 0, 256 * sizeof(uint8_t));
     memset(ppu->scanline_OAM_indecies, 0, 8 * sizeof(uint8_t));
     ppu->scanline_OAM_length = 0;
+    memset(ppu->sprite_line_buffer, 0, NES_SCREEN_WIDTH * sizeof(uint8_t));
+    memset(ppu->background_line_buffer, 0, NES_SCREEN_WIDTH * sizeof(uint8_t));
+
+    ppu->tile_id_latch = 0;
+    ppu->tile_attribute_latch = 0;
+    ppu->tile_pattern_lower_latch = 0;
+    ppu->tile_pattern_upper_latch = 0;
+    ppu->pattern_shift_lower = 0;
+    ppu->pattern_shift_upper = 0;
+    ppu->attribute_shift_lower = 0;
+    ppu->attribute_shift_upper = 0;
+
+    ppu->background_cache_enabled = true;
+    ResetBackgroundCache(ppu);
 
     ppu->render_state = PRE_RENDER;
-    ppu->scanline = (tv_system == NTSC) ? NTSC_VERTICAL_BLANKING_SCANLINE_END : PAL_VERTICAL_BLANKING_SCANLINE_END;
+    ppu->region = PPUGetRegion(tv_system);
+    ppu->scanline = ppu->region->vertical_blanking_scanline_end;
     ppu->cycle = 0;
 
     ppu->is_odd_frame = 0;
 
     ppu->sprite_0_hit_happened = false;
 
+    ppu->palette_indices_buffer = NULL;
+    ppu->palette = palette;
+
     ppu->ppu_bus = ppu_bus;
+
+    PPUCompositeInit();
 }
 
 void PPUReset(struct PPU* ppu, enum TVSystem tv_system) {
     ppu->ctrl_register = 0;
+    ppu->scanline_irq_cycle = ScanlineIRQCycle(ppu->ctrl_register);
     ppu->mask_register = 0;
     ppu->status_register = ppu->status_register & VERTICAL_BLANK_BIT;
     ppu->scroll_register = 0;
@@ -54,9 +100,23 @@ void PPUReset(struct PPU* ppu, enum TVSystem tv_system) {
     memset(ppu->OAM, 0, 256 * sizeof(uint8_t));
     memset(ppu->scanline_OAM_indecies, 0, 8 * sizeof(uint8_t));
     ppu->scanline_OAM_length = 0;
+    memset(ppu->sprite_line_buffer, 0, NES_SCREEN_WIDTH * sizeof(uint8_t));
+    memset(ppu->background_line_buffer, 0, NES_SCREEN_WIDTH * sizeof(uint8_t));
+
+    ppu->tile_id_latch = 0;
+    ppu->tile_attribute_latch = 0;
+    ppu->tile_pattern_lower_latch = 0;
+    ppu->tile_pattern_upper_latch = 0;
+    ppu->pattern_shift_lower = 0;
+    ppu->pattern_shift_upper = 0;
+    ppu->attribute_shift_lower = 0;
+    ppu->attribute_shift_upper = 0;
+
+    ResetBackgroundCache(ppu);
     
     ppu->render_state = PRE_RENDER;
-    ppu->scanline = (tv_system == NTSC) ? NTSC_VERTICAL_BLANKING_SCANLINE_END : PAL_VERTICAL_BLANKING_SCANLINE_END;
+    ppu->region = PPUGetRegion(tv_system);
+    ppu->scanline = ppu->region->vertical_blanking_scanline_end;
     ppu->cycle = 0;
 
     ppu->is_odd_frame = 0;
@@ -64,307 +124,708 @@ void PPUReset(struct PPU* ppu, enum TVSystem tv_system) {
     ppu->sprite_0_hit_happened = false;
 }
 
+void PPUSetRegion(struct PPU* ppu, enum TVSystem tv_system) {
+    ppu->region = PPUGetRegion(tv_system);
+    ppu->render_state = PRE_RENDER;
+    ppu->scanline = ppu->region->vertical_blanking_scanline_end;
+    ppu->cycle = 0;
 
-enum GenerateInterrupt PPUClockNTSC(struct PPU* ppu, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]) {
-    // the reason why the cartridge gets interrupted from here and the cpu isn't is 
-    // because PPU struct can't have a reference to CPU (that would create circular dependency)
-    // so either is has a void pointer to a callback or informs the emulator trough the return value, which interrupts it
-    enum GenerateInterrupt generate_interrupt = GENERATE_NO_INTERRUPT;
+    ppu->background_prefetch_clean = false;
+    ppu->background_line_cached = false;
+}
 
-    switch (ppu->render_state) {
-        case RENDER: 
-            if (ppu->cycle > 0 && ppu->cycle <= SCANLINE_VISIBLE_DOTS) {
-                uint8_t dot = ppu->cycle - 1;   // dot is basically x
-                uint8_t fine_x = (ppu->x + dot) & 0x07;
-                
-                uint8_t background_color_address = 0;
-                bool background_opaque = false;
 
-                if (ppu->mask_register & SHOW_BACKGROUND_BIT) {
-                    if ((ppu->mask_register & SHOW_BACKGROUND_LEFTMOST_BIT) || dot >= 8) {
-                        // render background
-                        uint16_t tile_address = 0x2000 | (ppu->v & 0x0FFF);
+// fetches both pattern planes of every sprite for the next scanline once, so the visible dots only have to look up a single byte
+static void RasterizeSpriteLine(struct PPU* ppu) {
+    memset(ppu->sprite_line_buffer, 0, NES_SCREEN_WIDTH * sizeof(uint8_t));
 
-                        uint16_t pattern_address = (((uint16_t)PPUBusRead(ppu->ppu_bus, tile_address) << 4) + ((ppu->v >> 12) & 0x0007)) 
-                                                 | ((ppu->ctrl_register & BACKGROUND_PATTERN_TABLE_ADDRESS_BIT) << 8);
+    uint8_t height = (ppu->ctrl_register & SPRITE_SIZE_BIT) ? 16 : 8;
+    for (int i = 0; i < ppu->scanline_OAM_length; i++) {
+        uint8_t sprite_y =          ppu->OAM[ppu->scanline_OAM_indecies[i]    ];
+        uint8_t sprite_index =      ppu->OAM[ppu->scanline_OAM_indecies[i] + 1];
+        uint8_t sprite_attributes = ppu->OAM[ppu->scanline_OAM_indecies[i] + 2];
+        uint8_t sprite_x =          ppu->OAM[ppu->scanline_OAM_indecies[i] + 3];
 
-                        background_color_address = ((PPUBusRead(ppu->ppu_bus, pattern_address) >> (fine_x ^ 0x07)) & 0x01)
-                                                 | (((PPUBusRead(ppu->ppu_bus, (pattern_address + 8)) >> (fine_x ^ 0x07)) & 0x01) << 1);
-                        
-                        background_opaque = (bool)background_color_address;
+        // this runs on the scanline before the sprite is drawn but sprites are also drawn 1 line below their y so the row is the same
+        uint8_t shift_y = (ppu->scanline - sprite_y) % height;
+        if (sprite_attributes & FLIP_SPRITE_VERTICALLY_BIT) {
+            shift_y ^= (height - 1);
+        }
 
-                        uint16_t attribute_address = 0x23C0 | (ppu->v & 0x0C00) | ((ppu->v >> 4) & 0x0038) | ((ppu->v >> 2) & 0x0007);
-                        background_color_address |= (((PPUBusRead(ppu->ppu_bus, attribute_address) >> (((ppu->v >> 4) & 0x04) | (ppu->v & 0x02))) & 0x03) << 2);
-                    }
+        uint16_t pattern_address;
+        if (ppu->ctrl_register & SPRITE_SIZE_BIT) {
+            // 16 pixel tall tiles
+            pattern_address = ((uint16_t)(sprite_index & 0b11111110) << 4) + ((shift_y & 0x07) | ((shift_y & 0x08) << 1));
+            pattern_address |= (sprite_index & 0b00000001) ? 0x1000 : 0;
+        } else {
+            // 8 pixel tall tiles
+            pattern_address = ((uint16_t)sprite_index << 4) + shift_y + ((ppu->ctrl_register & SPRITE_PATTERN_TABLE_ADDRESS_BIT) ? 0x1000 : 0);
+        }
 
-                    if (fine_x == 7) {
-                        if ((ppu->v & 0x001F) == 0x001F) {
-                            ppu->v &= ~0x001F;
-                            ppu->v ^= 0x0400;
-                        } else {
-                            ppu->v++;
-                        }
-                    }
-                }
+        uint8_t pattern_lower = PPUBusFetch(ppu->ppu_bus, pattern_address);
+        uint8_t pattern_upper = PPUBusFetch(ppu->ppu_bus, (pattern_address + 8));
+
+        uint8_t attributes = 0x10 | ((sprite_attributes & SPRITE_PALETTE_BITS) << 2);
+        attributes |= (sprite_attributes & SPRITE_PRIORITY_BIT) ? SPRITE_LINE_BEHIND_BACKGROUND_BIT : 0;
+        attributes |= (ppu->scanline_OAM_indecies[i] == 0) ? SPRITE_LINE_SPRITE_0_BIT : 0;
 
+        for (uint8_t fine_x = 0; fine_x < 8 && (sprite_x + fine_x) < NES_SCREEN_WIDTH; fine_x++) {
+            // sprites earlier in oam have priority so an opaque pixel is never overwritten
+            if (ppu->sprite_line_buffer[sprite_x + fine_x] & SPRITE_LINE_OPAQUE_BITS) {
+                continue;
+            }
 
-                uint8_t sprite_color_address = 0;
-                bool sprite_opaque = false;
+            uint8_t shift_x = (sprite_attributes & FLIP_SPRITE_HORIZONTALLY_BIT) ? fine_x : (fine_x ^ 0x07);
+            uint8_t color = ((pattern_lower >> shift_x) & 0x01) | (((pattern_upper >> shift_x) & 0x01) << 1);
 
-                bool sprite_in_foreground = false;
+            if (color) {
+                ppu->sprite_line_buffer[sprite_x + fine_x] = attributes | color;
+            }
+        }
+    }
+}
 
-                if ((ppu->mask_register & SHOW_SPRITES_BIT) && ((ppu->mask_register & SHOW_SPRITES_LEFTMOST_BIT) || dot >= 8)) {
-                    uint8_t height = (ppu->ctrl_register & SPRITE_SIZE_BIT) ? 16 : 8;
-                    int i = 0;
-                    while (!sprite_opaque && i < ppu->scanline_OAM_length) {
-                        uint8_t sprite_y =          ppu->OAM[ppu->scanline_OAM_indecies[i]    ] + 1;
-                        uint8_t sprite_index =      ppu->OAM[ppu->scanline_OAM_indecies[i] + 1];
-                        uint8_t sprite_attributes = ppu->OAM[ppu->scanline_OAM_indecies[i] + 2];
-                        uint8_t sprite_x =          ppu->OAM[ppu->scanline_OAM_indecies[i] + 3];
 
-                        
-                        if ((int)(dot - sprite_x) >= 0 && (int)(dot - sprite_x) < 8) {
-                            // note subtracting 2 unsigned numbers in both x and y case will result in positive numbers because of prior checks assuring it 
-                            uint8_t shift_x = (dot - sprite_x) % 8;
-                            uint8_t shift_y = (ppu->scanline - sprite_y) % height;
+static void CompositeScanline(struct PPU* ppu, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]) {
+    // with rendering disabled and v pointing into palette ram the backdrop shows that color instead
+    uint8_t backdrop_color_address = 0;
+    if ((ppu->v & 0x3F00) == 0x3F00 && !(ppu->mask_register & (SHOW_BACKGROUND_BIT | SHOW_SPRITES_BIT))) {
+        backdrop_color_address = ppu->v & 0x1F;
+    }
 
-                            if (!(sprite_attributes & FLIP_SPRITE_HORIZONTALLY_BIT)) {
-                                shift_x ^= 0x07;
-                            }
-                            if (sprite_attributes & FLIP_SPRITE_VERTICALLY_BIT) {
-                                shift_y ^= (height - 1);
-                            }
+    if (ppu->palette_indices_buffer != NULL) {
+        PPUCompositeScanline(ppu->background_line_buffer, ppu->sprite_line_buffer, ppu->ppu_bus->palette, ppu->mask_register, backdrop_color_address, &ppu->palette_indices_buffer[ppu->scanline * NES_SCREEN_WIDTH]);
+        return;
+    }
 
-                            uint16_t pattern_address;
-                            if (ppu->ctrl_register & SPRITE_SIZE_BIT) {
-                                // 16 pixel tall tiles
-                                pattern_address = ((uint16_t)(sprite_index & 0b11111110) << 4) + ((shift_y & 0x07) | ((shift_y & 0x08) << 1));
-                                pattern_address |= (sprite_index & 0b00000001) ? 0x1000 : 0;
-                            } else {
-                                // 8 pixel tall tiles
-                                pattern_address = ((uint16_t)sprite_index << 4) + shift_y + ((ppu->ctrl_register & SPRITE_PATTERN_TABLE_ADDRESS_BIT) ? 0x1000 : 0);
-                            }
+    uint16_t palette_indices[NES_SCREEN_WIDTH];
+    PPUCompositeScanline(ppu->background_line_buffer, ppu->sprite_line_buffer, ppu->ppu_bus->palette, ppu->mask_register, backdrop_color_address, palette_indices);
 
-                            sprite_color_address = ((PPUBusRead(ppu->ppu_bus, pattern_address) >> shift_x) & 0x01)
-                                                 | (((PPUBusRead(ppu->ppu_bus, (pattern_address + 8)) >> shift_x) & 0x01) << 1);
+    uint32_t* pixels_row = &pixels_buffer[ppu->scanline * NES_SCREEN_WIDTH];
+    for (int x = 0; x < NES_SCREEN_WIDTH; x++) {
+        pixels_row[x] = ppu->palette->colors_rgba[palette_indices[x]];
+    }
+}
 
-                            sprite_opaque = (bool)sprite_color_address;
+static inline bool RenderingEnabled(const struct PPU* ppu) {
+    return ppu->mask_register & (SHOW_BACKGROUND_BIT | SHOW_SPRITES_BIT);
+}
 
-                            sprite_color_address |= 0x10;
-                            sprite_color_address |= (sprite_attributes & SPRITE_PALETTE_BITS) << 2;
-                        
-                            sprite_in_foreground = !((bool)(sprite_attributes & SPRITE_PRIORITY_BIT));
-                        }
+static void IncrementHorizontal(struct PPU* ppu) {
+    if ((ppu->v & 0x001F) == 0x001F) {
+        ppu->v &= ~0x001F;
+        ppu->v ^= 0x0400;
+    } else {
+        ppu->v++;
+    }
+}
 
-                        i++;
-                    };
+static void IncrementVertical(struct PPU* ppu) {
+    if ((ppu->v & 0x7000) != 0x7000) {
+        ppu->v += 0x1000;
+    } else {
+        ppu->v &= ~0x7000;
+        uint16_t coarse_y = (ppu->v & 0x03E0) >> 5;
+        if (coarse_y == 29) {
+            coarse_y = 0;
+            ppu->v ^= 0x0800;
+        } else if (coarse_y == 31) {
+            coarse_y = 0;
+        } else {
+            coarse_y++;
+        }
+        ppu->v = (ppu->v & ~0x03E0) | (coarse_y << 5);
+    }
+}
 
+static void ReloadBackgroundShifters(struct PPU* ppu) {
+    ppu->pattern_shift_lower = (ppu->pattern_shift_lower & 0xFF00) | ppu->tile_pattern_lower_latch;
+    ppu->pattern_shift_upper = (ppu->pattern_shift_upper & 0xFF00) | ppu->tile_pattern_upper_latch;
+    ppu->attribute_shift_lower = (ppu->attribute_shift_lower & 0xFF00) | ((ppu->tile_attribute_latch & 0x01) ? 0x00FF : 0x0000);
+    ppu->attribute_shift_upper = (ppu->attribute_shift_upper & 0xFF00) | ((ppu->tile_attribute_latch & 0x02) ? 0x00FF : 0x0000);
+}
 
-                    if (sprite_opaque && background_opaque && ppu->scanline_OAM_indecies[i - 1] == 0 && dot != 255 && !ppu->sprite_0_hit_happened) {
-                        ppu->status_register |= SPRITE_ZERO_HIT_BIT;
-                        ppu->sprite_0_hit_happened = true;
-                    }
+// one step of the 8 dot tile fetch (nametable, attribute, pattern low, pattern high), the address is put on the bus
+// on the first dot of each pair and read on the second but the whole fetch is done at once here
+static void FetchBackground(struct PPU* ppu) {
+    switch ((ppu->cycle - 1) & 0x07) {
+        case 0:
+            ppu->tile_id_latch = PPUBusFetch(ppu->ppu_bus, 0x2000 | (ppu->v & 0x0FFF));
+            break;
+        case 2: {
+            uint16_t attribute_address = 0x23C0 | (ppu->v & 0x0C00) | ((ppu->v >> 4) & 0x0038) | ((ppu->v >> 2) & 0x0007);
+            ppu->tile_attribute_latch = (PPUBusFetch(ppu->ppu_bus, attribute_address) >> (((ppu->v >> 4) & 0x04) | (ppu->v & 0x02))) & 0x03;
+            break;
+        }
+        case 4:
+            ppu->tile_pattern_lower_latch = PPUBusFetch(ppu->ppu_bus, (((uint16_t)ppu->tile_id_latch << 4) + ((ppu->v >> 12) & 0x0007)) 
+                                                                   | ((ppu->ctrl_register & BACKGROUND_PATTERN_TABLE_ADDRESS_BIT) << 8));
+            break;
+        case 6:
+            ppu->tile_pattern_upper_latch = PPUBusFetch(ppu->ppu_bus, ((((uint16_t)ppu->tile_id_latch << 4) + ((ppu->v >> 12) & 0x0007)) 
+                                                                    | ((ppu->ctrl_register & BACKGROUND_PATTERN_TABLE_ADDRESS_BIT) << 8)) + 8);
+            break;
+        case 7:
+            IncrementHorizontal(ppu);
+            break;
+    }
+}
+
+static void DecodeBackgroundTile(struct PPU* ppu, const uint8_t nametable, const uint8_t tile_row, const uint8_t tile_column) {
+    uint8_t* const* pages = ppu->ppu_bus->cartridge->ppu_pages;
+    const uint8_t* nametable_bytes = pages[PPU_NAMETABLE_PAGE + nametable];
+
+    uint8_t tile_id = nametable_bytes[tile_row * NAMETABLE_TILE_COLUMNS + tile_column];
+    uint8_t attribute = nametable_bytes[NAMETABLE_ATTRIBUTE_OFFSET + (tile_row >> 2) * 8 + (tile_column >> 2)];
+    uint8_t attribute_bits = ((attribute >> (((tile_row << 1) & 0x04) | (tile_column & 0x02))) & 0x03) << 2;
+    uint16_t pattern_address = ppu->background_cache_pattern_table | ((uint16_t)tile_id << 4);
+    // a tile never crosses a page
+    const uint8_t* pattern = &pages[pattern_address / PPU_PAGE_SIZE][pattern_address % PPU_PAGE_SIZE];
+
+    uint16_t y = (nametable >> 1) * NES_SCREEN_HEIGHT + tile_row * 8;
+    uint16_t x = (nametable & 0x01) * NES_SCREEN_WIDTH + tile_column * 8;
+    for (uint8_t fine_y = 0; fine_y < 8; fine_y++) {
+        uint8_t pattern_lower = pattern[fine_y];
+        uint8_t pattern_upper = pattern[0x0008 | fine_y];
+
+        uint8_t* pixels = &ppu->background_cache[y + fine_y][x];
+        for (uint8_t fine_x = 0; fine_x < 8; fine_x++) {
+            pixels[fine_x] = ((pattern_lower >> (fine_x ^ 0x07)) & 0x01) | (((pattern_upper >> (fine_x ^ 0x07)) & 0x01) << 1) | attribute_bits;
+        }
+    }
+}
+
+// turns the switches the ppu bus can't see and the dirty chr tiles into dirty nametable tiles
+static void SyncBackgroundCacheSources(struct PPU* ppu) {
+    struct PPUBus* ppu_bus = ppu->ppu_bus;
+
+    uint16_t pattern_table = (ppu->ctrl_register & BACKGROUND_PATTERN_TABLE_ADDRESS_BIT) << 8;
+    if (pattern_table != ppu->background_cache_pattern_table) {
+        ppu->background_cache_pattern_table = pattern_table;
+        memset(ppu_bus->nametable_dirty, 0xFF, sizeof(ppu_bus->nametable_dirty));
+    }
+
+    uint8_t* const* pages = ppu_bus->cartridge->ppu_pages;
+    for (uint8_t nametable = 0; nametable < NAMETABLE_COUNT; nametable++) {
+        if (pages[PPU_NAMETABLE_PAGE + nametable] != ppu_bus->dirty_nametable_pages[nametable]) {
+            ppu_bus->dirty_nametable_pages[nametable] = pages[PPU_NAMETABLE_PAGE + nametable];
+            memset(ppu_bus->nametable_dirty[nametable], 0xFF, sizeof(ppu_bus->nametable_dirty[nametable]));
+        }
+    }
+
+    uint64_t chr_dirty = 0;
+    for (uint8_t page = 0; page < CHR_PAGE_COUNT; page++) {
+        if (pages[page] != ppu_bus->dirty_chr_pages[page]) {
+            ppu_bus->dirty_chr_pages[page] = pages[page];
+            ppu_bus->chr_dirty[page] = ~(uint64_t)0;
+        }
+        chr_dirty |= ppu_bus->chr_dirty[page];
+    }
+    if (chr_dirty == 0) {
+        return;
+    }
+
+    // only the tiles of the cached pattern table matter, switching to the other one marks everything anyway
+    const uint64_t* pattern_table_dirty = &ppu_bus->chr_dirty[pattern_table / CHR_PAGE_SIZE];
+    for (uint8_t nametable = 0; nametable < NAMETABLE_COUNT; nametable++) {
+        const uint8_t* nametable_bytes = pages[PPU_NAMETABLE_PAGE + nametable];
+        for (uint8_t tile_row = 0; tile_row < NAMETABLE_TILE_ROWS; tile_row++) {
+            for (uint8_t tile_column = 0; tile_column < NAMETABLE_TILE_COLUMNS; tile_column++) {
+                uint8_t tile_id = nametable_bytes[tile_row * NAMETABLE_TILE_COLUMNS + tile_column];
+                if ((pattern_table_dirty[tile_id >> 6] >> (tile_id & 0x3F)) & 0x01) {
+                    ppu_bus->nametable_dirty[nametable][tile_row] |= (uint32_t)1 << tile_column;
                 }
+            }
+        }
+    }
+    memset(ppu_bus->chr_dirty, 0, sizeof(ppu_bus->chr_dirty));
+}
 
-                uint8_t color_address = background_color_address;
-                if (!background_opaque && !sprite_opaque) {
-                    color_address = 0;
-                    if ((ppu->v & 0x3F00) == 0x3F00 && !(ppu->mask_register & (SHOW_BACKGROUND_BIT | SHOW_SPRITES_BIT))) {
-                        color_address = ppu->v & 0x1F;
-                    }
-                } else if (sprite_opaque && (!background_opaque || sprite_in_foreground)) {
-                    color_address = sprite_color_address;
+// at dot 1 of a visible line, when the fetches of the line can only read what is already decoded in the cache
+// the whole background line is copied from it in (at most) 2 spans and the pipeline idles until the end of the line
+static void CacheBackgroundLine(struct PPU* ppu) {
+    uint8_t coarse_y = (ppu->v >> 5) & 0x1F;
+    if (!ppu->background_cache_enabled || !ppu->background_prefetch_clean || !(ppu->mask_register & SHOW_BACKGROUND_BIT) || coarse_y >= NAMETABLE_TILE_ROWS) {
+        // rows 30 and 31 fetch the attribute bytes as tiles, those are left to the pipeline
+        return;
+    }
+
+    SyncBackgroundCacheSources(ppu);
+
+    // v already went past the 2 prefetched tiles
+    uint8_t nametable_y = (ppu->v >> 11) & 0x01;
+    uint8_t first_tile = ((((ppu->v >> 5) & 0x20) | (ppu->v & 0x1F)) - 2) & 0x3F;
+    for (uint8_t i = 0; i < BACKGROUND_LINE_TILES; i++) {
+        uint8_t tile = (first_tile + i) & 0x3F;
+        uint8_t nametable = (nametable_y << 1) | (tile >> 5);
+        uint32_t tile_bit = (uint32_t)1 << (tile & 0x1F);
+        if (ppu->ppu_bus->nametable_dirty[nametable][coarse_y] & tile_bit) {
+            DecodeBackgroundTile(ppu, nametable, coarse_y, tile & 0x1F);
+            ppu->ppu_bus->nametable_dirty[nametable][coarse_y] &= ~tile_bit;
+        }
+    }
+
+    ppu->background_line_column = first_tile * 8;
+    ppu->background_line_row = nametable_y * NES_SCREEN_HEIGHT + coarse_y * 8 + ((ppu->v >> 12) & 0x07);
+
+    const uint8_t* cache_row = ppu->background_cache[ppu->background_line_row];
+    uint16_t start = (ppu->background_line_column + ppu->x) % BACKGROUND_CACHE_WIDTH;
+    uint16_t first_span = BACKGROUND_CACHE_WIDTH - start;
+    if (first_span >= NES_SCREEN_WIDTH) {
+        memcpy(ppu->background_line_buffer, &cache_row[start], NES_SCREEN_WIDTH * sizeof(uint8_t));
+    } else {
+        memcpy(ppu->background_line_buffer, &cache_row[start], first_span * sizeof(uint8_t));
+        memcpy(&ppu->background_line_buffer[first_span], cache_row, (NES_SCREEN_WIDTH - first_span) * sizeof(uint8_t));
+    }
+
+    ppu->background_line_cached = true;
+}
+
+// up to 16 pixels of the cached line as one pattern or attribute plane, pixel is counted from the first prefetched tile
+static uint16_t CachedLinePlane(const struct PPU* ppu, const uint16_t pixel, const uint8_t count, const uint8_t plane) {
+    const uint8_t* cache_row = ppu->background_cache[ppu->background_line_row];
+    uint16_t bits = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        bits = (bits << 1) | ((cache_row[(ppu->background_line_column + pixel + i) % BACKGROUND_CACHE_WIDTH] >> plane) & 0x01);
+    }
+    return bits;
+}
+
+// puts the shifters and latches where the skipped fetches would have left them after the given dot, v is always kept up to date
+static void LeaveCachedLine(struct PPU* ppu, const uint16_t dot) {
+    uint16_t pixel = dot - 1;       // the pixel in the high bit of the shifters
+    uint8_t shifted = pixel & 0x07; // since the last reload, the freed low bits are 0
+    uint8_t count = 16 - shifted;
+
+    ppu->pattern_shift_lower = CachedLinePlane(ppu, pixel, count, 0) << shifted;
+    ppu->pattern_shift_upper = CachedLinePlane(ppu, pixel, count, 1) << shifted;
+    ppu->attribute_shift_lower = CachedLinePlane(ppu, pixel, count, 2) << shifted;
+    ppu->attribute_shift_upper = CachedLinePlane(ppu, pixel, count, 3) << shifted;
+
+    // the tile being fetched is 2 ahead, the latches of the steps that haven't happened yet still hold the tile before it
+    uint16_t fetched_pixel = (pixel & ~0x07) + 16;
+    uint8_t tile = ((ppu->background_line_column + fetched_pixel) / 8) & 0x3F;
+    uint8_t nametable = ((ppu->background_line_row / NES_SCREEN_HEIGHT) << 1) | (tile >> 5);
+    uint8_t tile_row = (ppu->background_line_row % NES_SCREEN_HEIGHT) / 8;
+    ppu->tile_id_latch = ppu->ppu_bus->cartridge->ppu_pages[PPU_NAMETABLE_PAGE + nametable][tile_row * NAMETABLE_TILE_COLUMNS + (tile & 0x1F)];
+
+    uint16_t attribute_pixel = (shifted >= 2) ? fetched_pixel : (fetched_pixel - 8);
+    ppu->tile_attribute_latch = CachedLinePlane(ppu, attribute_pixel, 1, 2) | (CachedLinePlane(ppu, attribute_pixel, 1, 3) << 1);
+    ppu->tile_pattern_lower_latch = CachedLinePlane(ppu, (shifted >= 4) ? fetched_pixel : (fetched_pixel - 8), 8, 0);
+    ppu->tile_pattern_upper_latch = CachedLinePlane(ppu, (shifted >= 6) ? fetched_pixel : (fetched_pixel - 8), 8, 1);
+
+    ppu->background_line_cached = false;
+}
+
+// anything that can change the background fetches (register writes, vram and chr writes, bank switches)
+static void BackgroundChanged(struct PPU* ppu) {
+    if (ppu->background_line_cached) {
+        LeaveCachedLine(ppu, ppu->cycle - 1);
+    }
+    ppu->background_prefetch_clean = false;
+}
+
+void PPUSyncBackground(struct PPU* ppu) {
+    BackgroundChanged(ppu);
+}
+
+// background half of the render and pre-render scanlines: dots 1-256 fetch the tiles for the line (2 tiles ahead),
+// 321-336 prefetch the first 2 tiles of the next line and the shifters move one pixel every dot in between
+static void ClockBackgroundPipeline(struct PPU* ppu) {
+    if (!RenderingEnabled(ppu)) {
+        return;
+    }
+
+    uint16_t dot = ppu->cycle;
+
+    if (ppu->background_line_cached) {
+        if ((dot & 0x07) == 0) {
+            IncrementHorizontal(ppu);
+        }
+        if (dot == SCANLINE_VISIBLE_DOTS) {
+            IncrementVertical(ppu);
+            LeaveCachedLine(ppu, dot);
+        }
+        return;
+    }
+
+    if (dot == 321) {
+        ppu->background_prefetch_clean = true;
+    }
+
+    if ((dot >= 2 && dot <= (SCANLINE_VISIBLE_DOTS + 1)) || (dot >= 322 && dot <= 337)) {
+        ppu->pattern_shift_lower <<= 1;
+        ppu->pattern_shift_upper <<= 1;
+        ppu->attribute_shift_lower <<= 1;
+        ppu->attribute_shift_upper <<= 1;
+    }
+
+    if (((dot & 0x07) == 1) && ((dot >= 9 && dot <= (SCANLINE_VISIBLE_DOTS + 1)) || dot == 329 || dot == 337)) {
+        ReloadBackgroundShifters(ppu);
+    }
+
+    if ((dot >= 1 && dot <= SCANLINE_VISIBLE_DOTS) || (dot >= 321 && dot <= 336)) {
+        FetchBackground(ppu);
+    }
+
+    if (dot == SCANLINE_VISIBLE_DOTS) {
+        IncrementVertical(ppu);
+    } else if (dot == (SCANLINE_VISIBLE_DOTS + 1)) {
+        ppu->v &= ~0x041F;
+        ppu->v |= ppu->t & 0x041F;
+    }
+}
+
+static void EvaluateSprites(struct PPU* ppu) {
+    uint8_t height = (ppu->ctrl_register & SPRITE_SIZE_BIT) ? 16 : 8;
+    ppu->scanline_OAM_length = 0;
+
+    for (int oam_index = ppu->oam_address_register / 4; oam_index < 64; oam_index++) {
+        uint8_t sprite_y = ppu->OAM[oam_index * 4];
+        if (sprite_y <= ppu->scanline && ppu->scanline < (sprite_y + height)) {     // sprites are drawn one scanline lower than their y, so this is the next line's set
+            if (ppu->scanline_OAM_length < SCANLINE_OAM_BUFFER_SIZE) {
+                ppu->scanline_OAM_indecies[ppu->scanline_OAM_length] = oam_index * 4;
+                ppu->scanline_OAM_length++;
+            } else {
+                if ((ppu->scanline + 1) < RENDER_SCANLINE_END && RenderingEnabled(ppu)) {
+                    ppu->status_register |= SPRITE_OVERFLOW_BIT;
                 }
-                uint32_t color_rgba = nes_palette_colors_rgba[PPUBusRead(ppu->ppu_bus, (0x3F00 + color_address))];
-                pixels_buffer[ppu->scanline * NES_SCREEN_WIDTH + dot] = color_rgba;
-            } else if ((ppu->cycle == (SCANLINE_VISIBLE_DOTS + 1)) && (ppu->mask_register & SHOW_BACKGROUND_BIT)) {
-                if ((ppu->v & 0x7000) != 0x7000) {
-                    ppu->v += 0x1000;
-                } else {
-                    ppu->v &= ~0x7000;
-                    uint16_t coarse_y = (ppu->v & 0x03E0) >> 5;
-                    if (coarse_y == 29) {
-                        coarse_y = 0;
-                        ppu->v ^= 0x0800;
-                    } else if (coarse_y == 31) {
-                        coarse_y = 0;
-                    } else {
-                        coarse_y++;
+                break;
+            }
+        }
+    }
+
+    RasterizeSpriteLine(ppu);
+}
+
+
+// region is always one of the constant entries of the table below, so after inlining every check on it is folded away
+static inline __attribute__((always_inline)) enum GenerateInterrupt ClockRegion(struct PPU* ppu, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT], const struct Region* region) {
+    // the PPU struct can't have a reference to CPU (that would create circular dependency) so the nmi is returned
+    // to the emulator, the cartridge irq doesn't need that because it's a line the cpu samples by itself
+    enum GenerateInterrupt generate_interrupt = GENERATE_NO_INTERRUPT;
+
+    switch (ppu->render_state) {
+        case RENDER: {
+            if (ppu->cycle == 1 && RenderingEnabled(ppu)) {
+                CacheBackgroundLine(ppu);
+            }
+            // the pipeline leaves the cached line at dot 256 but that dot's pixel was copied as well
+            bool background_line_cached = ppu->background_line_cached;
+            ClockBackgroundPipeline(ppu);
+
+            if (ppu->cycle > 0 && ppu->cycle <= SCANLINE_VISIBLE_DOTS) {
+                uint8_t dot = ppu->cycle - 1;   // dot is basically x
+                
+                uint8_t background_color_address = ppu->background_line_buffer[dot];
+                if (!background_line_cached) {
+                    background_color_address = 0;
+                    if (ppu->mask_register & SHOW_BACKGROUND_BIT) {
+                        // the leftmost 8 pixels are masked when the scanline is composited
+                        uint16_t fine_x_bit = 0x8000 >> ppu->x;
+                        background_color_address = ((ppu->pattern_shift_lower & fine_x_bit) ? 0x01 : 0)
+                                                 | ((ppu->pattern_shift_upper & fine_x_bit) ? 0x02 : 0)
+                                                 | ((ppu->attribute_shift_lower & fine_x_bit) ? 0x04 : 0)
+                                                 | ((ppu->attribute_shift_upper & fine_x_bit) ? 0x08 : 0);
                     }
-                    ppu->v = (ppu->v & ~0x03E0) | (coarse_y << 5);
-                }
-            } else if ((ppu->cycle == (SCANLINE_VISIBLE_DOTS + 2)) && (ppu->mask_register & (SHOW_BACKGROUND_BIT | SHOW_SPRITES_BIT))) {
-                ppu->v &= ~0x041F;
-                ppu->v |= ppu->t & 0x041F;
-            } else if (ppu->cycle == SCANLINE_IRQ_CYCLE && (ppu->mask_register & (SHOW_BACKGROUND_BIT | SHOW_SPRITES_BIT))) {
-                if (PPUBusScanlineIRQ(ppu->ppu_bus)) {
-                    generate_interrupt = GENERATE_IRQ;
+                    ppu->background_line_buffer[dot] = background_color_address;
                 }
-            } else if (ppu->cycle == SCANLINE_LAST_CYCLE) { // checking if sprite rendering is enabled is unnecesseary because if it's disabled than the oam cache won't be read                
-                ppu->scanline++;
-                ppu->cycle = 0;
-
-
-                uint8_t height = (ppu->ctrl_register & SPRITE_SIZE_BIT) ? 16 : 8;
-                ppu->scanline_OAM_length = 0;
-
-                for (int oam_index = ppu->oam_address_register / 4; oam_index < 64; oam_index++) {
-                    uint8_t sprite_y = ppu->OAM[oam_index * 4];
-                    if (sprite_y <= (ppu->scanline - 1) && (ppu->scanline - 1) < (sprite_y + height)) {     // note that scanline has already been incremented but the way sprite y is implemented it needs to be offset one less
-                        if (ppu->scanline_OAM_length < SCANLINE_OAM_BUFFER_SIZE) {
-                            ppu->scanline_OAM_indecies[ppu->scanline_OAM_length] = oam_index * 4;
-                            ppu->scanline_OAM_length++;
-                        } else {
-                            if (ppu->scanline < RENDER_SCANLINE_END && (ppu->mask_register & (SHOW_BACKGROUND_BIT | SHOW_SPRITES_BIT))) {
-                                ppu->status_register |= SPRITE_OVERFLOW_BIT;
-                            }
-                            break;
-                        }
+
+
+                // sprite 0 hit has to be known on the exact dot, everything else is left for the compositing at the end of the line
+                uint8_t sprite_pixel = ppu->sprite_line_buffer[dot];
+                if ((sprite_pixel & SPRITE_LINE_SPRITE_0_BIT) && (background_color_address & 0x03) && dot != 255 && !ppu->sprite_0_hit_happened) {
+                    bool sprite_visible = (ppu->mask_register & SHOW_SPRITES_BIT) && ((ppu->mask_register & SHOW_SPRITES_LEFTMOST_BIT) || dot >= 8);
+                    bool background_visible = (ppu->mask_register & SHOW_BACKGROUND_LEFTMOST_BIT) || dot >= 8;
+                    if (sprite_visible && background_visible) {
+                        ppu->status_register |= SPRITE_ZERO_HIT_BIT;
+                        ppu->sprite_0_hit_happened = true;
                     }
                 }
-            }
 
-            if (ppu->scanline == RENDER_SCANLINE_END) {
-                ppu->scanline_OAM_length = 0;
-                ppu->render_state = POST_RENDER;
+                if (dot == (SCANLINE_VISIBLE_DOTS - 1)) {
+                    CompositeScanline(ppu, pixels_buffer);
+                }
+            } else if (ppu->cycle == (SCANLINE_VISIBLE_DOTS + 1)) { // checking if sprite rendering is enabled is unnecesseary because if it's disabled than the line buffer won't be read
+                EvaluateSprites(ppu);
+            } else if (ppu->cycle == ppu->scanline_irq_cycle && RenderingEnabled(ppu)) {
+                PPUBusScanlineIRQ(ppu->ppu_bus);
             }
             break;
+        }
         case POST_RENDER: 
-            if (ppu->cycle == SCANLINE_LAST_CYCLE) {
-                ppu->scanline++;
-                ppu->cycle = 0;
-            }
-
-            if (ppu->scanline == NTSC_POST_RENDER_SCANLINE_END) {
-                ppu->render_state = VERTICAL_BLANKING;
-            }
             break;
         case VERTICAL_BLANKING: 
-            if (ppu->cycle == 1 && ppu->scanline == NTSC_POST_RENDER_SCANLINE_END) {
+            if (ppu->cycle == 1 && ppu->scanline == region->post_render_scanline_end) {
                 ppu->status_register |= VERTICAL_BLANK_BIT;
                 if (ppu->ctrl_register & GENERATE_NMI_BIT) {
                     generate_interrupt = GENERATE_NMI;
                 }
-            } else if (ppu->cycle == SCANLINE_LAST_CYCLE) {
-                ppu->scanline++;
-                ppu->cycle = 0;
-            }
-
-            if (ppu->scanline == NTSC_VERTICAL_BLANKING_SCANLINE_END) {
-                ppu->render_state = FINISHED;
             }
             break;
         case PRE_RENDER: 
+            ClockBackgroundPipeline(ppu);
+
             if (ppu->cycle == 1) {
                 ppu->status_register &= ~(SPRITE_ZERO_HIT_BIT | VERTICAL_BLANK_BIT | SPRITE_OVERFLOW_BIT);
                 ppu->sprite_0_hit_happened = false;
-            } else if ((ppu->cycle == (SCANLINE_VISIBLE_DOTS + 2)) && (ppu->mask_register & (SHOW_BACKGROUND_BIT | SHOW_SPRITES_BIT))) {
-                ppu->v &= ~0x041F;
-                ppu->v |= ppu->t & 0x041F;
-            } else if (ppu->cycle >= 281 && ppu->cycle <= 305 && (ppu->mask_register & (SHOW_BACKGROUND_BIT | SHOW_SPRITES_BIT))) {    // hard to get information on this but i think this should last 25 cycles and it starts at 281 because cycles and dots are offset by 1
+            } else if (ppu->cycle >= 280 && ppu->cycle <= 304 && RenderingEnabled(ppu)) {
                 ppu->v &= ~0x7BE0;
                 ppu->v |= ppu->t & 0x7BE0;
-            } else if (ppu->cycle == SCANLINE_IRQ_CYCLE && (ppu->mask_register & (SHOW_BACKGROUND_BIT | SHOW_SPRITES_BIT))) {
-                if (PPUBusScanlineIRQ(ppu->ppu_bus)) {
-                    generate_interrupt = GENERATE_IRQ;
-                }
-            } else if (ppu->cycle == (SCANLINE_LAST_CYCLE - 1) && ppu->is_odd_frame && (ppu->mask_register & (SHOW_BACKGROUND_BIT | SHOW_SPRITES_BIT))) {
-                ppu->scanline++;
-                ppu->cycle = 0;
-            } else if (ppu->cycle == SCANLINE_LAST_CYCLE) {
-                ppu->scanline++;
-                ppu->cycle = 0;
-            }
-
-            if (ppu->scanline == NTSC_PRE_RENDER_SCANLINE_END) {
-                ppu->render_state = RENDER;
-                ppu->scanline = 0;
-                ppu->is_odd_frame = !(ppu->is_odd_frame);
+            } else if (ppu->cycle == ppu->scanline_irq_cycle && RenderingEnabled(ppu)) {
+                PPUBusScanlineIRQ(ppu->ppu_bus);
+            } else if (ppu->cycle == (SCANLINE_LAST_CYCLE - 1) && region->skips_odd_frame_dot && ppu->is_odd_frame && RenderingEnabled(ppu)) {
+                // odd frames skip the last dot of the pre-render scanline (only on NTSC)
+                ppu->cycle = SCANLINE_LAST_CYCLE;
             }
             break;
         case FINISHED: 
             LOG(ERROR, PPU, "ppu shouldn't be clocked when it's state is set to FINISHED\n");
             break;
     }
+
     ppu->cycle++;
+    if (ppu->cycle == SCANLINE_DOTS) {
+        ppu->cycle = 0;
+        ppu->scanline++;
+
+        switch (ppu->render_state) {
+            case RENDER:
+                if (ppu->scanline == RENDER_SCANLINE_END) {
+                    ppu->scanline_OAM_length = 0;
+                    memset(ppu->sprite_line_buffer, 0, NES_SCREEN_WIDTH * sizeof(uint8_t));
+                    ppu->render_state = POST_RENDER;
+                }
+                break;
+            case POST_RENDER:
+                if (ppu->scanline == region->post_render_scanline_end) {
+                    ppu->render_state = VERTICAL_BLANKING;
+                }
+                break;
+            case VERTICAL_BLANKING:
+                if (ppu->scanline == region->vertical_blanking_scanline_end) {
+                    ppu->render_state = FINISHED;
+                }
+                break;
+            case PRE_RENDER:
+                if (ppu->scanline == region->pre_render_scanline_end) {
+                    ppu->render_state = RENDER;
+                    ppu->scanline = 0;
+                    ppu->is_odd_frame = !(ppu->is_odd_frame);
+                }
+                break;
+            case FINISHED:
+                break;
+        }
+    }
 
     return generate_interrupt;
 }
 
-enum GenerateInterrupt PPUClockPAL(struct PPU* ppu, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]) {
-    LOG(ERROR, PPU, "PAL not implemented\n");
+
+static const struct Region regions[] = {
+    [NTSC] = {
+        .tv_system = NTSC,
+        .name = "NTSC",
+        .Clock = &PPUClockNTSC,
+        .post_render_scanline_end = NTSC_POST_RENDER_SCANLINE_END,
+        .vertical_blanking_scanline_end = NTSC_VERTICAL_BLANKING_SCANLINE_END,
+        .pre_render_scanline_end = NTSC_PRE_RENDER_SCANLINE_END,
+        .skips_odd_frame_dot = true,
+        .ppu_dots_per_cpu_cycles = NTSC_PPU_DOTS_PER_CPU_CYCLES,
+        .cpu_cycles_per_ppu_dots = NTSC_CPU_CYCLES_PER_PPU_DOTS,
+        .frames_per_second = 60.0988f,
+    },
+    [PAL] = {
+        .tv_system = PAL,
+        .name = "PAL",
+        .Clock = &PPUClockPAL,
+        .post_render_scanline_end = PAL_POST_RENDER_SCANLINE_END,
+        .vertical_blanking_scanline_end = PAL_VERTICAL_BLANKING_SCANLINE_END,
+        .pre_render_scanline_end = PAL_PRE_RENDER_SCANLINE_END,
+        .skips_odd_frame_dot = false,
+        .ppu_dots_per_cpu_cycles = PAL_PPU_DOTS_PER_CPU_CYCLES,
+        .cpu_cycles_per_ppu_dots = PAL_CPU_CYCLES_PER_PPU_DOTS,
+        .frames_per_second = 50.0070f,
+    },
+    [DENDY] = {
+        .tv_system = DENDY,
+        .name = "Dendy",
+        .Clock = &PPUClockDendy,
+        .post_render_scanline_end = DENDY_POST_RENDER_SCANLINE_END,
+        .vertical_blanking_scanline_end = DENDY_VERTICAL_BLANKING_SCANLINE_END,
+        .pre_render_scanline_end = DENDY_PRE_RENDER_SCANLINE_END,
+        .skips_odd_frame_dot = false,
+        .ppu_dots_per_cpu_cycles = DENDY_PPU_DOTS_PER_CPU_CYCLES,
+        .cpu_cycles_per_ppu_dots = DENDY_CPU_CYCLES_PER_PPU_DOTS,
+        .frames_per_second = 50.0070f,
+    },
+};
+
+const struct Region* PPUGetRegion(enum TVSystem tv_system) {
+    if ((size_t)tv_system >= (sizeof(regions) / sizeof(regions[0]))) {
+        LOG(ERROR, PPU, "unknown tv system: %d\n", tv_system);
+    }
+    return &regions[tv_system];
 }
 
 
-void DebugView(
-    struct PPU* ppu, 
-    uint8_t palette_buffer[PALETTE_BUFFER_HEIGHT][PALETTE_BUFFER_WIDTH], 
-    uint32_t pattern_tables_pixels_buffer[2][PATTERN_TABLE_WIDTH * PATTERN_TABLE_HEIGHT],
-    uint8_t selected_palette,
-    char nametable_buffer[NAMETABLE_BYTE_BUFFER_HEIGHT][NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH],
-    uint8_t selected_nametable
-) {
-    for (int y = 0; y < PALETTE_BUFFER_HEIGHT; y++) {
-        for (int x = 0; x < PALETTE_BUFFER_WIDTH; x++) {
-            palette_buffer[y][x] = PPUBusRead(ppu->ppu_bus, 0x3F00 + (y * PALETTE_BUFFER_WIDTH + x));
-        }
+#define DEFINE_PPU_CLOCK(name, tv_system) \
+    enum GenerateInterrupt name(struct PPU* ppu, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]) { \
+        return ClockRegion(ppu, pixels_buffer, &regions[tv_system]); \
     }
 
+DEFINE_PPU_CLOCK(PPUClockNTSC, NTSC)
+DEFINE_PPU_CLOCK(PPUClockPAL, PAL)
+DEFINE_PPU_CLOCK(PPUClockDendy, DENDY)
 
+
+static inline void DrawTileRow(uint8_t* pixels, const uint8_t pattern_lower, const uint8_t pattern_upper, const uint8_t colors[4]) {
+    for (uint8_t fine_x = 0; fine_x < 8; fine_x++) {
+        uint8_t background_color_address = ((pattern_lower >> (fine_x ^ 0x07)) & 0x01)
+                                         | (((pattern_upper >> (fine_x ^ 0x07)) & 0x01) << 1);
+        pixels[fine_x] = colors[background_color_address];
+    }
+}
+
+static void DebugViewPatternTables(struct PPU* ppu, struct PPUDebugViewCache* cache, uint8_t selected_palette) {
+    uint8_t colors[4];
+    for (uint8_t i = 0; i < 4; i++) {
+        colors[i] = ppu->ppu_bus->palette[((selected_palette & 0x07) << 2) | i] & PALETTE_INDEX_COLOR_BITS;
+    }
+    bool colors_changed = !cache->valid || memcmp(colors, cache->pattern_tables_colors, sizeof(colors)) != 0;
+    memcpy(cache->pattern_tables_colors, colors, sizeof(colors));
+
+    bool changed = colors_changed;
     for (uint8_t i = 0; i < 2; i++) {
-        for (uint8_t tile_y = 0; tile_y < (PATTERN_TABLE_HEIGHT / 8); tile_y++) {
-            for (uint8_t tile_x = 0; tile_x < (PATTERN_TABLE_WIDTH / 8); tile_x++) {
-                for (uint8_t fine_y = 0; fine_y < 8; fine_y++) {
-                    uint8_t tile_id = tile_y * (PATTERN_TABLE_WIDTH / 8) + tile_x;
-                    
-                    uint16_t pattern_address_lower = (i * 0x1000) | (tile_id << 4) | 0x0000 | fine_y;
-                    uint16_t pattern_address_upper = (i * 0x1000) | (tile_id << 4) | 0x0008 | fine_y;
-
-                    uint8_t background_color_address_lower = PPUBusRead(ppu->ppu_bus, pattern_address_lower);
-                    uint8_t background_color_address_upper = PPUBusRead(ppu->ppu_bus, pattern_address_upper);
-
-                    for (uint8_t fine_x = 0; fine_x < 8; fine_x++) {
-                        uint8_t background_color_address = ((background_color_address_lower >> (fine_x ^ 0x07)) & 0x01)
-                                                         | ((background_color_address_upper >> ((fine_x ^ 0x07) - 1)) & 0x02);
-
-                        pattern_tables_pixels_buffer[i][(tile_y * 8 + fine_y) * PATTERN_TABLE_WIDTH + (tile_x * 8 + fine_x)] = nes_palette_colors_rgba[PPUBusRead(ppu->ppu_bus, 0x3F00 | ((selected_palette & 0x07) << 2) | background_color_address)];
-                    }
-                }
+        for (uint16_t tile_id = 0; tile_id < PATTERN_TABLE_TILE_COUNT; tile_id++) {
+            // read straight from the page table, going through the bus would change the open bus value
+            uint16_t address = (i * 0x1000) | (tile_id << 4);
+            const uint8_t* tile = &ppu->ppu_bus->cartridge->ppu_pages[address / PPU_PAGE_SIZE][address % PPU_PAGE_SIZE];
+
+            bool tile_changed = !cache->valid || memcmp(tile, cache->pattern_tiles[i][tile_id], CHR_TILE_SIZE) != 0;
+            cache->pattern_tiles_changed[i][tile_id] = tile_changed;
+            if (!tile_changed && !colors_changed) {
+                continue;
+            }
+            memcpy(cache->pattern_tiles[i][tile_id], tile, CHR_TILE_SIZE);
+
+            uint8_t tile_x = tile_id % (PATTERN_TABLE_WIDTH / 8);
+            uint8_t tile_y = tile_id / (PATTERN_TABLE_WIDTH / 8);
+            for (uint8_t fine_y = 0; fine_y < 8; fine_y++) {
+                DrawTileRow(&cache->pattern_tables[i][(tile_y * 8 + fine_y) * PATTERN_TABLE_WIDTH + tile_x * 8], tile[fine_y], tile[fine_y + 8], colors);
             }
+            changed = true;
         }
     }
 
-
-    uint16_t address_offset = 0;
-    switch (selected_nametable) {
-        case 0: address_offset = 0x2000; break;
-        case 1: address_offset = 0x2400; break;
-        case 2: address_offset = 0x2800; break;
-        case 3: address_offset = 0x2C00; break;
-        default:
-            LOG(ERROR, PPU, "select a nametable 0: 0x2000  1: 0x2400  2: 0x2800 3: 0x2C00\n");
+    if (changed) {
+        cache->pattern_tables_generation++;
     }
+}
 
-    char name_table_row_buffer[NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH + 1];
+static void DebugViewNametableText(struct PPUDebugViewCache* cache, const uint8_t* nametable) {
+    bool changed = false;
+    char cell_buffer[NAMETABLE_BYTE_WIDTH + 1];
 
     for (int y = 0; y < NAMETABLE_BYTE_BUFFER_HEIGHT; y++) {
         for (int x = 0; x < NAMETABLE_BYTE_BUFFER_WIDTH; x++) {
-            uint16_t temp_address = address_offset | (y * NAMETABLE_BYTE_BUFFER_WIDTH + x);
-            snprintf(&name_table_row_buffer[x * NAMETABLE_BYTE_WIDTH], (NAMETABLE_BYTE_WIDTH + 1) * sizeof(char), "%02X ", PPUBusRead(ppu->ppu_bus, temp_address));
+            uint16_t index = y * NAMETABLE_BYTE_BUFFER_WIDTH + x;
+            if (cache->valid && cache->nametable_bytes[index] == nametable[index]) {
+                continue;
+            }
+            cache->nametable_bytes[index] = nametable[index];
+
+            snprintf(cell_buffer, sizeof(cell_buffer), "%02X ", nametable[index]);
+            memcpy(&cache->nametable_text[y][x * NAMETABLE_BYTE_WIDTH], cell_buffer, NAMETABLE_BYTE_WIDTH * sizeof(char));
+            changed = true;
         }
-        memcpy(&nametable_buffer[y], &name_table_row_buffer[0], NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH * sizeof(char));
     }
+
+    if (changed) {
+        cache->nametable_text_generation++;
+    }
+}
+
+// uses the chr bytes read by DebugViewPatternTables
+static void DebugViewNametableImage(struct PPU* ppu, struct PPUDebugViewCache* cache, const uint8_t* nametable) {
+    // color 0 of every background palette is the shared backdrop
+    uint8_t colors[16];
+    for (uint8_t i = 0; i < 16; i++) {
+        colors[i] = ppu->ppu_bus->palette[((i & 0x03) == 0) ? 0 : i] & PALETTE_INDEX_COLOR_BITS;
+    }
+    uint16_t pattern_table = (ppu->ctrl_register & BACKGROUND_PATTERN_TABLE_ADDRESS_BIT) ? 1 : 0;
+
+    bool redraw_all = !cache->valid || pattern_table != cache->nametable_image_pattern_table || memcmp(colors, cache->nametable_image_colors, sizeof(colors)) != 0;
+    memcpy(cache->nametable_image_colors, colors, sizeof(colors));
+    cache->nametable_image_pattern_table = pattern_table;
+
+    bool changed = false;
+    for (uint8_t row = 0; row < NAMETABLE_TILE_ROWS; row++) {
+        for (uint8_t column = 0; column < NAMETABLE_TILE_COLUMNS; column++) {
+            uint8_t tile_id = nametable[row * NAMETABLE_TILE_COLUMNS + column];
+            uint8_t attribute = nametable[NAMETABLE_ATTRIBUTE_OFFSET + (row / 4) * 8 + (column / 4)];
+            uint8_t palette = (attribute >> (((row & 0x02) << 1) | (column & 0x02))) & 0x03;
+
+            if (!redraw_all && !cache->pattern_tiles_changed[pattern_table][tile_id]
+                && cache->nametable_image_tiles[row][column] == tile_id && cache->nametable_image_palettes[row][column] == palette) {
+                continue;
+            }
+            cache->nametable_image_tiles[row][column] = tile_id;
+            cache->nametable_image_palettes[row][column] = palette;
+
+            const uint8_t* tile = cache->pattern_tiles[pattern_table][tile_id];
+            for (uint8_t fine_y = 0; fine_y < 8; fine_y++) {
+                DrawTileRow(&cache->nametable_image[row * 8 + fine_y][column * 8], tile[fine_y], tile[fine_y + 8], &colors[palette << 2]);
+            }
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        cache->nametable_image_generation++;
+    }
+}
+
+
+void PPUDebugViewCacheInit(struct PPUDebugViewCache* cache) {
+    cache->pattern_tables_generation = 0;
+    cache->nametable_text_generation = 0;
+    cache->nametable_image_generation = 0;
+    cache->valid = false;
+}
+
+void DebugView(struct PPU* ppu, struct PPUDebugViewCache* cache, uint8_t selected_palette, uint8_t selected_nametable) {
+    for (int y = 0; y < PALETTE_BUFFER_HEIGHT; y++) {
+        for (int x = 0; x < PALETTE_BUFFER_WIDTH; x++) {
+            cache->palette[y][x] = ppu->ppu_bus->palette[y * PALETTE_BUFFER_WIDTH + x];
+        }
+    }
+
+    if (selected_nametable >= NAMETABLE_COUNT) {
+        LOG(ERROR, PPU, "select a nametable 0: 0x2000  1: 0x2400  2: 0x2800 3: 0x2C00\n");
+    }
+    const uint8_t* nametable = ppu->ppu_bus->cartridge->ppu_pages[PPU_NAMETABLE_PAGE + selected_nametable];
+
+    DebugViewPatternTables(ppu, cache, selected_palette);
+    DebugViewNametableText(cache, nametable);
+    DebugViewNametableImage(ppu, cache, nametable);
+
+    cache->valid = true;
 }
 
 
 void PPUWriteCtrl(struct PPU* ppu, const uint8_t data) {
+    BackgroundChanged(ppu);
     ppu->ctrl_register = data;
+    ppu->scanline_irq_cycle = ScanlineIRQCycle(ppu->ctrl_register);
 
     ppu->t &= ~((uint16_t)BASE_NAMETABLE_BITS << 10);
     ppu->t |= (ppu->ctrl_register & BASE_NAMETABLE_BITS) << 10;
 }
 
 void PPUWriteMask(struct PPU* ppu, const uint8_t data) {
+    BackgroundChanged(ppu);
     ppu->mask_register = data;
 }
 
@@ -378,6 +839,7 @@ void PPUWriteOAMData(struct PPU* ppu, const uint8_t data) {
 }
 
 void PPUWriteScroll(struct PPU* ppu, const uint8_t data) {
+    BackgroundChanged(ppu);
     if (ppu->w) {
         // 2. write
         ppu->t &= 0b1000110000011111;
@@ -393,6 +855,7 @@ void PPUWriteScroll(struct PPU* ppu, const uint8_t data) {
 }
 
 void PPUWritePPUAddress(struct PPU* ppu, const uint8_t data) {
+    BackgroundChanged(ppu);
     if (ppu->w) {
         // 2. write
         ppu->t &= 0xFF00;
@@ -408,6 +871,7 @@ void PPUWritePPUAddress(struct PPU* ppu, const uint8_t data) {
 }
 
 void PPUWritePPUData(struct PPU* ppu, const uint8_t data) {
+    BackgroundChanged(ppu);
     PPUBusWrite(ppu->ppu_bus, ppu->v, data);
     ppu->v += ((ppu->ctrl_register & VRAM_ADDRESS_INCREMENT_BIT) ? 32 : 1);
 }
@@ -426,6 +890,7 @@ uint8_t PPUReadOAMData(struct PPU* ppu) {
 }
 
 uint8_t PPUReadPPUData(struct PPU* ppu) {
+    BackgroundChanged(ppu);
     uint8_t temp = ppu->ppu_data_buffer;
     ppu->ppu_data_buffer = PPUBusRead(ppu->ppu_bus, ppu->v);
     if (ppu->v >= 0x3F00) {
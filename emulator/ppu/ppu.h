@@ -5,17 +5,7 @@
 #include <stdbool.h>
 
 #include "ppu_bus.h"
-
-static const uint32_t nes_palette_colors_rgba[64] = {
-    0x666666FF, 0x002A88FF, 0x1412A7FF, 0x3B00A4FF, 0x5C007EFF, 0x6E0040FF, 0x6C0600FF, 0x561D00FF,
-    0x333500FF, 0x0B4800FF, 0x005200FF, 0x004F08FF, 0x00404DFF, 0x000000FF, 0x000000FF, 0x000000FF,
-    0xADADADFF, 0x155FD9FF, 0x4240FFFF, 0x7527FEFF, 0xA01ACCFF, 0xB71E7BFF, 0xB53120FF, 0x994E00FF,
-    0x6B6D00FF, 0x388700FF, 0x0C9300FF, 0x008F32FF, 0x007C8DFF, 0x000000FF, 0x000000FF, 0x000000FF,
-    0xFFFEFFFF, 0x64B0FFFF, 0x9290FFFF, 0xC676FFFF, 0xF36AFFFF, 0xFE6ECCFF, 0xFE8170FF, 0xEA9E22FF,
-    0xBCBE00FF, 0x88D800FF, 0x5CE430FF, 0x45E082FF, 0x48CDDEFF, 0x4F4F4FFF, 0x000000FF, 0x000000FF,
-    0xFFFEFFFF, 0xC0DFFFFF, 0xD3D2FFFF, 0xE8C8FFFF, 0xFBC2FFFF, 0xFEC4EAFF, 0xFECCC5FF, 0xF7D8A5FF,
-    0xE4E594FF, 0xCFEF96FF, 0xBDF4ABFF, 0xB3F3CCFF, 0xB5EBF2FF, 0xB8B8B8FF, 0x000000FF, 0x000000FF,
-};
+#include "palette.h"
 
 
 #define PALETTE_BUFFER_WIDTH 4
@@ -29,6 +19,11 @@ static const uint32_t nes_palette_colors_rgba[64] = {
 #define NAMETABLE_BYTE_BUFFER_WIDTH 32
 #define NAMETABLE_BYTE_BUFFER_HEIGHT 32
 
+#define NAMETABLE_IMAGE_WIDTH 256
+#define NAMETABLE_IMAGE_HEIGHT 240
+
+#define PATTERN_TABLE_TILE_COUNT 256
+
 // ctrl register
 #define BASE_NAMETABLE_BITS                  0b00000011
 #define VRAM_ADDRESS_INCREMENT_BIT           0b00000100
@@ -61,6 +56,12 @@ static const uint32_t nes_palette_colors_rgba[64] = {
 #define FLIP_SPRITE_HORIZONTALLY_BIT 0b01000000
 #define FLIP_SPRITE_VERTICALLY_BIT   0b10000000
 
+// sprite line buffer entries, transparent pixels are left at 0
+#define SPRITE_LINE_COLOR_ADDRESS_BITS    0b00011111
+#define SPRITE_LINE_OPAQUE_BITS           0b00000011
+#define SPRITE_LINE_BEHIND_BACKGROUND_BIT 0b00100000
+#define SPRITE_LINE_SPRITE_0_BIT          0b01000000
+
 
 
 #define RENDER_SCANLINE_END 240
@@ -78,15 +79,35 @@ static const uint32_t nes_palette_colors_rgba[64] = {
 #define DENDY_PRE_RENDER_SCANLINE_END 312
 
 
+// PAL and Dendy have 16 / 5 = 3.2 and 3 ppu dots per cpu cycle
+#define NTSC_PPU_DOTS_PER_CPU_CYCLES 3
+#define NTSC_CPU_CYCLES_PER_PPU_DOTS 1
+#define PAL_PPU_DOTS_PER_CPU_CYCLES 16
+#define PAL_CPU_CYCLES_PER_PPU_DOTS 5
+#define DENDY_PPU_DOTS_PER_CPU_CYCLES 3
+#define DENDY_CPU_CYCLES_PER_PPU_DOTS 1
+
+
 #define SCANLINE_DOTS 341
 #define SCANLINE_VISIBLE_DOTS 256
-#define SCANLINE_IRQ_CYCLE 260
+// the mmc3 counts the rising edges of ppu A12 (chr fetches from 0x1000), the renderer skips most fetches so the edge
+// is taken from where it lands with the fetch pattern: the sprite fetches with the sprites at 0x1000 and the background
+// at 0x0000, the prefetch of the next line with it the other way around (with both on the same table A12 never rises)
+#define SCANLINE_SPRITE_FETCH_IRQ_CYCLE 260
+#define SCANLINE_BACKGROUND_FETCH_IRQ_CYCLE 324
+#define SCANLINE_NO_IRQ_CYCLE SCANLINE_DOTS
 #define SCANLINE_LAST_CYCLE 340
 
 
 #define NES_SCREEN_WIDTH 256
 #define NES_SCREEN_HEIGHT 240
 
+// all four nametables side by side like they are scrolled trough
+#define BACKGROUND_CACHE_WIDTH (2 * NES_SCREEN_WIDTH)
+#define BACKGROUND_CACHE_HEIGHT (2 * NES_SCREEN_HEIGHT)
+// the tiles a line can touch, 2 prefetched + 32 fetched during the visible dots
+#define BACKGROUND_LINE_TILES 34
+
 
 #define DONT_FIX_SPRITE_OVERFLOW
 
@@ -106,10 +127,32 @@ enum RenderState {
 
 enum GenerateInterrupt {
     GENERATE_NMI,
-    GENERATE_IRQ,
     GENERATE_NO_INTERRUPT,
 };
 
+struct PPU;
+
+// everything that differs between the tv systems, the ppu and the emulator loop only read these
+struct Region {
+    enum TVSystem tv_system;
+    const char* name;
+
+    // the clock function specialized for this region
+    enum GenerateInterrupt (*Clock)(struct PPU* ppu, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]);
+
+    uint16_t post_render_scanline_end;          // also the scanline where vertical blanking (and the nmi) starts
+    uint16_t vertical_blanking_scanline_end;
+    uint16_t pre_render_scanline_end;
+
+    bool skips_odd_frame_dot;
+
+    // the cpu is clocked cpu_cycles_per_ppu_dots times for every ppu_dots_per_cpu_cycles dots
+    uint8_t ppu_dots_per_cpu_cycles;
+    uint8_t cpu_cycles_per_ppu_dots;
+
+    float frames_per_second;
+};
+
 
 
 struct PPU {
@@ -130,35 +173,108 @@ struct PPU {
 
     uint8_t ppu_data_buffer;
 
+    // dot on which the cartridge scanline irq is clocked, follows the pattern tables in ctrl
+    uint16_t scanline_irq_cycle;
+
     uint8_t OAM[256];
     uint8_t scanline_OAM_indecies[SCANLINE_OAM_BUFFER_SIZE]; 
     uint8_t scanline_OAM_length;
 
+    // sprites of the current scanline, rasterized once when they are evaluated at the end of the previous one
+    uint8_t sprite_line_buffer[NES_SCREEN_WIDTH];
+    // background color addresses of the current scanline, composited with the sprites after the last visible dot
+    uint8_t background_line_buffer[NES_SCREEN_WIDTH];
+
+    // background fetch pipeline, latches hold the tile being fetched and the shifters the 2 tiles being drawn
+    uint8_t tile_id_latch;
+    uint8_t tile_attribute_latch;
+    uint8_t tile_pattern_lower_latch;
+    uint8_t tile_pattern_upper_latch;
+
+    uint16_t pattern_shift_lower;
+    uint16_t pattern_shift_upper;
+    uint16_t attribute_shift_lower;
+    uint16_t attribute_shift_upper;
+
+    // the nametables decoded to background color addresses (the same values the pipeline produces), the tiles are
+    // redecoded lazily when the ppu bus marks them dirty or when the pattern table, mirroring or chr banks are switched
+    uint8_t background_cache[BACKGROUND_CACHE_HEIGHT][BACKGROUND_CACHE_WIDTH];
+    uint16_t background_cache_pattern_table;
+
+    // off every line goes through the fetch pipeline, the background test renders the same frames both ways
+    bool background_cache_enabled;
+    // nothing that could change the 2 tiles prefetched for the next line happened since the prefetch started
+    bool background_prefetch_clean;
+    // the background of the current line was copied from the cache so the fetches are skipped until dot 256,
+    // anything that could change the rest of the line rebuilds the pipeline from the cache and continues dot by dot
+    bool background_line_cached;
+    uint16_t background_line_column;    // cache column of the first prefetched tile
+    uint16_t background_line_row;
+
     enum RenderState render_state;
     uint16_t scanline;
     uint16_t cycle;
 
+    const struct Region* region;
+
     uint8_t is_odd_frame;
     
     bool sprite_0_hit_happened; 
 
+    // when set the scanlines are written here as palette indices and the rgba pixels buffer is not touched,
+    // so the frontend can do the color conversion itself (straight into texture memory)
+    uint16_t* palette_indices_buffer;
+    // converts the palette indices when the rgba pixels buffer is used
+    const struct Palette* palette;
+
     struct PPUBus* ppu_bus;
 };
 
-void PPUInit(struct PPU* ppu, struct PPUBus* ppu_bus, enum TVSystem tv_system);
+// what the debug window shows of the ppu, kept between frames (the snapshots handed to the frontend rotate),
+// the pattern tables and the nametable image are nes colors (0 - 63), the frontend converts them
+struct PPUDebugViewCache {
+    uint8_t palette[PALETTE_BUFFER_HEIGHT][PALETTE_BUFFER_WIDTH];
+
+    // chr bytes and colors of the selected palette the pattern tables were drawn from
+    uint8_t pattern_tiles[2][PATTERN_TABLE_TILE_COUNT][CHR_TILE_SIZE];
+    bool pattern_tiles_changed[2][PATTERN_TABLE_TILE_COUNT];
+    uint8_t pattern_tables_colors[4];
+    uint8_t pattern_tables[2][PATTERN_TABLE_WIDTH * PATTERN_TABLE_HEIGHT];
+    uint32_t pattern_tables_generation;
+
+    uint8_t nametable_bytes[NAMETABLE_BYTE_BUFFER_HEIGHT * NAMETABLE_BYTE_BUFFER_WIDTH];
+    char nametable_text[NAMETABLE_BYTE_BUFFER_HEIGHT][NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH];
+    uint32_t nametable_text_generation;
+
+    // the selected nametable drawn with the background pattern table and palettes
+    uint8_t nametable_image_tiles[NAMETABLE_TILE_ROWS][NAMETABLE_TILE_COLUMNS];
+    uint8_t nametable_image_palettes[NAMETABLE_TILE_ROWS][NAMETABLE_TILE_COLUMNS];
+    uint8_t nametable_image_colors[16];
+    uint16_t nametable_image_pattern_table;
+    uint8_t nametable_image[NAMETABLE_IMAGE_HEIGHT][NAMETABLE_IMAGE_WIDTH];
+    uint32_t nametable_image_generation;
+
+    bool valid;
+};
+
+const struct Region* PPUGetRegion(enum TVSystem tv_system);
+
+void PPUInit(struct PPU* ppu, struct PPUBus* ppu_bus, const struct Palette* palette, enum TVSystem tv_system);
 void PPUReset(struct PPU* ppu, enum TVSystem tv_system);
+// restarts the frame at the pre-render scanline
+void PPUSetRegion(struct PPU* ppu, enum TVSystem tv_system);
+// has to be called before a mapper register write, bank switches change what the rest of a cached line would fetch
+void PPUSyncBackground(struct PPU* ppu);
 
+// one copy of the same clock routine per region with the region's constants built in
 enum GenerateInterrupt PPUClockNTSC(struct PPU* ppu, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]);
 enum GenerateInterrupt PPUClockPAL(struct PPU* ppu, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]);
+enum GenerateInterrupt PPUClockDendy(struct PPU* ppu, uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT]);
 
-void DebugView(
-    struct PPU* ppu, 
-    uint8_t palette_buffer[PALETTE_BUFFER_HEIGHT][PALETTE_BUFFER_WIDTH], 
-    uint32_t pattern_tables_pixels_buffer[2][PATTERN_TABLE_WIDTH * PATTERN_TABLE_HEIGHT],
-    uint8_t selected_palette,
-    char nametable_buffer[NAMETABLE_BYTE_BUFFER_HEIGHT][NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH],
-    uint8_t selected_nametable
-);
+void PPUDebugViewCacheInit(struct PPUDebugViewCache* cache);
+// only the tiles and nametable cells whose bytes (or colors) changed since the last call are drawn again,
+// the generations are bumped when something was so the frontend can skip copying and uploading the rest
+void DebugView(struct PPU* ppu, struct PPUDebugViewCache* cache, uint8_t selected_palette, uint8_t selected_nametable);
 
 void PPUWriteCtrl(struct PPU* ppu, const uint8_t data);
 void PPUWriteMask(struct PPU* ppu, const uint8_t data);
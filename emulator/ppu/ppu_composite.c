@@ -0,0 +1,200 @@
+#include "ppu_composite.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PPU_COMPOSITE_X86
+#endif
+
+
+typedef void (*CompositeKernel)(const uint8_t*, const uint8_t*, const uint8_t*, const uint8_t, const uint8_t, uint16_t*);
+
+static CompositeKernel composite_kernel = NULL;
+
+
+static void CompositeScanlineScalar(
+    const uint8_t* background, const uint8_t* sprites, const uint8_t* palette,
+    const uint8_t mask_register, const uint8_t backdrop_color_address, uint16_t* palette_indices
+) {
+    uint8_t color_bits = (mask_register & GREYSCALE_BIT) ? GREYSCALE_COLOR_BITS : PALETTE_INDEX_COLOR_BITS;
+    uint16_t emphasis = ((uint16_t)mask_register << PALETTE_INDEX_EMPHASIS_SHIFT) & PALETTE_INDEX_EMPHASIS_BITS;
+
+    for (int x = 0; x < NES_SCREEN_WIDTH; x++) {
+        uint8_t background_color_address = background[x];
+        if (!(mask_register & SHOW_BACKGROUND_LEFTMOST_BIT) && x < 8) {
+            background_color_address = 0;
+        }
+
+        uint8_t sprite_pixel = sprites[x];
+        if (!(mask_register & SHOW_SPRITES_BIT) || (!(mask_register & SHOW_SPRITES_LEFTMOST_BIT) && x < 8)) {
+            sprite_pixel = 0;
+        }
+
+        bool background_opaque = background_color_address & 0x03;
+        bool sprite_opaque = sprite_pixel & SPRITE_LINE_OPAQUE_BITS;
+
+        uint8_t color_address = background_opaque ? background_color_address : backdrop_color_address;
+        if (sprite_opaque && (!background_opaque || !(sprite_pixel & SPRITE_LINE_BEHIND_BACKGROUND_BIT))) {
+            color_address = sprite_pixel & SPRITE_LINE_COLOR_ADDRESS_BITS;
+        }
+
+        palette_indices[x] = (palette[color_address] & color_bits) | emphasis;
+    }
+}
+
+
+#ifdef PPU_COMPOSITE_X86
+
+__attribute__((target("sse2")))
+static void CompositeScanlineSSE2(
+    const uint8_t* background, const uint8_t* sprites, const uint8_t* palette,
+    const uint8_t mask_register, const uint8_t backdrop_color_address, uint16_t* palette_indices
+) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i opaque_bits = _mm_set1_epi8(SPRITE_LINE_OPAQUE_BITS);
+    const __m128i behind_bit = _mm_set1_epi8(SPRITE_LINE_BEHIND_BACKGROUND_BIT);
+    const __m128i sprite_color_bits = _mm_set1_epi8(SPRITE_LINE_COLOR_ADDRESS_BITS);
+    const __m128i backdrop = _mm_set1_epi8(backdrop_color_address);
+
+    const __m128i color_bits = _mm_set1_epi16((mask_register & GREYSCALE_BIT) ? GREYSCALE_COLOR_BITS : PALETTE_INDEX_COLOR_BITS);
+    const __m128i emphasis = _mm_set1_epi16(((uint16_t)mask_register << PALETTE_INDEX_EMPHASIS_SHIFT) & PALETTE_INDEX_EMPHASIS_BITS);
+
+    // only the first 8 pixels of the first block can be hidden by the leftmost bits
+    const __m128i leftmost = _mm_set_epi64x(-1, 0);
+    __m128i background_keep = (mask_register & SHOW_BACKGROUND_LEFTMOST_BIT) ? _mm_set1_epi8(-1) : leftmost;
+    __m128i sprites_keep = (mask_register & SHOW_SPRITES_LEFTMOST_BIT) ? _mm_set1_epi8(-1) : leftmost;
+    const __m128i sprites_shown = (mask_register & SHOW_SPRITES_BIT) ? _mm_set1_epi8(-1) : zero;
+
+    for (int x = 0; x < NES_SCREEN_WIDTH; x += 16) {
+        __m128i background_pixels = _mm_and_si128(_mm_loadu_si128((const __m128i*)&background[x]), background_keep);
+        __m128i sprite_pixels = _mm_and_si128(_mm_loadu_si128((const __m128i*)&sprites[x]), _mm_and_si128(sprites_keep, sprites_shown));
+        background_keep = _mm_set1_epi8(-1);
+        sprites_keep = _mm_set1_epi8(-1);
+
+        __m128i background_transparent = _mm_cmpeq_epi8(_mm_and_si128(background_pixels, opaque_bits), zero);
+        __m128i sprite_transparent = _mm_cmpeq_epi8(_mm_and_si128(sprite_pixels, opaque_bits), zero);
+        __m128i sprite_in_front = _mm_cmpeq_epi8(_mm_and_si128(sprite_pixels, behind_bit), zero);
+        __m128i use_sprite = _mm_andnot_si128(sprite_transparent, _mm_or_si128(background_transparent, sprite_in_front));
+
+        __m128i color_addresses = _mm_or_si128(_mm_andnot_si128(background_transparent, background_pixels), _mm_and_si128(background_transparent, backdrop));
+        color_addresses = _mm_or_si128(_mm_andnot_si128(use_sprite, color_addresses), _mm_and_si128(use_sprite, _mm_and_si128(sprite_pixels, sprite_color_bits)));
+
+        // sse2 has no byte shuffle so the 32 entry palette lookup stays scalar
+        uint8_t addresses[16];
+        uint8_t colors[16];
+        _mm_storeu_si128((__m128i*)addresses, color_addresses);
+        for (int i = 0; i < 16; i++) {
+            colors[i] = palette[addresses[i]];
+        }
+        __m128i color_pixels = _mm_loadu_si128((const __m128i*)colors);
+
+        __m128i lower = _mm_or_si128(_mm_and_si128(_mm_unpacklo_epi8(color_pixels, zero), color_bits), emphasis);
+        __m128i upper = _mm_or_si128(_mm_and_si128(_mm_unpackhi_epi8(color_pixels, zero), color_bits), emphasis);
+        _mm_storeu_si128((__m128i*)&palette_indices[x], lower);
+        _mm_storeu_si128((__m128i*)&palette_indices[x + 8], upper);
+    }
+}
+
+__attribute__((target("avx2")))
+static void CompositeScanlineAVX2(
+    const uint8_t* background, const uint8_t* sprites, const uint8_t* palette,
+    const uint8_t mask_register, const uint8_t backdrop_color_address, uint16_t* palette_indices
+) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i opaque_bits = _mm256_set1_epi8(SPRITE_LINE_OPAQUE_BITS);
+    const __m256i behind_bit = _mm256_set1_epi8(SPRITE_LINE_BEHIND_BACKGROUND_BIT);
+    const __m256i sprite_color_bits = _mm256_set1_epi8(SPRITE_LINE_COLOR_ADDRESS_BITS);
+    const __m256i upper_palette_bit = _mm256_set1_epi8(0x10);
+    const __m256i backdrop = _mm256_set1_epi8(backdrop_color_address);
+
+    const __m256i color_bits = _mm256_set1_epi16((mask_register & GREYSCALE_BIT) ? GREYSCALE_COLOR_BITS : PALETTE_INDEX_COLOR_BITS);
+    const __m256i emphasis = _mm256_set1_epi16(((uint16_t)mask_register << PALETTE_INDEX_EMPHASIS_SHIFT) & PALETTE_INDEX_EMPHASIS_BITS);
+
+    // vpshufb only looks up 16 bytes per lane, so both halves of palette ram are looked up and the right one is picked by bit 4
+    const __m256i palette_lower = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)&palette[0x00]));
+    const __m256i palette_upper = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)&palette[0x10]));
+
+    const __m256i leftmost = _mm256_set_epi64x(-1, -1, -1, 0);
+    __m256i background_keep = (mask_register & SHOW_BACKGROUND_LEFTMOST_BIT) ? _mm256_set1_epi8(-1) : leftmost;
+    __m256i sprites_keep = (mask_register & SHOW_SPRITES_LEFTMOST_BIT) ? _mm256_set1_epi8(-1) : leftmost;
+    const __m256i sprites_shown = (mask_register & SHOW_SPRITES_BIT) ? _mm256_set1_epi8(-1) : zero;
+
+    for (int x = 0; x < NES_SCREEN_WIDTH; x += 32) {
+        __m256i background_pixels = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&background[x]), background_keep);
+        __m256i sprite_pixels = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&sprites[x]), _mm256_and_si256(sprites_keep, sprites_shown));
+        background_keep = _mm256_set1_epi8(-1);
+        sprites_keep = _mm256_set1_epi8(-1);
+
+        __m256i background_transparent = _mm256_cmpeq_epi8(_mm256_and_si256(background_pixels, opaque_bits), zero);
+        __m256i sprite_transparent = _mm256_cmpeq_epi8(_mm256_and_si256(sprite_pixels, opaque_bits), zero);
+        __m256i sprite_in_front = _mm256_cmpeq_epi8(_mm256_and_si256(sprite_pixels, behind_bit), zero);
+        __m256i use_sprite = _mm256_andnot_si256(sprite_transparent, _mm256_or_si256(background_transparent, sprite_in_front));
+
+        __m256i color_addresses = _mm256_blendv_epi8(background_pixels, backdrop, background_transparent);
+        color_addresses = _mm256_blendv_epi8(color_addresses, _mm256_and_si256(sprite_pixels, sprite_color_bits), use_sprite);
+
+        __m256i upper_half = _mm256_cmpeq_epi8(_mm256_and_si256(color_addresses, upper_palette_bit), upper_palette_bit);
+        __m256i color_pixels = _mm256_blendv_epi8(
+            _mm256_shuffle_epi8(palette_lower, color_addresses),
+            _mm256_shuffle_epi8(palette_upper, color_addresses),
+            upper_half
+        );
+
+        __m256i lower = _mm256_or_si256(_mm256_and_si256(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(color_pixels)), color_bits), emphasis);
+        __m256i upper = _mm256_or_si256(_mm256_and_si256(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(color_pixels, 1)), color_bits), emphasis);
+        _mm256_storeu_si256((__m256i*)&palette_indices[x], lower);
+        _mm256_storeu_si256((__m256i*)&palette_indices[x + 16], upper);
+    }
+}
+
+#endif
+
+
+void PPUCompositeInit(void) {
+    composite_kernel = &CompositeScanlineScalar;
+
+#ifdef PPU_COMPOSITE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        composite_kernel = &CompositeScanlineAVX2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        composite_kernel = &CompositeScanlineSSE2;
+    }
+#endif
+}
+
+bool PPUCompositeSelectKernel(const enum PPUCompositeKernel kernel) {
+    switch (kernel) {
+        case PPU_COMPOSITE_SCALAR:
+            composite_kernel = &CompositeScanlineScalar;
+            return true;
+#ifdef PPU_COMPOSITE_X86
+        case PPU_COMPOSITE_SSE2:
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("sse2")) {
+                composite_kernel = &CompositeScanlineSSE2;
+                return true;
+            }
+            return false;
+        case PPU_COMPOSITE_AVX2:
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                composite_kernel = &CompositeScanlineAVX2;
+                return true;
+            }
+            return false;
+#endif
+        default:
+            return false;
+    }
+}
+
+void PPUCompositeScanline(
+    const uint8_t background[NES_SCREEN_WIDTH],
+    const uint8_t sprites[NES_SCREEN_WIDTH],
+    const uint8_t palette[PALETTE_RAM_SIZE],
+    const uint8_t mask_register,
+    const uint8_t backdrop_color_address,
+    uint16_t palette_indices[NES_SCREEN_WIDTH]
+) {
+    composite_kernel(background, sprites, palette, mask_register, backdrop_color_address, palette_indices);
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef PPU_COMPOSITE_H
+#define PPU_COMPOSITE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ppu.h"
+
+
+// the palette index layout is in palette.h
+#define PALETTE_INDEX_EMPHASIS_SHIFT 1   // mask register emphasis bits (5-7) end up at 6-8
+
+#define GREYSCALE_COLOR_BITS 0x30
+
+
+enum PPUCompositeKernel {
+    PPU_COMPOSITE_SCALAR,
+    PPU_COMPOSITE_SSE2,
+    PPU_COMPOSITE_AVX2,
+};
+
+
+// picks the widest kernel the cpu supports, safe to call more than once
+void PPUCompositeInit(void);
+// forces one kernel instead of the widest (so they can be checked against each other), false when the cpu doesn't support it
+bool PPUCompositeSelectKernel(const enum PPUCompositeKernel kernel);
+
+// background is one color address (0 - 15) per pixel with 0 in the low 2 bits when transparent,
+// sprites are entries of the sprite line buffer, palette is palette ram with the 0x10 mirrors already written
+void PPUCompositeScanline(
+    const uint8_t background[NES_SCREEN_WIDTH],
+    const uint8_t sprites[NES_SCREEN_WIDTH],
+    const uint8_t palette[PALETTE_RAM_SIZE],
+    const uint8_t mask_register,
+    const uint8_t backdrop_color_address,
+    uint16_t palette_indices[NES_SCREEN_WIDTH]
+);
+
+#endif
\ No newline at end of file
@@ -7,25 +7,66 @@ void PPUBusInit(struct PPUBus* ppu_bus, struct Cartridge* cartridge) {
     ppu_bus->cartridge = cartridge;
     memset(ppu_bus->palette, 0x00, PALETTE_RAM_SIZE * sizeof(uint8_t));
     memset(ppu_bus->ppu_vram, 0x00, VRAM_SIZE * sizeof(uint8_t));
+    CartridgeConnectVRAM(ppu_bus->cartridge, ppu_bus->ppu_vram);
+    PPUBusMarkAllDirty(ppu_bus);
 }
 
+// the cartridge may have been loaded again
 void PPUBusReset(struct PPUBus* ppu_bus) {
     memset(ppu_bus->palette, 0x00, PALETTE_RAM_SIZE * sizeof(uint8_t));
     memset(ppu_bus->ppu_vram, 0x00, VRAM_SIZE * sizeof(uint8_t));
+    CartridgeConnectVRAM(ppu_bus->cartridge, ppu_bus->ppu_vram);
+    PPUBusMarkAllDirty(ppu_bus);
 }
 
-bool PPUBusScanlineIRQ(struct PPUBus* ppu_bus) {
-    return CartridgeScanlineIRQ(ppu_bus->cartridge);
+// the pages are set to NULL so the next sync also marks everything
+void PPUBusMarkAllDirty(struct PPUBus* ppu_bus) {
+    memset(ppu_bus->nametable_dirty, 0xFF, sizeof(ppu_bus->nametable_dirty));
+    memset(ppu_bus->chr_dirty, 0xFF, sizeof(ppu_bus->chr_dirty));
+    for (uint8_t nametable = 0; nametable < NAMETABLE_COUNT; nametable++) {
+        ppu_bus->dirty_nametable_pages[nametable] = NULL;
+    }
+    for (uint8_t page = 0; page < CHR_PAGE_COUNT; page++) {
+        ppu_bus->dirty_chr_pages[page] = NULL;
+    }
+}
+
+// an attribute byte covers 4x4 tiles
+static void MarkNametableDirty(struct PPUBus* ppu_bus, const uint8_t* nametable_page, const uint16_t offset) {
+    for (uint8_t nametable = 0; nametable < NAMETABLE_COUNT; nametable++) {
+        if (ppu_bus->dirty_nametable_pages[nametable] != nametable_page) {
+            continue;
+        }
+
+        if (offset < NAMETABLE_ATTRIBUTE_OFFSET) {
+            ppu_bus->nametable_dirty[nametable][offset / NAMETABLE_TILE_COLUMNS] |= (uint32_t)1 << (offset % NAMETABLE_TILE_COLUMNS);
+        } else {
+            uint8_t attribute_index = offset - NAMETABLE_ATTRIBUTE_OFFSET;
+            uint8_t first_row = (attribute_index >> 3) * 4;
+            for (uint8_t row = first_row; row < (first_row + 4) && row < NAMETABLE_TILE_ROWS; row++) {
+                ppu_bus->nametable_dirty[nametable][row] |= (uint32_t)0x0F << ((attribute_index & 0x07) * 4);
+            }
+        }
+    }
+}
+
+static void MarkCHRDirty(struct PPUBus* ppu_bus, const uint16_t address) {
+    const uint8_t* chr_page = ppu_bus->cartridge->ppu_pages[address / CHR_PAGE_SIZE];
+    uint64_t tile_bit = (uint64_t)1 << ((address % CHR_PAGE_SIZE) / CHR_TILE_SIZE);
+    for (uint8_t page = 0; page < CHR_PAGE_COUNT; page++) {
+        if (ppu_bus->dirty_chr_pages[page] == chr_page) {
+            ppu_bus->chr_dirty[page] |= tile_bit;
+        }
+    }
+}
+
+void PPUBusScanlineIRQ(struct PPUBus* ppu_bus) {
+    CartridgeScanlineIRQ(ppu_bus->cartridge);
 }
 
 uint8_t PPUBusRead(struct PPUBus* ppu_bus, const uint16_t address) {
-    if (address < 0x2000) {
-        ppu_bus->ppu_vram_open_bus_data = CartridgeReadPPU(ppu_bus->cartridge, address);
-        return ppu_bus->ppu_vram_open_bus_data;
-    
-    } else if (address < 0x3F00) {
-        uint16_t vram_index = ppu_bus->cartridge->mirroring_offsets[((address & 0b0000110000000000) >> 10)] + (address & 0b0000001111111111);
-        ppu_bus->ppu_vram_open_bus_data = ppu_bus->ppu_vram[vram_index];
+    if (address < 0x3F00) {
+        ppu_bus->ppu_vram_open_bus_data = PPUBusFetch(ppu_bus, address);
         return ppu_bus->ppu_vram_open_bus_data;
 
     } else if (address < 0x4000) {
@@ -39,11 +80,13 @@ uint8_t PPUBusRead(struct PPUBus* ppu_bus, const uint16_t address) {
 void PPUBusWrite(struct PPUBus* ppu_bus, const uint16_t address, const uint8_t data) {
     if (address < 0x2000) {
         CartridgeWritePPU(ppu_bus->cartridge, address, data);
+        MarkCHRDirty(ppu_bus, address);
         ppu_bus->ppu_vram_open_bus_data = data;
     
     } else if (address < 0x3F00) {
-        uint16_t vram_index = ppu_bus->cartridge->mirroring_offsets[((address & 0b0000110000000000) >> 10)] + (address & 0b0000001111111111);
-        ppu_bus->ppu_vram[vram_index] = data;
+        uint8_t* nametable_page = ppu_bus->cartridge->ppu_pages[address / PPU_PAGE_SIZE];
+        nametable_page[address % PPU_PAGE_SIZE] = data;
+        MarkNametableDirty(ppu_bus, nametable_page, address % PPU_PAGE_SIZE);
         ppu_bus->ppu_vram_open_bus_data = data;
     
     } else if (address < 0x4000) {
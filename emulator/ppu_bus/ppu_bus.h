@@ -10,21 +10,46 @@
 #define PALETTE_RAM_SIZE 0x20   // 32 bytes
 #define VRAM_SIZE 0x0800    // 2 KB
 
+#define NAMETABLE_COUNT 4
+#define NAMETABLE_TILE_ROWS 30
+#define NAMETABLE_TILE_COLUMNS 32
+#define NAMETABLE_ATTRIBUTE_OFFSET 0x03C0
+
+#define CHR_PAGE_SIZE 0x0400    // 1 KB, the smallest chr bank
+#define CHR_PAGE_COUNT 8
+#define CHR_TILE_SIZE 16
+
 struct PPUBus {
     uint8_t ppu_vram[VRAM_SIZE];
     uint8_t palette[PALETTE_RAM_SIZE];
     
     uint8_t ppu_vram_open_bus_data;
 
+    // what changed since the ppu's background cache last decoded it, a bit per tile column of each (logical) nametable
+    // row and a bit per chr tile (a word per 1KB page), everything starts dirty
+    uint32_t nametable_dirty[NAMETABLE_COUNT][NAMETABLE_TILE_ROWS];
+    uint64_t chr_dirty[CHR_PAGE_COUNT];
+    // the nametable and chr pages the cache was decoded with, a write marks the nametables and pages that showed the byte
+    // back then, the ppu compares these with the current ones to notice the switches
+    const uint8_t* dirty_nametable_pages[NAMETABLE_COUNT];
+    const uint8_t* dirty_chr_pages[CHR_PAGE_COUNT];
+
     struct Cartridge* cartridge;
 };
 
 void PPUBusInit(struct PPUBus* ppu_bus, struct Cartridge* cartridge);
 void PPUBusReset(struct PPUBus* ppu_bus);
 
-bool PPUBusScanlineIRQ(struct PPUBus* ppu_bus);
+void PPUBusMarkAllDirty(struct PPUBus* ppu_bus);
+
+void PPUBusScanlineIRQ(struct PPUBus* ppu_bus);
 
 uint8_t PPUBusRead(struct PPUBus* ppu_bus, const uint16_t address);
 void PPUBusWrite(struct PPUBus* ppu_bus, const uint16_t address, const uint8_t data);
 
+// the renderer's pattern and nametable fetches (below 0x3F00), straight from the page table without touching the open bus
+static inline uint8_t PPUBusFetch(const struct PPUBus* ppu_bus, const uint16_t address) {
+    return ppu_bus->cartridge->ppu_pages[(address >> 10) & 0x0F][address & (PPU_PAGE_SIZE - 1)];
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,349 @@
+#include <string.h>
+
+#include "profiler.h"
+#include "logger.h"
+
+
+#define OP_CODE_BRK 0x00
+#define OP_CODE_JSR 0x20
+#define OP_CODE_RTI 0x40
+#define OP_CODE_RTS 0x60
+
+#define CALL_NODES_START_CAPACITY 1024
+#define LOCATION_NAME_LENGTH 32
+
+
+static uint32_t GetLocation(struct Profiler* profiler, const uint16_t address) {
+    uint32_t prg_rom_offset = CartridgeMapPRGROM(profiler->cartridge, address);
+    return (prg_rom_offset == CARTRIDGE_NOT_PRG_ROM) ? address : (0x8000 + prg_rom_offset);
+}
+
+static struct ProfilerLocation* GetLocationEntry(struct Profiler* profiler, const uint32_t location) {
+    uint32_t page = location / PROFILER_PAGE_SIZE;
+    if (page >= profiler->page_count) {
+        return NULL;    // the cartridge was reloaded with a smaller prg rom
+    }
+
+    if (profiler->pages[page] == NULL) {
+        profiler->pages[page] = calloc(PROFILER_PAGE_SIZE, sizeof(struct ProfilerLocation));
+        if (profiler->pages[page] == NULL) {
+            LOG(ERROR, PROFILER, "failed to allocate memmory for page: %u\n", page);
+        }
+    }
+
+    return &profiler->pages[page][location % PROFILER_PAGE_SIZE];
+}
+
+static uint32_t NewCallNode(struct Profiler* profiler, const uint32_t parent, const uint32_t location, const uint16_t address, const enum ProfilerFrameKind kind) {
+    if (profiler->call_node_count == profiler->call_node_capacity) {
+        profiler->call_node_capacity *= 2;
+        profiler->call_nodes = realloc(profiler->call_nodes, profiler->call_node_capacity * sizeof(struct ProfilerCallNode));
+        if (profiler->call_nodes == NULL) {
+            LOG(ERROR, PROFILER, "failed to allocate memmory for %u call nodes\n", profiler->call_node_capacity);
+        }
+    }
+
+    uint32_t index = profiler->call_node_count;
+    profiler->call_node_count++;
+
+    struct ProfilerCallNode* node = &profiler->call_nodes[index];
+    node->location = location;
+    node->address = address;
+    node->kind = kind;
+    node->parent = parent;
+    node->first_child = 0;    // 0 is the root, so it can't be anyone's child
+    node->next_sibling = 0;
+    node->cycles = 0;
+
+    if (index != PROFILER_ROOT_CALL_NODE) {
+        node->next_sibling = profiler->call_nodes[parent].first_child;
+        profiler->call_nodes[parent].first_child = index;
+    }
+
+    return index;
+}
+
+static void PushFrame(struct Profiler* profiler, const uint16_t address, const enum ProfilerFrameKind kind) {
+    if (profiler->call_depth >= PROFILER_MAX_CALL_DEPTH) {
+        profiler->call_depth_overflow++;
+        return;
+    }
+
+    uint32_t location = GetLocation(profiler, address);
+
+    uint32_t child = profiler->call_nodes[profiler->current_call_node].first_child;
+    while (child != 0) {
+        struct ProfilerCallNode* node = &profiler->call_nodes[child];
+        if (node->location == location && node->kind == kind) {
+            break;
+        }
+        child = node->next_sibling;
+    }
+
+    if (child == 0) {
+        child = NewCallNode(profiler, profiler->current_call_node, location, address, kind);
+    }
+
+    profiler->current_call_node = child;
+    profiler->call_depth++;
+}
+
+static void PopFrame(struct Profiler* profiler) {
+    if (profiler->call_depth_overflow > 0) {
+        profiler->call_depth_overflow--;
+    } else if (profiler->call_depth > 0) {
+        // games also use rts as an indirect jump (push address - 1 then rts), that would pop too much so it stops at the root
+        profiler->current_call_node = profiler->call_nodes[profiler->current_call_node].parent;
+        profiler->call_depth--;
+    }
+}
+
+// jsr and brk enter a new frame at the next executed address, rts and rti leave the current one
+static void HandlePreviousStackEffect(struct Profiler* profiler, const uint16_t next_address) {
+    if (!profiler->previous_valid || profiler->previous_stack_handled) {
+        return;
+    }
+    profiler->previous_stack_handled = true;
+
+    switch (profiler->previous_op_code) {
+        case OP_CODE_JSR: PushFrame(profiler, next_address, PROFILER_CALL); break;
+        case OP_CODE_BRK: PushFrame(profiler, next_address, PROFILER_IRQ); break;
+        case OP_CODE_RTS: PopFrame(profiler); break;
+        case OP_CODE_RTI: PopFrame(profiler); break;
+        default: break;
+    }
+}
+
+
+
+void ProfilerInit(struct Profiler* profiler, struct Cartridge* cartridge, const char* (*GetMnemonic)(uint8_t)) {
+    profiler->cartridge = cartridge;
+    profiler->GetMnemonic = GetMnemonic;
+
+    memset(profiler->op_codes, 0, sizeof(profiler->op_codes));
+
+    profiler->page_count = PROFILER_RAM_PAGES + ((cartridge->prg_rom_16KB_units * 0x4000) / PROFILER_PAGE_SIZE);
+    profiler->pages = calloc(profiler->page_count, sizeof(struct ProfilerLocation*));
+    if (profiler->pages == NULL) {
+        LOG(ERROR, PROFILER, "failed to allocate memmory for %u pages\n", profiler->page_count);
+    }
+
+    profiler->call_node_count = 0;
+    profiler->call_node_capacity = CALL_NODES_START_CAPACITY;
+    profiler->call_nodes = malloc(profiler->call_node_capacity * sizeof(struct ProfilerCallNode));
+    if (profiler->call_nodes == NULL) {
+        LOG(ERROR, PROFILER, "failed to allocate memmory for %u call nodes\n", profiler->call_node_capacity);
+    }
+    NewCallNode(profiler, PROFILER_ROOT_CALL_NODE, 0, 0, PROFILER_CALL);
+
+    profiler->current_call_node = PROFILER_ROOT_CALL_NODE;
+    profiler->call_depth = 0;
+    profiler->call_depth_overflow = 0;
+
+    profiler->previous_valid = false;
+    profiler->previous_stack_handled = true;
+    profiler->previous_tick_counter = 0;
+    profiler->previous_location = 0;
+    profiler->previous_call_node = PROFILER_ROOT_CALL_NODE;
+    profiler->previous_op_code = 0;
+
+    profiler->first_tick_counter = 0;
+}
+
+void ProfilerClean(struct Profiler* profiler) {
+    for (uint32_t i = 0; i < profiler->page_count; i++) {
+        free(profiler->pages[i]);
+    }
+    free(profiler->pages);
+    free(profiler->call_nodes);
+
+    profiler->pages = NULL;
+    profiler->page_count = 0;
+    profiler->call_nodes = NULL;
+    profiler->call_node_count = 0;
+}
+
+void ProfilerInstruction(struct Profiler* profiler, const uint16_t program_counter, const uint8_t op_code, const uint64_t tick_counter) {
+    if (profiler->previous_valid) {
+        uint64_t cycles = tick_counter - profiler->previous_tick_counter;
+
+        profiler->op_codes[profiler->previous_op_code].cycles += cycles;
+        profiler->call_nodes[profiler->previous_call_node].cycles += cycles;
+
+        struct ProfilerLocation* previous_entry = GetLocationEntry(profiler, profiler->previous_location);
+        if (previous_entry != NULL) {
+            previous_entry->counter.cycles += cycles;
+        }
+    } else {
+        profiler->first_tick_counter = tick_counter;
+    }
+
+    HandlePreviousStackEffect(profiler, program_counter);
+
+    uint32_t location = GetLocation(profiler, program_counter);
+
+    profiler->op_codes[op_code].executions++;
+
+    struct ProfilerLocation* entry = GetLocationEntry(profiler, location);
+    if (entry != NULL) {
+        entry->counter.executions++;
+        entry->address = program_counter;
+        entry->op_code = op_code;
+    }
+
+    profiler->previous_valid = true;
+    profiler->previous_stack_handled = false;
+    profiler->previous_tick_counter = tick_counter;
+    profiler->previous_location = location;
+    profiler->previous_call_node = profiler->current_call_node;
+    profiler->previous_op_code = op_code;
+}
+
+void ProfilerInterrupt(struct Profiler* profiler, const enum ProfilerFrameKind kind, const uint16_t return_address, const uint16_t handler_address) {
+    // the interrupted instruction has already been executed, so the address it continues from is the one pushed to the stack
+    HandlePreviousStackEffect(profiler, return_address);
+    PushFrame(profiler, handler_address, kind);
+}
+
+
+
+static void GetLocationName(const uint32_t location, const uint16_t address, char* buffer, const size_t buffer_size) {
+    if (location < 0x8000) {
+        snprintf(buffer, buffer_size, "$%04X@ram", address);
+    } else {
+        snprintf(buffer, buffer_size, "$%04X@prg%02X", address, (location - 0x8000) / PROFILER_PAGE_SIZE);
+    }
+}
+
+struct SortedLocation {
+    uint32_t location;
+    const struct ProfilerLocation* entry;
+};
+
+// descending by cycles
+static int CompareCycles(const void* a, const void* b) {
+    const struct ProfilerCounter* counter_a = *(const struct ProfilerCounter* const*)a;
+    const struct ProfilerCounter* counter_b = *(const struct ProfilerCounter* const*)b;
+    return (counter_a->cycles < counter_b->cycles) - (counter_a->cycles > counter_b->cycles);
+}
+
+static int CompareLocationCycles(const void* a, const void* b) {
+    const struct ProfilerLocation* entry_a = ((const struct SortedLocation*)a)->entry;
+    const struct ProfilerLocation* entry_b = ((const struct SortedLocation*)b)->entry;
+    return (entry_a->counter.cycles < entry_b->counter.cycles) - (entry_a->counter.cycles > entry_b->counter.cycles);
+}
+
+static double Percentage(const uint64_t cycles, const uint64_t total_cycles) {
+    return (total_cycles == 0) ? 0.0 : (100.0 * (double)cycles / (double)total_cycles);
+}
+
+void ProfilerWriteReport(struct Profiler* profiler, FILE* file) {
+    uint64_t total_cycles = profiler->previous_tick_counter - profiler->first_tick_counter;
+    uint64_t total_executions = 0;
+    for (uint16_t i = 0; i < 256; i++) {
+        total_executions += profiler->op_codes[i].executions;
+    }
+
+    fprintf(file, "total: %llu instructions  %llu cycles\n\n", (unsigned long long)total_executions, (unsigned long long)total_cycles);
+
+
+    const struct ProfilerCounter* op_codes[256];
+    for (uint16_t i = 0; i < 256; i++) {
+        op_codes[i] = &profiler->op_codes[i];
+    }
+    qsort(op_codes, 256, sizeof(op_codes[0]), &CompareCycles);
+
+    fprintf(file, "per opcode:\n%-6s %-4s %16s %16s %8s\n", "opcode", "", "executions", "cycles", "cycles%");
+    for (uint16_t i = 0; i < 256 && op_codes[i]->executions != 0; i++) {
+        uint8_t op_code = (uint8_t)(op_codes[i] - profiler->op_codes);
+        fprintf(
+            file, "$%02X    %-4s %16llu %16llu %7.2f%%\n",
+            op_code, profiler->GetMnemonic(op_code),
+            (unsigned long long)op_codes[i]->executions, (unsigned long long)op_codes[i]->cycles,
+            Percentage(op_codes[i]->cycles, total_cycles)
+        );
+    }
+
+
+    uint32_t location_count = 0;
+    for (uint32_t page = 0; page < profiler->page_count; page++) {
+        if (profiler->pages[page] != NULL) {
+            for (uint32_t i = 0; i < PROFILER_PAGE_SIZE; i++) {
+                location_count += (profiler->pages[page][i].counter.executions != 0);
+            }
+        }
+    }
+
+    fprintf(file, "\nper address:\n%-14s %-4s %16s %16s %8s\n", "address", "", "executions", "cycles", "cycles%");
+    if (location_count == 0) {
+        // nothing ran while profiling
+        return;
+    }
+
+    struct SortedLocation* locations = malloc(location_count * sizeof(struct SortedLocation));
+    if (locations == NULL) {
+        LOG(ERROR, PROFILER, "failed to allocate memmory for sorting %u locations\n", location_count);
+    }
+
+    uint32_t n = 0;
+    for (uint32_t page = 0; page < profiler->page_count; page++) {
+        if (profiler->pages[page] != NULL) {
+            for (uint32_t i = 0; i < PROFILER_PAGE_SIZE; i++) {
+                if (profiler->pages[page][i].counter.executions != 0) {
+                    locations[n].location = page * PROFILER_PAGE_SIZE + i;
+                    locations[n].entry = &profiler->pages[page][i];
+                    n++;
+                }
+            }
+        }
+    }
+    qsort(locations, location_count, sizeof(struct SortedLocation), &CompareLocationCycles);
+
+    for (uint32_t i = 0; i < location_count; i++) {
+        const struct ProfilerLocation* entry = locations[i].entry;
+
+        char name[LOCATION_NAME_LENGTH];
+        GetLocationName(locations[i].location, entry->address, name, sizeof(name));
+        fprintf(
+            file, "%-14s %-4s %16llu %16llu %7.2f%%\n",
+            name, profiler->GetMnemonic(entry->op_code),
+            (unsigned long long)entry->counter.executions, (unsigned long long)entry->counter.cycles,
+            Percentage(entry->counter.cycles, total_cycles)
+        );
+    }
+
+    free(locations);
+}
+
+// flamegraph.pl / speedscope "collapsed" format: one line per call path with its self cycles, frames separated by ;
+void ProfilerWriteCollapsedStacks(struct Profiler* profiler, FILE* file) {
+    uint32_t path[PROFILER_MAX_CALL_DEPTH + 1];
+
+    for (uint32_t i = 0; i < profiler->call_node_count; i++) {
+        struct ProfilerCallNode* node = &profiler->call_nodes[i];
+        if (node->cycles == 0) {
+            continue;
+        }
+
+        uint32_t depth = 0;
+        for (uint32_t index = i; index != PROFILER_ROOT_CALL_NODE; index = profiler->call_nodes[index].parent) {
+            path[depth] = index;
+            depth++;
+        }
+
+        fprintf(file, "main");
+        while (depth > 0) {
+            depth--;
+            struct ProfilerCallNode* frame = &profiler->call_nodes[path[depth]];
+
+            char name[LOCATION_NAME_LENGTH];
+            GetLocationName(frame->location, frame->address, name, sizeof(name));
+            switch (frame->kind) {
+                case PROFILER_CALL: fprintf(file, ";%s", name); break;
+                case PROFILER_NMI: fprintf(file, ";nmi %s", name); break;
+                case PROFILER_IRQ: fprintf(file, ";irq %s", name); break;
+            }
+        }
+        fprintf(file, " %llu\n", (unsigned long long)node->cycles);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cartridge.h"
+
+
+// locations below 0x8000 are cpu addresses (code running from ram/prg ram),
+// the rest are 0x8000 + offset into prg rom so the same address in different banks is counted separately
+#define PROFILER_PAGE_SIZE 0x2000
+#define PROFILER_RAM_PAGES (0x8000 / PROFILER_PAGE_SIZE)
+
+// deeper calls are still tracked (so the returns stay balanced) but they are counted in the deepest frame
+#define PROFILER_MAX_CALL_DEPTH 64
+
+#define PROFILER_ROOT_CALL_NODE 0
+
+
+enum ProfilerFrameKind {
+    PROFILER_CALL,
+    PROFILER_NMI,
+    PROFILER_IRQ,
+};
+
+struct ProfilerCounter {
+    uint64_t executions;
+    uint64_t cycles;
+};
+
+struct ProfilerLocation {
+    struct ProfilerCounter counter;
+    uint16_t address;
+    uint8_t op_code;
+};
+
+// node of the call tree, every distinct call path gets its own node so the collapsed stacks can be written at the end
+struct ProfilerCallNode {
+    uint32_t location;
+    uint16_t address;
+    enum ProfilerFrameKind kind;
+
+    uint32_t parent;
+    uint32_t first_child;
+    uint32_t next_sibling;
+
+    uint64_t cycles;
+};
+
+struct Profiler {
+    struct Cartridge* cartridge;
+    const char* (*GetMnemonic)(uint8_t);
+
+    struct ProfilerCounter op_codes[256];
+
+    // allocated on first use, so only the banks that actually run code take up memmory
+    struct ProfilerLocation** pages;
+    uint32_t page_count;
+
+    struct ProfilerCallNode* call_nodes;
+    uint32_t call_node_count;
+    uint32_t call_node_capacity;
+
+    uint32_t current_call_node;
+    uint32_t call_depth;
+    uint32_t call_depth_overflow;
+
+    // cycles of an instruction are only known when the next one starts (branches, page crossings, interrupts, dma)
+    bool previous_valid;
+    bool previous_stack_handled;
+    uint64_t previous_tick_counter;
+    uint32_t previous_location;
+    uint32_t previous_call_node;
+    uint8_t previous_op_code;
+
+    uint64_t first_tick_counter;
+};
+
+
+void ProfilerInit(struct Profiler* profiler, struct Cartridge* cartridge, const char* (*GetMnemonic)(uint8_t));
+void ProfilerClean(struct Profiler* profiler);
+
+void ProfilerInstruction(struct Profiler* profiler, const uint16_t program_counter, const uint8_t op_code, const uint64_t tick_counter);
+void ProfilerInterrupt(struct Profiler* profiler, const enum ProfilerFrameKind kind, const uint16_t return_address, const uint16_t handler_address);
+
+void ProfilerWriteReport(struct Profiler* profiler, FILE* file);
+void ProfilerWriteCollapsedStacks(struct Profiler* profiler, FILE* file);
+
+#endif
\ No newline at end of file
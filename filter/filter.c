@@ -0,0 +1,235 @@
+#include <stdlib.h>
+
+#include "filter.h"
+#include "filter_kernels.h"
+#include "filter_ntsc.h"
+#include "logger.h"
+
+
+static int Worker(void* data) {
+    struct FilterBand* band = (struct FilterBand*)data;
+    struct Filter* filter = band->filter;
+    uint32_t generation = 0;
+
+    mtx_lock(&filter->mutex);
+    while (true) {
+        while (filter->generation == generation && !filter->quit) {
+            cnd_wait(&filter->work_ready, &filter->mutex);
+        }
+        if (filter->quit) {
+            break;
+        }
+        generation = filter->generation;
+        mtx_unlock(&filter->mutex);
+
+        filter->pass.Kernel(&filter->pass, band->y_start, band->y_end);
+
+        mtx_lock(&filter->mutex);
+        filter->pending--;
+        if (filter->pending == 0) {
+            cnd_signal(&filter->work_done);
+        }
+    }
+    mtx_unlock(&filter->mutex);
+
+    return 0;
+}
+
+// every band only reads the source and writes its own rows, so a pass needs no locking apart from the hand over
+static void RunPass(struct Filter* filter) {
+    uint16_t height = filter->pass.source_height;
+    for (uint8_t i = 0; i < filter->thread_count; i++) {
+        filter->bands[i].y_start = (height * i) / filter->thread_count;
+        filter->bands[i].y_end = (height * (i + 1)) / filter->thread_count;
+    }
+
+    if (filter->thread_count > 1) {
+        mtx_lock(&filter->mutex);
+        filter->pending = filter->thread_count - 1;
+        filter->generation++;
+        cnd_broadcast(&filter->work_ready);
+        mtx_unlock(&filter->mutex);
+    }
+
+    filter->pass.Kernel(&filter->pass, filter->bands[0].y_start, filter->bands[0].y_end);
+
+    if (filter->thread_count > 1) {
+        mtx_lock(&filter->mutex);
+        while (filter->pending != 0) {
+            cnd_wait(&filter->work_done, &filter->mutex);
+        }
+        mtx_unlock(&filter->mutex);
+    }
+}
+
+
+void FilterInit(struct Filter* filter, const uint8_t thread_count) {
+    FilterKernelsInit();
+
+    filter->kind = FILTER_NEAREST;
+    filter->scale = 1;
+
+    filter->intermediate = NULL;
+    filter->intermediate_size = 0;
+
+    filter->ntsc = NULL;
+    filter->pixel_format = (struct FilterPixelFormat){
+        .red_shift = 24,
+        .green_shift = 16,
+        .blue_shift = 8,
+        .alpha_mask = 0x000000FF,
+    };
+    PaletteGetDefaultParameters(&filter->palette_parameters);
+    filter->palette = NULL;
+
+    filter->thread_count = (thread_count == 0) ? 1 : ((thread_count > FILTER_MAX_THREADS) ? FILTER_MAX_THREADS : thread_count);
+    filter->generation = 0;
+    filter->pending = 0;
+    filter->quit = false;
+
+    if (mtx_init(&filter->mutex, mtx_plain) != thrd_success || cnd_init(&filter->work_ready) != thrd_success || cnd_init(&filter->work_done) != thrd_success) {
+        LOG(ERROR, FILTER, "failed to create the worker synchronization\n");
+    }
+
+    for (uint8_t i = 0; i < filter->thread_count; i++) {
+        filter->bands[i].filter = filter;
+        filter->bands[i].y_start = 0;
+        filter->bands[i].y_end = 0;
+    }
+    for (uint8_t i = 1; i < filter->thread_count; i++) {
+        if (thrd_create(&filter->workers[i - 1], &Worker, &filter->bands[i]) != thrd_success) {
+            LOG(WARNING, FILTER, "failed to start worker %u, using %u threads\n", i, i);
+            filter->thread_count = i;
+            break;
+        }
+    }
+}
+
+void FilterClean(struct Filter* filter) {
+    mtx_lock(&filter->mutex);
+    filter->quit = true;
+    cnd_broadcast(&filter->work_ready);
+    mtx_unlock(&filter->mutex);
+
+    for (uint8_t i = 1; i < filter->thread_count; i++) {
+        thrd_join(filter->workers[i - 1], NULL);
+    }
+
+    cnd_destroy(&filter->work_done);
+    cnd_destroy(&filter->work_ready);
+    mtx_destroy(&filter->mutex);
+
+    free(filter->intermediate);
+    filter->intermediate = NULL;
+    filter->intermediate_size = 0;
+
+    free(filter->ntsc);
+    filter->ntsc = NULL;
+}
+
+bool FilterSet(struct Filter* filter, const enum FilterKind kind, const uint8_t scale) {
+    bool supported = false;
+    switch (kind) {
+        case FILTER_NEAREST:   supported = (scale >= 1 && scale <= FILTER_MAX_SCALE); break;
+        case FILTER_SCALEX:    supported = (scale >= 2 && scale <= FILTER_MAX_SCALE); break;
+        case FILTER_XBR_LITE:  supported = (scale == 2 || scale == 4); break;
+        case FILTER_NTSC:      supported = (scale == 2); break;
+        default: break;
+    }
+
+    if (supported && kind == FILTER_NTSC && filter->ntsc == NULL) {
+        filter->ntsc = (struct FilterNTSC*)malloc(sizeof(struct FilterNTSC));
+        if (filter->ntsc == NULL) {
+            LOG(ERROR, FILTER, "failed to allocate the ntsc tables\n");
+        }
+        FilterNTSCInit(filter->ntsc, &filter->palette_parameters, filter->palette);
+    }
+
+    if (supported) {
+        filter->kind = kind;
+        filter->scale = scale;
+    }
+    return supported;
+}
+
+void FilterSetPixelFormat(struct Filter* filter, const struct FilterPixelFormat pixel_format) {
+    filter->pixel_format = pixel_format;
+}
+
+void FilterSetPalette(struct Filter* filter, const struct PaletteParameters* parameters, const struct Palette* palette) {
+    filter->palette_parameters = *parameters;
+    filter->palette = palette;
+    if (filter->ntsc != NULL) {
+        FilterNTSCInit(filter->ntsc, &filter->palette_parameters, filter->palette);
+    }
+}
+
+void FilterApply(struct Filter* filter, const uint32_t* source, const uint16_t width, const uint16_t height, uint8_t* destination, const int pitch) {
+    if (filter->kind != FILTER_NEAREST && filter->scale == 4) {
+        uint32_t intermediate_size = (uint32_t)(2 * width) * (uint32_t)(2 * height);
+        if (filter->intermediate_size < intermediate_size) {
+            free(filter->intermediate);
+            filter->intermediate = (uint32_t*)malloc(intermediate_size * sizeof(uint32_t));
+            if (filter->intermediate == NULL) {
+                LOG(ERROR, FILTER, "failed to allocate %u pixels for the intermediate frame\n", intermediate_size);
+            }
+            filter->intermediate_size = intermediate_size;
+        }
+
+        filter->pass = (struct FilterPass){
+            .Kernel = FilterGetKernel(filter->kind, 2),
+            .scale = 2,
+            .source = source,
+            .source_width = width,
+            .source_height = height,
+            .destination = (uint8_t*)filter->intermediate,
+            .destination_pitch = 2 * width * sizeof(uint32_t),
+        };
+        RunPass(filter);
+
+        filter->pass = (struct FilterPass){
+            .Kernel = FilterGetKernel(filter->kind, 2),
+            .scale = 2,
+            .source = filter->intermediate,
+            .source_width = 2 * width,
+            .source_height = 2 * height,
+            .destination = destination,
+            .destination_pitch = pitch,
+        };
+        RunPass(filter);
+        return;
+    }
+
+    filter->pass = (struct FilterPass){
+        .Kernel = FilterGetKernel(filter->kind, filter->scale),
+        .scale = filter->scale,
+        .source = source,
+        .source_width = width,
+        .source_height = height,
+        .destination = destination,
+        .destination_pitch = pitch,
+    };
+    RunPass(filter);
+}
+
+void FilterApplyPaletteIndices(struct Filter* filter, const uint16_t* palette_indices, const uint16_t width, const uint16_t height, uint8_t* destination, const int pitch) {
+    if (filter->kind != FILTER_NTSC || width > FILTER_NTSC_MAX_WIDTH) {
+        LOG(ERROR, FILTER, "only the ntsc filter takes palette indices (up to %u pixels wide)\n", FILTER_NTSC_MAX_WIDTH);
+    }
+
+    FilterNTSCNextFrame(filter->ntsc);
+
+    filter->pass = (struct FilterPass){
+        .Kernel = FilterGetKernel(filter->kind, filter->scale),
+        .scale = filter->scale,
+        .source = NULL,
+        .palette_indices = palette_indices,
+        .source_width = width,
+        .source_height = height,
+        .destination = destination,
+        .destination_pitch = pitch,
+        .ntsc = filter->ntsc,
+        .pixel_format = filter->pixel_format,
+    };
+    RunPass(filter);
+}
\ No newline at end of file
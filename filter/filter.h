@@ -0,0 +1,103 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <threads.h>
+
+#include "palette.h"
+
+
+#define FILTER_MAX_SCALE 4
+#define FILTER_MAX_THREADS 16
+
+
+// the filters only compare and average whole bytes, so the pixels can be in any 32 bit format,
+// except ntsc which makes its own colors from palette indices and needs the pixel format
+enum FilterKind {
+    FILTER_NEAREST,     // integer scaling
+    FILTER_SCALEX,      // scale2x / scale3x (AdvMAME), 4x is scale2x applied twice
+    FILTER_XBR_LITE,    // 2xbr without the edge slopes, only 2x and 4x (applied twice)
+    FILTER_NTSC,        // composite signal artifacts, only 2x (twice the horizontal resolution, rows doubled)
+};
+
+struct FilterPixelFormat {
+    uint8_t red_shift;
+    uint8_t green_shift;
+    uint8_t blue_shift;
+    uint32_t alpha_mask;
+};
+
+struct Filter;
+struct FilterNTSC;
+
+// one horizontal band of one pass, rows are in source pixels
+struct FilterBand {
+    struct Filter* filter;
+    uint16_t y_start;
+    uint16_t y_end;
+};
+
+struct FilterPass {
+    void (*Kernel)(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end);
+    uint8_t scale;
+
+    const uint32_t* source;
+    const uint16_t* palette_indices;    // source of the ntsc filter
+    uint16_t source_width;
+    uint16_t source_height;
+    uint8_t* destination;
+    int destination_pitch;
+
+    const struct FilterNTSC* ntsc;
+    struct FilterPixelFormat pixel_format;
+};
+
+// the frame is split into horizontal bands, the calling thread does the first one and the workers the rest
+struct Filter {
+    enum FilterKind kind;
+    uint8_t scale;
+
+    // output of the first pass for the 4x filters that run a 2x one twice
+    uint32_t* intermediate;
+    uint32_t intermediate_size;
+
+    // tables of the ntsc filter, made when it's first selected and remade when the palette changes
+    struct FilterNTSC* ntsc;
+    struct FilterPixelFormat pixel_format;
+    struct PaletteParameters palette_parameters;
+    const struct Palette* palette;
+
+    struct FilterPass pass;
+
+    thrd_t workers[FILTER_MAX_THREADS - 1];
+    struct FilterBand bands[FILTER_MAX_THREADS];
+    uint8_t thread_count;
+
+    mtx_t mutex;
+    cnd_t work_ready;
+    cnd_t work_done;
+    uint32_t generation;    // bumped for every pass, the workers wait for it to change
+    uint8_t pending;        // workers still working on the current pass
+    bool quit;
+};
+
+
+// thread_count includes the calling thread
+void FilterInit(struct Filter* filter, const uint8_t thread_count);
+void FilterClean(struct Filter* filter);
+
+// returns false when the filter doesn't support that scale
+bool FilterSet(struct Filter* filter, const enum FilterKind kind, const uint8_t scale);
+// format of the pixels the ntsc filter writes, rgba8888 by default
+void FilterSetPixelFormat(struct Filter* filter, const struct FilterPixelFormat pixel_format);
+// hue, saturation and gamma the ntsc filter decodes with, the default parameters until this is called,
+// palette is a loaded one the flat colors have to match (it has to outlive the filter) or NULL
+void FilterSetPalette(struct Filter* filter, const struct PaletteParameters* parameters, const struct Palette* palette);
+
+// the destination has to be (width * scale) x (height * scale) pixels, rows are pitch bytes apart
+void FilterApply(struct Filter* filter, const uint32_t* source, const uint16_t width, const uint16_t height, uint8_t* destination, const int pitch);
+// same for the ntsc filter, the palette indices are the nes color in bits 0-5 and the emphasis bits in 6-8
+void FilterApplyPaletteIndices(struct Filter* filter, const uint16_t* palette_indices, const uint16_t width, const uint16_t height, uint8_t* destination, const int pitch);
+
+#endif
\ No newline at end of file
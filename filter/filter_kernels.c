@@ -0,0 +1,538 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter_kernels.h"
+#include "filter_ntsc.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILTER_X86
+#endif
+
+
+static FilterKernel nearest_kernel = NULL;
+static FilterKernel scale2x_kernel = NULL;
+static FilterKernel scale3x_kernel = NULL;
+static FilterKernel xbr_lite_kernel = NULL;
+
+
+// source rows outside the frame are clamped to the edge
+static inline const uint32_t* SourceRow(const struct FilterPass* pass, int y) {
+    if (y < 0) {
+        y = 0;
+    } else if (y >= pass->source_height) {
+        y = pass->source_height - 1;
+    }
+    return &pass->source[y * pass->source_width];
+}
+
+static inline uint32_t* DestinationRow(const struct FilterPass* pass, const uint32_t y) {
+    return (uint32_t*)(pass->destination + (size_t)y * pass->destination_pitch);
+}
+
+static inline void RepeatRow(const struct FilterPass* pass, const uint32_t y, const uint8_t count) {
+    size_t row_size = (size_t)pass->source_width * pass->scale * sizeof(uint32_t);
+    for (uint8_t i = 1; i <= count; i++) {
+        memcpy(DestinationRow(pass, y + i), DestinationRow(pass, y), row_size);
+    }
+}
+
+
+static void NearestScalar(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end) {
+    for (uint16_t y = y_start; y < y_end; y++) {
+        const uint32_t* row = SourceRow(pass, y);
+        uint32_t* out = DestinationRow(pass, y * pass->scale);
+
+        for (uint16_t x = 0; x < pass->source_width; x++) {
+            for (uint8_t i = 0; i < pass->scale; i++) {
+                out[x * pass->scale + i] = row[x];
+            }
+        }
+        RepeatRow(pass, y * pass->scale, pass->scale - 1);
+    }
+}
+
+
+// AdvMAME scale2x, the 4 outputs of E only differ from it on edges:
+//   B        E0 E1
+// D E F  ->  E2 E3
+//   H
+static inline void Scale2xPixel(const uint32_t* above, const uint32_t* row, const uint32_t* below, const uint16_t x, const uint16_t width, uint32_t* out_0, uint32_t* out_1) {
+    uint32_t B = above[x];
+    uint32_t D = row[(x > 0) ? (x - 1) : x];
+    uint32_t E = row[x];
+    uint32_t F = row[((x + 1) < width) ? (x + 1) : x];
+    uint32_t H = below[x];
+
+    if (B != H && D != F) {
+        out_0[2 * x + 0] = (D == B) ? D : E;
+        out_0[2 * x + 1] = (B == F) ? F : E;
+        out_1[2 * x + 0] = (D == H) ? D : E;
+        out_1[2 * x + 1] = (H == F) ? F : E;
+    } else {
+        out_0[2 * x + 0] = E;
+        out_0[2 * x + 1] = E;
+        out_1[2 * x + 0] = E;
+        out_1[2 * x + 1] = E;
+    }
+}
+
+static void Scale2xScalar(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end) {
+    for (uint16_t y = y_start; y < y_end; y++) {
+        const uint32_t* above = SourceRow(pass, y - 1);
+        const uint32_t* row = SourceRow(pass, y);
+        const uint32_t* below = SourceRow(pass, y + 1);
+        uint32_t* out_0 = DestinationRow(pass, 2 * y + 0);
+        uint32_t* out_1 = DestinationRow(pass, 2 * y + 1);
+
+        for (uint16_t x = 0; x < pass->source_width; x++) {
+            Scale2xPixel(above, row, below, x, pass->source_width, out_0, out_1);
+        }
+    }
+}
+
+
+//  A B C      E0 E1 E2
+//  D E F  ->  E3 E4 E5
+//  G H I      E6 E7 E8
+static inline void Scale3xPixel(const uint32_t* above, const uint32_t* row, const uint32_t* below, const uint16_t x, const uint16_t width, uint32_t* out_0, uint32_t* out_1, uint32_t* out_2) {
+    uint16_t left = (x > 0) ? (x - 1) : x;
+    uint16_t right = ((x + 1) < width) ? (x + 1) : x;
+
+    uint32_t A = above[left], B = above[x], C = above[right];
+    uint32_t D = row[left],   E = row[x],   F = row[right];
+    uint32_t G = below[left], H = below[x], I = below[right];
+
+    uint32_t* out = &out_0[3 * x];
+    uint32_t* out_middle = &out_1[3 * x];
+    uint32_t* out_bottom = &out_2[3 * x];
+
+    if (B != H && D != F) {
+        out[0] = (D == B) ? D : E;
+        out[1] = ((D == B && E != C) || (B == F && E != A)) ? B : E;
+        out[2] = (B == F) ? F : E;
+        out_middle[0] = ((D == B && E != G) || (D == H && E != A)) ? D : E;
+        out_middle[1] = E;
+        out_middle[2] = ((B == F && E != I) || (H == F && E != C)) ? F : E;
+        out_bottom[0] = (D == H) ? D : E;
+        out_bottom[1] = ((D == H && E != I) || (H == F && E != G)) ? H : E;
+        out_bottom[2] = (H == F) ? F : E;
+    } else {
+        out[0] = out[1] = out[2] = E;
+        out_middle[0] = out_middle[1] = out_middle[2] = E;
+        out_bottom[0] = out_bottom[1] = out_bottom[2] = E;
+    }
+}
+
+static void Scale3xScalar(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end) {
+    for (uint16_t y = y_start; y < y_end; y++) {
+        const uint32_t* above = SourceRow(pass, y - 1);
+        const uint32_t* row = SourceRow(pass, y);
+        const uint32_t* below = SourceRow(pass, y + 1);
+        uint32_t* out_0 = DestinationRow(pass, 3 * y + 0);
+        uint32_t* out_1 = DestinationRow(pass, 3 * y + 1);
+        uint32_t* out_2 = DestinationRow(pass, 3 * y + 2);
+
+        for (uint16_t x = 0; x < pass->source_width; x++) {
+            Scale3xPixel(above, row, below, x, pass->source_width, out_0, out_1, out_2);
+        }
+    }
+}
+
+
+// sum of the differences of the 4 bytes, the alpha/unused byte is the same for every color
+static inline uint32_t Distance(const uint32_t a, const uint32_t b) {
+    uint32_t distance = 0;
+    for (uint8_t shift = 0; shift < 32; shift += 8) {
+        distance += abs((int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF));
+    }
+    return distance;
+}
+
+static inline uint32_t Average(const uint32_t a, const uint32_t b) {
+    return (a & b) + (((a ^ b) & 0xFEFEFEFE) >> 1);
+}
+
+// one corner of 2xbr, p is the 5x5 neighbourhood around E and (dx, dy) points towards the corner,
+// the edge between H and F (rotated) is taken when the colors change less along it than across it
+//      A1 B1 C1
+//   A0 A  B  C  C4
+//   D0 D  E  F  F4
+//   G0 G  H  I  I4
+//      G5 H5 I5
+static inline uint32_t XBRCorner(const uint32_t p[5][5], const int dx, const int dy) {
+#define P(x, y) p[2 + (y) * dy][2 + (x) * dx]
+    uint32_t E = P(0, 0);
+    uint32_t F = P(1, 0);
+    uint32_t H = P(0, 1);
+    uint32_t I = P(1, 1);
+
+    // the blend would pick E itself, which is the case for most of a frame
+    if (E == F || E == H) {
+        return E;
+    }
+
+    uint32_t along = Distance(E, P(1, -1)) + Distance(E, P(-1, 1)) + Distance(I, P(2, 0)) + Distance(I, P(0, 2)) + 4 * Distance(H, F);
+    uint32_t across = Distance(H, P(-1, 0)) + Distance(H, P(1, 2)) + Distance(F, P(2, 1)) + Distance(F, P(0, -1)) + 4 * Distance(E, I);
+#undef P
+
+    if (along < across) {
+        return Average(E, (Distance(E, F) <= Distance(E, H)) ? F : H);
+    }
+    return E;
+}
+
+// rows are the 5 source rows around the pixel, the columns past the edges are clamped
+static inline void XBRLitePixel(const uint32_t* rows[5], const uint16_t x, const uint16_t width, uint32_t* out_0, uint32_t* out_1) {
+    uint32_t p[5][5];
+    for (int i = 0; i < 5; i++) {
+        int column = x + i - 2;
+        if (column < 0) {
+            column = 0;
+        } else if (column >= width) {
+            column = width - 1;
+        }
+
+        for (int j = 0; j < 5; j++) {
+            p[j][i] = rows[j][column];
+        }
+    }
+
+    out_0[2 * x + 0] = XBRCorner(p, -1, -1);
+    out_0[2 * x + 1] = XBRCorner(p, 1, -1);
+    out_1[2 * x + 0] = XBRCorner(p, -1, 1);
+    out_1[2 * x + 1] = XBRCorner(p, 1, 1);
+}
+
+static void XBRLite2xScalar(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end) {
+    for (uint16_t y = y_start; y < y_end; y++) {
+        const uint32_t* rows[5];
+        for (int i = 0; i < 5; i++) {
+            rows[i] = SourceRow(pass, y + i - 2);
+        }
+        uint32_t* out_0 = DestinationRow(pass, 2 * y + 0);
+        uint32_t* out_1 = DestinationRow(pass, 2 * y + 1);
+
+        for (uint16_t x = 0; x < pass->source_width; x++) {
+            XBRLitePixel(rows, x, pass->source_width, out_0, out_1);
+        }
+    }
+}
+
+
+#ifdef FILTER_X86
+
+__attribute__((target("sse2")))
+static void NearestSSE2(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end) {
+    uint16_t width = pass->source_width;
+
+    for (uint16_t y = y_start; y < y_end; y++) {
+        const uint32_t* row = SourceRow(pass, y);
+        uint32_t* out = DestinationRow(pass, y * pass->scale);
+
+        uint16_t x = 0;
+        switch (pass->scale) {
+            case 2:
+                for (; (x + 4) <= width; x += 4) {
+                    __m128i pixels = _mm_loadu_si128((const __m128i*)&row[x]);
+                    _mm_storeu_si128((__m128i*)&out[2 * x + 0], _mm_unpacklo_epi32(pixels, pixels));
+                    _mm_storeu_si128((__m128i*)&out[2 * x + 4], _mm_unpackhi_epi32(pixels, pixels));
+                }
+                break;
+            case 3:
+                for (; (x + 4) <= width; x += 4) {
+                    __m128i pixels = _mm_loadu_si128((const __m128i*)&row[x]);
+                    _mm_storeu_si128((__m128i*)&out[3 * x + 0], _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 0, 0, 0)));
+                    _mm_storeu_si128((__m128i*)&out[3 * x + 4], _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 1, 1)));
+                    _mm_storeu_si128((__m128i*)&out[3 * x + 8], _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 2)));
+                }
+                break;
+            case 4:
+                for (; (x + 4) <= width; x += 4) {
+                    __m128i pixels = _mm_loadu_si128((const __m128i*)&row[x]);
+                    _mm_storeu_si128((__m128i*)&out[4 * x + 0], _mm_shuffle_epi32(pixels, _MM_SHUFFLE(0, 0, 0, 0)));
+                    _mm_storeu_si128((__m128i*)&out[4 * x + 4], _mm_shuffle_epi32(pixels, _MM_SHUFFLE(1, 1, 1, 1)));
+                    _mm_storeu_si128((__m128i*)&out[4 * x + 8], _mm_shuffle_epi32(pixels, _MM_SHUFFLE(2, 2, 2, 2)));
+                    _mm_storeu_si128((__m128i*)&out[4 * x + 12], _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 3, 3, 3)));
+                }
+                break;
+            default:
+                break;
+        }
+
+        for (; x < width; x++) {
+            for (uint8_t i = 0; i < pass->scale; i++) {
+                out[x * pass->scale + i] = row[x];
+            }
+        }
+        RepeatRow(pass, y * pass->scale, pass->scale - 1);
+    }
+}
+
+// 4 pixels at a time, the first and last pixel of the row are done by the scalar code so D and F can be loaded unaligned
+__attribute__((target("sse2")))
+static void Scale2xSSE2(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end) {
+    uint16_t width = pass->source_width;
+
+    for (uint16_t y = y_start; y < y_end; y++) {
+        const uint32_t* above = SourceRow(pass, y - 1);
+        const uint32_t* row = SourceRow(pass, y);
+        const uint32_t* below = SourceRow(pass, y + 1);
+        uint32_t* out_0 = DestinationRow(pass, 2 * y + 0);
+        uint32_t* out_1 = DestinationRow(pass, 2 * y + 1);
+
+        Scale2xPixel(above, row, below, 0, width, out_0, out_1);
+
+        uint16_t x = 1;
+        for (; (x + 4) < width; x += 4) {
+            __m128i B = _mm_loadu_si128((const __m128i*)&above[x]);
+            __m128i D = _mm_loadu_si128((const __m128i*)&row[x - 1]);
+            __m128i E = _mm_loadu_si128((const __m128i*)&row[x]);
+            __m128i F = _mm_loadu_si128((const __m128i*)&row[x + 1]);
+            __m128i H = _mm_loadu_si128((const __m128i*)&below[x]);
+
+            // B != H && D != F
+            __m128i edge = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(B, H), _mm_cmpeq_epi32(D, F)), _mm_set1_epi32(-1));
+
+            __m128i mask_0 = _mm_and_si128(edge, _mm_cmpeq_epi32(D, B));
+            __m128i mask_1 = _mm_and_si128(edge, _mm_cmpeq_epi32(B, F));
+            __m128i mask_2 = _mm_and_si128(edge, _mm_cmpeq_epi32(D, H));
+            __m128i mask_3 = _mm_and_si128(edge, _mm_cmpeq_epi32(H, F));
+
+            __m128i E0 = _mm_or_si128(_mm_and_si128(mask_0, D), _mm_andnot_si128(mask_0, E));
+            __m128i E1 = _mm_or_si128(_mm_and_si128(mask_1, F), _mm_andnot_si128(mask_1, E));
+            __m128i E2 = _mm_or_si128(_mm_and_si128(mask_2, D), _mm_andnot_si128(mask_2, E));
+            __m128i E3 = _mm_or_si128(_mm_and_si128(mask_3, F), _mm_andnot_si128(mask_3, E));
+
+            _mm_storeu_si128((__m128i*)&out_0[2 * x + 0], _mm_unpacklo_epi32(E0, E1));
+            _mm_storeu_si128((__m128i*)&out_0[2 * x + 4], _mm_unpackhi_epi32(E0, E1));
+            _mm_storeu_si128((__m128i*)&out_1[2 * x + 0], _mm_unpacklo_epi32(E2, E3));
+            _mm_storeu_si128((__m128i*)&out_1[2 * x + 4], _mm_unpackhi_epi32(E2, E3));
+        }
+
+        for (; x < width; x++) {
+            Scale2xPixel(above, row, below, x, width, out_0, out_1);
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+static inline __m128i Select(const __m128i mask, const __m128i a, const __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// writes the 3 outputs of 4 pixels in order (a0 b0 c0 a1 b1 c1 ...)
+__attribute__((target("sse2")))
+static inline void Store3(uint32_t* out, const __m128i a, const __m128i b, const __m128i c) {
+    __m128 ab_low = _mm_castsi128_ps(_mm_unpacklo_epi32(a, b));    // a0 b0 a1 b1
+    __m128 ab_high = _mm_castsi128_ps(_mm_unpackhi_epi32(a, b));   // a2 b2 a3 b3
+    __m128 ca_low = _mm_castsi128_ps(_mm_unpacklo_epi32(c, a));    // c0 a0 c1 a1
+    __m128 ca_high = _mm_castsi128_ps(_mm_unpackhi_epi32(c, a));   // c2 a2 c3 a3
+    __m128 bc_low = _mm_castsi128_ps(_mm_unpacklo_epi32(b, c));    // b0 c0 b1 c1
+    __m128 bc_high = _mm_castsi128_ps(_mm_unpackhi_epi32(b, c));   // b2 c2 b3 c3
+
+    _mm_storeu_si128((__m128i*)&out[0], _mm_castps_si128(_mm_shuffle_ps(ab_low, ca_low, _MM_SHUFFLE(3, 0, 1, 0))));
+    _mm_storeu_si128((__m128i*)&out[4], _mm_castps_si128(_mm_shuffle_ps(bc_low, ab_high, _MM_SHUFFLE(1, 0, 3, 2))));
+    _mm_storeu_si128((__m128i*)&out[8], _mm_castps_si128(_mm_shuffle_ps(ca_high, bc_high, _MM_SHUFFLE(3, 2, 3, 0))));
+}
+
+// same layout as Scale2xSSE2, the first and last pixel go through the scalar code
+__attribute__((target("sse2")))
+static void Scale3xSSE2(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end) {
+    uint16_t width = pass->source_width;
+
+    for (uint16_t y = y_start; y < y_end; y++) {
+        const uint32_t* above = SourceRow(pass, y - 1);
+        const uint32_t* row = SourceRow(pass, y);
+        const uint32_t* below = SourceRow(pass, y + 1);
+        uint32_t* out_0 = DestinationRow(pass, 3 * y + 0);
+        uint32_t* out_1 = DestinationRow(pass, 3 * y + 1);
+        uint32_t* out_2 = DestinationRow(pass, 3 * y + 2);
+
+        Scale3xPixel(above, row, below, 0, width, out_0, out_1, out_2);
+
+        uint16_t x = 1;
+        for (; (x + 4) < width; x += 4) {
+            __m128i A = _mm_loadu_si128((const __m128i*)&above[x - 1]);
+            __m128i B = _mm_loadu_si128((const __m128i*)&above[x]);
+            __m128i C = _mm_loadu_si128((const __m128i*)&above[x + 1]);
+            __m128i D = _mm_loadu_si128((const __m128i*)&row[x - 1]);
+            __m128i E = _mm_loadu_si128((const __m128i*)&row[x]);
+            __m128i F = _mm_loadu_si128((const __m128i*)&row[x + 1]);
+            __m128i G = _mm_loadu_si128((const __m128i*)&below[x - 1]);
+            __m128i H = _mm_loadu_si128((const __m128i*)&below[x]);
+            __m128i I = _mm_loadu_si128((const __m128i*)&below[x + 1]);
+
+            // B != H && D != F
+            __m128i edge = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(B, H), _mm_cmpeq_epi32(D, F)), _mm_set1_epi32(-1));
+
+            __m128i DB = _mm_and_si128(edge, _mm_cmpeq_epi32(D, B));
+            __m128i BF = _mm_and_si128(edge, _mm_cmpeq_epi32(B, F));
+            __m128i DH = _mm_and_si128(edge, _mm_cmpeq_epi32(D, H));
+            __m128i HF = _mm_and_si128(edge, _mm_cmpeq_epi32(H, F));
+            __m128i EA = _mm_cmpeq_epi32(E, A);
+            __m128i EC = _mm_cmpeq_epi32(E, C);
+            __m128i EG = _mm_cmpeq_epi32(E, G);
+            __m128i EI = _mm_cmpeq_epi32(E, I);
+
+            __m128i E0 = Select(DB, D, E);
+            __m128i E1 = Select(_mm_or_si128(_mm_andnot_si128(EC, DB), _mm_andnot_si128(EA, BF)), B, E);
+            __m128i E2 = Select(BF, F, E);
+            __m128i E3 = Select(_mm_or_si128(_mm_andnot_si128(EG, DB), _mm_andnot_si128(EA, DH)), D, E);
+            __m128i E5 = Select(_mm_or_si128(_mm_andnot_si128(EI, BF), _mm_andnot_si128(EC, HF)), F, E);
+            __m128i E6 = Select(DH, D, E);
+            __m128i E7 = Select(_mm_or_si128(_mm_andnot_si128(EI, DH), _mm_andnot_si128(EG, HF)), H, E);
+            __m128i E8 = Select(HF, F, E);
+
+            Store3(&out_0[3 * x], E0, E1, E2);
+            Store3(&out_1[3 * x], E3, E, E5);
+            Store3(&out_2[3 * x], E6, E7, E8);
+        }
+
+        for (; x < width; x++) {
+            Scale3xPixel(above, row, below, x, width, out_0, out_1, out_2);
+        }
+    }
+}
+
+// Distance for 4 pixels: the absolute byte differences, then the 4 bytes of every pixel added up
+__attribute__((target("sse2")))
+static inline __m128i DistanceSSE2(const __m128i a, const __m128i b) {
+    __m128i difference = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+    __m128i pairs = _mm_add_epi32(_mm_and_si128(difference, _mm_set1_epi32(0x00FF00FF)), _mm_and_si128(_mm_srli_epi32(difference, 8), _mm_set1_epi32(0x00FF00FF)));
+    return _mm_add_epi32(_mm_and_si128(pairs, _mm_set1_epi32(0xFFFF)), _mm_srli_epi32(pairs, 16));
+}
+
+// XBRCorner for the 4 pixels starting at x, none of the 5x5 neighbourhoods may go past the row ends
+__attribute__((target("sse2")))
+static inline __m128i XBRCornerSSE2(const uint32_t* rows[5], const uint16_t x, const int dx, const int dy) {
+#define P(i, j) _mm_loadu_si128((const __m128i*)&rows[2 + (j) * dy][x + (i) * dx])
+    __m128i E = P(0, 0);
+    __m128i F = P(1, 0);
+    __m128i H = P(0, 1);
+    __m128i I = P(1, 1);
+
+    __m128i along = _mm_add_epi32(
+        _mm_add_epi32(_mm_add_epi32(DistanceSSE2(E, P(1, -1)), DistanceSSE2(E, P(-1, 1))), _mm_add_epi32(DistanceSSE2(I, P(2, 0)), DistanceSSE2(I, P(0, 2)))),
+        _mm_slli_epi32(DistanceSSE2(H, F), 2)
+    );
+    __m128i across = _mm_add_epi32(
+        _mm_add_epi32(_mm_add_epi32(DistanceSSE2(H, P(-1, 0)), DistanceSSE2(H, P(1, 2))), _mm_add_epi32(DistanceSSE2(F, P(2, 1)), DistanceSSE2(F, P(0, -1)))),
+        _mm_slli_epi32(DistanceSSE2(E, I), 2)
+    );
+#undef P
+
+    // E == F or E == H keeps E like the early return of the scalar code
+    __m128i keep = _mm_or_si128(_mm_cmpeq_epi32(E, F), _mm_cmpeq_epi32(E, H));
+    __m128i blend = _mm_andnot_si128(keep, _mm_cmplt_epi32(along, across));
+
+    __m128i closer = Select(_mm_cmpgt_epi32(DistanceSSE2(E, F), DistanceSSE2(E, H)), H, F);
+    __m128i average = _mm_add_epi32(_mm_and_si128(E, closer), _mm_srli_epi32(_mm_and_si128(_mm_xor_si128(E, closer), _mm_set1_epi32(0xFEFEFEFE)), 1));
+    return Select(blend, average, E);
+}
+
+// 4 pixels at a time, the 2 pixels at both row ends need clamped columns and go through the scalar code
+__attribute__((target("sse2")))
+static void XBRLite2xSSE2(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end) {
+    uint16_t width = pass->source_width;
+
+    for (uint16_t y = y_start; y < y_end; y++) {
+        const uint32_t* rows[5];
+        for (int i = 0; i < 5; i++) {
+            rows[i] = SourceRow(pass, y + i - 2);
+        }
+        uint32_t* out_0 = DestinationRow(pass, 2 * y + 0);
+        uint32_t* out_1 = DestinationRow(pass, 2 * y + 1);
+
+        uint16_t x = 0;
+        for (; x < 2 && x < width; x++) {
+            XBRLitePixel(rows, x, width, out_0, out_1);
+        }
+        for (; (x + 4 + 2) <= width; x += 4) {
+            // every corner keeps E when E matches B or D and B or F and so on (flat areas), then the 4 pixels are only doubled
+            __m128i B = _mm_loadu_si128((const __m128i*)&rows[1][x]);
+            __m128i D = _mm_loadu_si128((const __m128i*)&rows[2][x - 1]);
+            __m128i E = _mm_loadu_si128((const __m128i*)&rows[2][x]);
+            __m128i F = _mm_loadu_si128((const __m128i*)&rows[2][x + 1]);
+            __m128i H = _mm_loadu_si128((const __m128i*)&rows[3][x]);
+            __m128i EB = _mm_cmpeq_epi32(E, B);
+            __m128i ED = _mm_cmpeq_epi32(E, D);
+            __m128i EF = _mm_cmpeq_epi32(E, F);
+            __m128i EH = _mm_cmpeq_epi32(E, H);
+            __m128i flat = _mm_and_si128(_mm_and_si128(_mm_or_si128(ED, EB), _mm_or_si128(EF, EB)), _mm_and_si128(_mm_or_si128(ED, EH), _mm_or_si128(EF, EH)));
+            if (_mm_movemask_epi8(flat) == 0xFFFF) {
+                _mm_storeu_si128((__m128i*)&out_0[2 * x + 0], _mm_unpacklo_epi32(E, E));
+                _mm_storeu_si128((__m128i*)&out_0[2 * x + 4], _mm_unpackhi_epi32(E, E));
+                _mm_storeu_si128((__m128i*)&out_1[2 * x + 0], _mm_unpacklo_epi32(E, E));
+                _mm_storeu_si128((__m128i*)&out_1[2 * x + 4], _mm_unpackhi_epi32(E, E));
+                continue;
+            }
+
+            __m128i E0 = XBRCornerSSE2(rows, x, -1, -1);
+            __m128i E1 = XBRCornerSSE2(rows, x, 1, -1);
+            __m128i E2 = XBRCornerSSE2(rows, x, -1, 1);
+            __m128i E3 = XBRCornerSSE2(rows, x, 1, 1);
+
+            _mm_storeu_si128((__m128i*)&out_0[2 * x + 0], _mm_unpacklo_epi32(E0, E1));
+            _mm_storeu_si128((__m128i*)&out_0[2 * x + 4], _mm_unpackhi_epi32(E0, E1));
+            _mm_storeu_si128((__m128i*)&out_1[2 * x + 0], _mm_unpacklo_epi32(E2, E3));
+            _mm_storeu_si128((__m128i*)&out_1[2 * x + 4], _mm_unpackhi_epi32(E2, E3));
+        }
+        for (; x < width; x++) {
+            XBRLitePixel(rows, x, width, out_0, out_1);
+        }
+    }
+}
+
+#endif
+
+
+void FilterKernelsInit(void) {
+    if (!FilterKernelsSelect(FILTER_KERNELS_AVX) && !FilterKernelsSelect(FILTER_KERNELS_SSE2)) {
+        FilterKernelsSelect(FILTER_KERNELS_SCALAR);
+    }
+}
+
+bool FilterKernelsSelect(const enum FilterKernelSet kernel_set) {
+    switch (kernel_set) {
+        case FILTER_KERNELS_SCALAR:
+            nearest_kernel = &NearestScalar;
+            scale2x_kernel = &Scale2xScalar;
+            scale3x_kernel = &Scale3xScalar;
+            xbr_lite_kernel = &XBRLite2xScalar;
+            break;
+#ifdef FILTER_X86
+        // only the ntsc filter has avx kernels, the others stay on sse2
+        case FILTER_KERNELS_SSE2:
+        case FILTER_KERNELS_AVX:
+            __builtin_cpu_init();
+            if (!__builtin_cpu_supports("sse2")) {
+                return false;
+            }
+            nearest_kernel = &NearestSSE2;
+            scale2x_kernel = &Scale2xSSE2;
+            scale3x_kernel = &Scale3xSSE2;
+            xbr_lite_kernel = &XBRLite2xSSE2;
+            break;
+#endif
+        default:
+            return false;
+    }
+
+    return FilterNTSCKernelsSelect(kernel_set);
+}
+
+FilterKernel FilterGetKernel(const enum FilterKind kind, const uint8_t pass_scale) {
+    switch (kind) {
+        case FILTER_NEAREST:
+            return nearest_kernel;
+        case FILTER_SCALEX:
+            return (pass_scale == 3) ? scale3x_kernel : scale2x_kernel;
+        case FILTER_XBR_LITE:
+            return xbr_lite_kernel;
+        case FILTER_NTSC:
+            return FilterNTSCGetKernel();
+        default:
+            return NULL;
+    }
+}
\ No newline at end of file
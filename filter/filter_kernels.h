@@ -0,0 +1,27 @@
+#ifndef FILTER_KERNELS_H
+#define FILTER_KERNELS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "filter.h"
+
+
+typedef void (*FilterKernel)(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end);
+
+enum FilterKernelSet {
+    FILTER_KERNELS_SCALAR,
+    FILTER_KERNELS_SSE2,
+    FILTER_KERNELS_AVX,     // ntsc only, the other filters use their sse2 kernels
+};
+
+
+// picks the widest kernels the cpu supports, safe to call more than once
+void FilterKernelsInit(void);
+// forces one set of kernels instead of the widest (so they can be checked against each other), false when the cpu doesn't support it
+bool FilterKernelsSelect(const enum FilterKernelSet kernel_set);
+
+// kernel of a single pass, the 4x scalex and xbr filters are 2 passes of the 2x kernel
+FilterKernel FilterGetKernel(const enum FilterKind kind, const uint8_t pass_scale);
+
+#endif
\ No newline at end of file
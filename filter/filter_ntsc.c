@@ -0,0 +1,312 @@
+#include <math.h>
+#include <string.h>
+
+#include "filter_ntsc.h"
+#include "palette.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILTER_X86
+#endif
+
+
+#define NTSC_PI 3.14159265358979323846f
+
+// one scanline worth of blocks with an empty one on both sides, so every output reads 3 without bounds checks
+#define MAX_BLOCKS (FILTER_NTSC_BLOCKS_PER_PIXEL * FILTER_NTSC_MAX_WIDTH + 2)
+
+
+static FilterKernel ntsc_kernel = NULL;
+
+
+static inline float Determinant(const float matrix[3][3]) {
+    return matrix[0][0] * (matrix[1][1] * matrix[2][2] - matrix[1][2] * matrix[2][1])
+         - matrix[0][1] * (matrix[1][0] * matrix[2][2] - matrix[1][2] * matrix[2][0])
+         + matrix[0][2] * (matrix[1][0] * matrix[2][1] - matrix[1][1] * matrix[2][0]);
+}
+
+// solves the fcc yiq to rgb matrix backwards (cramer's rule), for the colors of a loaded palette
+static void RGBToYIQ(const float rgb[3], float yiq[3]) {
+    const float matrix[3][3] = {
+        {1.0f, PALETTE_I_TO_RED, PALETTE_Q_TO_RED},
+        {1.0f, PALETTE_I_TO_GREEN, PALETTE_Q_TO_GREEN},
+        {1.0f, PALETTE_I_TO_BLUE, PALETTE_Q_TO_BLUE},
+    };
+    float determinant = Determinant(matrix);
+
+    for (uint8_t column = 0; column < 3; column++) {
+        float replaced[3][3];
+        memcpy(replaced, matrix, sizeof(replaced));
+        for (uint8_t row = 0; row < 3; row++) {
+            replaced[row][column] = rgb[row];
+        }
+        yiq[column] = Determinant(replaced) / determinant;
+    }
+}
+
+// moves the blocks of every palette index so a flat area of it decodes to the loaded color,
+// the artifacts at the edges between colors still come from the signal
+static void MatchPalette(struct FilterNTSC* ntsc, const struct Palette* palette, const float gamma) {
+    for (uint16_t palette_index = 0; palette_index < PALETTE_INDEX_COUNT; palette_index++) {
+        uint32_t rgba = palette->colors_rgba[palette_index];
+        float rgb[3];
+        for (uint8_t channel = 0; channel < 3; channel++) {
+            // aims at the middle of the gamma table step, the decoder truncates
+            uint8_t value = (rgba >> (24 - 8 * channel)) & 0xFF;
+            rgb[channel] = powf(value / 255.0f, 1.0f / gamma) + 0.5f / (FILTER_NTSC_GAMMA_SIZE - 1);
+        }
+        float target[3];
+        RGBToYIQ(rgb, target);
+
+        // a flat area sums 3 blocks in a row (a whole subcarrier cycle): both of phase 0 and the first of phase 2,
+        // so moving every block by a third of the difference moves the flat color onto the target
+        float* tables[3] = {&ntsc->y[palette_index][0][0], &ntsc->i[palette_index][0][0], &ntsc->q[palette_index][0][0]};
+        for (uint8_t component = 0; component < 3; component++) {
+            float* table = tables[component];
+            float flat = table[0 * FILTER_NTSC_BLOCKS_PER_PIXEL + 0] + table[0 * FILTER_NTSC_BLOCKS_PER_PIXEL + 1] + table[2 * FILTER_NTSC_BLOCKS_PER_PIXEL + 0];
+            float shift = (target[component] - flat) / 3.0f;
+            for (uint8_t block = 0; block < FILTER_NTSC_PIXEL_PHASES * FILTER_NTSC_BLOCKS_PER_PIXEL; block++) {
+                table[block] += shift;
+            }
+        }
+    }
+}
+
+
+void FilterNTSCInit(struct FilterNTSC* ntsc, const struct PaletteParameters* parameters, const struct Palette* palette) {
+    float hue = PALETTE_HUE_TWEAK + parameters->hue / PALETTE_DEGREES_PER_PHASE;
+
+    for (uint16_t palette_index = 0; palette_index < PALETTE_INDEX_COUNT; palette_index++) {
+        for (uint8_t pixel_phase = 0; pixel_phase < FILTER_NTSC_PIXEL_PHASES; pixel_phase++) {
+            for (uint8_t block = 0; block < FILTER_NTSC_BLOCKS_PER_PIXEL; block++) {
+                float y = 0.0f;
+                float i = 0.0f;
+                float q = 0.0f;
+
+                for (uint8_t sample = 0; sample < FILTER_NTSC_SAMPLES_PER_BLOCK; sample++) {
+                    uint8_t phase = (pixel_phase * FILTER_NTSC_SAMPLES_PER_BLOCK + block * FILTER_NTSC_SAMPLES_PER_BLOCK + sample) % FILTER_NTSC_SAMPLES_PER_CYCLE;
+                    float signal = PaletteSignal(palette_index, phase) / FILTER_NTSC_SAMPLES_PER_CYCLE;
+
+                    y += signal;
+                    i += signal * cosf(NTSC_PI * (phase + hue) / 6.0f);
+                    q += signal * sinf(NTSC_PI * (phase + hue) / 6.0f);
+                }
+
+                ntsc->y[palette_index][pixel_phase][block] = y;
+                ntsc->i[palette_index][pixel_phase][block] = i * parameters->saturation;
+                ntsc->q[palette_index][pixel_phase][block] = q * parameters->saturation;
+            }
+        }
+    }
+
+    if (palette != NULL) {
+        MatchPalette(ntsc, palette, parameters->gamma);
+    }
+
+    for (uint16_t i = 0; i < FILTER_NTSC_GAMMA_SIZE; i++) {
+        ntsc->gamma[i] = (uint8_t)(255.0f * powf((float)i / (FILTER_NTSC_GAMMA_SIZE - 1), parameters->gamma) + 0.5f);
+    }
+
+    ntsc->frame_phase = 0;
+}
+
+void FilterNTSCNextFrame(struct FilterNTSC* ntsc) {
+    ntsc->frame_phase = (ntsc->frame_phase + FILTER_NTSC_SCANLINE_PHASE_STEP) % (2 * FILTER_NTSC_SCANLINE_PHASE_STEP);
+}
+
+
+// the y, i and q blocks of one scanline, index 0 and the last one stay empty (black)
+struct Blocks {
+    float y[MAX_BLOCKS];
+    float i[MAX_BLOCKS];
+    float q[MAX_BLOCKS];
+};
+
+static void FillBlocks(const struct FilterPass* pass, const uint16_t y, struct Blocks* blocks) {
+    const struct FilterNTSC* ntsc = pass->ntsc;
+    const uint16_t* palette_indices = &pass->palette_indices[y * pass->source_width];
+
+    // pixels are 8 samples, so the pixel phase (in units of 4 samples) goes 0, 2, 1, 0, 2, 1...
+    uint8_t pixel_phase = ((ntsc->frame_phase + y * FILTER_NTSC_SCANLINE_PHASE_STEP) % FILTER_NTSC_SAMPLES_PER_CYCLE) / FILTER_NTSC_SAMPLES_PER_BLOCK;
+
+    for (uint16_t x = 0; x < pass->source_width; x++) {
+        uint16_t palette_index = palette_indices[x] % PALETTE_INDEX_COUNT;
+        uint16_t block = 1 + x * FILTER_NTSC_BLOCKS_PER_PIXEL;
+
+        blocks->y[block + 0] = ntsc->y[palette_index][pixel_phase][0];
+        blocks->y[block + 1] = ntsc->y[palette_index][pixel_phase][1];
+        blocks->i[block + 0] = ntsc->i[palette_index][pixel_phase][0];
+        blocks->i[block + 1] = ntsc->i[palette_index][pixel_phase][1];
+        blocks->q[block + 0] = ntsc->q[palette_index][pixel_phase][0];
+        blocks->q[block + 1] = ntsc->q[palette_index][pixel_phase][1];
+
+        pixel_phase = (pixel_phase + 2) % FILTER_NTSC_PIXEL_PHASES;
+    }
+
+    uint16_t last = 1 + pass->source_width * FILTER_NTSC_BLOCKS_PER_PIXEL;
+    blocks->y[0] = blocks->i[0] = blocks->q[0] = 0.0f;
+    blocks->y[last] = blocks->i[last] = blocks->q[last] = 0.0f;
+}
+
+static inline uint32_t PackPixel(const struct FilterPass* pass, const int32_t red, const int32_t green, const int32_t blue) {
+    const uint8_t* gamma = pass->ntsc->gamma;
+    return ((uint32_t)gamma[red] << pass->pixel_format.red_shift)
+         | ((uint32_t)gamma[green] << pass->pixel_format.green_shift)
+         | ((uint32_t)gamma[blue] << pass->pixel_format.blue_shift)
+         | pass->pixel_format.alpha_mask;
+}
+
+static inline int32_t GammaIndex(float value) {
+    value = (value < 0.0f) ? 0.0f : ((value > 1.0f) ? 1.0f : value);
+    return (int32_t)(value * (FILTER_NTSC_GAMMA_SIZE - 1));
+}
+
+// decodes the outputs from first to the end of the row (the simd kernels leave the remainder for this),
+// the chroma is summed first like the simd kernels do so they round the same
+static void DecodeScalar(const struct FilterPass* pass, const struct Blocks* blocks, uint16_t first, uint32_t* out) {
+    uint16_t width = pass->source_width * FILTER_NTSC_BLOCKS_PER_PIXEL;
+
+    for (uint16_t x = first; x < width; x++) {
+        float y = blocks->y[x] + blocks->y[x + 1] + blocks->y[x + 2];
+        float i = blocks->i[x] + blocks->i[x + 1] + blocks->i[x + 2];
+        float q = blocks->q[x] + blocks->q[x + 1] + blocks->q[x + 2];
+
+        out[x] = PackPixel(
+            pass,
+            GammaIndex(y + (PALETTE_I_TO_RED * i + PALETTE_Q_TO_RED * q)),
+            GammaIndex(y + (PALETTE_I_TO_GREEN * i + PALETTE_Q_TO_GREEN * q)),
+            GammaIndex(y + (PALETTE_I_TO_BLUE * i + PALETTE_Q_TO_BLUE * q))
+        );
+    }
+}
+
+static inline void RepeatRow(const struct FilterPass* pass, const uint16_t y) {
+    uint8_t* row = pass->destination + (size_t)(2 * y) * pass->destination_pitch;
+    memcpy(row + pass->destination_pitch, row, (size_t)pass->source_width * FILTER_NTSC_BLOCKS_PER_PIXEL * sizeof(uint32_t));
+}
+
+static void NTSCScalar(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end) {
+    struct Blocks blocks;
+
+    for (uint16_t y = y_start; y < y_end; y++) {
+        FillBlocks(pass, y, &blocks);
+        DecodeScalar(pass, &blocks, 0, (uint32_t*)(pass->destination + (size_t)(2 * y) * pass->destination_pitch));
+        RepeatRow(pass, y);
+    }
+}
+
+
+#ifdef FILTER_X86
+
+__attribute__((target("sse2")))
+static void NTSCSSE2(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end) {
+    struct Blocks blocks;
+    uint16_t width = pass->source_width * FILTER_NTSC_BLOCKS_PER_PIXEL;
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 gamma_scale = _mm_set1_ps(FILTER_NTSC_GAMMA_SIZE - 1);
+
+    for (uint16_t y = y_start; y < y_end; y++) {
+        FillBlocks(pass, y, &blocks);
+        uint32_t* out = (uint32_t*)(pass->destination + (size_t)(2 * y) * pass->destination_pitch);
+
+        uint16_t x = 0;
+        for (; (x + 4) <= width; x += 4) {
+            __m128 luma = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(&blocks.y[x]), _mm_loadu_ps(&blocks.y[x + 1])), _mm_loadu_ps(&blocks.y[x + 2]));
+            __m128 in_phase = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(&blocks.i[x]), _mm_loadu_ps(&blocks.i[x + 1])), _mm_loadu_ps(&blocks.i[x + 2]));
+            __m128 quadrature = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(&blocks.q[x]), _mm_loadu_ps(&blocks.q[x + 1])), _mm_loadu_ps(&blocks.q[x + 2]));
+
+            __m128 red = _mm_add_ps(luma, _mm_add_ps(_mm_mul_ps(in_phase, _mm_set1_ps(PALETTE_I_TO_RED)), _mm_mul_ps(quadrature, _mm_set1_ps(PALETTE_Q_TO_RED))));
+            __m128 green = _mm_add_ps(luma, _mm_add_ps(_mm_mul_ps(in_phase, _mm_set1_ps(PALETTE_I_TO_GREEN)), _mm_mul_ps(quadrature, _mm_set1_ps(PALETTE_Q_TO_GREEN))));
+            __m128 blue = _mm_add_ps(luma, _mm_add_ps(_mm_mul_ps(in_phase, _mm_set1_ps(PALETTE_I_TO_BLUE)), _mm_mul_ps(quadrature, _mm_set1_ps(PALETTE_Q_TO_BLUE))));
+
+            int32_t red_index[4];
+            int32_t green_index[4];
+            int32_t blue_index[4];
+            _mm_storeu_si128((__m128i*)red_index, _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(red, zero), one), gamma_scale)));
+            _mm_storeu_si128((__m128i*)green_index, _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(green, zero), one), gamma_scale)));
+            _mm_storeu_si128((__m128i*)blue_index, _mm_cvttps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(blue, zero), one), gamma_scale)));
+
+            for (uint8_t j = 0; j < 4; j++) {
+                out[x + j] = PackPixel(pass, red_index[j], green_index[j], blue_index[j]);
+            }
+        }
+
+        DecodeScalar(pass, &blocks, x, out);
+        RepeatRow(pass, y);
+    }
+}
+
+__attribute__((target("avx")))
+static void NTSCAVX(const struct FilterPass* pass, const uint16_t y_start, const uint16_t y_end) {
+    struct Blocks blocks;
+    uint16_t width = pass->source_width * FILTER_NTSC_BLOCKS_PER_PIXEL;
+
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 gamma_scale = _mm256_set1_ps(FILTER_NTSC_GAMMA_SIZE - 1);
+
+    for (uint16_t y = y_start; y < y_end; y++) {
+        FillBlocks(pass, y, &blocks);
+        uint32_t* out = (uint32_t*)(pass->destination + (size_t)(2 * y) * pass->destination_pitch);
+
+        uint16_t x = 0;
+        for (; (x + 8) <= width; x += 8) {
+            __m256 luma = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(&blocks.y[x]), _mm256_loadu_ps(&blocks.y[x + 1])), _mm256_loadu_ps(&blocks.y[x + 2]));
+            __m256 in_phase = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(&blocks.i[x]), _mm256_loadu_ps(&blocks.i[x + 1])), _mm256_loadu_ps(&blocks.i[x + 2]));
+            __m256 quadrature = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(&blocks.q[x]), _mm256_loadu_ps(&blocks.q[x + 1])), _mm256_loadu_ps(&blocks.q[x + 2]));
+
+            __m256 red = _mm256_add_ps(luma, _mm256_add_ps(_mm256_mul_ps(in_phase, _mm256_set1_ps(PALETTE_I_TO_RED)), _mm256_mul_ps(quadrature, _mm256_set1_ps(PALETTE_Q_TO_RED))));
+            __m256 green = _mm256_add_ps(luma, _mm256_add_ps(_mm256_mul_ps(in_phase, _mm256_set1_ps(PALETTE_I_TO_GREEN)), _mm256_mul_ps(quadrature, _mm256_set1_ps(PALETTE_Q_TO_GREEN))));
+            __m256 blue = _mm256_add_ps(luma, _mm256_add_ps(_mm256_mul_ps(in_phase, _mm256_set1_ps(PALETTE_I_TO_BLUE)), _mm256_mul_ps(quadrature, _mm256_set1_ps(PALETTE_Q_TO_BLUE))));
+
+            int32_t red_index[8];
+            int32_t green_index[8];
+            int32_t blue_index[8];
+            _mm256_storeu_si256((__m256i*)red_index, _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(red, zero), one), gamma_scale)));
+            _mm256_storeu_si256((__m256i*)green_index, _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(green, zero), one), gamma_scale)));
+            _mm256_storeu_si256((__m256i*)blue_index, _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(blue, zero), one), gamma_scale)));
+
+            for (uint8_t j = 0; j < 8; j++) {
+                out[x + j] = PackPixel(pass, red_index[j], green_index[j], blue_index[j]);
+            }
+        }
+
+        DecodeScalar(pass, &blocks, x, out);
+        RepeatRow(pass, y);
+    }
+}
+
+#endif
+
+
+bool FilterNTSCKernelsSelect(const enum FilterKernelSet kernel_set) {
+    switch (kernel_set) {
+        case FILTER_KERNELS_SCALAR:
+            ntsc_kernel = &NTSCScalar;
+            return true;
+#ifdef FILTER_X86
+        case FILTER_KERNELS_SSE2:
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("sse2")) {
+                ntsc_kernel = &NTSCSSE2;
+                return true;
+            }
+            return false;
+        case FILTER_KERNELS_AVX:
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx")) {
+                ntsc_kernel = &NTSCAVX;
+                return true;
+            }
+            return false;
+#endif
+        default:
+            return false;
+    }
+}
+
+FilterKernel FilterNTSCGetKernel(void) {
+    return ntsc_kernel;
+}
\ No newline at end of file
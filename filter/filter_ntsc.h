@@ -0,0 +1,52 @@
+#ifndef FILTER_NTSC_H
+#define FILTER_NTSC_H
+
+#include <stdint.h>
+
+#include "filter.h"
+#include "filter_kernels.h"
+#include "palette.h"
+
+
+// the color subcarrier is 12 samples long and every pixel is 8 samples, so a pixel starts at phase 0, 4 or 8
+#define FILTER_NTSC_SAMPLES_PER_PIXEL 8
+#define FILTER_NTSC_SAMPLES_PER_CYCLE 12
+#define FILTER_NTSC_PIXEL_PHASES 3
+// every scanline (341 dots) starts 4 samples later than the previous one
+#define FILTER_NTSC_SCANLINE_PHASE_STEP 4
+
+// output pixels are 4 samples wide (2x horizontal resolution) and decoded from the 12 samples around them,
+// which are exactly 3 blocks of 4 samples, so the tables hold the block sums instead of the samples themselves
+#define FILTER_NTSC_SAMPLES_PER_BLOCK 4
+#define FILTER_NTSC_BLOCKS_PER_PIXEL 2
+
+#define FILTER_NTSC_GAMMA_SIZE 1024
+
+#define FILTER_NTSC_MAX_WIDTH 256
+
+
+struct FilterNTSC {
+    // y, i and q contributions of the 2 blocks of a pixel for every starting phase, already divided by the window length
+    float y[PALETTE_INDEX_COUNT][FILTER_NTSC_PIXEL_PHASES][FILTER_NTSC_BLOCKS_PER_PIXEL];
+    float i[PALETTE_INDEX_COUNT][FILTER_NTSC_PIXEL_PHASES][FILTER_NTSC_BLOCKS_PER_PIXEL];
+    float q[PALETTE_INDEX_COUNT][FILTER_NTSC_PIXEL_PHASES][FILTER_NTSC_BLOCKS_PER_PIXEL];
+
+    // linear 0 - 1 (in FILTER_NTSC_GAMMA_SIZE steps) to the 8 bit output
+    uint8_t gamma[FILTER_NTSC_GAMMA_SIZE];
+
+    // the odd frames are one dot shorter, so the phase of the first pixel alternates between frames
+    uint8_t frame_phase;
+};
+
+
+// the signal is decoded with the hue, saturation and gamma of the palette engine, with a palette (loaded from a file)
+// the flat colors are moved onto it too, NULL keeps the decoded ones
+void FilterNTSCInit(struct FilterNTSC* ntsc, const struct PaletteParameters* parameters, const struct Palette* palette);
+// called once per frame before it's filtered
+void FilterNTSCNextFrame(struct FilterNTSC* ntsc);
+
+// called by FilterKernelsSelect
+bool FilterNTSCKernelsSelect(const enum FilterKernelSet kernel_set);
+FilterKernel FilterNTSCGetKernel(void);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,23 @@
+#include "logger.h"
+
+
+static void (*logger_fatal_callback)(void*) = NULL;
+static void* logger_fatal_callback_data = NULL;
+
+
+void LoggerSetFatalCallback(void (*fatal_callback)(void*), void* fatal_callback_data) {
+    logger_fatal_callback = fatal_callback;
+    logger_fatal_callback_data = fatal_callback_data;
+}
+
+void LoggerExit(void) {
+    void (*fatal_callback)(void*) = logger_fatal_callback;
+    logger_fatal_callback = NULL;   // an error inside the callback shouldn't call it again
+
+    if (fatal_callback != NULL) {
+        fatal_callback(logger_fatal_callback_data);
+        fflush(stdout);
+    }
+
+    exit(1);
+}
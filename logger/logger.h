@@ -17,6 +17,14 @@
 #define IGNORE_MESSAGE_PPU        0
 #define IGNORE_MESSAGE_PPU_BUS    0
 #define IGNORE_MESSAGE_EMULATOR   0
+#define IGNORE_MESSAGE_PROFILER   0
+#define IGNORE_MESSAGE_DEBUGGER   0
+#define IGNORE_MESSAGE_APU        0
+#define IGNORE_MESSAGE_TRIPLE_BUFFER 0
+#define IGNORE_MESSAGE_FILTER     0
+#define IGNORE_MESSAGE_PALETTE    0
+#define IGNORE_MESSAGE_CAPTURE    0
+#define IGNORE_MESSAGE_SCREENSHOT 0
 #define IGNORE_MESSAGE_MAIN       0
 
 enum LogLevel {
@@ -35,15 +43,28 @@ enum LogSource {
     PPU,
     PPU_BUS,
     EMULATOR,
+    SCREENSHOT,
+    CAPTURE,
+    PALETTE,
+    FILTER,
+    TRIPLE_BUFFER,
+    APU,
+    DEBUGGER,
+    PROFILER,
     MAIN,
 };
 
+// the fatal callback runs right before the process exits on an error (or on a warning with EXIT_ON_WARNING)
+// so state that is only kept in memory (eg. the cpu trace) can still be dumped
+void LoggerSetFatalCallback(void (*fatal_callback)(void*), void* fatal_callback_data);
+__attribute__((noreturn)) void LoggerExit(void);
+
 #define LOG(log_level, log_source, format, ...) do { \
     switch (log_source) { \
         case CARTRIDGE: \
             if (IGNORE_MESSAGE_CARTRIDGE) { \
                 if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
-                    exit(1); \
+                    LoggerExit(); \
                 } \
                 continue; \
             } else { \
@@ -53,7 +74,7 @@ enum LogSource {
         case MAPPER: \
             if (IGNORE_MESSAGE_MAPPER) { \
                 if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
-                    exit(1); \
+                    LoggerExit(); \
                 } \
                 continue; \
             } else { \
@@ -63,7 +84,7 @@ enum LogSource {
         case CONTROLLER: \
             if (IGNORE_MESSAGE_CONTROLLER) { \
                 if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
-                    exit(1); \
+                    LoggerExit(); \
                 } \
                 continue; \
             } else { \
@@ -73,7 +94,7 @@ enum LogSource {
         case CPU: \
             if (IGNORE_MESSAGE_CPU) { \
                 if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
-                    exit(1); \
+                    LoggerExit(); \
                 } \
                 continue; \
             } else { \
@@ -83,7 +104,7 @@ enum LogSource {
         case CPU_BUS: \
             if (IGNORE_MESSAGE_CPU_BUS) { \
                 if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
-                    exit(1); \
+                    LoggerExit(); \
                 } \
                 continue; \
             } else { \
@@ -93,7 +114,7 @@ enum LogSource {
         case PPU: \
             if (IGNORE_MESSAGE_PPU) { \
                 if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
-                    exit(1); \
+                    LoggerExit(); \
                 } \
                 continue; \
             } else { \
@@ -103,7 +124,7 @@ enum LogSource {
         case PPU_BUS: \
             if (IGNORE_MESSAGE_PPU_BUS) { \
                 if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
-                    exit(1); \
+                    LoggerExit(); \
                 } \
                 continue; \
             } else { \
@@ -113,17 +134,97 @@ enum LogSource {
         case EMULATOR: \
             if (IGNORE_MESSAGE_EMULATOR) { \
                 if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
-                    exit(1); \
+                    LoggerExit(); \
                 } \
                 continue; \
             } else { \
                 printf("EMULATOR "); \
             } \
             break; \
+        case PROFILER: \
+            if (IGNORE_MESSAGE_PROFILER) { \
+                if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
+                    LoggerExit(); \
+                } \
+                continue; \
+            } else { \
+                printf("PROFILER "); \
+            } \
+            break; \
+        case DEBUGGER: \
+            if (IGNORE_MESSAGE_DEBUGGER) { \
+                if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
+                    LoggerExit(); \
+                } \
+                continue; \
+            } else { \
+                printf("DEBUGGER "); \
+            } \
+            break; \
+        case APU: \
+            if (IGNORE_MESSAGE_APU) { \
+                if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
+                    LoggerExit(); \
+                } \
+                continue; \
+            } else { \
+                printf("APU "); \
+            } \
+            break; \
+        case TRIPLE_BUFFER: \
+            if (IGNORE_MESSAGE_TRIPLE_BUFFER) { \
+                if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
+                    LoggerExit(); \
+                } \
+                continue; \
+            } else { \
+                printf("TRIPLE_BUFFER "); \
+            } \
+            break; \
+        case FILTER: \
+            if (IGNORE_MESSAGE_FILTER) { \
+                if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
+                    LoggerExit(); \
+                } \
+                continue; \
+            } else { \
+                printf("FILTER "); \
+            } \
+            break; \
+        case PALETTE: \
+            if (IGNORE_MESSAGE_PALETTE) { \
+                if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
+                    LoggerExit(); \
+                } \
+                continue; \
+            } else { \
+                printf("PALETTE "); \
+            } \
+            break; \
+        case CAPTURE: \
+            if (IGNORE_MESSAGE_CAPTURE) { \
+                if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
+                    LoggerExit(); \
+                } \
+                continue; \
+            } else { \
+                printf("CAPTURE "); \
+            } \
+            break; \
+        case SCREENSHOT: \
+            if (IGNORE_MESSAGE_SCREENSHOT) { \
+                if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
+                    LoggerExit(); \
+                } \
+                continue; \
+            } else { \
+                printf("SCREENSHOT "); \
+            } \
+            break; \
         case MAIN: \
             if (IGNORE_MESSAGE_MAIN) { \
                 if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
-                    exit(1); \
+                    LoggerExit(); \
                 } \
                 continue; \
             } else { \
@@ -152,7 +253,7 @@ enum LogSource {
     fflush(stdout); \
 \
     if ((log_level == WARNING && EXIT_ON_WARNING) || log_level == ERROR) { \
-        exit(1); \
+        LoggerExit(); \
     } \
 } while (0)
 
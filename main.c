@@ -1,14 +1,41 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
 
 #include "emulator.h"
+#include "ppu_composite.h"
 #include "logger.h"
+#include "triple_buffer.h"
+#include "filter.h"
+#include "capture.h"
+#include "screenshot.h"
 
 
 #define FONT_TEXTURE_CHAR_SIZE 8
 #define FONT_TEXTURE_CHARS_WIDTH 16
 #define FONT_TEXTURE_CHARS_HEIGHT 16
+#define FONT_GLYPH_COUNT (FONT_TEXTURE_CHARS_WIDTH * FONT_TEXTURE_CHARS_HEIGHT)
+#define FONT_GLYPH_PIXELS (FONT_TEXTURE_CHAR_SIZE * FONT_TEXTURE_CHAR_SIZE)
+
+// a debug text cell that can't match any character and color
+#define DEBUG_TEXT_CELL_EMPTY 0xFFFF
+
+// ~10ms at 48kHz, the latency of the device on top of what is queued in the ring
+#define AUDIO_DEVICE_BUFFER_SAMPLES 512
+// in case the device stops calling back (unplugged etc.) the emulation thread still wakes up
+#define AUDIO_WAIT_TIMEOUT_MS 100
+// the sdl thread handles events at least this often even when no frames are coming (paused)
+#define PRESENT_WAIT_TIMEOUT_MS 10
+
+// requests from the sdl thread, handled by the emulation thread between frames
+#define EMULATION_COMMAND_TOGGLE_PAUSE          0b00000001
+#define EMULATION_COMMAND_RESET                 0b00000010
+#define EMULATION_COMMAND_CLEAR_DEBUGGER_POINTS 0b00000100
+#define EMULATION_COMMAND_DUMP_TRACE            0b00001000
+#define EMULATION_COMMAND_TOGGLE_TRACE          0b00010000
 
 
 
@@ -20,6 +47,23 @@
 #define MAX_3(a, b, c) MAX_2(a, MAX_2(b, c))
 #define MAX_4(a, b, c, d) MAX_2(a, MAX_3(b, c, d))
 
+enum DebugTextColor {
+    DEBUG_TEXT_DISASSEMBLY,
+    DEBUG_TEXT_DISASSEMBLY_ACTIVE,
+    DEBUG_TEXT_ZERO_PAGE,
+    DEBUG_TEXT_REGISTERS,
+    DEBUG_TEXT_NAMETABLE,
+    DEBUG_TEXT_COLOR_COUNT,
+};
+
+static const uint32_t debug_text_colors_rgba[DEBUG_TEXT_COLOR_COUNT] = {
+    [DEBUG_TEXT_DISASSEMBLY] = 0xFF0000FF,
+    [DEBUG_TEXT_DISASSEMBLY_ACTIVE] = 0x0000FFFF,
+    [DEBUG_TEXT_ZERO_PAGE] = 0x00FF00FF,
+    [DEBUG_TEXT_REGISTERS] = 0xFF00FFFF,
+    [DEBUG_TEXT_NAMETABLE] = 0xFFFF00FF,
+};
+
 struct DebugLayout {
     uint8_t zero_page_offset_x;
     uint8_t zero_page_offset_y;
@@ -39,9 +83,8 @@ struct DebugLayout {
     uint8_t nametable_offset_x;
     uint8_t nametable_offset_y;
 
-    uint8_t disassembly_active_row_y;
-    uint8_t selected_palette;
-    uint8_t selected_nametable;
+    uint8_t nametable_image_offset_x;
+    uint8_t nametable_image_offset_y;
 
     uint8_t width;
     uint8_t height;
@@ -52,32 +95,119 @@ struct MainWindow {
     SDL_Renderer* renderer; 
     SDL_Texture* texture;
 
-    uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT];
+    // palette indices mapped to the pixel format of the texture
+    uint32_t native_palette[PALETTE_INDEX_COUNT];
+
+    // with an upscaling filter the frame is converted into filter_source first and the filter writes into the texture
+    struct Filter* filter;
+    uint32_t* filter_source;
+    uint8_t texture_scale;
+};
+
+// shared with the audio callback
+struct AudioOutput {
+    struct AudioRing* ring;
+    // posted after every callback, the main loop sleeps on it while the emulation is paced by the audio device
+    SDL_sem* consumed;
+    int16_t last_sample;
 };
 
 struct DebugWindow {
     SDL_Window* window; 
     SDL_Renderer* renderer; 
     SDL_Texture* texture;
-    SDL_Texture* font_texture;
+
+    // the text is drawn on the cpu from glyphs already colored for every region and uploaded as one texture,
+    // a cell is only drawn again when its character or color changed and only the changed rows are uploaded
+    SDL_Texture* text_texture;
+    uint32_t* glyphs;       // [DEBUG_TEXT_COLOR_COUNT][FONT_GLYPH_COUNT][FONT_GLYPH_PIXELS] in the format of the text texture
+    uint32_t* text_pixels;
+    uint16_t* text_cells;   // character | (color << 8) of every cell of the layout
+    uint16_t text_dirty_row_start;
+    uint16_t text_dirty_row_end;
+
+    // both pattern tables side by side, streamed and then copied onto the render target
+    SDL_Texture* pattern_tables_texture;
+    SDL_Texture* nametable_image_texture;
+    // the images are only converted again when the snapshot has a newer one
+    uint32_t pattern_tables_generation;
+    uint32_t nametable_image_generation;
+
+    // the swatches are drawn straight from the rgba palette
+    const struct Palette* palette;
+    uint32_t native_palette[PALETTE_COLOR_COUNT];
 
     struct DebugLayout layout;
+};
 
+// what the debug window shows, made by the emulation thread and handed over through a triple buffer
+struct DebugSnapshot {
+    // the generations tell which parts are already up to date in this buffer
     char disassembly_buffer[DISASSEMBLY_BUFFER_HEIGHT][DISASSEMBLY_BUFFER_WIDTH];
+    uint8_t disassembly_active_row_y;
+    uint32_t disassembly_generation;
+
     char zero_page_buffer[ZERO_PAGE_BYTE_BUFFER_HEIGHT][ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH];
+    uint32_t zero_page_generation;
+
     char registers_buffer[REGISTERS_BUFFER_HEIGHT][REGISTER_WIDTH]; 
+    uint32_t registers_generation;
 
     uint8_t palette_buffer[PALETTE_BUFFER_HEIGHT][PALETTE_BUFFER_WIDTH];
 
-    uint32_t pattern_tables_pixels_buffer[2][PATTERN_TABLE_WIDTH * PATTERN_TABLE_HEIGHT];
+    uint8_t pattern_tables_buffer[2][PATTERN_TABLE_WIDTH * PATTERN_TABLE_HEIGHT];
+    uint32_t pattern_tables_generation;
 
     char nametable_buffer[NAMETABLE_BYTE_BUFFER_HEIGHT][NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH];
+    uint32_t nametable_generation;
+
+    uint8_t nametable_image_buffer[NAMETABLE_IMAGE_HEIGHT][NAMETABLE_IMAGE_WIDTH];
+    uint32_t nametable_image_generation;
+};
+
+// the emulator itself is only touched by the emulation thread, the sdl thread talks to it through these
+struct EmulationShared {
+    struct Emulator* emulator;
+    struct CPUDisassemblyCache* disassembly_cache;
+    struct PPUDebugViewCache* debug_view_cache;
+    struct AudioOutput* audio_output;
+    bool audio_paced;
+
+    // for reloading on reset
+    const char* rom_filename;
+    bool tv_system_forced;
+    enum TVSystem forced_tv_system;
+
+    // finished frames (NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT palette indices) and debug snapshots
+    struct TripleBuffer frames;
+    // every finished frame is also queued here when capturing (NULL otherwise)
+    struct Capture* capture;
+    struct TripleBuffer debug_snapshots;
+    // posted after every emulation loop, the sdl thread sleeps on it
+    SDL_sem* frame_ready;
+
+    _Atomic uint32_t commands;
+    _Atomic bool debug_shown;
+    _Atomic uint8_t selected_palette;
+    _Atomic uint8_t selected_nametable;
+    // set by the emulation thread when a breakpoint/watchpoint stopped it, so the sdl thread opens the debug window
+    _Atomic bool debugger_hit;
+    _Atomic bool quit;
 };
 
 
 void Clean(struct MainWindow main_window, struct DebugWindow debug_window) {
-    if (debug_window.font_texture != NULL) {
-        SDL_DestroyTexture(debug_window.font_texture);
+    if (debug_window.text_texture != NULL) {
+        SDL_DestroyTexture(debug_window.text_texture);
+    }
+    free(debug_window.glyphs);
+    free(debug_window.text_pixels);
+    free(debug_window.text_cells);
+    if (debug_window.pattern_tables_texture != NULL) {
+        SDL_DestroyTexture(debug_window.pattern_tables_texture);
+    }
+    if (debug_window.nametable_image_texture != NULL) {
+        SDL_DestroyTexture(debug_window.nametable_image_texture);
     }
     if (debug_window.texture != NULL) {
         SDL_DestroyTexture(debug_window.texture);
@@ -99,6 +229,134 @@ void Clean(struct MainWindow main_window, struct DebugWindow debug_window) {
     }
 }
 
+// first 32 bit rgb format the renderer supports, the frames are converted into the locked texture memory directly
+// so picking one the renderer doesn't have to convert again on unlock saves another copy
+uint32_t NativeTextureFormat(SDL_Renderer* renderer) {
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0) {
+        for (uint32_t i = 0; i < info.num_texture_formats; i++) {
+            uint32_t format = info.texture_formats[i];
+            if (!SDL_ISPIXELFORMAT_FOURCC(format) && !SDL_ISPIXELFORMAT_INDEXED(format) && SDL_BYTESPERPIXEL(format) == 4) {
+                return format;
+            }
+        }
+    }
+
+    return SDL_PIXELFORMAT_RGBA8888;
+}
+
+void MapNativePalette(SDL_Texture* texture, const struct Palette* palette, uint32_t* native_palette, uint16_t palette_size) {
+    uint32_t format = SDL_PIXELFORMAT_RGBA8888;
+    SDL_QueryTexture(texture, &format, NULL, NULL, NULL);
+
+    SDL_PixelFormat* pixel_format = SDL_AllocFormat(format);
+    for (uint16_t i = 0; i < palette_size; i++) {
+        uint32_t rgba = palette->colors_rgba[i];
+        native_palette[i] = (pixel_format != NULL)
+            ? SDL_MapRGBA(pixel_format, (rgba >> 24) & 0xFF, (rgba >> 16) & 0xFF, (rgba >> 8) & 0xFF, rgba & 0xFF)
+            : rgba;
+    }
+    SDL_FreeFormat(pixel_format);
+}
+
+// the ntsc filter makes its own colors instead of using the palette, so it has to know where the channels go
+void SetFilterPixelFormat(struct Filter* filter, SDL_Texture* texture) {
+    uint32_t format = SDL_PIXELFORMAT_RGBA8888;
+    SDL_QueryTexture(texture, &format, NULL, NULL, NULL);
+
+    SDL_PixelFormat* pixel_format = SDL_AllocFormat(format);
+    if (pixel_format != NULL) {
+        FilterSetPixelFormat(filter, (struct FilterPixelFormat){
+            .red_shift = pixel_format->Rshift,
+            .green_shift = pixel_format->Gshift,
+            .blue_shift = pixel_format->Bshift,
+            .alpha_mask = pixel_format->Amask,
+        });
+    }
+    SDL_FreeFormat(pixel_format);
+}
+
+// expands the glyphs of the font into every text color in the format of the text texture, 
+// the font is white on black so a glyph pixel is just the color scaled by the font pixel
+bool LoadDebugFont(struct DebugWindow* debug_window, const char* filename) {
+    SDL_Surface* loaded = IMG_Load(filename);
+    if (loaded == NULL) {
+        return false;
+    }
+    SDL_Surface* font = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(loaded);
+    if (font == NULL) {
+        return false;
+    }
+    if (font->w < FONT_TEXTURE_CHARS_WIDTH * FONT_TEXTURE_CHAR_SIZE || font->h < FONT_TEXTURE_CHARS_HEIGHT * FONT_TEXTURE_CHAR_SIZE) {
+        SDL_FreeSurface(font);
+        return false;
+    }
+
+    size_t cell_count = (size_t)debug_window->layout.width * debug_window->layout.height;
+    debug_window->glyphs = (uint32_t*)malloc(DEBUG_TEXT_COLOR_COUNT * FONT_GLYPH_COUNT * FONT_GLYPH_PIXELS * sizeof(uint32_t));
+    debug_window->text_pixels = (uint32_t*)calloc(cell_count * FONT_GLYPH_PIXELS, sizeof(uint32_t));
+    debug_window->text_cells = (uint16_t*)malloc(cell_count * sizeof(uint16_t));
+    if (debug_window->glyphs == NULL || debug_window->text_pixels == NULL || debug_window->text_cells == NULL) {
+        SDL_FreeSurface(font);
+        return false;
+    }
+    for (size_t i = 0; i < cell_count; i++) {
+        debug_window->text_cells[i] = DEBUG_TEXT_CELL_EMPTY;
+    }
+    // the whole texture is uploaded once so the cells that are never drawn aren't left undefined
+    debug_window->text_dirty_row_start = 0;
+    debug_window->text_dirty_row_end = debug_window->layout.height;
+
+    uint32_t format = SDL_PIXELFORMAT_RGBA8888;
+    SDL_QueryTexture(debug_window->text_texture, &format, NULL, NULL, NULL);
+    SDL_PixelFormat* pixel_format = SDL_AllocFormat(format);
+    if (pixel_format == NULL) {
+        SDL_FreeSurface(font);
+        return false;
+    }
+
+    uint32_t black = SDL_MapRGBA(pixel_format, 0x00, 0x00, 0x00, 0xFF);
+    for (size_t i = 0; i < cell_count * FONT_GLYPH_PIXELS; i++) {
+        debug_window->text_pixels[i] = black;
+    }
+
+    for (uint8_t color = 0; color < DEBUG_TEXT_COLOR_COUNT; color++) {
+        uint32_t rgba = debug_text_colors_rgba[color];
+        uint8_t red = (rgba >> 24) & 0xFF;
+        uint8_t green = (rgba >> 16) & 0xFF;
+        uint8_t blue = (rgba >> 8) & 0xFF;
+
+        for (uint16_t c = 0; c < FONT_GLYPH_COUNT; c++) {
+            uint32_t* glyph = &debug_window->glyphs[((size_t)color * FONT_GLYPH_COUNT + c) * FONT_GLYPH_PIXELS];
+
+            for (uint8_t y = 0; y < FONT_TEXTURE_CHAR_SIZE; y++) {
+                const uint8_t* font_row = (const uint8_t*)font->pixels
+                                        + ((c / FONT_TEXTURE_CHARS_WIDTH) * FONT_TEXTURE_CHAR_SIZE + y) * font->pitch
+                                        + (c % FONT_TEXTURE_CHARS_WIDTH) * FONT_TEXTURE_CHAR_SIZE * 4;
+
+                for (uint8_t x = 0; x < FONT_TEXTURE_CHAR_SIZE; x++) {
+                    const uint8_t* font_pixel = &font_row[x * 4];
+                    // same as the color mod on a blended texture over black
+                    uint16_t alpha = font_pixel[3];
+                    glyph[y * FONT_TEXTURE_CHAR_SIZE + x] = SDL_MapRGBA(
+                        pixel_format,
+                        (uint8_t)((red * font_pixel[0] / 255) * alpha / 255),
+                        (uint8_t)((green * font_pixel[1] / 255) * alpha / 255),
+                        (uint8_t)((blue * font_pixel[2] / 255) * alpha / 255),
+                        0xFF
+                    );
+                }
+            }
+        }
+    }
+
+    SDL_FreeFormat(pixel_format);
+    SDL_FreeSurface(font);
+    return true;
+}
+
+
 void Init(struct MainWindow* main_window, struct DebugWindow* debug_window) {
     main_window->window = SDL_CreateWindow(
         "NES emulator",
@@ -125,16 +383,19 @@ void Init(struct MainWindow* main_window, struct DebugWindow* debug_window) {
     
     main_window->texture = SDL_CreateTexture(
         main_window->renderer, 
-        SDL_PIXELFORMAT_RGBA8888, 
+        NativeTextureFormat(main_window->renderer), 
         SDL_TEXTUREACCESS_STREAMING, 
-        NES_SCREEN_WIDTH,
-        NES_SCREEN_HEIGHT
+        NES_SCREEN_WIDTH * main_window->texture_scale,
+        NES_SCREEN_HEIGHT * main_window->texture_scale
     );
     if (main_window->texture == NULL) {
         Clean(*main_window, *debug_window);
         SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Texture creation] Error during the SDL initialization: %s", SDL_GetError());
 		exit(1);
     }
+    if (main_window->filter != NULL) {
+        SetFilterPixelFormat(main_window->filter, main_window->texture);
+    }
 
 
 
@@ -176,25 +437,93 @@ void Init(struct MainWindow* main_window, struct DebugWindow* debug_window) {
     }
 
     
-    debug_window->font_texture = IMG_LoadTexture(debug_window->renderer, "font.png");
-    if (debug_window->font_texture == NULL) {
+    debug_window->pattern_tables_texture = SDL_CreateTexture(
+        debug_window->renderer, 
+        NativeTextureFormat(debug_window->renderer), 
+        SDL_TEXTUREACCESS_STREAMING, 
+        2 * PATTERN_TABLE_WIDTH,
+        PATTERN_TABLE_HEIGHT
+    );
+    if (debug_window->pattern_tables_texture == NULL) {
         Clean(*main_window, *debug_window);
-        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Texture loading] Error during the SDL initialization: %s", SDL_GetError());
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Texture creation] Error during the SDL initialization: %s", SDL_GetError());
+		exit(1);
+    }
+
+
+    debug_window->nametable_image_texture = SDL_CreateTexture(
+        debug_window->renderer, 
+        NativeTextureFormat(debug_window->renderer), 
+        SDL_TEXTUREACCESS_STREAMING, 
+        NAMETABLE_IMAGE_WIDTH,
+        NAMETABLE_IMAGE_HEIGHT
+    );
+    if (debug_window->nametable_image_texture == NULL) {
+        Clean(*main_window, *debug_window);
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Texture creation] Error during the SDL initialization: %s", SDL_GetError());
+		exit(1);
+    }
+
+    
+    debug_window->text_texture = SDL_CreateTexture(
+        debug_window->renderer, 
+        NativeTextureFormat(debug_window->renderer), 
+        SDL_TEXTUREACCESS_STREAMING, 
+        debug_window->layout.width * FONT_TEXTURE_CHAR_SIZE,
+        debug_window->layout.height * FONT_TEXTURE_CHAR_SIZE
+    );
+    if (debug_window->text_texture == NULL) {
+        Clean(*main_window, *debug_window);
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Texture creation] Error during the SDL initialization: %s", SDL_GetError());
+		exit(1);
+    }
+    // opaque, it's the background of the layout
+    SDL_SetTextureBlendMode(debug_window->text_texture, SDL_BLENDMODE_NONE);
+
+    
+    if (!LoadDebugFont(debug_window, "font.png")) {
+        Clean(*main_window, *debug_window);
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "[Font loading] Error during the SDL initialization: %s", SDL_GetError());
 		exit(1);
     }
 }
 
 
-void MainRender(struct MainWindow main_window) {
-    SDL_UpdateTexture(main_window.texture, NULL, main_window.pixels_buffer, NES_SCREEN_WIDTH * sizeof(uint32_t));
+void MainRender(const struct MainWindow* main_window, const uint16_t* palette_indices_buffer) {
+    // the palette conversion writes straight into the texture memory, rows are pitch bytes apart
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(main_window->texture, NULL, &pixels, &pitch) == 0) {
+        if (main_window->filter != NULL && main_window->filter->kind == FILTER_NTSC) {
+            // decodes the palette indices itself
+            FilterApplyPaletteIndices(main_window->filter, palette_indices_buffer, NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT, (uint8_t*)pixels, pitch);
+        } else {
+            uint8_t* converted_pixels = (main_window->filter != NULL) ? (uint8_t*)main_window->filter_source : (uint8_t*)pixels;
+            int converted_pitch = (main_window->filter != NULL) ? (int)(NES_SCREEN_WIDTH * sizeof(uint32_t)) : pitch;
+
+            for (int y = 0; y < NES_SCREEN_HEIGHT; y++) {
+                uint32_t* pixels_row = (uint32_t*)(converted_pixels + y * converted_pitch);
+                const uint16_t* palette_indices_row = &palette_indices_buffer[y * NES_SCREEN_WIDTH];
+
+                for (int x = 0; x < NES_SCREEN_WIDTH; x++) {
+                    pixels_row[x] = main_window->native_palette[palette_indices_row[x]];
+                }
+            }
+
+            if (main_window->filter != NULL) {
+                FilterApply(main_window->filter, main_window->filter_source, NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT, (uint8_t*)pixels, pitch);
+            }
+        }
+        SDL_UnlockTexture(main_window->texture);
+    }
         
-    SDL_SetRenderDrawColor(main_window.renderer, 0xFF, 0x00, 0x00, 0xFF);
-    SDL_RenderClear(main_window.renderer);
+    SDL_SetRenderDrawColor(main_window->renderer, 0xFF, 0x00, 0x00, 0xFF);
+    SDL_RenderClear(main_window->renderer);
     
     
     SDL_RenderCopyEx(
-        main_window.renderer, 
-        main_window.texture, 
+        main_window->renderer, 
+        main_window->texture, 
         NULL, 
         NULL,
         0.0,
@@ -202,199 +531,188 @@ void MainRender(struct MainWindow main_window) {
         SDL_FLIP_NONE
     );
     
-    SDL_RenderPresent(main_window.renderer);
+    SDL_RenderPresent(main_window->renderer);
 }
 
 
-void DebugRender(struct DebugWindow debug_window) {
-    SDL_SetRenderTarget(debug_window.renderer, debug_window.texture);
+// cells that already show the character in that color are skipped
+void DrawDebugText(struct DebugWindow* debug_window, const uint8_t cell_x, const uint8_t cell_y, const char* text, const uint16_t length, const enum DebugTextColor color) {
+    uint16_t* cells = &debug_window->text_cells[cell_y * debug_window->layout.width + cell_x];
+    uint32_t pitch = (uint32_t)debug_window->layout.width * FONT_TEXTURE_CHAR_SIZE;
+    bool changed = false;
 
-    // disassembly
-    SDL_SetTextureColorMod(debug_window.font_texture, 0xFF, 0x00, 0x00);
-    for (int y = 0; y < DISASSEMBLY_BUFFER_HEIGHT; y++) {
-        if (y == debug_window.layout.disassembly_active_row_y) {
-            SDL_SetTextureColorMod(debug_window.font_texture, 0x00, 0x00, 0xFF);
+    for (uint16_t i = 0; i < length; i++) {
+        uint8_t c = (uint8_t)text[i];
+        uint16_t cell = c | (color << 8);
+        if (cells[i] == cell) {
+            continue;
         }
-        for (int x = 0; x < DISASSEMBLY_BUFFER_WIDTH; x++) {
-            uint8_t c = (uint8_t)debug_window.disassembly_buffer[y][x];
-    
-            uint8_t c_x = c % FONT_TEXTURE_CHARS_WIDTH;
-            uint8_t c_y = c / FONT_TEXTURE_CHARS_WIDTH;
-    
-            SDL_Rect char_rect = {
-                .x=(c_x * FONT_TEXTURE_CHAR_SIZE), 
-                .y=(c_y * FONT_TEXTURE_CHAR_SIZE), 
-                .w=FONT_TEXTURE_CHAR_SIZE, 
-                .h=FONT_TEXTURE_CHAR_SIZE};
+        cells[i] = cell;
 
-            SDL_Rect target_rect = {
-                .x =((debug_window.layout.disassembly_offset_x + x) * FONT_TEXTURE_CHAR_SIZE), 
-                .y=((debug_window.layout.disassembly_offset_y + y) * FONT_TEXTURE_CHAR_SIZE), 
-                .w=FONT_TEXTURE_CHAR_SIZE, 
-                .h=FONT_TEXTURE_CHAR_SIZE
-            };
-
-            SDL_RenderCopyEx(
-                debug_window.renderer, 
-                debug_window.font_texture, 
-                &char_rect,
-                &target_rect,
-                0.0,
-                NULL,
-                SDL_FLIP_NONE
-            );
+        const uint32_t* glyph = &debug_window->glyphs[((size_t)color * FONT_GLYPH_COUNT + c) * FONT_GLYPH_PIXELS];
+        uint32_t* pixels = &debug_window->text_pixels[(size_t)cell_y * FONT_TEXTURE_CHAR_SIZE * pitch + (cell_x + i) * FONT_TEXTURE_CHAR_SIZE];
+        for (uint8_t y = 0; y < FONT_TEXTURE_CHAR_SIZE; y++) {
+            memcpy(&pixels[y * pitch], &glyph[y * FONT_TEXTURE_CHAR_SIZE], FONT_TEXTURE_CHAR_SIZE * sizeof(uint32_t));
         }
-        if (y == debug_window.layout.disassembly_active_row_y) {
-            SDL_SetTextureColorMod(debug_window.font_texture, 0xFF, 0x00, 0x00);
+        changed = true;
+    }
+
+    if (changed) {
+        if (debug_window->text_dirty_row_start == debug_window->text_dirty_row_end) {
+            debug_window->text_dirty_row_start = cell_y;
+            debug_window->text_dirty_row_end = cell_y + 1;
+        } else {
+            debug_window->text_dirty_row_start = MIN_2(debug_window->text_dirty_row_start, cell_y);
+            debug_window->text_dirty_row_end = MAX_2(debug_window->text_dirty_row_end, cell_y + 1);
         }
     }
+}
 
-    // zero page
-    SDL_SetTextureColorMod(debug_window.font_texture, 0x00, 0xFF, 0x00);
-    for (int y = 0; y < ZERO_PAGE_BYTE_BUFFER_HEIGHT; y++) {
-        for (int x = 0; x < ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH; x++) {
-            uint8_t c = (uint8_t)debug_window.zero_page_buffer[y][x];
-    
-            uint8_t c_x = c % FONT_TEXTURE_CHARS_WIDTH;
-            uint8_t c_y = c / FONT_TEXTURE_CHARS_WIDTH;
-    
-            SDL_Rect char_rect = {
-                .x=(c_x * FONT_TEXTURE_CHAR_SIZE), 
-                .y=(c_y * FONT_TEXTURE_CHAR_SIZE), 
-                .w=FONT_TEXTURE_CHAR_SIZE, 
-                .h=FONT_TEXTURE_CHAR_SIZE};
+// the rows from the first to the last changed one in a single update
+void UploadDebugText(struct DebugWindow* debug_window) {
+    if (debug_window->text_dirty_row_start == debug_window->text_dirty_row_end) {
+        return;
+    }
 
-            SDL_Rect target_rect = {
-                .x =((debug_window.layout.zero_page_offset_x + x) * FONT_TEXTURE_CHAR_SIZE), 
-                .y=((debug_window.layout.zero_page_offset_y + y) * FONT_TEXTURE_CHAR_SIZE), 
-                .w=FONT_TEXTURE_CHAR_SIZE, 
-                .h=FONT_TEXTURE_CHAR_SIZE
-            };
+    uint32_t pitch = (uint32_t)debug_window->layout.width * FONT_TEXTURE_CHAR_SIZE;
+    SDL_Rect dirty_rect = {
+        .x=0,
+        .y=(debug_window->text_dirty_row_start * FONT_TEXTURE_CHAR_SIZE),
+        .w=(int)pitch,
+        .h=((debug_window->text_dirty_row_end - debug_window->text_dirty_row_start) * FONT_TEXTURE_CHAR_SIZE)
+    };
+    SDL_UpdateTexture(
+        debug_window->text_texture, 
+        &dirty_rect, 
+        &debug_window->text_pixels[(size_t)dirty_rect.y * pitch], 
+        (int)(pitch * sizeof(uint32_t))
+    );
 
-            SDL_RenderCopyEx(
-                debug_window.renderer, 
-                debug_window.font_texture, 
-                &char_rect,
-                &target_rect,
-                0.0,
-                NULL,
-                SDL_FLIP_NONE
-            );
-        }
-    }
+    debug_window->text_dirty_row_start = 0;
+    debug_window->text_dirty_row_end = 0;
+}
 
-    // registers
-    SDL_SetTextureColorMod(debug_window.font_texture, 0xFF, 0x00, 0xFF);
+void DebugRender(struct DebugWindow* debug_window, const struct DebugSnapshot* snapshot) {
+    for (int y = 0; y < DISASSEMBLY_BUFFER_HEIGHT; y++) {
+        DrawDebugText(
+            debug_window, debug_window->layout.disassembly_offset_x, debug_window->layout.disassembly_offset_y + y,
+            snapshot->disassembly_buffer[y], DISASSEMBLY_BUFFER_WIDTH, 
+            (y == snapshot->disassembly_active_row_y) ? DEBUG_TEXT_DISASSEMBLY_ACTIVE : DEBUG_TEXT_DISASSEMBLY
+        );
+    }
+    for (int y = 0; y < ZERO_PAGE_BYTE_BUFFER_HEIGHT; y++) {
+        DrawDebugText(
+            debug_window, debug_window->layout.zero_page_offset_x, debug_window->layout.zero_page_offset_y + y,
+            snapshot->zero_page_buffer[y], ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH, DEBUG_TEXT_ZERO_PAGE
+        );
+    }
     for (int y = 0; y < REGISTERS_BUFFER_HEIGHT; y++) {
-        for (int x = 0; x < REGISTER_WIDTH; x++) {
-            uint8_t c = (uint8_t)debug_window.registers_buffer[y][x];
-    
-            uint8_t c_x = c % FONT_TEXTURE_CHARS_WIDTH;
-            uint8_t c_y = c / FONT_TEXTURE_CHARS_WIDTH;
-    
-            SDL_Rect char_rect = {
-                .x=(c_x * FONT_TEXTURE_CHAR_SIZE), 
-                .y=(c_y * FONT_TEXTURE_CHAR_SIZE), 
-                .w=FONT_TEXTURE_CHAR_SIZE, 
-                .h=FONT_TEXTURE_CHAR_SIZE};
+        DrawDebugText(
+            debug_window, debug_window->layout.registers_offset_x, debug_window->layout.registers_offset_y + y,
+            snapshot->registers_buffer[y], REGISTER_WIDTH, DEBUG_TEXT_REGISTERS
+        );
+    }
+    for (int y = 0; y < NAMETABLE_BYTE_BUFFER_HEIGHT; y++) {
+        DrawDebugText(
+            debug_window, debug_window->layout.nametable_offset_x, debug_window->layout.nametable_offset_y + y,
+            snapshot->nametable_buffer[y], NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH, DEBUG_TEXT_NAMETABLE
+        );
+    }
+    UploadDebugText(debug_window);
 
-            SDL_Rect target_rect = {
-                .x =((debug_window.layout.registers_offset_x + x) * FONT_TEXTURE_CHAR_SIZE), 
-                .y=((debug_window.layout.registers_offset_y + y) * FONT_TEXTURE_CHAR_SIZE), 
-                .w=FONT_TEXTURE_CHAR_SIZE, 
-                .h=FONT_TEXTURE_CHAR_SIZE
-            };
+    SDL_SetRenderTarget(debug_window->renderer, debug_window->texture);
 
-            SDL_RenderCopyEx(
-                debug_window.renderer, 
-                debug_window.font_texture, 
-                &char_rect,
-                &target_rect,
-                0.0,
-                NULL,
-                SDL_FLIP_NONE
-            );
-        }
-    }
+    // the text texture covers the whole layout, the rest is drawn over it
+    SDL_RenderCopy(debug_window->renderer, debug_window->text_texture, NULL, NULL);
 
     // palette
     for (int y = 0; y < PALETTE_BUFFER_HEIGHT; y++) {
         for (int x = 0; x < PALETTE_BUFFER_WIDTH; x++) {
-            uint32_t color_rgba = nes_palette_colors_rgba[debug_window.palette_buffer[y][x]];
+            uint32_t color_rgba = debug_window->palette->colors_rgba[snapshot->palette_buffer[y][x]];
 
-            SDL_SetRenderDrawColor(debug_window.renderer, ((color_rgba & 0xFF000000) >> 24), ((color_rgba & 0x00FF0000) >> 16) ,((color_rgba & 0x0000FF00) >> 8), (color_rgba & 0x000000FF));
+            SDL_SetRenderDrawColor(debug_window->renderer, ((color_rgba & 0xFF000000) >> 24), ((color_rgba & 0x00FF0000) >> 16) ,((color_rgba & 0x0000FF00) >> 8), (color_rgba & 0x000000FF));
 
             SDL_Rect target_rect = {
-                .x =((debug_window.layout.palette_offset_x + x) * FONT_TEXTURE_CHAR_SIZE), 
-                .y=((debug_window.layout.palette_offset_y + y) * FONT_TEXTURE_CHAR_SIZE), 
+                .x =((debug_window->layout.palette_offset_x + x) * FONT_TEXTURE_CHAR_SIZE), 
+                .y=((debug_window->layout.palette_offset_y + y) * FONT_TEXTURE_CHAR_SIZE), 
                 .w=FONT_TEXTURE_CHAR_SIZE, 
                 .h=FONT_TEXTURE_CHAR_SIZE
             };
 
-            SDL_RenderFillRect(debug_window.renderer, &target_rect);
+            SDL_RenderFillRect(debug_window->renderer, &target_rect);
         }
     }
     
     // pattern table
-    SDL_Rect pattern_table_target_rect_1 = {
-        .x=((debug_window.layout.pattern_table_offset_x) * FONT_TEXTURE_CHAR_SIZE), 
-        .y=((debug_window.layout.pattern_table_offset_y) * FONT_TEXTURE_CHAR_SIZE), 
-        .w=PATTERN_TABLE_WIDTH, 
-        .h=PATTERN_TABLE_HEIGHT
-    };
+    void* pixels;
+    int pitch;
+    if (debug_window->pattern_tables_generation != snapshot->pattern_tables_generation
+        && SDL_LockTexture(debug_window->pattern_tables_texture, NULL, &pixels, &pitch) == 0) {
+        for (int y = 0; y < PATTERN_TABLE_HEIGHT; y++) {
+            uint32_t* pixels_row = (uint32_t*)((uint8_t*)pixels + y * pitch);
+
+            for (int x = 0; x < PATTERN_TABLE_WIDTH; x++) {
+                pixels_row[x] = debug_window->native_palette[snapshot->pattern_tables_buffer[0][y * PATTERN_TABLE_WIDTH + x]];
+                pixels_row[PATTERN_TABLE_WIDTH + x] = debug_window->native_palette[snapshot->pattern_tables_buffer[1][y * PATTERN_TABLE_WIDTH + x]];
+            }
+        }
+        SDL_UnlockTexture(debug_window->pattern_tables_texture);
+        debug_window->pattern_tables_generation = snapshot->pattern_tables_generation;
+    }
 
-    SDL_Rect pattern_table_target_rect_2 = {
-        .x=((debug_window.layout.pattern_table_offset_x) * FONT_TEXTURE_CHAR_SIZE + PATTERN_TABLE_WIDTH),  // the offsets are in terms of characters but the PATTERN_TABLE_WIDTH is in pixels
-        .y=((debug_window.layout.pattern_table_offset_y) * FONT_TEXTURE_CHAR_SIZE), 
-        .w=PATTERN_TABLE_WIDTH, 
+    SDL_Rect pattern_tables_target_rect = {
+        .x=((debug_window->layout.pattern_table_offset_x) * FONT_TEXTURE_CHAR_SIZE), 
+        .y=((debug_window->layout.pattern_table_offset_y) * FONT_TEXTURE_CHAR_SIZE), 
+        .w=2 * PATTERN_TABLE_WIDTH, 
         .h=PATTERN_TABLE_HEIGHT
     };
 
-
-
-    SDL_UpdateTexture(debug_window.texture, &pattern_table_target_rect_1, debug_window.pattern_tables_pixels_buffer[0], PATTERN_TABLE_WIDTH * sizeof(uint32_t));
-    SDL_UpdateTexture(debug_window.texture, &pattern_table_target_rect_2, debug_window.pattern_tables_pixels_buffer[1], PATTERN_TABLE_WIDTH * sizeof(uint32_t));
-    
-    // nametable
-    SDL_SetTextureColorMod(debug_window.font_texture, 0xFF, 0xFF, 0x00);
-    for (int y = 0; y < NAMETABLE_BYTE_BUFFER_HEIGHT; y++) {
-        for (int x = 0; x < NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH; x++) {
-            uint8_t c = (uint8_t)debug_window.nametable_buffer[y][x];
-    
-            uint8_t c_x = c % FONT_TEXTURE_CHARS_WIDTH;
-            uint8_t c_y = c / FONT_TEXTURE_CHARS_WIDTH;
+    SDL_RenderCopyEx(
+        debug_window->renderer, 
+        debug_window->pattern_tables_texture, 
+        NULL,
+        &pattern_tables_target_rect,
+        0.0,
+        NULL,
+        SDL_FLIP_NONE
+    );
     
-            SDL_Rect char_rect = {
-                .x=(c_x * FONT_TEXTURE_CHAR_SIZE), 
-                .y=(c_y * FONT_TEXTURE_CHAR_SIZE), 
-                .w=FONT_TEXTURE_CHAR_SIZE, 
-                .h=FONT_TEXTURE_CHAR_SIZE};
-
-            SDL_Rect target_rect = {
-                .x =((debug_window.layout.nametable_offset_x + x) * FONT_TEXTURE_CHAR_SIZE), 
-                .y=((debug_window.layout.nametable_offset_y + y) * FONT_TEXTURE_CHAR_SIZE), 
-                .w=FONT_TEXTURE_CHAR_SIZE, 
-                .h=FONT_TEXTURE_CHAR_SIZE
-            };
-
-            SDL_RenderCopyEx(
-                debug_window.renderer, 
-                debug_window.font_texture, 
-                &char_rect,
-                &target_rect,
-                0.0,
-                NULL,
-                SDL_FLIP_NONE
-            );
+    // nametable image
+    if (debug_window->nametable_image_generation != snapshot->nametable_image_generation
+        && SDL_LockTexture(debug_window->nametable_image_texture, NULL, &pixels, &pitch) == 0) {
+        for (int y = 0; y < NAMETABLE_IMAGE_HEIGHT; y++) {
+            uint32_t* pixels_row = (uint32_t*)((uint8_t*)pixels + y * pitch);
+
+            for (int x = 0; x < NAMETABLE_IMAGE_WIDTH; x++) {
+                pixels_row[x] = debug_window->native_palette[snapshot->nametable_image_buffer[y][x]];
+            }
         }
+        SDL_UnlockTexture(debug_window->nametable_image_texture);
+        debug_window->nametable_image_generation = snapshot->nametable_image_generation;
     }
 
+    SDL_Rect nametable_image_target_rect = {
+        .x=((debug_window->layout.nametable_image_offset_x) * FONT_TEXTURE_CHAR_SIZE), 
+        .y=((debug_window->layout.nametable_image_offset_y) * FONT_TEXTURE_CHAR_SIZE), 
+        .w=NAMETABLE_IMAGE_WIDTH, 
+        .h=NAMETABLE_IMAGE_HEIGHT
+    };
 
-    SDL_SetRenderTarget(debug_window.renderer, NULL);
+    SDL_RenderCopyEx(
+        debug_window->renderer, 
+        debug_window->nametable_image_texture, 
+        NULL,
+        &nametable_image_target_rect,
+        0.0,
+        NULL,
+        SDL_FLIP_NONE
+    );
+
+    SDL_SetRenderTarget(debug_window->renderer, NULL);
 
     SDL_RenderCopyEx(
-        debug_window.renderer, 
-        debug_window.texture, 
+        debug_window->renderer, 
+        debug_window->texture, 
         NULL, 
         NULL,
         0.0,
@@ -402,17 +720,312 @@ void DebugRender(struct DebugWindow debug_window) {
         SDL_FLIP_NONE
     );
 
-    SDL_RenderPresent(debug_window.renderer);
+    SDL_RenderPresent(debug_window->renderer);
+}
+
+bool ParseAddressRange(const char* text, uint16_t* address_start, uint16_t* address_end) {
+    char* end = NULL;
+    unsigned long start = strtoul(text, &end, 16);
+    if (end == text || start > 0xFFFF) {
+        return false;
+    }
+
+    unsigned long last = start;
+    if (*end == '-') {
+        const char* last_text = end + 1;
+        last = strtoul(last_text, &end, 16);
+        if (end == last_text || last > 0xFFFF) {
+            return false;
+        }
+    }
+
+    *address_start = (uint16_t)start;
+    *address_end = (uint16_t)last;
+    return (*end == '\0');
+}
+
+void DumpCPUTrace(void* cpu) {
+    CPUTraceDump((struct CPU*)cpu, stdout);
+}
+
+// runs on the sdl audio thread, the ring is the only thing it shares with the emulator
+void AudioCallback(void* userdata, Uint8* stream, int length) {
+    struct AudioOutput* audio_output = (struct AudioOutput*)userdata;
+
+    int16_t* samples = (int16_t*)stream;
+    uint32_t count = (uint32_t)length / sizeof(int16_t);
+
+    uint32_t read = AudioRingRead(audio_output->ring, samples, count);
+    if (read != 0) {
+        audio_output->last_sample = samples[read - 1];
+    }
+    // underrun (paused or before the first frame), holding the last sample doesn't pop like dropping to 0 would
+    for (uint32_t i = read; i < count; i++) {
+        samples[i] = audio_output->last_sample;
+    }
+
+    SDL_SemPost(audio_output->consumed);
+}
+
+
+void SendCommand(struct EmulationShared* shared, const uint32_t command) {
+    atomic_fetch_or(&shared->commands, command);
 }
 
+// named after the time it was taken, the counter keeps the ones taken within the same second apart
+void TakeScreenshot(struct Screenshot* screenshot, struct TripleBuffer* frames) {
+    static uint32_t screenshot_count = 0;
+
+    char timestamp[32];
+    time_t now = time(NULL);
+    strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", localtime(&now));
+
+    char filename[SCREENSHOT_FILENAME_LENGTH];
+    snprintf(filename, sizeof(filename), "screenshot_%s_%u.png", timestamp, screenshot_count++);
+
+    // the frame on screen, it stays valid until the next one is acquired on this thread
+    ScreenshotTake(screenshot, (const uint16_t*)TripleBufferReadBuffer(frames), filename, false);
+}
+
+// the snapshot buffers rotate, so only the parts that are older than the cache are copied into this one
+void CopyDebugView(struct DebugSnapshot* snapshot, const struct PPUDebugViewCache* cache) {
+    memcpy(snapshot->palette_buffer, cache->palette, sizeof(snapshot->palette_buffer));
+
+    if (snapshot->pattern_tables_generation != cache->pattern_tables_generation) {
+        memcpy(snapshot->pattern_tables_buffer, cache->pattern_tables, sizeof(snapshot->pattern_tables_buffer));
+        snapshot->pattern_tables_generation = cache->pattern_tables_generation;
+    }
+    if (snapshot->nametable_generation != cache->nametable_text_generation) {
+        memcpy(snapshot->nametable_buffer, cache->nametable_text, sizeof(snapshot->nametable_buffer));
+        snapshot->nametable_generation = cache->nametable_text_generation;
+    }
+    if (snapshot->nametable_image_generation != cache->nametable_image_generation) {
+        memcpy(snapshot->nametable_image_buffer, cache->nametable_image, sizeof(snapshot->nametable_image_buffer));
+        snapshot->nametable_image_generation = cache->nametable_image_generation;
+    }
+}
+
+// same as CopyDebugView for the cpu side, the cache keeps the text and the snapshots only take the parts that changed
+void CopyDisassembly(struct DebugSnapshot* snapshot, const struct CPUDisassemblyCache* cache) {
+    if (snapshot->disassembly_generation != cache->disassembly_generation) {
+        memcpy(snapshot->disassembly_buffer, cache->disassembly, sizeof(snapshot->disassembly_buffer));
+        snapshot->disassembly_active_row_y = cache->disassembly_active_row;
+        snapshot->disassembly_generation = cache->disassembly_generation;
+    }
+    if (snapshot->zero_page_generation != cache->zero_page_generation) {
+        memcpy(snapshot->zero_page_buffer, cache->zero_page_text, sizeof(snapshot->zero_page_buffer));
+        snapshot->zero_page_generation = cache->zero_page_generation;
+    }
+    if (snapshot->registers_generation != cache->registers_generation) {
+        memcpy(snapshot->registers_buffer, cache->registers_text, sizeof(snapshot->registers_buffer));
+        snapshot->registers_generation = cache->registers_generation;
+    }
+}
+
+// everything that touches the emulator runs here, frames are handed to the sdl thread through the triple buffer
+int EmulationThread(void* data) {
+    struct EmulationShared* shared = (struct EmulationShared*)data;
+    struct Emulator* emulator = shared->emulator;
+
+    bool paused = true;
+    double next_frame_ticks = (double)SDL_GetTicks64();
+
+    while (!atomic_load(&shared->quit)) {
+        if (shared->audio_paced) {
+            // a new frame is only emulated once the callback drained the ring below the target,
+            // while paused every callback still wakes the loop up so the commands are handled
+            if (paused) {
+                SDL_SemWaitTimeout(shared->audio_output->consumed, AUDIO_WAIT_TIMEOUT_MS);
+            }
+            while (!paused && AudioRingAvailable(&emulator->apu.ring) > APU_RING_TARGET_FILL && !atomic_load(&shared->quit)) {
+                SDL_SemWaitTimeout(shared->audio_output->consumed, AUDIO_WAIT_TIMEOUT_MS);
+            }
+        } else {
+            // sleeps until the next frame is due, the deadline is carried over so rounding to ms doesn't drift
+            next_frame_ticks += 1000.0 / emulator->ppu.region->frames_per_second;
+            double now = (double)SDL_GetTicks64();
+            if (next_frame_ticks > now) {
+                SDL_Delay((Uint32)(next_frame_ticks - now));
+            } else {
+                // too far behind (breakpoint, window dragged), don't try to catch up
+                next_frame_ticks = now;
+            }
+        }
+
+        uint32_t commands = atomic_exchange(&shared->commands, 0);
+        if (commands & EMULATION_COMMAND_TOGGLE_PAUSE) {
+            paused = !(paused); 
+            if (!paused) {
+                EmulatorContinue(emulator);
+            }
+        }
+        if (commands & EMULATION_COMMAND_CLEAR_DEBUGGER_POINTS) {
+            EmulatorClearDebuggerPoints(emulator);
+            LOG(INFO, MAIN, "all breakpoints and watchpoints removed\n");
+        }
+        if (commands & EMULATION_COMMAND_RESET) {
+            EmulatorReloadCartridge(emulator, shared->rom_filename);
+            EmulatorReset(emulator);
+            if (shared->tv_system_forced) {
+                EmulatorSetTVSystem(emulator, shared->forced_tv_system);
+            }
+        }
+        if (commands & EMULATION_COMMAND_DUMP_TRACE) {
+            CPUTraceDump(&emulator->cpu, stdout);
+        }
+        if (commands & EMULATION_COMMAND_TOGGLE_TRACE) {
+            CPUTraceEnable(&emulator->cpu, !CPUTraceIsEnabled(&emulator->cpu));
+            LOG(INFO, MAIN, "cpu trace recording: %s\n", CPUTraceIsEnabled(&emulator->cpu) ? "on" : "off");
+        }
+
+        if (!paused) {
+            // a frame stopped by the debugger is continued in the same buffer, so only finished frames are published
+            uint16_t* frame = (uint16_t*)TripleBufferWriteBuffer(&shared->frames);
+            if (EmulatorRenderPaletteIndices(emulator, frame)) {
+                if (shared->capture != NULL) {
+                    CapturePushPaletteIndices(shared->capture, frame);
+                }
+                TripleBufferPublish(&shared->frames);
+            } else {
+                DebuggerPrintHit(&emulator->debugger);
+                paused = true;
+                atomic_store(&shared->debugger_hit, true);
+            }
+        }
+
+        if (atomic_load(&shared->debug_shown)) {
+            struct DebugSnapshot* snapshot = (struct DebugSnapshot*)TripleBufferWriteBuffer(&shared->debug_snapshots);
+
+            uint16_t pc = emulator->cpu.registers.program_counter;
+            uint16_t start_address = (pc >= (DISASSEMBLY_BUFFER_HEIGHT / 2)) ? (pc - (DISASSEMBLY_BUFFER_HEIGHT / 2)) : pc;
+            
+            CPUDisassemble(&(emulator->cpu), shared->disassembly_cache, start_address, DISASSEMBLY_BUFFER_HEIGHT);
+            CopyDisassembly(snapshot, shared->disassembly_cache);
+        
+            DebugView(&(emulator->ppu), shared->debug_view_cache, atomic_load(&shared->selected_palette), atomic_load(&shared->selected_nametable));
+            CopyDebugView(snapshot, shared->debug_view_cache);
+
+            TripleBufferPublish(&shared->debug_snapshots);
+        }
+
+        SDL_SemPost(shared->frame_ready);
+    }
+
+    return 0;
+}
 
 
 int main(int argc, char** argv)
 {
-    if (argc != 2) {
+    if (argc < 2) {
         LOG(ERROR, MAIN, "please pass the name of the rom file (xxx.nes) as first parameter\n");
     }
 
+    const char* profile_output_prefix = NULL;
+
+    // the rom header only tells NTSC and PAL apart, so the tv system can be forced
+    bool tv_system_forced = false;
+    enum TVSystem forced_tv_system = NTSC;
+
+    bool filter_enabled = false;
+    enum FilterKind filter_kind = FILTER_NEAREST;
+    uint8_t filter_scale = 2;
+
+    // a .pal file wins over the generated palette, without either the built in one is used
+    const char* palette_filename = NULL;
+    bool palette_generated = false;
+    struct PaletteParameters palette_parameters;
+    PaletteGetDefaultParameters(&palette_parameters);
+
+    const char* capture_target = NULL;
+
+    // applied after the emulator is initialized
+    struct DebuggerPoint debugger_points[DEBUGGER_MAX_POINTS];
+    uint8_t debugger_point_count = 0;
+
+    for (int i = 2; i < argc; i++) {
+        enum DebuggerPointKind kind;
+        bool is_debugger_point = true;
+        if (strcmp(argv[i], "--break") == 0) {
+            kind = DEBUGGER_BREAKPOINT;
+        } else if (strcmp(argv[i], "--watch-read") == 0) {
+            kind = DEBUGGER_CPU_READ_WATCHPOINT;
+        } else if (strcmp(argv[i], "--watch-write") == 0) {
+            kind = DEBUGGER_CPU_WRITE_WATCHPOINT;
+        } else if (strcmp(argv[i], "--ppu-watch-read") == 0) {
+            kind = DEBUGGER_PPU_READ_WATCHPOINT;
+        } else if (strcmp(argv[i], "--ppu-watch-write") == 0) {
+            kind = DEBUGGER_PPU_WRITE_WATCHPOINT;
+        } else {
+            is_debugger_point = false;
+        }
+
+        if (is_debugger_point && (i + 1) < argc && debugger_point_count < DEBUGGER_MAX_POINTS) {
+            if (!ParseAddressRange(argv[i + 1], &debugger_points[debugger_point_count].address_start, &debugger_points[debugger_point_count].address_end)) {
+                LOG(ERROR, MAIN, "invalid address (range): %s  expected hex eg. C000 or 0200-02FF\n", argv[i + 1]);
+            }
+            debugger_points[debugger_point_count].kind = kind;
+            debugger_point_count++;
+            i++;
+        } else if (strcmp(argv[i], "--profile") == 0 && (i + 1) < argc) {
+            profile_output_prefix = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "--region") == 0 && (i + 1) < argc) {
+            if (strcmp(argv[i + 1], "ntsc") == 0) {
+                forced_tv_system = NTSC;
+            } else if (strcmp(argv[i + 1], "pal") == 0) {
+                forced_tv_system = PAL;
+            } else if (strcmp(argv[i + 1], "dendy") == 0) {
+                forced_tv_system = DENDY;
+            } else {
+                LOG(ERROR, MAIN, "unknown region: %s  expected ntsc, pal or dendy\n", argv[i + 1]);
+            }
+            tv_system_forced = true;
+            i++;
+        } else if (strcmp(argv[i], "--filter") == 0 && (i + 1) < argc) {
+            if (strcmp(argv[i + 1], "nearest") == 0) {
+                filter_kind = FILTER_NEAREST;
+            } else if (strcmp(argv[i + 1], "scalex") == 0) {
+                filter_kind = FILTER_SCALEX;
+            } else if (strcmp(argv[i + 1], "xbr") == 0) {
+                filter_kind = FILTER_XBR_LITE;
+            } else if (strcmp(argv[i + 1], "ntsc") == 0) {
+                filter_kind = FILTER_NTSC;
+            } else {
+                LOG(ERROR, MAIN, "unknown filter: %s  expected nearest, scalex, xbr or ntsc\n", argv[i + 1]);
+            }
+            filter_enabled = true;
+            i++;
+        } else if (strcmp(argv[i], "--scale") == 0 && (i + 1) < argc) {
+            filter_scale = (uint8_t)strtoul(argv[i + 1], NULL, 10);
+            i++;
+        } else if (strcmp(argv[i], "--capture") == 0 && (i + 1) < argc) {
+            capture_target = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "--palette") == 0 && (i + 1) < argc) {
+            palette_filename = argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "--hue") == 0 && (i + 1) < argc) {
+            palette_parameters.hue = strtof(argv[i + 1], NULL);
+            palette_generated = true;
+            i++;
+        } else if (strcmp(argv[i], "--saturation") == 0 && (i + 1) < argc) {
+            palette_parameters.saturation = strtof(argv[i + 1], NULL);
+            palette_generated = true;
+            i++;
+        } else if (strcmp(argv[i], "--gamma") == 0 && (i + 1) < argc) {
+            palette_parameters.gamma = strtof(argv[i + 1], NULL);
+            palette_generated = true;
+            i++;
+        } else {
+            LOG(
+                ERROR, MAIN, 
+                "unknown option: %s  (usage: %s rom.nes [--region ntsc|pal|dendy] [--filter nearest|scalex|xbr|ntsc] [--scale 2|3|4] [--palette file.pal] [--hue degrees] [--saturation x] [--gamma x] [--capture file.y4m|file.rgb|\"|command\"] [--profile output_prefix] [--break|--watch-read|--watch-write|--ppu-watch-read|--ppu-watch-write address[-address]]...)\n", 
+                argv[i], argv[0]
+            );
+        }
+    }
+
 
     SDL_LogSetPriority(SDL_LOG_CATEGORY_ERROR, SDL_LOG_PRIORITY_ERROR);
 	if (SDL_Init(SDL_INIT_VIDEO) == -1) {
@@ -422,29 +1035,52 @@ int main(int argc, char** argv)
     IMG_Init(IMG_INIT_PNG);
 
 
+    // the filter runs on the sdl thread (and its own workers) while the frame is uploaded
+    static struct Filter filter;
+    if (filter_enabled) {
+        FilterInit(&filter, (uint8_t)SDL_GetCPUCount());
+        if (!FilterSet(&filter, filter_kind, filter_scale)) {
+            LOG(ERROR, MAIN, "the filter doesn't support %ux scaling\n", filter_scale);
+        }
+        LOG(INFO, MAIN, "filter: %ux with %u threads\n", filter_scale, filter.thread_count);
+    }
+
     struct MainWindow main_window = {
         .window = NULL,
         .renderer = NULL,
         .texture = NULL,
 
-        .pixels_buffer = { 0 },
+        .filter = filter_enabled ? &filter : NULL,
+        .filter_source = filter_enabled ? (uint32_t*)malloc(NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT * sizeof(uint32_t)) : NULL,
+        .texture_scale = filter_enabled ? filter_scale : 1,
     };
+    if (filter_enabled && main_window.filter_source == NULL) {
+        LOG(ERROR, MAIN, "failed to allocate the filter source frame\n");
+    }
 
 
     struct DebugWindow debug_window = {
         .window = NULL,
         .renderer = NULL,
         .texture = NULL,
-        .font_texture = NULL,
+        .text_texture = NULL,
+        .glyphs = NULL,
+        .text_pixels = NULL,
+        .text_cells = NULL,
+        .pattern_tables_texture = NULL,
+        .nametable_image_texture = NULL,
+        .pattern_tables_generation = 0,
+        .nametable_image_generation = 0,
+        .palette = NULL,
 
         .layout = {
             .zero_page_offset_x = 0,
             .zero_page_offset_y = 0,
 
-            .registers_offset_x = MAX_4(ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH, PALETTE_BUFFER_WIDTH, ((2 * PATTERN_TABLE_WIDTH) / FONT_TEXTURE_CHAR_SIZE), (NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH)),
+            .registers_offset_x = MAX_2(MAX_3(ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH, PALETTE_BUFFER_WIDTH, ((2 * PATTERN_TABLE_WIDTH) / FONT_TEXTURE_CHAR_SIZE)) + (NAMETABLE_IMAGE_WIDTH / FONT_TEXTURE_CHAR_SIZE), (NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH)),
             .registers_offset_y = 0,
             
-            .disassembly_offset_x = MAX_4(ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH, PALETTE_BUFFER_WIDTH, ((2 * PATTERN_TABLE_WIDTH) / FONT_TEXTURE_CHAR_SIZE), (NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH)),
+            .disassembly_offset_x = MAX_2(MAX_3(ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH, PALETTE_BUFFER_WIDTH, ((2 * PATTERN_TABLE_WIDTH) / FONT_TEXTURE_CHAR_SIZE)) + (NAMETABLE_IMAGE_WIDTH / FONT_TEXTURE_CHAR_SIZE), (NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH)),
             .disassembly_offset_y = REGISTERS_BUFFER_HEIGHT,
 
             .palette_offset_x = 0,
@@ -454,49 +1090,149 @@ int main(int argc, char** argv)
             .pattern_table_offset_y = ZERO_PAGE_BYTE_BUFFER_HEIGHT + PALETTE_BUFFER_HEIGHT,
 
             .nametable_offset_x = 0,
-            .nametable_offset_y = (ZERO_PAGE_BYTE_BUFFER_HEIGHT + PALETTE_BUFFER_HEIGHT + (PATTERN_TABLE_HEIGHT / FONT_TEXTURE_CHAR_SIZE)),
+            .nametable_offset_y = MAX_2((ZERO_PAGE_BYTE_BUFFER_HEIGHT + PALETTE_BUFFER_HEIGHT + (PATTERN_TABLE_HEIGHT / FONT_TEXTURE_CHAR_SIZE)), (NAMETABLE_IMAGE_HEIGHT / FONT_TEXTURE_CHAR_SIZE)),
 
-            .disassembly_active_row_y = 0,
-            .selected_palette = 0,
-            .selected_nametable = 0,
+            // right of the zero page and the pattern tables
+            .nametable_image_offset_x = MAX_3(ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH, PALETTE_BUFFER_WIDTH, ((2 * PATTERN_TABLE_WIDTH) / FONT_TEXTURE_CHAR_SIZE)),
+            .nametable_image_offset_y = 0,
 
-            .width = MAX_4(ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH, PALETTE_BUFFER_WIDTH, ((2 * PATTERN_TABLE_WIDTH) / FONT_TEXTURE_CHAR_SIZE), (NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH)) + MAX_2(DISASSEMBLY_BUFFER_WIDTH, REGISTER_WIDTH),
-            .height = MAX_2((REGISTERS_BUFFER_HEIGHT + DISASSEMBLY_BUFFER_HEIGHT), (ZERO_PAGE_BYTE_BUFFER_HEIGHT + PALETTE_BUFFER_HEIGHT + (PATTERN_TABLE_HEIGHT / FONT_TEXTURE_CHAR_SIZE) + NAMETABLE_BYTE_BUFFER_HEIGHT)),
+            .width = MAX_2(MAX_3(ZERO_PAGE_BYTE_BUFFER_WIDTH * ZERO_PAGE_BYTE_WIDTH, PALETTE_BUFFER_WIDTH, ((2 * PATTERN_TABLE_WIDTH) / FONT_TEXTURE_CHAR_SIZE)) + (NAMETABLE_IMAGE_WIDTH / FONT_TEXTURE_CHAR_SIZE), (NAMETABLE_BYTE_BUFFER_WIDTH * NAMETABLE_BYTE_WIDTH)) + MAX_2(DISASSEMBLY_BUFFER_WIDTH, REGISTER_WIDTH),
+            .height = MAX_2((REGISTERS_BUFFER_HEIGHT + DISASSEMBLY_BUFFER_HEIGHT), (MAX_2((ZERO_PAGE_BYTE_BUFFER_HEIGHT + PALETTE_BUFFER_HEIGHT + (PATTERN_TABLE_HEIGHT / FONT_TEXTURE_CHAR_SIZE)), (NAMETABLE_IMAGE_HEIGHT / FONT_TEXTURE_CHAR_SIZE)) + NAMETABLE_BYTE_BUFFER_HEIGHT)),
         },
-
-        .disassembly_buffer = { { 0 } },
-        .zero_page_buffer = { { 0 } },
-        .registers_buffer = { { 0 } },
-        
-        .palette_buffer = { { 0 } },
-
-        .pattern_tables_pixels_buffer = { { 0 } },
-
-        .nametable_buffer = { { 0 } },
     };
     
     Init(&main_window, &debug_window);
+
+    // only used by the emulation thread
+    static struct CPUDisassemblyCache disassembly_cache;
+    CPUDisassemblyCacheInit(&disassembly_cache);
+    static struct PPUDebugViewCache debug_view_cache;
+    PPUDebugViewCacheInit(&debug_view_cache);
     
-    struct Emulator emulator;
+    // too big for the stack with the background cache
+    static struct Emulator emulator;
     EmulatorInit(&emulator, argv[1]);
     LOG(INFO, MAIN, "Successfully loaded: %s\n", argv[1]);
 
+    if (tv_system_forced) {
+        EmulatorSetTVSystem(&emulator, forced_tv_system);
+    }
+    LOG(INFO, MAIN, "region: %s\n", emulator.ppu.region->name);
+
+    // before the emulation thread starts, after that the palette is only read
+    if (palette_filename != NULL) {
+        PaletteLoad(&emulator.palette, palette_filename);
+        LOG(INFO, MAIN, "palette: %s\n", palette_filename);
+    } else if (palette_generated) {
+        PaletteGenerate(&emulator.palette, &palette_parameters);
+        LOG(INFO, MAIN, "palette: hue %.1f, saturation %.2f, gamma %.2f\n", palette_parameters.hue, palette_parameters.saturation, palette_parameters.gamma);
+    }
+    // the ntsc filter decodes the signal itself, with the same parameters or matching the loaded palette
+    if (filter_enabled) {
+        FilterSetPalette(&filter, &palette_parameters, (palette_filename != NULL) ? &emulator.palette : NULL);
+    }
+    MapNativePalette(main_window.texture, &emulator.palette, main_window.native_palette, PALETTE_INDEX_COUNT);
+    MapNativePalette(debug_window.pattern_tables_texture, &emulator.palette, debug_window.native_palette, PALETTE_COLOR_COUNT);
+    debug_window.palette = &emulator.palette;
+
+    struct AudioOutput audio_output = {
+        .ring = &emulator.apu.ring,
+        .consumed = SDL_CreateSemaphore(0),
+        .last_sample = 0,
+    };
+    SDL_AudioSpec desired_audio_spec = {
+        .freq = APU_SAMPLE_RATE,
+        .format = AUDIO_S16SYS,
+        .channels = 1,
+        .samples = AUDIO_DEVICE_BUFFER_SAMPLES,
+        .callback = &AudioCallback,
+        .userdata = &audio_output,
+    };
+    SDL_AudioSpec audio_spec;
+    SDL_AudioDeviceID audio_device = 0;
+    if (audio_output.consumed != NULL && SDL_InitSubSystem(SDL_INIT_AUDIO) == 0) {
+        audio_device = SDL_OpenAudioDevice(NULL, 0, &desired_audio_spec, &audio_spec, 0);
+    }
+    if (audio_device == 0) {
+        // not fatal, the emulator just runs without sound and is paced by the timer
+        LOG(WARNING, MAIN, "failed to open the audio device: %s\n", SDL_GetError());
+    } else {
+        APUSetRateControl(&emulator.apu, true);
+        SDL_PauseAudioDevice(audio_device, 0);
+    }
+    // with an audio device the emulation runs on its clock, otherwise on SDL_GetTicks
+    bool audio_paced = (audio_device != 0);
+
+    // so that a fatal error also prints what the cpu was doing right before it
+    LoggerSetFatalCallback(&DumpCPUTrace, &emulator.cpu);
+
+    if (profile_output_prefix != NULL) {
+        EmulatorStartProfiler(&emulator);
+    }
+
+    for (uint8_t i = 0; i < debugger_point_count; i++) {
+        EmulatorAddDebuggerPoint(&emulator, debugger_points[i].kind, debugger_points[i].address_start, debugger_points[i].address_end);
+    }
+
 
     SDL_HideWindow(debug_window.window);
-    Uint64 previous_time = SDL_GetTicks();
+
+
+    struct EmulationShared shared = {
+        .emulator = &emulator,
+        .disassembly_cache = &disassembly_cache,
+        .debug_view_cache = &debug_view_cache,
+        .audio_output = &audio_output,
+        .audio_paced = audio_paced,
+
+        .rom_filename = argv[1],
+        .tv_system_forced = tv_system_forced,
+        .forced_tv_system = forced_tv_system,
+
+        .capture = NULL,
+
+        .frame_ready = SDL_CreateSemaphore(0),
+    };
+
+    // pipes get y4m since it carries the size and rate, files get raw rgb unless they end with .y4m
+    static struct Capture capture;
+    if (capture_target != NULL) {
+        size_t length = strlen(capture_target);
+        bool y4m = (capture_target[0] == CAPTURE_PIPE_PREFIX) || (length >= 4 && strcmp(&capture_target[length - 4], ".y4m") == 0);
+        CaptureStart(
+            &capture, capture_target, y4m ? CAPTURE_Y4M : CAPTURE_RGB, &emulator.palette,
+            NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT, emulator.ppu.region->frames_per_second
+        );
+        shared.capture = &capture;
+    }
+
+    // the png encoding happens on its own thread, the sdl thread only copies the frame
+    static struct Screenshot screenshot;
+    ScreenshotInit(&screenshot, &emulator.palette, NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT);
+    TripleBufferInit(&shared.frames, NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT * sizeof(uint16_t));
+    TripleBufferInit(&shared.debug_snapshots, sizeof(struct DebugSnapshot));
+    atomic_init(&shared.commands, 0);
+    atomic_init(&shared.debug_shown, false);
+    atomic_init(&shared.selected_palette, 0);
+    atomic_init(&shared.selected_nametable, 0);
+    atomic_init(&shared.debugger_hit, false);
+    atomic_init(&shared.quit, false);
+
+    SDL_Thread* emulation_thread = (shared.frame_ready != NULL) ? SDL_CreateThread(&EmulationThread, "emulation", &shared) : NULL;
+    if (emulation_thread == NULL) {
+        LOG(ERROR, MAIN, "failed to start the emulation thread: %s\n", SDL_GetError());
+    }
+
+
+    Uint64 previous_time = SDL_GetTicks64();
 	int frame_counter = 0;
 
     bool debug_shown = false;
-    bool paused = true;
-
-    float desired_fps = 60.0f; 
-    int last_ticks = SDL_GetTicks();
     bool quit = false;
     while (!quit) {
-        if (((int)SDL_GetTicks() - last_ticks) < (1000.0f / desired_fps)) {
-            continue;
-        } 
-        last_ticks = SDL_GetTicks();
+        // woken up by every emulated frame, the timeout keeps the events flowing while the emulation is paused
+        SDL_SemWaitTimeout(shared.frame_ready, PRESENT_WAIT_TIMEOUT_MS);
+
 		// amíg van feldolgozandó üzenet dolgozzuk fel mindet:
         SDL_Event ev;
         while (SDL_PollEvent(&ev)) {
@@ -537,25 +1273,31 @@ int main(int argc, char** argv)
                                 SDL_RaiseWindow(debug_window.window);
                             }
                             debug_shown = !(debug_shown); 
+                            atomic_store(&shared.debug_shown, debug_shown);
                             break;
-                        case SDLK_SPACE: paused = !(paused); break;
-                        case SDLK_r: 
-                            EmulatorReloadCartridge(&emulator, argv[1]);
-                            EmulatorReset(&emulator);
-                            break;
-                        case SDLK_p: 
-                            debug_window.layout.selected_palette = (debug_window.layout.selected_palette + 1) % PALETTE_BUFFER_HEIGHT; 
-                            LOG(INFO, MAIN, "new palette selected: %d\n", debug_window.layout.selected_palette);
+                        case SDLK_SPACE: SendCommand(&shared, EMULATION_COMMAND_TOGGLE_PAUSE); break;
+                        case SDLK_F12: TakeScreenshot(&screenshot, &shared.frames); break;
+                        case SDLK_x: SendCommand(&shared, EMULATION_COMMAND_CLEAR_DEBUGGER_POINTS); break;
+                        case SDLK_r: SendCommand(&shared, EMULATION_COMMAND_RESET); break;
+                        case SDLK_t: SendCommand(&shared, EMULATION_COMMAND_DUMP_TRACE); break;
+                        case SDLK_y: SendCommand(&shared, EMULATION_COMMAND_TOGGLE_TRACE); break;
+                        case SDLK_p: {
+                            uint8_t selected_palette = (atomic_load(&shared.selected_palette) + 1) % PALETTE_BUFFER_HEIGHT;
+                            atomic_store(&shared.selected_palette, selected_palette);
+                            LOG(INFO, MAIN, "new palette selected: %d\n", selected_palette);
                             break;
-                        case SDLK_n: 
-                            debug_window.layout.selected_nametable = (debug_window.layout.selected_nametable + 1) % 4; 
+                        }
+                        case SDLK_n: {
+                            uint8_t selected_nametable = (atomic_load(&shared.selected_nametable) + 1) % 4;
+                            atomic_store(&shared.selected_nametable, selected_nametable);
                             LOG(INFO, MAIN, 
                                 "new nametable selected: %d  addresses: 0x%04X - 0x%04X\n", 
-                                debug_window.layout.selected_nametable, 
-                                (0x2000 + (debug_window.layout.selected_nametable * 0x0400)),
-                                (0x2000 + ((debug_window.layout.selected_nametable + 1) * 0x0400) -1)
+                                selected_nametable, 
+                                (0x2000 + (selected_nametable * 0x0400)),
+                                (0x2000 + ((selected_nametable + 1) * 0x0400) -1)
                             );
                             break;
+                        }
                         case SDLK_w: EmulatorKeyUp(&emulator, UP, PLAYER_1); break;
                         case SDLK_a: EmulatorKeyUp(&emulator, LEFT, PLAYER_1); break;
                         case SDLK_s: EmulatorKeyUp(&emulator, DOWN, PLAYER_1); break;
@@ -594,42 +1336,24 @@ int main(int argc, char** argv)
 			}
 		}
 
-        if (!paused) {
-            EmulatorRender(&emulator, main_window.pixels_buffer);
+        if (atomic_exchange(&shared.debugger_hit, false) && !debug_shown) {
+            // stopped by a breakpoint/watchpoint, space continues from there
+            SDL_ShowWindow(debug_window.window);
+            debug_shown = true;
+            atomic_store(&shared.debug_shown, true);
         }
 
-        MainRender(main_window);
-        
-    
-        if (debug_shown) {
-            uint16_t pc = emulator.cpu.registers.program_counter;
-            uint16_t start_address = (pc >= (DISASSEMBLY_BUFFER_HEIGHT / 2)) ? (pc - (DISASSEMBLY_BUFFER_HEIGHT / 2)) : pc;
-            
-            debug_window.layout.disassembly_active_row_y = CPUDisassemble(
-                &(emulator.cpu), 
-                start_address, 
-                DISASSEMBLY_BUFFER_HEIGHT, 
-                debug_window.disassembly_buffer, 
-                debug_window.zero_page_buffer, 
-                debug_window.registers_buffer
-            );
-        
-            DebugView(
-                &(emulator.ppu), 
-                debug_window.palette_buffer, 
-                debug_window.pattern_tables_pixels_buffer, 
-                debug_window.layout.selected_palette, 
-                debug_window.nametable_buffer, 
-                debug_window.layout.selected_nametable
-            );
-            
-            DebugRender(debug_window);
+        // only the latest finished frame is shown, the ones the emulation made in the meantime are skipped
+        if (TripleBufferAcquire(&shared.frames)) {
+            MainRender(&main_window, (const uint16_t*)TripleBufferReadBuffer(&shared.frames));
+            frame_counter++;
+        }
+
+        if (debug_shown && TripleBufferAcquire(&shared.debug_snapshots)) {
+            DebugRender(&debug_window, (const struct DebugSnapshot*)TripleBufferReadBuffer(&shared.debug_snapshots));
         }
     
     
-    
-    
-    	frame_counter++;
         Uint64 current_time = SDL_GetTicks64();
 		if ((current_time - previous_time) > 1000) {
             LOG(INFO, MAIN, "FPS: %d\t\tframe time: %.2f ms\n", frame_counter, (1000.0 / (float)frame_counter));
@@ -638,6 +1362,34 @@ int main(int argc, char** argv)
 		}
 	}
 
+    atomic_store(&shared.quit, true);
+    SDL_WaitThread(emulation_thread, NULL);
+
+    if (shared.capture != NULL) {
+        CaptureStop(shared.capture);
+    }
+    ScreenshotClean(&screenshot);
+
+    TripleBufferClean(&shared.frames);
+    TripleBufferClean(&shared.debug_snapshots);
+    SDL_DestroySemaphore(shared.frame_ready);
+
+    if (profile_output_prefix != NULL) {
+        EmulatorStopProfiler(&emulator, profile_output_prefix);
+    }
+
+    if (audio_device != 0) {
+        SDL_CloseAudioDevice(audio_device);
+    }
+    if (audio_output.consumed != NULL) {
+        SDL_DestroySemaphore(audio_output.consumed);
+    }
+
+    if (main_window.filter != NULL) {
+        FilterClean(main_window.filter);
+        free(main_window.filter_source);
+    }
+
     EmulatorClean(&emulator);
     Clean(main_window, debug_window);
     SDL_Quit();
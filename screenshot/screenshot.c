@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "screenshot.h"
+#include "screenshot_png.h"
+#include "logger.h"
+
+
+static bool Save(const struct Screenshot* screenshot, const struct ScreenshotRequest* request) {
+    FILE* file = fopen(request->filename, "wb");
+    if (file == NULL) {
+        LOG(WARNING, SCREENSHOT, "failed to open %s\n", request->filename);
+        return false;
+    }
+
+    bool encoded = ScreenshotEncodePNG(file, request->palette_indices, screenshot->width, screenshot->height, screenshot->palette);
+    if (fclose(file) != 0 || !encoded) {
+        LOG(WARNING, SCREENSHOT, "failed to write %s\n", request->filename);
+        return false;
+    }
+    LOG(INFO, SCREENSHOT, "saved %s\n", request->filename);
+    return true;
+}
+
+static int Encoder(void* data) {
+    struct Screenshot* screenshot = (struct Screenshot*)data;
+
+    mtx_lock(&screenshot->mutex);
+    while (true) {
+        while (screenshot->queued == 0 && !screenshot->stop) {
+            cnd_wait(&screenshot->request_queued, &screenshot->mutex);
+        }
+        if (screenshot->queued == 0) {
+            break;
+        }
+        const struct ScreenshotRequest* request = &screenshot->requests[screenshot->read_index];
+        mtx_unlock(&screenshot->mutex);
+
+        bool saved = Save(screenshot, request);
+
+        mtx_lock(&screenshot->mutex);
+        if (saved) {
+            screenshot->saved++;
+        } else {
+            screenshot->failed++;
+        }
+        screenshot->read_index = (screenshot->read_index + 1) % SCREENSHOT_QUEUE_LENGTH;
+        screenshot->queued--;
+        cnd_broadcast(&screenshot->request_done);
+    }
+    mtx_unlock(&screenshot->mutex);
+
+    return 0;
+}
+
+
+void ScreenshotInit(struct Screenshot* screenshot, const struct Palette* palette, const uint16_t width, const uint16_t height) {
+    screenshot->palette = palette;
+    screenshot->width = width;
+    screenshot->height = height;
+
+    for (uint8_t i = 0; i < SCREENSHOT_QUEUE_LENGTH; i++) {
+        screenshot->requests[i].filename[0] = '\0';
+        screenshot->requests[i].palette_indices = (uint16_t*)malloc((size_t)width * height * sizeof(uint16_t));
+        if (screenshot->requests[i].palette_indices == NULL) {
+            LOG(ERROR, SCREENSHOT, "failed to allocate the screenshot queue\n");
+        }
+    }
+
+    screenshot->read_index = 0;
+    screenshot->write_index = 0;
+    screenshot->queued = 0;
+    screenshot->stop = false;
+
+    screenshot->saved = 0;
+    screenshot->failed = 0;
+    screenshot->dropped = 0;
+
+    if (mtx_init(&screenshot->mutex, mtx_plain) != thrd_success
+        || cnd_init(&screenshot->request_queued) != thrd_success || cnd_init(&screenshot->request_done) != thrd_success) {
+        LOG(ERROR, SCREENSHOT, "failed to create the encoder synchronization\n");
+    }
+    if (thrd_create(&screenshot->encoder, &Encoder, screenshot) != thrd_success) {
+        LOG(ERROR, SCREENSHOT, "failed to start the encoder thread\n");
+    }
+}
+
+void ScreenshotClean(struct Screenshot* screenshot) {
+    mtx_lock(&screenshot->mutex);
+    screenshot->stop = true;
+    cnd_signal(&screenshot->request_queued);
+    mtx_unlock(&screenshot->mutex);
+
+    thrd_join(screenshot->encoder, NULL);
+
+    cnd_destroy(&screenshot->request_done);
+    cnd_destroy(&screenshot->request_queued);
+    mtx_destroy(&screenshot->mutex);
+
+    for (uint8_t i = 0; i < SCREENSHOT_QUEUE_LENGTH; i++) {
+        free(screenshot->requests[i].palette_indices);
+        screenshot->requests[i].palette_indices = NULL;
+    }
+
+    if (screenshot->saved + screenshot->failed + screenshot->dropped > 0) {
+        LOG(INFO, SCREENSHOT, "%u screenshots saved, %u failed, %u dropped (queue full)\n", screenshot->saved, screenshot->failed, screenshot->dropped);
+    }
+}
+
+bool ScreenshotTake(struct Screenshot* screenshot, const uint16_t* palette_indices, const char* filename, const bool wait) {
+    mtx_lock(&screenshot->mutex);
+    while (wait && screenshot->queued == SCREENSHOT_QUEUE_LENGTH) {
+        cnd_wait(&screenshot->request_done, &screenshot->mutex);
+    }
+    if (screenshot->queued == SCREENSHOT_QUEUE_LENGTH) {
+        screenshot->dropped++;
+        mtx_unlock(&screenshot->mutex);
+        LOG(WARNING, SCREENSHOT, "dropped %s, %u screenshots are still being encoded\n", filename, SCREENSHOT_QUEUE_LENGTH);
+        return false;
+    }
+
+    // a frame is only a 120KB copy, the encoding is what would hitch
+    struct ScreenshotRequest* request = &screenshot->requests[screenshot->write_index];
+    snprintf(request->filename, SCREENSHOT_FILENAME_LENGTH, "%s", filename);
+    memcpy(request->palette_indices, palette_indices, (size_t)screenshot->width * screenshot->height * sizeof(uint16_t));
+
+    screenshot->write_index = (screenshot->write_index + 1) % SCREENSHOT_QUEUE_LENGTH;
+    screenshot->queued++;
+    cnd_signal(&screenshot->request_queued);
+    mtx_unlock(&screenshot->mutex);
+    return true;
+}
\ No newline at end of file
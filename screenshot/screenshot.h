@@ -0,0 +1,52 @@
+#ifndef SCREENSHOT_H
+#define SCREENSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <threads.h>
+
+#include "palette.h"
+
+
+// screenshots waiting to be encoded
+#define SCREENSHOT_QUEUE_LENGTH 4
+#define SCREENSHOT_FILENAME_LENGTH 512
+
+
+struct ScreenshotRequest {
+    char filename[SCREENSHOT_FILENAME_LENGTH];
+    uint16_t* palette_indices;
+};
+
+// copies of the frames are queued and an encoder thread turns them into png files,
+// any thread can take a screenshot (the copy is made under the lock)
+struct Screenshot {
+    const struct Palette* palette;
+    uint16_t width;
+    uint16_t height;
+
+    struct ScreenshotRequest requests[SCREENSHOT_QUEUE_LENGTH];
+    uint8_t read_index;
+    uint8_t write_index;
+    uint8_t queued;
+
+    thrd_t encoder;
+    mtx_t mutex;
+    cnd_t request_queued;
+    cnd_t request_done;
+    bool stop;
+
+    uint32_t saved;
+    uint32_t failed;
+    uint32_t dropped;
+};
+
+
+void ScreenshotInit(struct Screenshot* screenshot, const struct Palette* palette, const uint16_t width, const uint16_t height);
+// encodes the queued screenshots before it returns
+void ScreenshotClean(struct Screenshot* screenshot);
+
+// returns false (and drops the screenshot) when the queue is full, unless wait is set (batch runs) which waits for a free slot instead
+bool ScreenshotTake(struct Screenshot* screenshot, const uint16_t* palette_indices, const char* filename, const bool wait);
+
+#endif
\ No newline at end of file
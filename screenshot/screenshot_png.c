@@ -0,0 +1,314 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "screenshot_png.h"
+
+
+#define DEFLATE_WINDOW_SIZE 32768
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_END_OF_BLOCK 256
+
+#define PNG_COLOR_TYPE_RGB 2
+#define PNG_COLOR_TYPE_INDEXED 3
+#define PNG_FILTER_NONE 0
+#define PNG_FILTER_UP 2
+
+#define CRC32_POLYNOMIAL 0xEDB88320   // reflected
+#define ADLER32_MODULO 65521
+
+
+// rfc 1951 length codes 257 - 285 and distance codes 0 - 29
+static const uint16_t length_bases[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const uint8_t length_extra_bits[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const uint16_t distance_bases[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+static const uint8_t distance_extra_bits[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+
+struct BitWriter {
+    uint8_t* data;
+    size_t size;
+    uint32_t bits;
+    uint8_t bit_count;
+};
+
+// deflate packs everything from the lowest bit up
+static inline void WriteBits(struct BitWriter* writer, const uint32_t value, const uint8_t count) {
+    writer->bits |= value << writer->bit_count;
+    writer->bit_count += count;
+    while (writer->bit_count >= 8) {
+        writer->data[writer->size++] = writer->bits & 0xFF;
+        writer->bits >>= 8;
+        writer->bit_count -= 8;
+    }
+}
+
+// except the huffman codes, those start with their highest bit
+static inline void WriteCode(struct BitWriter* writer, const uint16_t code, const uint8_t length) {
+    uint16_t reversed = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        reversed |= ((code >> i) & 1) << (length - 1 - i);
+    }
+    WriteBits(writer, reversed, length);
+}
+
+// the fixed literal/length code of rfc 1951 3.2.6
+static void WriteLiteralLength(struct BitWriter* writer, const uint16_t symbol) {
+    if (symbol < 144) {
+        WriteCode(writer, 0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        WriteCode(writer, 0x190 + (symbol - 144), 9);
+    } else if (symbol < 280) {
+        WriteCode(writer, symbol - 256, 7);
+    } else {
+        WriteCode(writer, 0xC0 + (symbol - 280), 8);
+    }
+}
+
+static void WriteMatch(struct BitWriter* writer, const uint16_t length, const uint16_t distance) {
+    uint8_t length_code = 0;
+    while (length_code < 28 && length_bases[length_code + 1] <= length) {
+        length_code++;
+    }
+    WriteLiteralLength(writer, 257 + length_code);
+    WriteBits(writer, length - length_bases[length_code], length_extra_bits[length_code]);
+
+    uint8_t distance_code = 0;
+    while (distance_code < 29 && distance_bases[distance_code + 1] <= distance) {
+        distance_code++;
+    }
+    WriteCode(writer, distance_code, 5);
+    WriteBits(writer, distance - distance_bases[distance_code], distance_extra_bits[distance_code]);
+}
+
+static inline uint32_t Hash(const uint8_t* data) {
+    uint32_t bytes = (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16);
+    return (bytes * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+static inline size_t MatchLength(const uint8_t* data, const size_t size, const size_t position, const size_t candidate) {
+    size_t max_length = size - position;
+    max_length = (max_length > DEFLATE_MAX_MATCH) ? DEFLATE_MAX_MATCH : max_length;
+
+    size_t length = 0;
+    while (length < max_length && data[candidate + length] == data[position + length]) {
+        length++;
+    }
+    return length;
+}
+
+// one fixed huffman block, the data is at most a frame so it's all in the window anyway
+static bool Deflate(const uint8_t* data, const size_t size, struct BitWriter* writer) {
+    int32_t* head = (int32_t*)malloc((1 << DEFLATE_HASH_BITS) * sizeof(int32_t));
+    if (head == NULL) {
+        return false;
+    }
+    memset(head, 0xFF, (1 << DEFLATE_HASH_BITS) * sizeof(int32_t));
+
+    WriteBits(writer, 1, 1);   // last block
+    WriteBits(writer, 1, 2);   // fixed huffman codes
+
+    size_t position = 0;
+    while (position < size) {
+        size_t best_length = 0;
+        size_t best_distance = 0;
+
+        if (position + DEFLATE_MIN_MATCH <= size) {
+            uint32_t hash = Hash(&data[position]);
+            int32_t candidate = head[hash];
+            head[hash] = (int32_t)position;
+
+            if (candidate >= 0 && position - (size_t)candidate <= DEFLATE_WINDOW_SIZE) {
+                best_length = MatchLength(data, size, position, (size_t)candidate);
+                best_distance = position - (size_t)candidate;
+            }
+            // runs of the same byte (flat backgrounds, rows zeroed by the up filter) are the common case
+            if (position > 0 && best_length < DEFLATE_MAX_MATCH) {
+                size_t run_length = MatchLength(data, size, position, position - 1);
+                if (run_length > best_length) {
+                    best_length = run_length;
+                    best_distance = 1;
+                }
+            }
+        }
+
+        if (best_length >= DEFLATE_MIN_MATCH) {
+            WriteMatch(writer, (uint16_t)best_length, (uint16_t)best_distance);
+            for (size_t i = 1; i < best_length && position + i + DEFLATE_MIN_MATCH <= size; i++) {
+                head[Hash(&data[position + i])] = (int32_t)(position + i);
+            }
+            position += best_length;
+        } else {
+            WriteLiteralLength(writer, data[position]);
+            position++;
+        }
+    }
+
+    WriteLiteralLength(writer, DEFLATE_END_OF_BLOCK);
+    if (writer->bit_count > 0) {
+        WriteBits(writer, 0, 8 - writer->bit_count);
+    }
+
+    free(head);
+    return true;
+}
+
+
+static inline void WriteU32(uint8_t* destination, const uint32_t value) {
+    destination[0] = (value >> 24) & 0xFF;
+    destination[1] = (value >> 16) & 0xFF;
+    destination[2] = (value >> 8) & 0xFF;
+    destination[3] = value & 0xFF;
+}
+
+static uint32_t Adler32(const uint8_t* data, const size_t size) {
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (size_t i = 0; i < size; i++) {
+        a = (a + data[i]) % ADLER32_MODULO;
+        b = (b + a) % ADLER32_MODULO;
+    }
+    return (b << 16) | a;
+}
+
+static uint32_t CRC32(const uint32_t table[256], uint32_t crc, const uint8_t* data, const size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static bool WriteChunk(FILE* file, const uint32_t crc_table[256], const char type[4], const uint8_t* data, const uint32_t size) {
+    uint8_t header[8];
+    WriteU32(header, size);
+    memcpy(&header[4], type, 4);
+
+    uint32_t crc = CRC32(crc_table, 0xFFFFFFFF, &header[4], 4);
+    crc = ~CRC32(crc_table, crc, data, size);
+    uint8_t footer[4];
+    WriteU32(footer, crc);
+
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header)
+        && (size == 0 || fwrite(data, 1, size, file) == size)
+        && fwrite(footer, 1, sizeof(footer), file) == sizeof(footer);
+}
+
+
+bool ScreenshotEncodePNG(FILE* file, const uint16_t* palette_indices, const uint16_t width, const uint16_t height, const struct Palette* palette) {
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    // cheap enough to build per image, and the encoder stays free of shared state
+    uint32_t crc_table[256];
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? ((crc >> 1) ^ CRC32_POLYNOMIAL) : (crc >> 1);
+        }
+        crc_table[i] = crc;
+    }
+
+    uint32_t pixel_count = (uint32_t)width * height;
+
+    // palette index -> PLTE entry, in the order they first show up
+    int16_t plte_entries[PALETTE_INDEX_COUNT];
+    memset(plte_entries, 0xFF, sizeof(plte_entries));
+    uint8_t plte[SCREENSHOT_PNG_MAX_PALETTE_SIZE * 3];
+    uint16_t plte_size = 0;
+    bool indexed = true;
+    for (uint32_t i = 0; i < pixel_count && indexed; i++) {
+        uint16_t palette_index = palette_indices[i] % PALETTE_INDEX_COUNT;
+        if (plte_entries[palette_index] >= 0) {
+            continue;
+        }
+        if (plte_size == SCREENSHOT_PNG_MAX_PALETTE_SIZE) {
+            indexed = false;
+            break;
+        }
+        uint32_t rgba = palette->colors_rgba[palette_index];
+        plte[plte_size * 3 + 0] = (rgba >> 24) & 0xFF;
+        plte[plte_size * 3 + 1] = (rgba >> 16) & 0xFF;
+        plte[plte_size * 3 + 2] = (rgba >> 8) & 0xFF;
+        plte_entries[palette_index] = (int16_t)plte_size++;
+    }
+
+    // every row starts with its filter byte
+    uint8_t bytes_per_pixel = indexed ? 1 : 3;
+    size_t row_size = 1 + (size_t)width * bytes_per_pixel;
+    size_t raw_size = row_size * height;
+    uint8_t* raw = (uint8_t*)malloc(raw_size);
+    // the fixed codes are at most 9 bits per byte, plus the zlib header and adler32
+    uint8_t* compressed = (uint8_t*)malloc(raw_size + raw_size / 8 + 64);
+    if (raw == NULL || compressed == NULL) {
+        free(raw);
+        free(compressed);
+        return false;
+    }
+
+    for (uint16_t y = 0; y < height; y++) {
+        uint8_t* row = &raw[y * row_size];
+        const uint16_t* source = &palette_indices[y * width];
+        for (uint16_t x = 0; x < width; x++) {
+            uint16_t palette_index = source[x] % PALETTE_INDEX_COUNT;
+            if (indexed) {
+                row[1 + x] = (uint8_t)plte_entries[palette_index];
+            } else {
+                uint32_t rgba = palette->colors_rgba[palette_index];
+                row[1 + x * 3 + 0] = (rgba >> 24) & 0xFF;
+                row[1 + x * 3 + 1] = (rgba >> 16) & 0xFF;
+                row[1 + x * 3 + 2] = (rgba >> 8) & 0xFF;
+            }
+        }
+    }
+    // from the bottom up, so every row is still unfiltered when the one below it reads it
+    for (uint16_t y = height - 1; y > 0; y--) {
+        uint8_t* row = &raw[y * row_size];
+        const uint8_t* above = &raw[(y - 1) * row_size];
+        row[0] = PNG_FILTER_UP;
+        for (size_t i = 1; i < row_size; i++) {
+            row[i] = row[i] - above[i];
+        }
+    }
+    raw[0] = PNG_FILTER_NONE;
+
+    struct BitWriter writer = {
+        .data = compressed,
+        .size = 0,
+        .bits = 0,
+        .bit_count = 0,
+    };
+    // zlib header: deflate with a 32KB window, no preset dictionary, fastest
+    compressed[writer.size++] = 0x78;
+    compressed[writer.size++] = 0x01;
+    bool deflated = Deflate(raw, raw_size, &writer);
+    WriteU32(&compressed[writer.size], Adler32(raw, raw_size));
+    writer.size += 4;
+
+    uint8_t header[13];
+    WriteU32(&header[0], width);
+    WriteU32(&header[4], height);
+    header[8] = 8;   // bit depth
+    header[9] = indexed ? PNG_COLOR_TYPE_INDEXED : PNG_COLOR_TYPE_RGB;
+    header[10] = 0;  // deflate
+    header[11] = 0;  // adaptive filtering
+    header[12] = 0;  // not interlaced
+
+    bool written = deflated
+        && fwrite(signature, 1, sizeof(signature), file) == sizeof(signature)
+        && WriteChunk(file, crc_table, "IHDR", header, sizeof(header))
+        && (!indexed || WriteChunk(file, crc_table, "PLTE", plte, plte_size * 3))
+        && WriteChunk(file, crc_table, "IDAT", compressed, (uint32_t)writer.size)
+        && WriteChunk(file, crc_table, "IEND", NULL, 0);
+
+    free(raw);
+    free(compressed);
+    return written;
+}
\ No newline at end of file
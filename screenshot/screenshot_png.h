@@ -0,0 +1,19 @@
+#ifndef SCREENSHOT_PNG_H
+#define SCREENSHOT_PNG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "palette.h"
+
+
+// a frame rarely has more than a few dozen colors, so it's saved with a PLTE (rgb above 256 distinct palette indices)
+#define SCREENSHOT_PNG_MAX_PALETTE_SIZE 256
+
+
+// small self contained encoder: fixed huffman deflate with a single candidate hash matcher and the up filter,
+// a whole frame takes a few ms and ends up a few KB
+bool ScreenshotEncodePNG(FILE* file, const uint16_t* palette_indices, const uint16_t width, const uint16_t height, const struct Palette* palette);
+
+#endif
\ No newline at end of file
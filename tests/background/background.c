@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "emulator.h"
+#include "logger.h"
+
+
+// the test writes a small MMC3 rom (2 * 16KB prg, 32KB chr) and renders it twice, once with the background line cache
+// and once with every line through the fetch pipeline: the irq handler switches the background chr bank and the mirroring
+// every 8 scanlines, the main loop keeps writing prg ram and the nmi handler scrolls a bit further every frame
+#define TEST_PRG_ROM_SIZE 0x8000
+#define TEST_CHR_ROM_SIZE 0x8000
+#define TEST_PRG_ROM_START 0x8000
+#define TEST_RESET_ADDRESS 0xE000
+#define TEST_IRQ_ADDRESS 0xE080
+#define TEST_NMI_ADDRESS 0xE0C0
+#define TEST_SEED 0x4E5
+
+#define TEST_FRAMES 120
+#define TEST_MIN_CACHED_FRACTION 4
+
+
+static uint32_t random_state = TEST_SEED;
+
+static uint8_t RandomByte(void) {
+    random_state = random_state * 1103515245 + 12345;
+    return (uint8_t)(random_state >> 16);
+}
+
+static void WriteTestROM(const char* filename) {
+    static uint8_t prg_rom[TEST_PRG_ROM_SIZE];
+    static uint8_t chr_rom[TEST_CHR_ROM_SIZE];
+    memset(prg_rom, 0xFF, sizeof(prg_rom));
+    for (uint32_t i = 0; i < TEST_CHR_ROM_SIZE; i++) {
+        chr_rom[i] = RandomByte();
+    }
+
+    const uint8_t reset[] = {
+        0x78, 0xD8,             // sei, cld
+        0xA2, 0xFF, 0x9A,       // ldx #$FF, txs
+        0xA9, 0x40,             // lda #$40
+        0x8D, 0x17, 0x40,       // sta $4017 (no apu frame irq)
+        0xA9, 0x80,             // lda #$80
+        0x8D, 0x01, 0xA0,       // sta $A001 (prg ram on)
+        0xA9, 0x20,             // lda #$20
+        0x8D, 0x06, 0x20,       // sta $2006
+        0xA9, 0x00,             // lda #$00
+        0x8D, 0x06, 0x20,       // sta $2006
+        0xA0, 0x08,             // ldy #8
+        0xA2, 0x00,             // ldx #0
+        0x8A,                   // txa (0xE01D)
+        0x8D, 0x07, 0x20,       // sta $2007 (both nametables get 0 - 255 4 times)
+        0xE8,                   // inx
+        0xD0, 0xF9,             // bne $E01D
+        0x88,                   // dey
+        0xD0, 0xF6,             // bne $E01D
+        0xA9, 0x3F,             // lda #$3F
+        0x8D, 0x06, 0x20,       // sta $2006
+        0xA9, 0x00,             // lda #$00
+        0x8D, 0x06, 0x20,       // sta $2006
+        0xAA,                   // tax
+        0x8A,                   // txa (0xE032)
+        0x8D, 0x07, 0x20,       // sta $2007 (palette 0 - 31)
+        0xE8,                   // inx
+        0xE0, 0x20,             // cpx #$20
+        0xD0, 0xF7,             // bne $E032
+        0xA9, 0x00,             // lda #0
+        0x8D, 0x05, 0x20,       // sta $2005
+        0x8D, 0x05, 0x20,       // sta $2005
+        0xA9, 0x07,             // lda #7
+        0x8D, 0x00, 0xC0,       // sta $C000 (latch)
+        0x8D, 0x01, 0xC0,       // sta $C001 (reload)
+        0x8D, 0x01, 0xE0,       // sta $E001 (enable)
+        0xA9, 0x88,             // lda #$88
+        0x8D, 0x00, 0x20,       // sta $2000 (nmi on, sprites at 0x1000)
+        0xA9, 0x1E,             // lda #$1E
+        0x8D, 0x01, 0x20,       // sta $2001 (rendering on)
+        0x58,                   // cli
+        0xEE, 0x00, 0x60,       // inc $6000 (0xE059)
+        0x8D, 0x00, 0x70,       // sta $7000
+        0x4C, 0x59, 0xE0,       // jmp $E059
+    };
+    const uint8_t irq[] = {
+        0x48,                   // pha
+        0xE6, 0x10,             // inc $10
+        0xA9, 0x00,             // lda #0
+        0x8D, 0x00, 0x80,       // sta $8000 (select the chr bank at 0x0000)
+        0xA5, 0x10,             // lda $10
+        0x0A,                   // asl
+        0x29, 0x1E,             // and #$1E (2KB banks inside the 32KB chr rom)
+        0x8D, 0x01, 0x80,       // sta $8001
+        0xA5, 0x10,             // lda $10
+        0x29, 0x01,             // and #1
+        0x8D, 0x00, 0xA0,       // sta $A000 (mirroring)
+        0x8D, 0x00, 0x61,       // sta $6100
+        0x8D, 0x00, 0xE0,       // sta $E000 (acknowledge)
+        0x8D, 0x01, 0xE0,       // sta $E001 (enable)
+        0x68,                   // pla
+        0x40,                   // rti
+    };
+    const uint8_t nmi[] = {
+        0x48,                   // pha
+        0xAD, 0x02, 0x20,       // lda $2002
+        0xE6, 0x11,             // inc $11
+        0xA5, 0x11,             // lda $11
+        0x8D, 0x05, 0x20,       // sta $2005
+        0x8D, 0x05, 0x20,       // sta $2005
+        0x68,                   // pla
+        0x40,                   // rti
+    };
+    memcpy(&prg_rom[TEST_RESET_ADDRESS - TEST_PRG_ROM_START], reset, sizeof(reset));
+    memcpy(&prg_rom[TEST_IRQ_ADDRESS - TEST_PRG_ROM_START], irq, sizeof(irq));
+    memcpy(&prg_rom[TEST_NMI_ADDRESS - TEST_PRG_ROM_START], nmi, sizeof(nmi));
+
+    const uint16_t vectors[3] = { TEST_NMI_ADDRESS, TEST_RESET_ADDRESS, TEST_IRQ_ADDRESS };
+    for (uint8_t i = 0; i < 3; i++) {
+        prg_rom[NON_MASKABLE_INTERRUPT_OFFSET - TEST_PRG_ROM_START + i * 2] = vectors[i] & 0xFF;
+        prg_rom[NON_MASKABLE_INTERRUPT_OFFSET - TEST_PRG_ROM_START + i * 2 + 1] = vectors[i] >> 8;
+    }
+
+    // iNES header: 2 prg units, 4 chr units, mapper 4
+    const uint8_t header[16] = { 'N', 'E', 'S', 0x1A, 2, 4, 0x40, 0x00 };
+
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) {
+        LOG(ERROR, MAIN, "failed to write the test rom: %s\n", filename);
+    }
+    fwrite(header, 1, sizeof(header), file);
+    fwrite(prg_rom, 1, sizeof(prg_rom), file);
+    fwrite(chr_rom, 1, sizeof(chr_rom), file);
+    fclose(file);
+}
+
+
+struct TestRun {
+    struct Emulator emulator;
+    uint16_t palette_indices[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT];
+    uint32_t instructions;
+    // the ones that started while the ppu was on a line copied from the cache
+    uint32_t cached_instructions;
+};
+
+static void CountInstructions(struct CPU* cpu, void* data) {
+    struct TestRun* run = (struct TestRun*)data;
+    run->instructions++;
+    if (run->emulator.ppu.background_line_cached) {
+        run->cached_instructions++;
+    }
+}
+
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        LOG(ERROR, MAIN, "usage: %s test_rom.nes  (the rom is written there)\n", argv[0]);
+    }
+    WriteTestROM(argv[1]);
+
+    static struct TestRun cached;
+    static struct TestRun pipeline;
+    EmulatorInit(&cached.emulator, argv[1]);
+    EmulatorInit(&pipeline.emulator, argv[1]);
+    pipeline.emulator.ppu.background_cache_enabled = false;
+    CPUSetTraceHook(&cached.emulator.cpu, &CountInstructions, &cached);
+
+    bool passed = true;
+    for (uint32_t frame = 0; frame < TEST_FRAMES && passed; frame++) {
+        EmulatorRenderPaletteIndices(&cached.emulator, cached.palette_indices);
+        EmulatorRenderPaletteIndices(&pipeline.emulator, pipeline.palette_indices);
+
+        for (uint32_t i = 0; i < NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT; i++) {
+            if (cached.palette_indices[i] != pipeline.palette_indices[i]) {
+                LOG(
+                    INFO, MAIN, "frame %u differs at %u, %u: 0x%03X with the cache, 0x%03X through the pipeline\n",
+                    frame, i % NES_SCREEN_WIDTH, i / NES_SCREEN_WIDTH, cached.palette_indices[i], pipeline.palette_indices[i]
+                );
+                passed = false;
+                break;
+            }
+        }
+    }
+
+    // the prg ram writes of the main loop must not throw the ppu off the cached lines, 
+    // most of the instructions run during the visible lines so well over a quarter of them should be on cached ones
+    if (cached.cached_instructions < cached.instructions / TEST_MIN_CACHED_FRACTION) {
+        LOG(INFO, MAIN, "only %u of %u instructions ran on lines from the background cache\n", cached.cached_instructions, cached.instructions);
+        passed = false;
+    }
+
+    EmulatorClean(&cached.emulator);
+    EmulatorClean(&pipeline.emulator);
+
+    if (!passed) {
+        return 1;
+    }
+    LOG(INFO, MAIN, "%u frames match with and without the background cache (%u of %u instructions ran on cached lines)\n", TEST_FRAMES, cached.cached_instructions, cached.instructions);
+    return 0;
+}
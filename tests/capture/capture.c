@@ -0,0 +1,36 @@
+#include <stdio.h>
+
+#include "capture.h"
+#include "logger.h"
+
+
+// the command exits after the first bytes, so the writer runs into a closed pipe on the first frames
+#define CAPTURE_TEST_TARGET "|head -c 10 >/dev/null"
+#define CAPTURE_TEST_WIDTH 256
+#define CAPTURE_TEST_HEIGHT 240
+#define CAPTURE_TEST_FRAMES 64
+
+
+int main(void) {
+    static struct Palette palette;
+    static uint16_t palette_indices[CAPTURE_TEST_WIDTH * CAPTURE_TEST_HEIGHT];
+    PaletteInit(&palette);
+
+    static struct Capture capture;
+    CaptureStart(&capture, CAPTURE_TEST_TARGET, CAPTURE_Y4M, &palette, CAPTURE_TEST_WIDTH, CAPTURE_TEST_HEIGHT, 60.0f);
+    for (uint32_t frame = 0; frame < CAPTURE_TEST_FRAMES; frame++) {
+        for (uint32_t i = 0; i < CAPTURE_TEST_WIDTH * CAPTURE_TEST_HEIGHT; i++) {
+            palette_indices[i] = (uint16_t)((i + frame) % PALETTE_INDEX_COUNT);
+        }
+        CapturePushPaletteIndices(&capture, palette_indices);
+    }
+    CaptureStop(&capture);
+
+    // getting here at all means the closed pipe didn't take the process down
+    if (!capture.write_failed || capture.frames_written == CAPTURE_TEST_FRAMES) {
+        LOG(INFO, MAIN, "the capture into the closed pipe didn't fail (%u of %u frames written)\n", capture.frames_written, CAPTURE_TEST_FRAMES);
+        return 1;
+    }
+    LOG(INFO, MAIN, "the capture stopped after %u frames when the pipe closed\n", capture.frames_written);
+    return 0;
+}
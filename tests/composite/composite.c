@@ -0,0 +1,92 @@
+#include <stdio.h>
+
+#include "ppu_composite.h"
+#include "logger.h"
+
+
+// every mask register value is tried on this many random scanlines
+#define COMPOSITE_LINES_PER_MASK 64
+#define COMPOSITE_SEED 0x2C0A5E
+
+#define BACKGROUND_COLOR_ADDRESS_BITS 0x0F
+#define SPRITE_LINE_BITS (SPRITE_LINE_COLOR_ADDRESS_BITS | SPRITE_LINE_BEHIND_BACKGROUND_BIT | SPRITE_LINE_SPRITE_0_BIT)
+
+
+static const char* kernel_names[] = {
+    [PPU_COMPOSITE_SCALAR] = "scalar",
+    [PPU_COMPOSITE_SSE2] = "sse2",
+    [PPU_COMPOSITE_AVX2] = "avx2",
+};
+
+
+static uint32_t random_state = COMPOSITE_SEED;
+
+static uint8_t RandomByte(void) {
+    random_state = random_state * 1103515245 + 12345;
+    return (uint8_t)(random_state >> 16);
+}
+
+// random background color addresses (0 - 15), sprite line entries (sprite colors 0x10 - 0x1F, behind and sprite 0 bits),
+// palette ram (the whole byte, the kernels have to drop the upper bits themselves) and backdrop
+static void RandomScanline(uint8_t background[NES_SCREEN_WIDTH], uint8_t sprites[NES_SCREEN_WIDTH], uint8_t palette[PALETTE_RAM_SIZE], uint8_t* backdrop_color_address) {
+    for (int x = 0; x < NES_SCREEN_WIDTH; x++) {
+        background[x] = RandomByte() & BACKGROUND_COLOR_ADDRESS_BITS;
+        sprites[x] = RandomByte() & SPRITE_LINE_BITS;
+    }
+    for (int i = 0; i < PALETTE_RAM_SIZE; i++) {
+        palette[i] = RandomByte();
+    }
+    for (int i = 0x10; i < PALETTE_RAM_SIZE; i += 4) {
+        palette[i] = palette[i - 0x10];
+    }
+    *backdrop_color_address = RandomByte() & SPRITE_LINE_COLOR_ADDRESS_BITS;
+}
+
+static bool CheckKernel(const enum PPUCompositeKernel kernel) {
+    static uint8_t background[NES_SCREEN_WIDTH];
+    static uint8_t sprites[NES_SCREEN_WIDTH];
+    static uint8_t palette[PALETTE_RAM_SIZE];
+    static uint16_t expected[NES_SCREEN_WIDTH];
+    static uint16_t palette_indices[NES_SCREEN_WIDTH];
+
+    random_state = COMPOSITE_SEED;
+    for (uint16_t mask_register = 0; mask_register < 0x100; mask_register++) {
+        for (int line = 0; line < COMPOSITE_LINES_PER_MASK; line++) {
+            uint8_t backdrop_color_address;
+            RandomScanline(background, sprites, palette, &backdrop_color_address);
+
+            PPUCompositeSelectKernel(PPU_COMPOSITE_SCALAR);
+            PPUCompositeScanline(background, sprites, palette, (uint8_t)mask_register, backdrop_color_address, expected);
+            PPUCompositeSelectKernel(kernel);
+            PPUCompositeScanline(background, sprites, palette, (uint8_t)mask_register, backdrop_color_address, palette_indices);
+
+            for (int x = 0; x < NES_SCREEN_WIDTH; x++) {
+                if (palette_indices[x] != expected[x]) {
+                    LOG(
+                        INFO, MAIN, "%s kernel differs at x %d with mask 0x%02X (background 0x%02X, sprite 0x%02X, backdrop 0x%02X): 0x%03X instead of 0x%03X\n",
+                        kernel_names[kernel], x, mask_register, background[x], sprites[x], backdrop_color_address, palette_indices[x], expected[x]
+                    );
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+int main(void) {
+    bool passed = true;
+    for (enum PPUCompositeKernel kernel = PPU_COMPOSITE_SSE2; kernel <= PPU_COMPOSITE_AVX2; kernel++) {
+        if (!PPUCompositeSelectKernel(kernel)) {
+            LOG(INFO, MAIN, "%s kernel isn't supported here, skipped\n", kernel_names[kernel]);
+            continue;
+        }
+        if (CheckKernel(kernel)) {
+            LOG(INFO, MAIN, "%s kernel matches the scalar kernel\n", kernel_names[kernel]);
+        } else {
+            passed = false;
+        }
+    }
+    return passed ? 0 : 1;
+}
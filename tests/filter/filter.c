@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter.h"
+#include "filter_kernels.h"
+#include "filter_ntsc.h"
+#include "palette.h"
+#include "logger.h"
+
+
+// a few colors make the equal neighbours the scale filters look for, the odd size runs the scalar row ends of the simd kernels
+#define FILTER_FRAMES 8
+#define FILTER_COLORS 4
+#define FILTER_SEED 0xF1173
+
+#define FILTER_MAX_WIDTH 256
+#define FILTER_MAX_HEIGHT 240
+
+// a flat line of one color is decoded for every palette index and the middle pixel is compared with the palette,
+// the decoder truncates into a gamma table and the palette rounds, so they can be a step apart
+#define FILTER_FLAT_WIDTH 16
+#define FILTER_FLAT_TOLERANCE 2
+
+
+struct FilterCase {
+    enum FilterKind kind;
+    uint8_t scale;
+    const char* name;
+};
+
+static const struct FilterCase filter_cases[] = {
+    { FILTER_NEAREST, 1, "nearest 1x" },
+    { FILTER_NEAREST, 2, "nearest 2x" },
+    { FILTER_NEAREST, 3, "nearest 3x" },
+    { FILTER_NEAREST, 4, "nearest 4x" },
+    { FILTER_SCALEX, 2, "scale2x" },
+    { FILTER_SCALEX, 3, "scale3x" },
+    { FILTER_SCALEX, 4, "scale4x" },
+    { FILTER_XBR_LITE, 2, "xbr-lite 2x" },
+    { FILTER_XBR_LITE, 4, "xbr-lite 4x" },
+};
+
+static const uint16_t frame_sizes[][2] = {
+    { FILTER_MAX_WIDTH, FILTER_MAX_HEIGHT },
+    { 37, 11 },
+};
+
+// the ntsc tables with the default, tweaked and loaded (the built in one here) palettes
+struct FilterPaletteCase {
+    struct PaletteParameters parameters;
+    bool loaded;
+    const char* name;
+};
+
+static const struct FilterPaletteCase palette_cases[] = {
+    { { 0.0f, 1.0f, 2.2f / 1.8f }, false, "default" },
+    { { 20.0f, 1.4f, 1.6f }, false, "hue 20, saturation 1.4, gamma 1.6" },
+    { { -15.0f, 0.5f, 1.0f }, true, "loaded palette" },
+};
+
+static const char* kernel_set_names[] = {
+    [FILTER_KERNELS_SCALAR] = "scalar",
+    [FILTER_KERNELS_SSE2] = "sse2",
+    [FILTER_KERNELS_AVX] = "avx",
+};
+
+
+static uint32_t random_state = FILTER_SEED;
+
+static uint32_t RandomWord(void) {
+    random_state = random_state * 1103515245 + 12345;
+    return random_state;
+}
+
+// every other frame is made of a few colors, the rest are random bytes
+static void RandomFrame(uint32_t* pixels, const uint32_t pixel_count, const uint32_t frame) {
+    uint32_t colors[FILTER_COLORS];
+    for (uint8_t i = 0; i < FILTER_COLORS; i++) {
+        colors[i] = RandomWord() | 0xFF;
+    }
+    for (uint32_t i = 0; i < pixel_count; i++) {
+        pixels[i] = (frame & 1) ? RandomWord() : colors[(RandomWord() >> 16) % FILTER_COLORS];
+    }
+}
+
+// random palette indices, the emphasis bits included
+static void RandomPaletteIndices(uint16_t* palette_indices, const uint32_t pixel_count, const uint32_t frame) {
+    uint16_t colors[FILTER_COLORS];
+    for (uint8_t i = 0; i < FILTER_COLORS; i++) {
+        colors[i] = (RandomWord() >> 16) % PALETTE_INDEX_COUNT;
+    }
+    for (uint32_t i = 0; i < pixel_count; i++) {
+        palette_indices[i] = (frame & 1) ? ((RandomWord() >> 16) % PALETTE_INDEX_COUNT) : colors[(RandomWord() >> 16) % FILTER_COLORS];
+    }
+}
+
+static bool Near(const uint32_t color, const uint32_t expected) {
+    for (uint8_t shift = 8; shift < 32; shift += 8) {
+        int difference = (int)((color >> shift) & 0xFF) - (int)((expected >> shift) & 0xFF);
+        if (difference > FILTER_FLAT_TOLERANCE || difference < -FILTER_FLAT_TOLERANCE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the flat colors of the ntsc filter have to be the ones of the palette made from the same parameters (or loaded)
+static bool CheckNTSCPalette(struct Filter* filter, const struct FilterPaletteCase* palette_case) {
+    static struct Palette palette;
+    static uint16_t palette_indices[FILTER_FLAT_WIDTH];
+    static uint32_t filtered[FILTER_FLAT_WIDTH * 2 * 2];
+
+    if (palette_case->loaded) {
+        PaletteInit(&palette);
+    } else {
+        PaletteGenerate(&palette, &palette_case->parameters);
+    }
+    FilterSetPalette(filter, &palette_case->parameters, palette_case->loaded ? &palette : NULL);
+    FilterSet(filter, FILTER_NTSC, 2);
+    FilterKernelsSelect(FILTER_KERNELS_SCALAR);
+
+    for (uint16_t palette_index = 0; palette_index < PALETTE_INDEX_COUNT; palette_index++) {
+        for (uint8_t x = 0; x < FILTER_FLAT_WIDTH; x++) {
+            palette_indices[x] = palette_index;
+        }
+        FilterApplyPaletteIndices(filter, palette_indices, FILTER_FLAT_WIDTH, 1, (uint8_t*)filtered, FILTER_FLAT_WIDTH * 2 * sizeof(uint32_t));
+
+        uint32_t color = filtered[FILTER_FLAT_WIDTH];
+        if (!Near(color, palette.colors_rgba[palette_index])) {
+            LOG(
+                INFO, MAIN, "ntsc (%s) decodes palette index 0x%03X to 0x%08X instead of 0x%08X\n",
+                palette_case->name, palette_index, color, palette.colors_rgba[palette_index]
+            );
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool CheckNTSCKernelSet(struct Filter* filter, const enum FilterKernelSet kernel_set) {
+    static struct Palette palette;
+    static uint16_t palette_indices[FILTER_MAX_WIDTH * FILTER_MAX_HEIGHT];
+    static uint32_t expected[FILTER_MAX_WIDTH * 2 * FILTER_MAX_HEIGHT * 2];
+    static uint32_t filtered[FILTER_MAX_WIDTH * 2 * FILTER_MAX_HEIGHT * 2];
+
+    PaletteInit(&palette);
+    FilterSet(filter, FILTER_NTSC, 2);
+
+    random_state = FILTER_SEED;
+    for (uint8_t i = 0; i < sizeof(palette_cases) / sizeof(palette_cases[0]); i++) {
+        const struct FilterPaletteCase* palette_case = &palette_cases[i];
+        FilterSetPalette(filter, &palette_case->parameters, palette_case->loaded ? &palette : NULL);
+
+        for (uint8_t size = 0; size < sizeof(frame_sizes) / sizeof(frame_sizes[0]); size++) {
+            uint16_t width = frame_sizes[size][0];
+            uint16_t height = frame_sizes[size][1];
+            int pitch = width * 2 * sizeof(uint32_t);
+
+            for (uint32_t frame = 0; frame < FILTER_FRAMES; frame++) {
+                RandomPaletteIndices(palette_indices, (uint32_t)width * height, frame);
+
+                // every frame moves the phase on, both kernels have to start from the same one
+                uint8_t frame_phase = filter->ntsc->frame_phase;
+                FilterKernelsSelect(FILTER_KERNELS_SCALAR);
+                FilterApplyPaletteIndices(filter, palette_indices, width, height, (uint8_t*)expected, pitch);
+                filter->ntsc->frame_phase = frame_phase;
+                FilterKernelsSelect(kernel_set);
+                FilterApplyPaletteIndices(filter, palette_indices, width, height, (uint8_t*)filtered, pitch);
+
+                if (memcmp(expected, filtered, (size_t)pitch * height * 2) != 0) {
+                    uint32_t first = 0;
+                    while (expected[first] == filtered[first]) {
+                        first++;
+                    }
+                    LOG(
+                        INFO, MAIN, "%s ntsc (%s) differs from scalar on a %ux%u frame at %u, %u: 0x%08X instead of 0x%08X\n",
+                        kernel_set_names[kernel_set], palette_case->name, width, height, first % (width * 2), first / (width * 2), filtered[first], expected[first]
+                    );
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static bool CheckKernelSet(struct Filter* filter, const enum FilterKernelSet kernel_set) {
+    static uint32_t source[FILTER_MAX_WIDTH * FILTER_MAX_HEIGHT];
+    static uint32_t expected[FILTER_MAX_WIDTH * FILTER_MAX_SCALE * FILTER_MAX_HEIGHT * FILTER_MAX_SCALE];
+    static uint32_t filtered[FILTER_MAX_WIDTH * FILTER_MAX_SCALE * FILTER_MAX_HEIGHT * FILTER_MAX_SCALE];
+
+    random_state = FILTER_SEED;
+    for (uint8_t size = 0; size < sizeof(frame_sizes) / sizeof(frame_sizes[0]); size++) {
+        uint16_t width = frame_sizes[size][0];
+        uint16_t height = frame_sizes[size][1];
+
+        for (uint32_t frame = 0; frame < FILTER_FRAMES; frame++) {
+            RandomFrame(source, (uint32_t)width * height, frame);
+
+            for (uint8_t i = 0; i < sizeof(filter_cases) / sizeof(filter_cases[0]); i++) {
+                const struct FilterCase* filter_case = &filter_cases[i];
+                int pitch = width * filter_case->scale * sizeof(uint32_t);
+                size_t size_bytes = (size_t)pitch * height * filter_case->scale;
+                FilterSet(filter, filter_case->kind, filter_case->scale);
+
+                FilterKernelsSelect(FILTER_KERNELS_SCALAR);
+                FilterApply(filter, source, width, height, (uint8_t*)expected, pitch);
+                FilterKernelsSelect(kernel_set);
+                FilterApply(filter, source, width, height, (uint8_t*)filtered, pitch);
+
+                if (memcmp(expected, filtered, size_bytes) != 0) {
+                    uint32_t first = 0;
+                    while (expected[first] == filtered[first]) {
+                        first++;
+                    }
+                    uint32_t output_width = (uint32_t)width * filter_case->scale;
+                    LOG(
+                        INFO, MAIN, "%s %s differs from scalar on a %ux%u frame at %u, %u: 0x%08X instead of 0x%08X\n",
+                        kernel_set_names[kernel_set], filter_case->name, width, height, first % output_width, first / output_width, filtered[first], expected[first]
+                    );
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+int main(void) {
+    static struct Filter filter;
+    FilterInit(&filter, 1);
+
+    bool passed = true;
+    if (!FilterKernelsSelect(FILTER_KERNELS_SSE2)) {
+        LOG(INFO, MAIN, "sse2 kernels aren't supported here, skipped\n");
+    } else if (CheckKernelSet(&filter, FILTER_KERNELS_SSE2)) {
+        LOG(INFO, MAIN, "sse2 kernels match the scalar kernels\n");
+    } else {
+        passed = false;
+    }
+
+    // only ntsc has avx kernels
+    for (enum FilterKernelSet kernel_set = FILTER_KERNELS_SSE2; kernel_set <= FILTER_KERNELS_AVX; kernel_set++) {
+        if (!FilterKernelsSelect(kernel_set)) {
+            LOG(INFO, MAIN, "%s kernels aren't supported here, skipped\n", kernel_set_names[kernel_set]);
+        } else if (CheckNTSCKernelSet(&filter, kernel_set)) {
+            LOG(INFO, MAIN, "%s ntsc kernel matches the scalar kernel\n", kernel_set_names[kernel_set]);
+        } else {
+            passed = false;
+        }
+    }
+
+    for (uint8_t i = 0; i < sizeof(palette_cases) / sizeof(palette_cases[0]); i++) {
+        if (CheckNTSCPalette(&filter, &palette_cases[i])) {
+            LOG(INFO, MAIN, "ntsc flat colors match the palette (%s)\n", palette_cases[i].name);
+        } else {
+            passed = false;
+        }
+    }
+
+    FilterClean(&filter);
+    return passed ? 0 : 1;
+}
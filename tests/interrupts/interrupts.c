@@ -0,0 +1,190 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "emulator.h"
+#include "logger.h"
+
+
+// the test writes a small MMC3 rom (2 * 16KB prg, 8KB chr) and runs it: the reset code sets up the irq counter
+// and waits in a loop, the irq handler counts the irqs in TEST_IRQ_COUNT_ADDRESS, acknowledges and reenables them
+#define TEST_PRG_ROM_SIZE 0x8000
+#define TEST_CHR_ROM_SIZE 0x2000
+#define TEST_PRG_ROM_START 0x8000
+#define TEST_RESET_ADDRESS 0xE000
+#define TEST_IRQ_ADDRESS 0xE040
+#define TEST_NMI_ADDRESS 0xE050
+#define TEST_IRQ_COUNT_ADDRESS 0x0010
+
+// with a latch of 16 the counter reaches 0 every 17 scanlines, 14 times in the 241 clocks of the first frame
+#define TEST_IRQ_LATCH 16
+#define TEST_FIRST_FRAME_IRQS 14
+
+#define CHECK(condition) Check(condition, #condition, __LINE__)
+
+
+static uint32_t failures = 0;
+
+static void Check(bool condition, const char* text, int line) {
+    if (!condition) {
+        LOG(INFO, MAIN, "check failed (line %d): %s\n", line, text);
+        failures++;
+    }
+}
+
+static void WriteTestROM(const char* filename) {
+    static uint8_t prg_rom[TEST_PRG_ROM_SIZE];
+    static uint8_t chr_rom[TEST_CHR_ROM_SIZE];
+    memset(prg_rom, 0xFF, sizeof(prg_rom));
+    for (uint32_t i = 0; i < TEST_CHR_ROM_SIZE; i++) {
+        chr_rom[i] = (uint8_t)(i * 37);
+    }
+
+    const uint8_t reset[] = {
+        0x78,                   // sei
+        0xA2, 0xFF, 0x9A,       // ldx #$FF, txs
+        0xA9, 0x40,             // lda #$40
+        0x8D, 0x17, 0x40,       // sta $4017 (no apu frame irq)
+        0xA9, 0x08,             // lda #$08
+        0x8D, 0x00, 0x20,       // sta $2000 (sprites at 0x1000)
+        0xA9, 0x18,             // lda #$18
+        0x8D, 0x01, 0x20,       // sta $2001 (rendering on)
+        0xA9, TEST_IRQ_LATCH,   // lda #latch
+        0x8D, 0x00, 0xC0,       // sta $C000 (latch)
+        0x8D, 0x01, 0xC0,       // sta $C001 (reload)
+        0x8D, 0x01, 0xE0,       // sta $E001 (enable)
+        0x58,                   // cli
+        0x4C, 0x1F, 0xE0,       // jmp $E01F (this instruction)
+    };
+    const uint8_t irq[] = {
+        0xE6, TEST_IRQ_COUNT_ADDRESS,   // inc count
+        0x8D, 0x00, 0xE0,               // sta $E000 (acknowledge)
+        0x8D, 0x01, 0xE0,               // sta $E001 (enable)
+        0x40,                           // rti
+    };
+    memcpy(&prg_rom[TEST_RESET_ADDRESS - TEST_PRG_ROM_START], reset, sizeof(reset));
+    memcpy(&prg_rom[TEST_IRQ_ADDRESS - TEST_PRG_ROM_START], irq, sizeof(irq));
+    prg_rom[TEST_NMI_ADDRESS - TEST_PRG_ROM_START] = 0x40;   // rti
+
+    const uint16_t vectors[3] = { TEST_NMI_ADDRESS, TEST_RESET_ADDRESS, TEST_IRQ_ADDRESS };
+    for (uint8_t i = 0; i < 3; i++) {
+        prg_rom[NON_MASKABLE_INTERRUPT_OFFSET - TEST_PRG_ROM_START + i * 2] = vectors[i] & 0xFF;
+        prg_rom[NON_MASKABLE_INTERRUPT_OFFSET - TEST_PRG_ROM_START + i * 2 + 1] = vectors[i] >> 8;
+    }
+
+    // iNES header: 2 prg units, 1 chr unit, mapper 4
+    const uint8_t header[16] = { 'N', 'E', 'S', 0x1A, 2, 1, 0x40, 0x00 };
+
+    FILE* file = fopen(filename, "wb");
+    if (file == NULL) {
+        LOG(ERROR, MAIN, "failed to write the test rom: %s\n", filename);
+    }
+    fwrite(header, 1, sizeof(header), file);
+    fwrite(prg_rom, 1, sizeof(prg_rom), file);
+    fwrite(chr_rom, 1, sizeof(chr_rom), file);
+    fclose(file);
+}
+
+
+static void TestIRQLine(struct Emulator* emulator) {
+    struct Cartridge* cartridge = &emulator->cartridge;
+
+    CartridgeWriteCPU(cartridge, 0xC000, 3);
+    CartridgeWriteCPU(cartridge, 0xC001, 0);
+    CartridgeWriteCPU(cartridge, 0xE001, 0);
+    CHECK(!cartridge->irq);
+
+    // the first clock reloads the counter, it reaches 0 on the 4th
+    for (uint8_t i = 0; i < 3; i++) {
+        CartridgeScanlineIRQ(cartridge);
+        CHECK(!cartridge->irq);
+    }
+    CartridgeScanlineIRQ(cartridge);
+    CHECK(cartridge->irq);
+
+    // the line stays asserted until 0xE000 acknowledges it
+    CartridgeScanlineIRQ(cartridge);
+    CHECK(cartridge->irq);
+    CartridgeWriteCPU(cartridge, 0xE000, 0);
+    CHECK(!cartridge->irq);
+
+    // a disabled counter still counts but doesn't assert the line
+    for (uint8_t i = 0; i < 8; i++) {
+        CartridgeScanlineIRQ(cartridge);
+        CHECK(!cartridge->irq);
+    }
+}
+
+static void TestScanlineIRQCycle(struct Emulator* emulator) {
+    struct PPU* ppu = &emulator->ppu;
+
+    PPUWriteCtrl(ppu, SPRITE_PATTERN_TABLE_ADDRESS_BIT);
+    CHECK(ppu->scanline_irq_cycle == SCANLINE_SPRITE_FETCH_IRQ_CYCLE);
+    PPUWriteCtrl(ppu, SPRITE_SIZE_BIT);
+    CHECK(ppu->scanline_irq_cycle == SCANLINE_SPRITE_FETCH_IRQ_CYCLE);
+    PPUWriteCtrl(ppu, BACKGROUND_PATTERN_TABLE_ADDRESS_BIT);
+    CHECK(ppu->scanline_irq_cycle == SCANLINE_BACKGROUND_FETCH_IRQ_CYCLE);
+    PPUWriteCtrl(ppu, 0);
+    CHECK(ppu->scanline_irq_cycle == SCANLINE_NO_IRQ_CYCLE);
+    PPUWriteCtrl(ppu, SPRITE_PATTERN_TABLE_ADDRESS_BIT | BACKGROUND_PATTERN_TABLE_ADDRESS_BIT);
+    CHECK(ppu->scanline_irq_cycle == SCANLINE_NO_IRQ_CYCLE);
+}
+
+static void TestPushedStatusFlags(struct Emulator* emulator, bool non_maskable) {
+    struct CPU* cpu = &emulator->cpu;
+
+    cpu->registers.status_flags = UNUSED | CARRY;
+    cpu->registers.stack_pointer = STACK_POINTER_OFFSET;
+    if (non_maskable) {
+        CPUNonMaskableInterrupt(cpu);
+        CHECK(cpu->registers.program_counter == TEST_NMI_ADDRESS);
+    } else {
+        CPUInterruptRequest(cpu);
+        CHECK(cpu->registers.program_counter == TEST_IRQ_ADDRESS);
+    }
+
+    // RTI has to bring back the flags from before the interrupt, with irqs still enabled
+    uint8_t pushed_status_flags = CPUBusRead(cpu->cpu_bus, STACK_OFFSET + STACK_POINTER_OFFSET - 2);
+    CHECK(pushed_status_flags == (UNUSED | CARRY));
+    CHECK(cpu->registers.status_flags & IRQ_DISABLE);
+    CHECK(cpu->registers.stack_pointer == STACK_POINTER_OFFSET - 3);
+}
+
+static void TestIRQHandler(const char* filename) {
+    static struct Emulator emulator;
+    static uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT];
+    EmulatorInit(&emulator, filename);
+
+    EmulatorRender(&emulator, pixels_buffer);
+    uint8_t irq_count = CPUBusRead(&emulator.cpu_bus, TEST_IRQ_COUNT_ADDRESS);
+    if (irq_count != TEST_FIRST_FRAME_IRQS) {
+        LOG(INFO, MAIN, "%u irqs were handled in the first frame, expected %u\n", irq_count, TEST_FIRST_FRAME_IRQS);
+    }
+    CHECK(irq_count == TEST_FIRST_FRAME_IRQS);
+
+    EmulatorClean(&emulator);
+}
+
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        LOG(ERROR, MAIN, "usage: %s test_rom.nes  (the rom is written there)\n", argv[0]);
+    }
+    WriteTestROM(argv[1]);
+
+    TestIRQHandler(argv[1]);
+
+    static struct Emulator emulator;
+    EmulatorInit(&emulator, argv[1]);
+    TestIRQLine(&emulator);
+    TestScanlineIRQCycle(&emulator);
+    TestPushedStatusFlags(&emulator, false);
+    TestPushedStatusFlags(&emulator, true);
+    EmulatorClean(&emulator);
+
+    if (failures != 0) {
+        LOG(INFO, MAIN, "%u interrupt checks failed\n", failures);
+        return 1;
+    }
+    LOG(INFO, MAIN, "interrupt checks passed\n");
+    return 0;
+}
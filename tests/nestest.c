@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "emulator.h"
+#include "logger.h"
+
+
+// nestest.nes in automation mode: execution starts at 0xC000 instead of the reset vector
+// and the results of the official opcode tests are written to 0x0002 (0x00 means every test passed)
+#define NESTEST_START_ADDRESS 0xC000
+#define NESTEST_START_STATUS_FLAGS 0x24
+#define NESTEST_START_STACK_POINTER 0xFD
+#define NESTEST_START_CYCLE 7
+#define NESTEST_RESULT_ADDRESS 0x0002
+
+#define TRACE_LINE_LENGTH 128
+#define TRACE_DISASSEMBLY_LENGTH 48
+
+
+struct NestestTrace {
+    FILE* golden_log;
+    uint32_t line_number;
+};
+
+
+static void Finish(struct CPU* cpu, struct NestestTrace* trace, int exit_code) {
+    uint8_t result = CPUBusRead(cpu->cpu_bus, NESTEST_RESULT_ADDRESS);
+    if (exit_code == 0 && result != 0x00) {
+        LOG(INFO, MAIN, "nestest reported failure code 0x%02X\n", result);
+        exit_code = 1;
+    }
+
+    if (trace->golden_log != NULL) {
+        if (exit_code == 0) {
+            LOG(INFO, MAIN, "nestest trace matched %u lines\n", trace->line_number);
+        }
+        fclose(trace->golden_log);
+    }
+
+    // the cpu can't be stopped mid frame and it would run into the unofficial opcodes (not supported) right after this
+    exit(exit_code);
+}
+
+static void StripLineEnding(char* line) {
+    size_t length = strlen(line);
+    while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) {
+        line[--length] = '\0';
+    }
+}
+
+static void TraceInstruction(struct CPU* cpu, void* trace_hook_data) {
+    struct NestestTrace* trace = (struct NestestTrace*)trace_hook_data;
+
+    uint16_t program_counter = cpu->registers.program_counter;
+
+    char disassembly[TRACE_DISASSEMBLY_LENGTH];
+    uint8_t length = CPUDisassembleInstruction(cpu, program_counter, disassembly, sizeof(disassembly));
+
+    if (strncmp(disassembly, "???", 3) == 0) {
+        // first unofficial opcode, the official part of nestest is over
+        char golden_line[TRACE_LINE_LENGTH];
+        if (trace->golden_log != NULL && fgets(golden_line, sizeof(golden_line), trace->golden_log) != NULL) {
+            LOG(INFO, MAIN, "trace ended at line %u but the golden log continues:\n%s", trace->line_number + 1, golden_line);
+            Finish(cpu, trace, 1);
+        }
+        Finish(cpu, trace, 0);
+    }
+
+    char bytes[9] = { 0 };
+    int bytes_length = 0;
+    for (uint8_t i = 0; i < length; i++) {
+        bytes_length += snprintf(&bytes[bytes_length], sizeof(bytes) - bytes_length, (i == 0) ? "%02X" : " %02X", CPUBusRead(cpu->cpu_bus, program_counter + i));
+    }
+
+    char line[TRACE_LINE_LENGTH];
+    snprintf(
+        line, sizeof(line), "%04X  %-8s  %-31s A:%02X X:%02X Y:%02X P:%02X SP:%02X PPU:%3d,%3d CYC:%llu",
+        program_counter, bytes, disassembly,
+        cpu->registers.a_register, cpu->registers.x_register, cpu->registers.y_register,
+        cpu->registers.status_flags, cpu->registers.stack_pointer,
+        cpu->cpu_bus->ppu->scanline, cpu->cpu_bus->ppu->cycle, (unsigned long long)cpu->tick_counter
+    );
+
+    trace->line_number++;
+
+    if (trace->golden_log == NULL) {
+        printf("%s\n", line);
+        return;
+    }
+
+    char golden_line[TRACE_LINE_LENGTH];
+    if (fgets(golden_line, sizeof(golden_line), trace->golden_log) == NULL) {
+        Finish(cpu, trace, 0);
+    }
+    StripLineEnding(golden_line);
+
+    if (strcmp(line, golden_line) != 0) {
+        LOG(INFO, MAIN, "trace diverged at line %u\nexpected: %s\nactual:   %s\n", trace->line_number, golden_line, line);
+        Finish(cpu, trace, 1);
+    }
+}
+
+
+int main(int argc, char** argv) {
+    if (argc != 2 && argc != 3) {
+        LOG(ERROR, MAIN, "usage: %s nestest.nes [nestest.log]  (without a golden log the trace is printed to stdout)\n", argv[0]);
+    }
+
+    struct NestestTrace trace = {
+        .golden_log = NULL,
+        .line_number = 0,
+    };
+
+    if (argc == 3) {
+        trace.golden_log = fopen(argv[2], "r");
+        if (trace.golden_log == NULL) {
+            LOG(ERROR, MAIN, "Failed to open golden log: %s\n", argv[2]);
+        }
+    }
+
+    static struct Emulator emulator;
+    EmulatorInit(&emulator, argv[1]);
+
+    emulator.cpu.registers.program_counter = NESTEST_START_ADDRESS;
+    emulator.cpu.registers.status_flags = NESTEST_START_STATUS_FLAGS;
+    emulator.cpu.registers.stack_pointer = NESTEST_START_STACK_POINTER;
+    emulator.cpu.tick_counter = NESTEST_START_CYCLE;
+
+    // the reference log starts at dot 21 of scanline 0 and the ppu is clocked 3 times before the first cpu cycle
+    emulator.ppu.render_state = RENDER;
+    emulator.ppu.scanline = 0;
+    emulator.ppu.cycle = NESTEST_START_CYCLE * 3 - 3;
+
+    CPUSetTraceHook(&emulator.cpu, &TraceInstruction, &trace);
+
+    static uint32_t pixels_buffer[NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT];
+    while (true) {
+        EmulatorRender(&emulator, pixels_buffer);
+    }
+}
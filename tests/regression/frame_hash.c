@@ -0,0 +1,99 @@
+#include <string.h>
+
+#include "frame_hash.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define FRAME_HASH_X86_64
+#endif
+
+
+#define CRC32C_POLYNOMIAL 0x82F63B78   // reflected
+#define CRC32C_SEED 0xFFFFFFFF
+
+typedef uint64_t (*FrameHashKernel)(const uint8_t* data, const size_t size);
+
+
+static uint32_t crc32c_table[256];
+static FrameHashKernel frame_hash_kernel = NULL;
+
+
+static inline uint64_t ReadWord(const uint8_t* data) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+// the crc32 instruction takes the bytes of the word from the lowest one up, so this does the same
+static inline uint32_t CRC32CWordScalar(uint32_t crc, const uint64_t word) {
+    for (uint8_t byte = 0; byte < 8; byte++) {
+        crc = crc32c_table[(crc ^ (uint32_t)(word >> (byte * 8))) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static inline uint32_t CRC32CByteScalar(const uint32_t crc, const uint8_t byte) {
+    return crc32c_table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+}
+
+static uint64_t FrameHashScalar(const uint8_t* data, const size_t size) {
+    uint32_t crc_even = CRC32C_SEED;
+    uint32_t crc_odd = CRC32C_SEED;
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        crc_even = CRC32CWordScalar(crc_even, ReadWord(&data[i]));
+        crc_odd = CRC32CWordScalar(crc_odd, ReadWord(&data[i + 8]));
+    }
+    for (; i < size; i++) {
+        crc_even = CRC32CByteScalar(crc_even, data[i]);
+    }
+
+    return ((uint64_t)~crc_even << 32) | (uint64_t)~crc_odd;
+}
+
+#ifdef FRAME_HASH_X86_64
+
+// 2 independent crcs hide the 3 cycle latency of the instruction
+__attribute__((target("sse4.2")))
+static uint64_t FrameHashSSE42(const uint8_t* data, const size_t size) {
+    uint64_t crc_even = CRC32C_SEED;
+    uint64_t crc_odd = CRC32C_SEED;
+
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        crc_even = _mm_crc32_u64(crc_even, ReadWord(&data[i]));
+        crc_odd = _mm_crc32_u64(crc_odd, ReadWord(&data[i + 8]));
+    }
+    for (; i < size; i++) {
+        crc_even = _mm_crc32_u8((uint32_t)crc_even, data[i]);
+    }
+
+    return ((uint64_t)~(uint32_t)crc_even << 32) | (uint64_t)~(uint32_t)crc_odd;
+}
+
+#endif
+
+
+void FrameHashInit(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? ((crc >> 1) ^ CRC32C_POLYNOMIAL) : (crc >> 1);
+        }
+        crc32c_table[i] = crc;
+    }
+
+    frame_hash_kernel = &FrameHashScalar;
+
+#ifdef FRAME_HASH_X86_64
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        frame_hash_kernel = &FrameHashSSE42;
+    }
+#endif
+}
+
+uint64_t FrameHash(const void* data, const size_t size) {
+    return frame_hash_kernel((const uint8_t*)data, size);
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#ifndef FRAME_HASH_H
+#define FRAME_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+// picks the sse4.2 crc32 instruction when the cpu has it, safe to call more than once
+void FrameHashInit(void);
+
+// crc32c of the even and the odd 8 byte words combined into 64 bits,
+// the scalar fallback gives the same result so the manifests work on every machine
+uint64_t FrameHash(const void* data, const size_t size);
+
+#endif
\ No newline at end of file
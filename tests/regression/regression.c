@@ -0,0 +1,491 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <threads.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "emulator.h"
+#include "frame_hash.h"
+#include "screenshot.h"
+#include "logger.h"
+
+
+// every line of the manifest is either empty, a # comment or a rom:
+//   rom.nes movie|- frame:hash frame:hash ...
+// paths are relative to the manifest, a checkpoint without a hash (or with -) is only recorded by --update
+#define MANIFEST_MAX_LINES 1024
+#define MANIFEST_LINE_LENGTH 2048
+#define REGRESSION_MAX_CHECKPOINTS 64
+#define REGRESSION_MAX_THREADS 64
+#define REGRESSION_PATH_LENGTH 512
+#define REGRESSION_ERROR_LENGTH (REGRESSION_PATH_LENGTH + 64)
+
+// every line of a movie is "frame buttons_1 [buttons_2]" with the buttons as a hex mask of enum Button,
+// the buttons are held from the start of that frame until the next line
+#define MOVIE_MAX_INPUTS 8192
+
+#define NO_HASH 0
+
+
+struct Checkpoint {
+    uint32_t frame;
+    uint64_t expected_hash;
+    uint64_t hash;
+};
+
+struct MovieInput {
+    uint32_t frame;
+    uint8_t buttons_1;
+    uint8_t buttons_2;
+};
+
+struct RegressionJob {
+    uint32_t line_index;
+
+    // as written in the manifest (for --update) and resolved against its directory
+    char rom_token[REGRESSION_PATH_LENGTH];
+    char movie_token[REGRESSION_PATH_LENGTH];
+    char rom_filename[REGRESSION_PATH_LENGTH];
+    char movie_filename[REGRESSION_PATH_LENGTH];
+
+    struct Checkpoint checkpoints[REGRESSION_MAX_CHECKPOINTS];
+    uint8_t checkpoint_count;
+
+    bool passed;
+    double milliseconds;
+    char error[REGRESSION_ERROR_LENGTH];
+};
+
+struct Regression {
+    struct RegressionJob* jobs;
+    uint32_t job_count;
+    // the workers take the jobs in manifest order
+    atomic_uint next_job;
+
+    // every checkpoint is also saved as <directory>/<rom>_<manifest line>_<frame>.png when set
+    const char* screenshot_directory;
+    struct Screenshot* screenshot;
+};
+
+
+static double Milliseconds(void) {
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return (double)time.tv_sec * 1000.0 + (double)time.tv_nsec / 1000000.0;
+}
+
+static uint32_t CPUCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (uint32_t)count : 1;
+#endif
+}
+
+static void ResolvePath(const char* manifest_filename, const char* token, char path[REGRESSION_PATH_LENGTH]) {
+    const char* slash = strrchr(manifest_filename, '/');
+    const char* backslash = strrchr(manifest_filename, '\\');
+    if (backslash != NULL && (slash == NULL || backslash > slash)) {
+        slash = backslash;
+    }
+
+    bool absolute = (token[0] == '/' || token[0] == '\\' || (token[0] != '\0' && token[1] == ':'));
+    if (absolute || slash == NULL) {
+        snprintf(path, REGRESSION_PATH_LENGTH, "%s", token);
+    } else {
+        snprintf(path, REGRESSION_PATH_LENGTH, "%.*s%s", (int)(slash - manifest_filename + 1), manifest_filename, token);
+    }
+}
+
+
+static bool ParseJob(const char* manifest_filename, const char* line, const uint32_t line_index, struct RegressionJob* job) {
+    memset(job, 0, sizeof(struct RegressionJob));
+    job->line_index = line_index;
+
+    int offset = 0;
+    int length = 0;
+    if (sscanf(line, " %511s %511s%n", job->rom_token, job->movie_token, &length) != 2) {
+        return false;
+    }
+    offset += length;
+
+    ResolvePath(manifest_filename, job->rom_token, job->rom_filename);
+    if (strcmp(job->movie_token, "-") != 0) {
+        ResolvePath(manifest_filename, job->movie_token, job->movie_filename);
+    }
+
+    char checkpoint[64];
+    while (sscanf(&line[offset], " %63s%n", checkpoint, &length) == 1) {
+        offset += length;
+
+        if (job->checkpoint_count == REGRESSION_MAX_CHECKPOINTS) {
+            return false;
+        }
+        struct Checkpoint* current = &job->checkpoints[job->checkpoint_count];
+
+        char* end = NULL;
+        current->frame = (uint32_t)strtoul(checkpoint, &end, 10);
+        current->expected_hash = NO_HASH;
+        if (end == checkpoint || current->frame == 0) {
+            return false;
+        }
+        if (*end == ':' && strcmp(end + 1, "-") != 0) {
+            current->expected_hash = strtoull(end + 1, &end, 16);
+        } else if (*end == ':') {
+            end += 2;
+        }
+        if (*end != '\0') {
+            return false;
+        }
+        // the frames are played once, so the checkpoints have to be in order
+        if (job->checkpoint_count > 0 && current->frame <= job->checkpoints[job->checkpoint_count - 1].frame) {
+            return false;
+        }
+        job->checkpoint_count++;
+    }
+
+    return job->checkpoint_count > 0;
+}
+
+static bool LoadMovie(struct RegressionJob* job, struct MovieInput* inputs, uint32_t* input_count) {
+    *input_count = 0;
+    if (job->movie_filename[0] == '\0') {
+        return true;
+    }
+
+    FILE* movie = fopen(job->movie_filename, "r");
+    if (movie == NULL) {
+        snprintf(job->error, REGRESSION_ERROR_LENGTH, "failed to open the movie %s", job->movie_filename);
+        return false;
+    }
+
+    char line[128];
+    uint32_t line_number = 0;
+    while (fgets(line, sizeof(line), movie) != NULL) {
+        line_number++;
+        char first = '\0';
+        if (sscanf(line, " %c", &first) != 1 || first == '#') {
+            continue;
+        }
+
+        unsigned int frame = 0;
+        unsigned int buttons_1 = 0;
+        unsigned int buttons_2 = 0;
+        int fields = sscanf(line, "%u %x %x", &frame, &buttons_1, &buttons_2);
+        if (fields < 2 || buttons_1 > 0xFF || buttons_2 > 0xFF || *input_count == MOVIE_MAX_INPUTS
+            || (*input_count > 0 && frame < inputs[*input_count - 1].frame)) {
+            snprintf(job->error, REGRESSION_ERROR_LENGTH, "invalid movie line %u in %s", line_number, job->movie_filename);
+            fclose(movie);
+            return false;
+        }
+
+        inputs[(*input_count)++] = (struct MovieInput){
+            .frame = frame,
+            .buttons_1 = (uint8_t)buttons_1,
+            .buttons_2 = (uint8_t)buttons_2,
+        };
+    }
+    fclose(movie);
+    return true;
+}
+
+static void PressButtons(struct Emulator* emulator, const uint8_t held, const uint8_t buttons, const enum Player player) {
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        uint8_t button = 1 << bit;
+        if ((held ^ buttons) & button) {
+            if (buttons & button) {
+                EmulatorKeyDown(emulator, (enum Button)button, player);
+            } else {
+                EmulatorKeyUp(emulator, (enum Button)button, player);
+            }
+        }
+    }
+}
+
+static void SaveCheckpoint(const struct Regression* regression, const struct RegressionJob* job, const uint32_t frame, const uint16_t* palette_indices) {
+    const char* name = job->rom_token;
+    for (const char* c = job->rom_token; *c != '\0'; c++) {
+        if (*c == '/' || *c == '\\') {
+            name = c + 1;
+        }
+    }
+    const char* extension = strrchr(name, '.');
+    int name_length = (extension != NULL) ? (int)(extension - name) : (int)strlen(name);
+
+    char filename[SCREENSHOT_FILENAME_LENGTH];
+    snprintf(filename, sizeof(filename), "%s/%.*s_%u_%u.png", regression->screenshot_directory, name_length, name, job->line_index + 1, frame);
+    // a batch run would rather wait for the encoder than lose a screenshot
+    ScreenshotTake(regression->screenshot, palette_indices, filename, true);
+}
+
+static void RunJob(const struct Regression* regression, struct RegressionJob* job, struct Emulator* emulator, struct MovieInput* inputs, uint16_t* palette_indices) {
+    double start = Milliseconds();
+
+    // the cartridge errors are fatal, so at least a missing rom only fails its own line
+    FILE* rom = fopen(job->rom_filename, "rb");
+    if (rom == NULL) {
+        snprintf(job->error, REGRESSION_ERROR_LENGTH, "failed to open the rom %s", job->rom_filename);
+        return;
+    }
+    fclose(rom);
+
+    uint32_t input_count = 0;
+    if (!LoadMovie(job, inputs, &input_count)) {
+        return;
+    }
+
+    EmulatorInit(emulator, job->rom_filename);
+
+    uint32_t next_input = 0;
+    uint8_t held_1 = 0;
+    uint8_t held_2 = 0;
+    uint8_t checkpoint = 0;
+    uint32_t last_frame = job->checkpoints[job->checkpoint_count - 1].frame;
+
+    for (uint32_t frame = 1; frame <= last_frame; frame++) {
+        while (next_input < input_count && inputs[next_input].frame <= frame) {
+            PressButtons(emulator, held_1, inputs[next_input].buttons_1, PLAYER_1);
+            PressButtons(emulator, held_2, inputs[next_input].buttons_2, PLAYER_2);
+            held_1 = inputs[next_input].buttons_1;
+            held_2 = inputs[next_input].buttons_2;
+            next_input++;
+        }
+
+        // the palette indices don't depend on the palette, so the hashes stay valid when it changes
+        EmulatorRenderPaletteIndices(emulator, palette_indices);
+
+        if (frame == job->checkpoints[checkpoint].frame) {
+            job->checkpoints[checkpoint].hash = FrameHash(palette_indices, NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT * sizeof(uint16_t));
+            checkpoint++;
+            if (regression->screenshot != NULL) {
+                SaveCheckpoint(regression, job, frame, palette_indices);
+            }
+        }
+    }
+
+    EmulatorClean(emulator);
+
+    job->passed = true;
+    for (uint8_t i = 0; i < job->checkpoint_count; i++) {
+        if (job->checkpoints[i].hash != job->checkpoints[i].expected_hash) {
+            job->passed = false;
+        }
+    }
+    job->milliseconds = Milliseconds() - start;
+}
+
+static int Worker(void* data) {
+    struct Regression* regression = (struct Regression*)data;
+
+    struct Emulator* emulator = (struct Emulator*)malloc(sizeof(struct Emulator));
+    struct MovieInput* inputs = (struct MovieInput*)malloc(MOVIE_MAX_INPUTS * sizeof(struct MovieInput));
+    uint16_t* palette_indices = (uint16_t*)malloc(NES_SCREEN_WIDTH * NES_SCREEN_HEIGHT * sizeof(uint16_t));
+    if (emulator == NULL || inputs == NULL || palette_indices == NULL) {
+        LOG(ERROR, MAIN, "failed to allocate a worker\n");
+    }
+
+    while (true) {
+        uint32_t job_index = atomic_fetch_add(&regression->next_job, 1);
+        if (job_index >= regression->job_count) {
+            break;
+        }
+        RunJob(regression, &regression->jobs[job_index], emulator, inputs, palette_indices);
+    }
+
+    free(palette_indices);
+    free(inputs);
+    free(emulator);
+    return 0;
+}
+
+
+static void WriteManifest(const char* manifest_filename, char** lines, const uint32_t line_count, const struct Regression* regression) {
+    FILE* manifest = fopen(manifest_filename, "w");
+    if (manifest == NULL) {
+        LOG(ERROR, MAIN, "failed to write %s\n", manifest_filename);
+    }
+
+    uint32_t job_index = 0;
+    for (uint32_t i = 0; i < line_count; i++) {
+        if (job_index < regression->job_count && regression->jobs[job_index].line_index == i) {
+            const struct RegressionJob* job = &regression->jobs[job_index++];
+            fprintf(manifest, "%s %s", job->rom_token, job->movie_token);
+            for (uint8_t c = 0; c < job->checkpoint_count; c++) {
+                fprintf(manifest, " %u:%016llx", job->checkpoints[c].frame, (unsigned long long)job->checkpoints[c].hash);
+            }
+            fprintf(manifest, "\n");
+        } else {
+            fprintf(manifest, "%s", lines[i]);
+        }
+    }
+    fclose(manifest);
+}
+
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        LOG(ERROR, MAIN, "usage: %s manifest.txt [--jobs N] [--update] [--screenshots directory]  (--update records the hashes instead of comparing them)\n", argv[0]);
+    }
+
+    const char* manifest_filename = argv[1];
+    uint32_t thread_count = CPUCount();
+    bool update = false;
+    const char* screenshot_directory = NULL;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--jobs") == 0 && (i + 1) < argc) {
+            thread_count = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+            i++;
+        } else if (strcmp(argv[i], "--update") == 0) {
+            update = true;
+        } else if (strcmp(argv[i], "--screenshots") == 0 && (i + 1) < argc) {
+            screenshot_directory = argv[i + 1];
+            i++;
+        } else {
+            LOG(ERROR, MAIN, "unknown option: %s\n", argv[i]);
+        }
+    }
+
+    FILE* manifest = fopen(manifest_filename, "r");
+    if (manifest == NULL) {
+        LOG(ERROR, MAIN, "failed to open the manifest %s\n", manifest_filename);
+    }
+
+    static char* lines[MANIFEST_MAX_LINES];
+    uint32_t line_count = 0;
+    static struct RegressionJob jobs[MANIFEST_MAX_LINES];
+    struct Regression regression = {
+        .jobs = jobs,
+        .job_count = 0,
+        .screenshot_directory = screenshot_directory,
+        .screenshot = NULL,
+    };
+    atomic_init(&regression.next_job, 0);
+
+    char line[MANIFEST_LINE_LENGTH];
+    while (fgets(line, sizeof(line), manifest) != NULL) {
+        if (line_count == MANIFEST_MAX_LINES) {
+            LOG(ERROR, MAIN, "the manifest has more than %u lines\n", MANIFEST_MAX_LINES);
+        }
+        lines[line_count] = strdup(line);
+
+        char first = '\0';
+        if (sscanf(line, " %c", &first) == 1 && first != '#') {
+            if (!ParseJob(manifest_filename, line, line_count, &jobs[regression.job_count])) {
+                LOG(ERROR, MAIN, "invalid manifest line %u: %s", line_count + 1, line);
+            }
+            regression.job_count++;
+        }
+        line_count++;
+    }
+    fclose(manifest);
+
+    FrameHashInit();
+
+    // the checkpoints are saved with the built in palette, the same one every emulator starts with
+    static struct Palette palette;
+    static struct Screenshot screenshot;
+    if (screenshot_directory != NULL) {
+        PaletteInit(&palette);
+        ScreenshotInit(&screenshot, &palette, NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT);
+        regression.screenshot = &screenshot;
+    }
+
+    thread_count = (thread_count > REGRESSION_MAX_THREADS) ? REGRESSION_MAX_THREADS : thread_count;
+    thread_count = (thread_count > regression.job_count) ? regression.job_count : thread_count;
+    thread_count = (thread_count == 0) ? 1 : thread_count;
+
+    double start = Milliseconds();
+
+    // the tables every emulator shares (composite kernel, band-limited steps) are built by the first EmulatorInit,
+    // so that one happens before the workers start
+    FILE* first_rom = (regression.job_count > 0) ? fopen(jobs[0].rom_filename, "rb") : NULL;
+    if (first_rom != NULL) {
+        fclose(first_rom);
+        static struct Emulator emulator;
+        EmulatorInit(&emulator, jobs[0].rom_filename);
+        EmulatorClean(&emulator);
+    }
+
+    // the main thread is one of the workers
+    thrd_t workers[REGRESSION_MAX_THREADS];
+    uint32_t started = 0;
+    for (uint32_t i = 1; i < thread_count; i++) {
+        if (thrd_create(&workers[i - 1], &Worker, &regression) != thrd_success) {
+            LOG(WARNING, MAIN, "failed to start worker %u, using %u threads\n", i, i);
+            break;
+        }
+        started++;
+    }
+    if (regression.job_count > 0) {
+        Worker(&regression);
+    }
+    for (uint32_t i = 0; i < started; i++) {
+        thrd_join(workers[i], NULL);
+    }
+
+    if (regression.screenshot != NULL) {
+        ScreenshotClean(regression.screenshot);
+    }
+
+    double wall_milliseconds = Milliseconds() - start;
+
+    uint32_t failed = 0;
+    double rom_milliseconds = 0.0;
+    for (uint32_t i = 0; i < regression.job_count; i++) {
+        const struct RegressionJob* job = &jobs[i];
+        uint32_t frames = job->checkpoints[job->checkpoint_count - 1].frame;
+        rom_milliseconds += job->milliseconds;
+
+        if (job->error[0] != '\0') {
+            printf("ERROR %s: %s\n", job->rom_token, job->error);
+            failed++;
+            continue;
+        }
+
+        printf(
+            "%s %s  %u frames in %.1f ms (%.0f fps)\n",
+            (update || job->passed) ? "PASS " : "FAIL ", job->rom_token, frames, job->milliseconds,
+            (job->milliseconds > 0.0) ? (frames * 1000.0 / job->milliseconds) : 0.0
+        );
+        if (!job->passed && !update) {
+            for (uint8_t c = 0; c < job->checkpoint_count; c++) {
+                if (job->checkpoints[c].hash != job->checkpoints[c].expected_hash) {
+                    printf(
+                        "    frame %u: expected %016llx got %016llx\n", job->checkpoints[c].frame,
+                        (unsigned long long)job->checkpoints[c].expected_hash, (unsigned long long)job->checkpoints[c].hash
+                    );
+                }
+            }
+            failed++;
+        }
+    }
+
+    printf(
+        "%u / %u roms passed, %.1f ms on %u threads (%.1f ms of emulation)\n",
+        regression.job_count - failed, regression.job_count, wall_milliseconds, thread_count, rom_milliseconds
+    );
+
+    if (update) {
+        // a rom that couldn't run would lose its hashes
+        if (failed != 0) {
+            LOG(ERROR, MAIN, "not updating %s, %u roms didn't run\n", manifest_filename, failed);
+        }
+        WriteManifest(manifest_filename, lines, line_count, &regression);
+        printf("updated %s\n", manifest_filename);
+    }
+
+    for (uint32_t i = 0; i < line_count; i++) {
+        free(lines[i]);
+    }
+    return (failed == 0) ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "triple_buffer.h"
+#include "logger.h"
+
+
+void TripleBufferInit(struct TripleBuffer* triple_buffer, const size_t buffer_size) {
+    for (uint8_t i = 0; i < 3; i++) {
+        triple_buffer->buffers[i] = malloc(buffer_size);
+        if (triple_buffer->buffers[i] == NULL) {
+            LOG(ERROR, TRIPLE_BUFFER, "failed to allocate %zu bytes\n", buffer_size);
+        }
+        memset(triple_buffer->buffers[i], 0, buffer_size);
+    }
+    triple_buffer->buffer_size = buffer_size;
+
+    triple_buffer->write_index = 0;
+    triple_buffer->read_index = 1;
+    atomic_init(&triple_buffer->middle, 2);
+}
+
+void TripleBufferClean(struct TripleBuffer* triple_buffer) {
+    for (uint8_t i = 0; i < 3; i++) {
+        free(triple_buffer->buffers[i]);
+        triple_buffer->buffers[i] = NULL;
+    }
+}
+
+void* TripleBufferWriteBuffer(struct TripleBuffer* triple_buffer) {
+    return triple_buffer->buffers[triple_buffer->write_index];
+}
+
+void TripleBufferPublish(struct TripleBuffer* triple_buffer) {
+    // release: the contents have to be visible before the consumer can take the buffer,
+    // acquire: the buffer we get back may have just been released by the consumer
+    uint8_t previous = atomic_exchange_explicit(&triple_buffer->middle, triple_buffer->write_index | TRIPLE_BUFFER_FRESH_BIT, memory_order_acq_rel);
+    triple_buffer->write_index = previous & TRIPLE_BUFFER_INDEX_BITS;
+}
+
+bool TripleBufferAcquire(struct TripleBuffer* triple_buffer) {
+    if (!(atomic_load_explicit(&triple_buffer->middle, memory_order_relaxed) & TRIPLE_BUFFER_FRESH_BIT)) {
+        return false;
+    }
+    uint8_t previous = atomic_exchange_explicit(&triple_buffer->middle, triple_buffer->read_index, memory_order_acq_rel);
+    triple_buffer->read_index = previous & TRIPLE_BUFFER_INDEX_BITS;
+    return true;
+}
+
+const void* TripleBufferReadBuffer(struct TripleBuffer* triple_buffer) {
+    return triple_buffer->buffers[triple_buffer->read_index];
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+
+// set in middle when the producer published a buffer the consumer hasn't taken yet
+#define TRIPLE_BUFFER_FRESH_BIT 0x04
+#define TRIPLE_BUFFER_INDEX_BITS 0x03
+
+
+// lock free hand over of whole buffers from one producer thread to one consumer thread:
+// both own a buffer of their own and swap it with the shared middle one, so neither ever waits for the other
+// and the consumer always gets the latest complete buffer (older ones are skipped)
+struct TripleBuffer {
+    void* buffers[3];
+    size_t buffer_size;
+
+    uint8_t write_index;   // producer only
+    uint8_t read_index;    // consumer only
+    _Atomic uint8_t middle;
+};
+
+
+void TripleBufferInit(struct TripleBuffer* triple_buffer, const size_t buffer_size);
+void TripleBufferClean(struct TripleBuffer* triple_buffer);
+
+// producer side, the buffer stays the same until it's published
+void* TripleBufferWriteBuffer(struct TripleBuffer* triple_buffer);
+void TripleBufferPublish(struct TripleBuffer* triple_buffer);
+
+// consumer side, returns true when a newer buffer was taken over, the read buffer stays valid until the next call
+bool TripleBufferAcquire(struct TripleBuffer* triple_buffer);
+const void* TripleBufferReadBuffer(struct TripleBuffer* triple_buffer);
+
+#endif
\ No newline at end of file